@@ -0,0 +1,34 @@
+// Copyright (c) 2020 Graphcore Ltd. All rights reserved.
+
+#ifndef poplibs_test_Cholesky_hpp
+#define poplibs_test_Cholesky_hpp
+
+#include <boost/multi_array.hpp>
+
+namespace poplibs_test {
+namespace cholesky {
+
+/*
+ * Computes the Cholesky factor of each of the [N, N] matrices in \p a.
+ *
+ * If lower is true the lower triangle of a is read and the lower factor L
+ * such that A = L * L' is written to factor, otherwise the upper triangle is
+ * read and the upper factor U such that A = U' * U is written. Elements
+ * outside the triangle of the factor are zero.
+ */
+void cholesky(const boost::multi_array<double, 3> &a,
+              boost::multi_array<double, 3> &factor, bool lower);
+
+/*
+ * Solves A * X = B for each of the [N, N] symmetric positive definite
+ * matrices in a and the corresponding [N, K] matrices in b using the Cholesky
+ * factor read from the lower or upper triangle of a.
+ */
+void choleskySolve(const boost::multi_array<double, 3> &a,
+                   const boost::multi_array<double, 3> &b,
+                   boost::multi_array<double, 3> &x, bool lower);
+
+} // namespace cholesky
+} // namespace poplibs_test
+
+#endif // poplibs_test_Cholesky_hpp
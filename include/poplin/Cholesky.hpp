@@ -0,0 +1,82 @@
+// Copyright (c) 2020 Graphcore Ltd. All rights reserved.
+/** \file
+ *
+ * Cholesky factorisation of symmetric positive definite matrices and solving
+ * linear equations using the factorisation.
+ *
+ */
+
+#ifndef poplin_Cholesky_hpp
+#define poplin_Cholesky_hpp
+#include <poplar/Graph.hpp>
+#include <poplar/Program.hpp>
+
+namespace poplin {
+
+namespace matmul {
+class PlanningCache;
+}
+
+/**
+ * Computes the Cholesky factor of a batch of symmetric positive definite
+ * matrices.
+ *
+ * The matrix is recursively halved down to \p blockSize and each level is
+ * factorised using triangularSolve() and a matrix multiplication to update
+ * the trailing block.
+ *
+ *  \param graph          The Poplar graph.
+ *  \param a              Tensor of floating-point type with shape [..., N,N].
+ *  \param lower          If true, only the lower triangle of \p a is read and
+ *                        the lower triangular factor L such that A = L * L^T
+ *                        is returned. Otherwise only the upper triangle of
+ *                        \p a is read and the upper triangular factor U such
+ *                        that A = U^T * U is returned.
+ *  \param blockSize      Block size for blocked factorisation.
+ *  \param prog           A reference to a program sequence which the code
+ *                        to perform the factorisation will be appended to.
+ *  \param debugContext   Optional debug information.
+ *  \param options        A structure describing options on how the
+ *                        multiplication should be implemented.
+ *                        See matMul() for details.
+ *  \param cache          Optional pointer to a planning cache to use.
+ *  \returns              A tensor with the same shape as \p a containing the
+ *                        triangular factor. Elements outside the triangle are
+ *                        zero.
+ */
+poplar::Tensor cholesky(poplar::Graph &graph, const poplar::Tensor &a,
+                        bool lower, std::size_t blockSize,
+                        poplar::program::Sequence &prog,
+                        const poplar::DebugContext &debugContext = {},
+                        poplar::OptionFlags options = {},
+                        matmul::PlanningCache *cache = nullptr);
+
+/**
+ * Solves systems of linear equations AX = B with symmetric positive definite
+ * coefficients using the Cholesky factorisation of A.
+ *
+ *  \param graph          The Poplar graph.
+ *  \param a              Tensor of floating-point type with shape [..., N,N].
+ *  \param b              Tensor of the same type with shape [..., N, K].
+ *  \param lower          Use the upper or lower triangle of \p a.
+ *  \param blockSize      Block size for blocked factorisation and solver.
+ *  \param prog           A reference to a program sequence which the code
+ *                        to perform the solve will be appended to.
+ *  \param debugContext   Optional debug information.
+ *  \param options        A structure describing options on how the
+ *                        multiplication should be implemented.
+ *                        See matMul() for details.
+ *  \param cache          Optional pointer to a planning cache to use.
+ *  \returns              Tensor with shape of \p b with linear system solution.
+ */
+poplar::Tensor choleskySolve(poplar::Graph &graph, const poplar::Tensor &a,
+                             const poplar::Tensor &b, bool lower,
+                             std::size_t blockSize,
+                             poplar::program::Sequence &prog,
+                             const poplar::DebugContext &debugContext = {},
+                             poplar::OptionFlags options = {},
+                             matmul::PlanningCache *cache = nullptr);
+
+} // namespace poplin
+
+#endif // poplin_Cholesky_hpp
@@ -8,6 +8,7 @@
 #ifndef poplin_Convolution_hpp
 #define poplin_Convolution_hpp
 #include "ConvParams.hpp"
+#include "Epilogue.hpp"
 
 #include <poplar/Graph.hpp>
 #include <poplar/OptionFlags.hpp>
@@ -271,6 +272,30 @@ poplar::Tensor convolution(poplar::Graph &graph, const poplar::Tensor &in,
                            const poplar::OptionFlags &options = {},
                            PlanningCache *cache = nullptr);
 
+/** Convolve an input with a set of weights and apply \p epilogue to the
+ *  output.
+ *
+ * This is equivalent to convolution() followed by addBias(), the
+ * non-linearity and a cast, except that the planner includes the cost of the
+ * epilogue when it chooses the plan of the convolution. That plan can differ
+ * from the one createInput() and createWeights() lay out their tensors for.
+ *
+ * \param epilogue The biases, non-linearity and output type to apply, see
+ *                 Epilogue. The biases have the shape [outChans].
+ *
+ * The other parameters are as for convolution(). The returned tensor has the
+ * shape [B x outChans x H x W] and the output type of the epilogue.
+ */
+poplar::Tensor convolution(poplar::Graph &graph, const poplar::Tensor &in,
+                           const poplar::Tensor &weights,
+                           const ConvParams &params,
+                           bool transposeAndFlipWeights,
+                           const Epilogue &epilogue,
+                           poplar::program::Sequence &prog,
+                           const poplar::DebugContext &debugContext = {},
+                           const poplar::OptionFlags &options = {},
+                           PlanningCache *cache = nullptr);
+
 using ConvPlanParams = std::tuple<const poplar::Target *, const ConvParams,
                                   const poplar::OptionFlags *>;
 /**
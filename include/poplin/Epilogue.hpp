@@ -0,0 +1,61 @@
+// Copyright (c) 2020 Graphcore Ltd. All rights reserved.
+/** \file
+ *
+ * Elementwise operations applied to the output of a convolution or matrix
+ * multiplication.
+ *
+ */
+
+#ifndef poplin_Epilogue_hpp
+#define poplin_Epilogue_hpp
+
+#include <boost/optional.hpp>
+#include <poplar/Tensor.hpp>
+#include <poplar/Type.hpp>
+#include <popops/ExprOp.hpp>
+#include <poputil/DebugInfo.hpp>
+
+namespace poplin {
+
+/** Operations applied to the output of a convolution or matrix
+ *  multiplication, in place of separate calls to addBias(), a non-linearity
+ *  and a cast.
+ *
+ *  The biases are added first, then the non-linearity is applied and the
+ *  result is converted to the output type. The intermediate values are
+ *  FLOAT if the output of the operation or the result is FLOAT.
+ *
+ *  The epilogue runs after the operation. With biases and a RELU, SIGMOID or
+ *  TANH non-linearity, it adds the biases, applies the non-linearity and
+ *  casts the result in a single pass over the output, computing in FLOAT.
+ *  Otherwise it makes one pass over the output to add the biases and one to
+ *  apply the non-linearity and cast the result, plus a pass to cast the output
+ *  first if the result is FLOAT and the output is not. The planner includes
+ *  the cycles of these passes in the cost of each plan.
+ */
+struct Epilogue {
+  /// The biases to add, with one element per output channel of a
+  /// convolution or per column of a matrix multiplication. Not added if the
+  /// tensor is not valid.
+  poplar::Tensor biases;
+  /// The non-linearity to apply after the biases, for example RELU, SIGMOID
+  /// or TANH.
+  boost::optional<popops::expr::UnaryOpType> nonLinearity;
+  /// The element type of the result. The output type of the operation if not
+  /// set.
+  boost::optional<poplar::Type> outputType;
+
+  /// True if the epilogue does nothing.
+  bool empty() const {
+    return !biases.valid() && !nonLinearity && !outputType;
+  }
+};
+
+} // namespace poplin
+
+namespace poputil {
+template <>
+poplar::ProfileValue toProfileValue(const poplin::Epilogue &t);
+} // namespace poputil
+
+#endif // poplin_Epilogue_hpp
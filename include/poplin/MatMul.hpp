@@ -7,6 +7,7 @@
 
 #ifndef poplin_MatMul_hpp
 #define poplin_MatMul_hpp
+#include "poplin/Epilogue.hpp"
 #include <iosfwd>
 #include <map>
 #include <poplar/Graph.hpp>
@@ -124,6 +125,33 @@ poplar::Tensor matMul(poplar::Graph &graph, const poplar::Tensor &A,
                       const poplar::OptionFlags &options = {},
                       matmul::PlanningCache *cache = nullptr);
 
+/** Multiply two matrices and apply \p epilogue to the result.
+ *
+ *  Calculates `C = A * B` followed by the biases, non-linearity and cast of
+ *  \p epilogue, which the planner includes in the cost of the
+ *  multiplication. That plan can differ from the one createMatMulInputLHS()
+ *  and createMatMulInputRHS() lay out their tensors for. matMul() without an
+ *  epilogue is the same as an empty epilogue.
+ *
+ *  \param outputType      The element type of the result of the
+ *                         multiplication, before the epilogue.
+ *  \param epilogue        The operations to apply to the result, see
+ *                         Epilogue. The biases have the shape
+ *                         [\p B.dim(1)] and are added to each row.
+ *
+ *  The other parameters are as for matMul().
+ *
+ *  \returns               The result of the multiplication after the
+ *                         epilogue, of the epilogue's output type if it has
+ *                         one and \p outputType otherwise.
+ */
+poplar::Tensor matMul(poplar::Graph &graph, const poplar::Tensor &A,
+                      const poplar::Tensor &B, poplar::program::Sequence &prog,
+                      const poplar::Type &outputType, const Epilogue &epilogue,
+                      const poplar::DebugContext &debugContext = {},
+                      const poplar::OptionFlags &options = {},
+                      matmul::PlanningCache *cache = nullptr);
+
 void matMulReportPlan(std::ostream &out, const poplar::Graph &graph,
                       const poplar::Type &inputType,
                       const poplar::Type &outputType,
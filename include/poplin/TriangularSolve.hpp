@@ -9,6 +9,7 @@
 #define popops_TriangularSolve_hpp
 #include <poplar/Graph.hpp>
 #include <poplar/Program.hpp>
+#include <poplin/MatMul.hpp>
 
 namespace poplin {
 
@@ -67,6 +68,30 @@ poplar::Tensor triangularSolve(poplar::Graph &graph, const poplar::Tensor &a,
                                poplar::OptionFlags options = {},
                                matmul::PlanningCache *cache = nullptr);
 
+/**
+ * Predict what matrix multiplications will be needed for the given parameters
+ * and return list of corresponding matmul parameters and options.
+ *
+ *  \param inputType      Element type of \p a and \p b.
+ *  \param outputType     Element type of the solution, must match
+ *                        \p inputType.
+ *  \param aShape         Shape of tensor A, [..., N,N].
+ *  \param bShape         Shape of tensor B, [..., N, K] if \p leftSide is
+ *                        true, [..., K, N] otherwise.
+ *  \param leftSide       Solve AX = B if true, XA = B overwise.
+ *  \param lower          Use the upper or lower triangle of A.
+ *  \param blockSize      Block size for blocked solver.
+ *  \param options        Matmul options, see matMul() for details.
+ *  \returns              Vector of pairs of [\c MatMulParams, \c OptionFlags]
+ *                        which can be passed to preplanMatMuls().
+ */
+std::vector<std::pair<MatMulParams, poplar::OptionFlags>>
+getTriangularSolveMatMulPrePlanParameters(
+    const poplar::Type &inputType, const poplar::Type &outputType,
+    const std::vector<std::size_t> &aShape,
+    const std::vector<std::size_t> &bShape, bool leftSide, bool lower,
+    std::size_t blockSize, const poplar::OptionFlags &options = {});
+
 } // namespace poplin
 
 #endif // poplin_TriangularSolve_hpp
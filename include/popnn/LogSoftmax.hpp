@@ -8,6 +8,36 @@
 
 namespace popnn {
 
+/// The normaliser of the softmax along the innermost dimension of a tensor.
+struct SoftmaxNormaliser {
+  /// The largest value of each row, of type FLOAT.
+  poplar::Tensor max;
+  /// The sum of the exponentials of each row minus its largest value, of type
+  /// FLOAT. Each element is at least 1.
+  poplar::Tensor sumExp;
+};
+
+/** Compute the maximum and the sum of exponentials relative to it along the
+ *  innermost dimension of \p t with a single read of \p t.
+ *
+ *  Each worker keeps a running maximum and a sum that is rescaled whenever
+ *  the maximum grows. The partial pairs of a row are then combined into
+ *  the normaliser of the row. The log of the softmax is
+ *  `t - max - log(sumExp)`.
+ *
+ * \param graph             The graph to add the operation to.
+ * \param t                 The FLOAT or HALF tensor to reduce.
+ * \param prog              The sequence to add the operation to.
+ * \param debugContext      Optional debug information.
+ *
+ * \returns The normaliser, with the shape of \p t without its innermost
+ *          dimension.
+ */
+SoftmaxNormaliser
+softmaxNormaliser(poplar::Graph &graph, const poplar::Tensor &t,
+                  poplar::program::Sequence &prog,
+                  const poplar::DebugContext &debugContext = {});
+
 /** Update tensor \p t by computing log of softmax in-place.
  *
  * \param graph             The graph to add the operation to.
@@ -12,6 +12,7 @@ enum LossType { SUM_SQUARED_LOSS, CROSS_ENTROPY_LOSS };
 #ifndef __POPC__
 #include "popops/EncodingConstants.hpp"
 #include <poplar/Graph.hpp>
+#include <poplar/OptionFlags.hpp>
 #include <poplar/Program.hpp>
 #include <poplar/Tensor.hpp>
 
@@ -83,6 +84,40 @@ calcLoss(poplar::Graph &graph, const poplar::Tensor &modelOutputs,
          const poplar::Tensor &deltas, const poplar::Tensor &numCorrect,
          LossType lossType, const poplar::DebugContext &debugContext = {});
 
+/** Calculate the softmax cross-entropy loss of a set of logits and sparse
+ *  labels, and its gradient with respect to the logits.
+ *
+ *  This is equivalent to applying a softmax to \p logits and calling
+ *  calcLoss() with CROSS_ENTROPY_LOSS and the one-hot encoding of \p labels,
+ *  but neither the probabilities nor the one-hot encoding is created: the
+ *  gradient, `deltasScale * (softmax(logits) - onehot(labels))`, is written
+ *  in place of \p logits. The softmax is computed stably by subtracting the
+ *  largest logit of each row.
+ *
+ *  \param graph          Graph to add operations and tensors to.
+ *  \param logits         2D tensor of logits of type FLOAT or HALF, of shape
+ *                        [batch][classes]. Overwritten with the gradient.
+ *  \param labels         1D tensor of the class of each row, of type
+ *                        UNSIGNED_INT or INT. Rows labelled with
+ *                        MASKED_LABEL_CODE have zero loss and gradient. The
+ *                        loss of a row with a label out of range is NaN.
+ *  \param loss           1D tensor to store the loss of each row.
+ *  \param deltasScale    Optional scalar tensor of the type of \p logits to
+ *                        scale the gradient by. If not given the gradient is
+ *                        not scaled.
+ *  \param debugContext   Optional debug information.
+ */
+poplar::program::Program calcSparseSoftmaxCrossEntropyLoss(
+    poplar::Graph &graph, const poplar::Tensor &logits,
+    const poplar::Tensor &labels, const poplar::Tensor &loss,
+    const poplar::Tensor &deltasScale,
+    const poplar::DebugContext &debugContext = {});
+
+poplar::program::Program calcSparseSoftmaxCrossEntropyLoss(
+    poplar::Graph &graph, const poplar::Tensor &logits,
+    const poplar::Tensor &labels, const poplar::Tensor &loss,
+    const poplar::DebugContext &debugContext = {});
+
 /** Calculate the number of correct classifications for a set of
  *  activations and expected labels.
  *
@@ -115,10 +150,12 @@ calcAccuracy(poplar::Graph &graph, const poplar::Tensor &modelOutputs,
  *  \param input          2D tensor of inputs
  *  \param prog           Program to which the graph for this operation is added
  *  \param debugContext   Optional debug information.
+ *  \param options        Top-k options, see topK().
  */
 poplar::Tensor argMax(poplar::Graph &graph, const poplar::Tensor &input,
                       poplar::program::Sequence &prog,
-                      const poplar::DebugContext &debugContext = {});
+                      const poplar::DebugContext &debugContext = {},
+                      const poplar::OptionFlags &options = {});
 
 /** Compute argmin for each of the outer dimensions of \p input tensor.
  *
@@ -138,6 +175,19 @@ poplar::Tensor argMin(poplar::Graph &graph, const poplar::Tensor &input,
  * [batch][values] and will return a tensor in the shape of [batch][K] where K
  * is the max values of each batch of values.
  *
+ *  **Top-k options**
+ *
+ *    * `method` (auto, heap, streaming) [=heap]
+ *
+ *      The algorithm used. `heap` gathers the values onto tiles in turn and
+ *      reduces them with heap-based vertices. `streaming` finds the top K of
+ *      the values each tile holds without exchanging them, rejecting values
+ *      below the current K-th largest, and then merges the partial results in
+ *      a tree across tiles, which is faster and uses less memory for large
+ *      numbers of classes. `auto` uses `streaming` when the number of classes
+ *      is large compared to K. Both methods return the lowest index among
+ *      equal maximum values in argMax().
+ *
  *  \param graph          Graph to add operations and tensors to.
  *  \param input          2D tensor of inputs
  *  \param indices        The tensor to store the indices in.
@@ -145,11 +195,13 @@ poplar::Tensor argMin(poplar::Graph &graph, const poplar::Tensor &input,
  *  \param sort           If true values will be sorted in descending order.
  *  \param prog           Program to which the graph for this operation is added
  *  \param debugContext   Optional debug information.
+ *  \param options        Top-k options, see above.
  */
 poplar::Tensor topK(poplar::Graph &graph, const poplar::Tensor &input,
                     poplar::Tensor &indices, unsigned K, bool sort,
                     poplar::program::Sequence &prog,
-                    const poplar::DebugContext &debugContext = {});
+                    const poplar::DebugContext &debugContext = {},
+                    const poplar::OptionFlags &options = {});
 
 } // end namespace popnn
 
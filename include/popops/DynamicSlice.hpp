@@ -9,6 +9,7 @@
 #define popops_DynamicSlice_hpp
 #include <poplar/Graph.hpp>
 #include <poplar/Program.hpp>
+#include <popops/Operation.hpp>
 #include <poputil/DebugInfo.hpp>
 #include <string>
 #include <vector>
@@ -324,7 +325,12 @@ void multiUpdate(poplar::Graph &graph, const poplar::Tensor &t,
  *                     \p dims.
  *  \param prog        The program to be extended.
  *  \param plan        Plan describing how the operation will be implemented.
+ *                     Duplicate indices are coalesced before the update when
+ *                     the plan was created with the `coalesceDuplicates`
+ *                     option, see embedding::plan().
  *  \param options     Flags controlling how the operation will be implemented.
+ *                     Without a plan, `coalesceDuplicates` may be set to
+ *                     `always` to coalesce duplicate indices.
  *  \param debugContext Optional debug information.
  */
 void multiUpdateAdd(poplar::Graph &graph, const poplar::Tensor &t,
@@ -336,6 +342,38 @@ void multiUpdateAdd(poplar::Graph &graph, const poplar::Tensor &t,
                     const poplar::OptionFlags &options,
                     const poplar::DebugContext &debugContext = {});
 
+/** Combine multiple slices into a tensor with a reduction operation
+ * for i offsets:
+ *   t[offsets[i]] = op(t[offsets[i]], s[i])
+ * \p t and \p s must have the same element type. Updates to the same offset
+ * are combined in an unspecified order. This can be used for segment
+ * reductions, such as the max-pooling of neighbourhoods in graph neural
+ * networks, and for max-unpooling.
+ *
+ *  \param graph       The Poplar graph.
+ *  \param t           The tensor being updated (must be rank 2).
+ *  \param s           The slices to combine.
+ *  \param offsets     The offsets within \p t to be updated.
+ *  \param dims        The dimensions of \p t to be updated
+ *                     (must be rank 1).
+ *  \param sizes       The size of the update in each of the dimensions in
+ *                     \p dims.
+ *  \param prog        The program to be extended.
+ *  \param plan        Plan describing how the operation will be implemented.
+ *  \param op          The operation to combine the slices with. One of ADD,
+ *                     MUL, MIN or MAX. ADD is equivalent to multiUpdateAdd()
+ *                     with a scale of one.
+ *  \param options     Flags controlling how the operation will be implemented.
+ *  \param debugContext Optional debug information.
+ */
+void multiUpdateOp(poplar::Graph &graph, const poplar::Tensor &t,
+                   const poplar::Tensor &s, const poplar::Tensor &offsets,
+                   const std::vector<std::size_t> &dims,
+                   const std::vector<std::size_t> &sizes,
+                   poplar::program::Sequence &prog, const SlicePlan &plan,
+                   Operation op, const poplar::OptionFlags &options,
+                   const poplar::DebugContext &debugContext = {});
+
 namespace embedding {
 
 /** Create a plan for implementing a set of operations on an
@@ -351,6 +389,22 @@ namespace embedding {
  * \param options     Set of option flags controlling how the operation
  *                    will be implemented.
  *
+ * **Embedding plan options**
+ *
+ *    * `coalesceDuplicates` (never, always, auto) [=never]
+ *
+ *      Whether a multiUpdateAdd() with the plan first sorts the indices and
+ *      sums the updates to each distinct index, so that each row of the
+ *      embedding matrix is updated at most once. This adds a sort and a
+ *      segmented sum of the updates, which pays off when many of the indices
+ *      are repeated. With `auto` the planner estimates the cost of both
+ *      variants using `expectedUniqueLookupProportion`.
+ *
+ *    * `expectedUniqueLookupProportion` Decimal between 0 and 1 [=1]
+ *
+ *      The proportion of the indices of an update expected to be distinct,
+ *      used when `coalesceDuplicates` is `auto`.
+ *
  * \returns A plan which describes how the embedding matrix lookup/update
  *          operations should be implemented.
  */
@@ -0,0 +1,111 @@
+// Copyright (c) 2020 Graphcore Ltd. All rights reserved.
+/** \file
+ *
+ * Deferred fusion of chains of element-wise operations.
+ *
+ */
+
+#ifndef popops_ElementWiseBuilder_hpp
+#define popops_ElementWiseBuilder_hpp
+
+#include <poplar/Graph.hpp>
+#include <poplar/OptionFlags.hpp>
+#include <poplar/Program.hpp>
+#include <popops/Expr.hpp>
+
+#include <memory>
+#include <vector>
+
+namespace popops {
+
+/** Records a chain of element-wise operations over tensors of the same shape
+ *  and materialises them as fused map expressions when flushed.
+ *
+ *  Instead of issuing one compute set per element-wise call, the value of each
+ *  tensor written by the chain is kept as an expression of the values the
+ *  tensors had before the chain started. Reading a tensor that has a pending
+ *  write returns its pending expression, so a sequence such as
+ *
+ *  \code
+ *    ElementWiseBuilder b(graph);
+ *    auto m = b.addTensor(momentum);
+ *    auto g = b.addTensor(grad);
+ *    auto w = b.addTensor(weights);
+ *    b.set(m, expr::Add(expr::Mul(expr::Const(0.9f), b.get(m)), b.get(g)));
+ *    b.set(w, expr::Sub(b.get(w), expr::Mul(expr::Const(0.01f), b.get(m))));
+ *    b.flush(prog);
+ *  \endcode
+ *
+ *  is materialised as one mapInPlace() per written tensor, each of which is a
+ *  single pass over memory when the expression can be turned into a generated
+ *  codelet. A value read by a single expression is inlined into it, while a
+ *  value read by more than one expression, as by \c b.set(x,
+ *  expr::Add(b.get(x), b.get(x))), is first materialised once into a
+ *  temporary, so the fused expressions grow linearly with the chain. Writes
+ *  are ordered so that no tensor is overwritten before every pending
+ *  expression that reads its original value has been materialised.
+ *
+ *  Expressions passed to set() must only refer to placeholders returned by
+ *  get() on the same builder.
+ */
+class ElementWiseBuilder {
+public:
+  /// Identifies a tensor registered with the builder.
+  using TensorId = std::size_t;
+
+  /** \param graph        The graph to add the fused operations to.
+   *  \param debugContext Optional debug information.
+   *  \param options      Map options passed to mapInPlace() when flushing.
+   */
+  ElementWiseBuilder(poplar::Graph &graph,
+                     const poplar::DebugContext &debugContext = {},
+                     poplar::OptionFlags options = {});
+  ~ElementWiseBuilder();
+
+  /** Register a tensor to be read or written by the chain. All tensors must
+   *  have the same shape.
+   */
+  TensorId addTensor(const poplar::Tensor &t);
+
+  /** Create a new tensor of type \p type with the same shape and tile mapping
+   *  as the tensor \p like, to be written by the chain.
+   */
+  TensorId addOutput(const poplar::Type &type, TensorId like,
+                     const poplar::DebugContext &debugContext = {});
+
+  /// The tensor registered as \p id.
+  const poplar::Tensor &getTensor(TensorId id) const;
+
+  /// A placeholder for the current value of \p id, taking into account any
+  /// pending write to it.
+  expr::Any get(TensorId id) const;
+
+  /// Record that \p id is assigned the value of \p e.
+  void set(TensorId id, const expr::Expr &e);
+
+  /// Number of tensors with a pending write.
+  std::size_t numPending() const;
+
+  /** Add programs to \p prog that materialise all pending writes. After this
+   *  call there are no pending writes and get() returns placeholders again.
+   */
+  void flush(poplar::program::Sequence &prog);
+
+private:
+  poplar::Graph &graph;
+  poplar::DebugNameAndId dnai;
+  poplar::OptionFlags options;
+  std::vector<poplar::Tensor> tensors;
+  // The values assigned by the chain, placeholder i referring to value i - 1:
+  // the original value of a tensor when the expression is null, and
+  // otherwise an expression of earlier values.
+  std::vector<std::unique_ptr<expr::Expr>> values;
+  // The tensor each value is assigned to.
+  std::vector<TensorId> valueOf;
+  // The current value of each tensor.
+  std::vector<std::size_t> current;
+};
+
+} // namespace popops
+
+#endif // popops_ElementWiseBuilder_hpp
@@ -0,0 +1,120 @@
+// Copyright (c) 2020 Graphcore Ltd. All rights reserved.
+/** \file
+ *
+ * A device-resident cache of the rows of an embedding table held off chip.
+ *
+ */
+
+#ifndef popops_EmbeddingCache_hpp
+#define popops_EmbeddingCache_hpp
+
+#include <poplar/Graph.hpp>
+#include <poplar/OptionFlags.hpp>
+#include <poplar/Program.hpp>
+
+namespace popops {
+
+/** Lookups into an embedding table that is too large to be held in tile
+ *  memory. The table is held in a remote buffer and the most recently used
+ *  rows are cached on the device.
+ *
+ *  The cache has a number of lines, each holding one row of the table,
+ *  which are grouped into sets of `associativity` lines. A row can only be
+ *  held in the set given by its index modulo the number of sets, and a tag
+ *  array records which row each line holds. Lookups that hit in the cache
+ *  are resolved on the device. The rows of lookups that miss are fetched
+ *  from the remote buffer with a single copy, returned and installed in the
+ *  cache, replacing a line of the set chosen from the higher bits of the
+ *  index.
+ *
+ *  The cache is read-only: updates to the table must be written to the
+ *  remote buffer and the cache invalidated with initialise().
+ *
+ *  **Embedding cache options**
+ *
+ *    * `associativity` Integer [=1]
+ *
+ *      The number of lines in each set. 1 gives a direct-mapped cache. Must
+ *      divide the number of lines.
+ *
+ *    * `maxMissesPerFetch` Integer [=number of lookups]
+ *
+ *      The number of rows fetched from the remote buffer with each copy. When
+ *      a lookup has more misses than this, further fetches are made. Smaller
+ *      values reduce the size of the fetch buffer and the time spent fetching
+ *      when most lookups hit.
+ *
+ *    * `handle` String [="embeddingCacheTable"]
+ *
+ *      The handle of the remote buffer holding the table. Each cache in a
+ *      graph must have a different handle.
+ */
+class EmbeddingCache {
+public:
+  /** \param graph         The graph to add the cache to.
+   *  \param type          The element type of the embedding table.
+   *  \param numEntries    The number of rows in the embedding table.
+   *  \param embeddingSize The number of elements in each row.
+   *  \param numLines      The number of rows held in the cache.
+   *  \param numLookups    The number of indices in each lookup.
+   *  \param options       Embedding cache options, see above.
+   *  \param debugContext  Optional debug information.
+   */
+  EmbeddingCache(poplar::Graph &graph, const poplar::Type &type,
+                 std::size_t numEntries, std::size_t embeddingSize,
+                 std::size_t numLines, std::size_t numLookups,
+                 const poplar::OptionFlags &options = {},
+                 const poplar::DebugContext &debugContext = {});
+
+  /** Add programs to \p prog that invalidate every line of the cache and
+   *  zero the hit and miss counters. This must be run before the first
+   *  lookup.
+   */
+  void initialise(poplar::program::Sequence &prog);
+
+  /** Look up the rows of the embedding table at \p indices.
+   *
+   *  \param indices      A tensor of shape {numLookups} and type UNSIGNED_INT.
+   *  \param prog         The program to add the lookup to.
+   *  \param debugContext Optional debug information.
+   *  \returns            A tensor of shape {numLookups, embeddingSize}.
+   */
+  poplar::Tensor lookup(const poplar::Tensor &indices,
+                        poplar::program::Sequence &prog,
+                        const poplar::DebugContext &debugContext = {});
+
+  /// The remote buffer holding the embedding table, with one repeat per row.
+  const poplar::RemoteBuffer &getTable() const { return table; }
+
+  /// The number of lookups that hit in the cache since initialise(), as a
+  /// scalar INT tensor.
+  const poplar::Tensor &getHitCount() const { return hits; }
+
+  /// The number of lookups that missed in the cache since initialise(), as a
+  /// scalar INT tensor.
+  const poplar::Tensor &getMissCount() const { return misses; }
+
+private:
+  poplar::Graph &graph;
+  poplar::DebugNameAndId dnai;
+  poplar::Type type;
+  std::size_t numEntries;
+  std::size_t embeddingSize;
+  std::size_t numLookups;
+  unsigned numSets;
+  unsigned associativity;
+  unsigned maxMissesPerFetch;
+
+  poplar::RemoteBuffer table;
+  // {numLines, embeddingSize}
+  poplar::Tensor lines;
+  // {numLines, 1}, the row held by each line or -1 when invalid. Line
+  // `set * associativity + way` is the given way of the set.
+  poplar::Tensor tags;
+  poplar::Tensor hits;
+  poplar::Tensor misses;
+};
+
+} // namespace popops
+
+#endif // popops_EmbeddingCache_hpp
@@ -12,6 +12,7 @@
 #include <poplar/OptionFlags.hpp>
 #include <poplar/Program.hpp>
 #include <string>
+#include <vector>
 
 namespace popops {
 
@@ -90,6 +91,95 @@ void histogram(poplar::Graph &graph, const poplar::Tensor &input,
                const poplar::Tensor &levels, bool absoluteOfInput,
                poplar::program::Sequence &prog,
                const poplar::DebugContext &debugContext = {});
+
+/** Gather a single histogram of the elements of all of the tensors in
+ *  \p inputs.
+ *
+ *  This is equivalent to histogram() of the concatenation of the flattened
+ *  inputs. The counting for every input is done in one compute set, with one
+ *  reduction of the partial histograms, rather than one of each per tensor.
+ *  Inputs of a different type to \p levels are compared against a copy of
+ *  \p levels cast to their type.
+ *
+ *  \param graph           The Poplar graph.
+ *  \param inputs          The float or half tensors on which to gather
+ *                         histogram statistics.
+ *  \param levels          The levels defining the comparisons to carry out in
+ *                         generating the histogram output.
+ *  \param absoluteOfInput If true, the absolute value of each input is
+ *                         calculated before comparison to the \p levels data.
+ *  \param prog            A sequence program to which the code performing the
+ *                         histogram will be appended.
+ *  \param debugContext    Optional debug information.
+ *  \param options         Histogram options, see histogram().
+ *
+ *  \return                The levels + 1 histogram results, as for
+ *                         histogram().
+ */
+poplar::Tensor histogram(poplar::Graph &graph,
+                         const std::vector<poplar::Tensor> &inputs,
+                         const poplar::Tensor &levels, bool absoluteOfInput,
+                         poplar::program::Sequence &prog,
+                         const poplar::DebugContext &debugContext = {},
+                         const poplar::OptionFlags &options = {});
+
+/** Fill a tensor with a single histogram of the elements of all of the
+ *  tensors in \p inputs, in the same way as the histogram() of a single
+ *  tensor with an output.
+ */
+void histogram(poplar::Graph &graph, const std::vector<poplar::Tensor> &inputs,
+               poplar::Tensor &output, bool updateOutput,
+               const poplar::Tensor &levels, bool absoluteOfInput,
+               poplar::program::Sequence &prog,
+               const poplar::DebugContext &debugContext = {});
+
+/** Gather a histogram of the binary exponents of the absolute values of the
+ *  elements of all of the tensors in \p inputs.
+ *
+ *  Rather than comparing each element with each level, the bin of each
+ *  element is found from its exponent, so the cost does not grow with the
+ *  number of bins. This is intended for gathering the statistics of the
+ *  gradients used in automatic loss scaling.
+ *
+ *  Bin 0 counts the elements with \f$|x| < 2^{minExponent}\f$, including
+ *  zeros. Bin `i`, for `0 < i < numBins - 1`, counts the elements with
+ *  \f$2^{minExponent + i - 1} \le |x| < 2^{minExponent + i}\f$ and the last
+ *  bin counts the larger elements, infinities and NaNs. This is the same as
+ *  histogram() with `absoluteOfInput` and levels
+ *  \f$2^{minExponent}, ..., 2^{minExponent + numBins - 2}\f$.
+ *
+ *  \param graph        The Poplar graph.
+ *  \param inputs       The float or half tensors on which to gather
+ *                      statistics.
+ *  \param minExponent  The exponent of the upper bound of bin 0. Must be at
+ *                      least -126.
+ *  \param numBins      The number of bins, at least 2.
+ *  \param prog         A sequence program to which the code performing the
+ *                      histogram will be appended.
+ *  \param debugContext Optional debug information.
+ *  \param options      Histogram options, see histogram().
+ *
+ *  \return             A tensor of \p numBins counts, of type unsigned int or
+ *                      float if the option `useFloatArithmetic` is "true".
+ */
+poplar::Tensor exponentHistogram(poplar::Graph &graph,
+                                 const std::vector<poplar::Tensor> &inputs,
+                                 int minExponent, unsigned numBins,
+                                 poplar::program::Sequence &prog,
+                                 const poplar::DebugContext &debugContext = {},
+                                 const poplar::OptionFlags &options = {});
+
+/** Fill a tensor with a histogram of the binary exponents of the elements of
+ *  all of the tensors in \p inputs, as exponentHistogram(). The number of bins
+ *  is the number of elements of \p output, which is of type float or
+ *  unsigned int and is accumulated into if \p updateOutput is true, as for
+ *  histogram().
+ */
+void exponentHistogram(poplar::Graph &graph,
+                       const std::vector<poplar::Tensor> &inputs,
+                       poplar::Tensor &output, bool updateOutput,
+                       int minExponent, poplar::program::Sequence &prog,
+                       const poplar::DebugContext &debugContext = {});
 } // namespace popops
 
 #endif // popops_GatherStatistics_hpp
@@ -0,0 +1,58 @@
+// Copyright (c) 2020 Graphcore Ltd. All rights reserved.
+/** \file
+ *
+ * Gather the statistics used to check and clip gradients in a single pass.
+ *
+ */
+
+#ifndef popops_GradientStatistics_hpp
+#define popops_GradientStatistics_hpp
+
+#include <poplar/Graph.hpp>
+#include <poplar/OptionFlags.hpp>
+#include <poplar/Program.hpp>
+#include <poplar/Tensor.hpp>
+
+#include <vector>
+
+namespace popops {
+
+/// The statistics of a list of tensors, with one element per tensor.
+struct GradientStatistics {
+  /// BOOL, true if the tensor contains a NaN or an infinity.
+  poplar::Tensor hasNonFinite;
+  /// FLOAT, the largest absolute value of the finite elements of the tensor.
+  poplar::Tensor maxAbs;
+  /// FLOAT, the sum of the squares of the finite elements of the tensor.
+  poplar::Tensor sumSquares;
+};
+
+/** Check a list of tensors for non-finite values and find their largest
+ *  absolute value and sum of squares.
+ *
+ *  This is equivalent to calling hasNaN(), reduce() with
+ *  popops::Operation::MAX of the absolute values and reduce() with
+ *  popops::Operation::SQUARE_ADD on each tensor, except that each element is
+ *  read once and infinities are also detected. The partial statistics of
+ *  every tensor are gathered in one compute set and reduced together, so the
+ *  number of compute sets does not depend on the number of tensors.
+ *
+ *  \param graph        The graph to add the tensors and vertices to.
+ *  \param ts           The tensors to gather statistics of. Each must be of
+ *                      type FLOAT or HALF and have a tile mapping.
+ *  \param prog         The program to add the computation to.
+ *  \param debugContext Optional debug information.
+ *  \param options      Options passed to reduce().
+ *  \returns            The statistics, each of shape {ts.size()}.
+ *  \throw poputil::poplibs_error If \p ts is empty or any tensor is not of
+ *         type FLOAT or HALF.
+ */
+GradientStatistics
+gradientStatistics(poplar::Graph &graph, const std::vector<poplar::Tensor> &ts,
+                   poplar::program::Sequence &prog,
+                   const poplar::DebugContext &debugContext = {},
+                   const poplar::OptionFlags &options = {});
+
+} // namespace popops
+
+#endif // popops_GradientStatistics_hpp
@@ -0,0 +1,80 @@
+// Copyright (c) 2020 Graphcore Ltd. All rights reserved.
+/** \file
+ *
+ * Element-wise operations applied to many tensors at once.
+ *
+ */
+
+#ifndef popops_MultiTensor_hpp
+#define popops_MultiTensor_hpp
+
+#include <poplar/Graph.hpp>
+#include <poplar/OptionFlags.hpp>
+#include <poplar/Program.hpp>
+#include <popops/Expr.hpp>
+
+#include <vector>
+
+namespace popops {
+
+/** Apply mapInPlace() to many tensors with a single compute set.
+ *
+ *  Calling mapInPlace() once per tensor adds a compute set, and at least one
+ *  vertex per tile region, for each tensor. For models with many small
+ *  tensors, such as biases and normalisation parameters, the synchronisation
+ *  and vertex overheads dominate. This function instead flattens and
+ *  concatenates the operands so that regions of different tensors that are
+ *  mapped to the same tile are processed by the same vertices.
+ *
+ *  \param graph        The graph to update.
+ *  \param expr         The expression to map across the tensors.
+ *  \param ts           One list of tensors per placeholder of \p expr. The
+ *                      tensors in `ts[0]` are updated in place. Each other
+ *                      list either has one tensor for each tensor in `ts[0]`,
+ *                      with the same number of elements, or has a single
+ *                      tensor with one element which is used for all of them.
+ *  \param prog         The sequence to extend with the operations.
+ *  \param debugContext Optional debug information.
+ *  \param options      Element-wise options. See map().
+ *
+ *  Tensors in `ts[0]` are grouped by the element types of their operands and
+ *  each group is processed with one compute set, so the common case of a
+ *  single type uses a single compute set.
+ */
+void multiTensorMapInPlace(poplar::Graph &graph, const expr::Expr &expr,
+                           const std::vector<std::vector<poplar::Tensor>> &ts,
+                           poplar::program::Sequence &prog,
+                           const poplar::DebugContext &debugContext = {},
+                           const poplar::OptionFlags &options = {});
+
+/** Perform `A[i] += scaleB * B[i]` for every pair of tensors with as few
+ *  compute sets as possible, in the same way as multiTensorMapInPlace().
+ *
+ *  \param graph        The graph to update.
+ *  \param A            The destination tensors.
+ *  \param B            The tensors to add, each with the same number of
+ *                      elements as the corresponding tensor in \p A.
+ *  \param scaleB       The scalar tensor to multiply elements of \p B by.
+ *  \param prog         The sequence to extend with the operations.
+ *  \param debugContext Optional debug information.
+ *  \param options      Scaled add options. See scaledAddTo().
+ */
+void multiTensorScaledAddTo(poplar::Graph &graph,
+                            const std::vector<poplar::Tensor> &A,
+                            const std::vector<poplar::Tensor> &B,
+                            const poplar::Tensor &scaleB,
+                            poplar::program::Sequence &prog,
+                            const poplar::DebugContext &debugContext = {},
+                            const poplar::OptionFlags &options = {});
+
+/// As multiTensorScaledAddTo() with a constant scale.
+void multiTensorScaledAddTo(poplar::Graph &graph,
+                            const std::vector<poplar::Tensor> &A,
+                            const std::vector<poplar::Tensor> &B, float scaleB,
+                            poplar::program::Sequence &prog,
+                            const poplar::DebugContext &debugContext = {},
+                            const poplar::OptionFlags &options = {});
+
+} // namespace popops
+
+#endif // popops_MultiTensor_hpp
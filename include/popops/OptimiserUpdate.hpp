@@ -0,0 +1,110 @@
+// Copyright (c) 2020 Graphcore Ltd. All rights reserved.
+/** \file
+ *
+ * Fused optimiser weight updates.
+ *
+ */
+
+#ifndef popops_OptimiserUpdate_hpp
+#define popops_OptimiserUpdate_hpp
+
+#include <poplar/Graph.hpp>
+#include <poplar/Program.hpp>
+#include <poplar/Tensor.hpp>
+
+namespace popops {
+
+/// Hyperparameters of a stochastic gradient descent with momentum update.
+struct MomentumParams {
+  float momentum = 0.9f;
+  float weightDecay = 0.0f;
+};
+
+/// Hyperparameters of an Adam or LAMB update.
+struct AdamParams {
+  float beta1 = 0.9f;
+  float beta2 = 0.999f;
+  float epsilon = 1e-6f;
+  float weightDecay = 0.0f;
+};
+
+/** Stochastic gradient descent with momentum, updating the weights and the
+ *  velocity in a single pass:
+ *
+ *    g = grads / lossScale + weightDecay * weights
+ *    velocity = momentum * velocity + g
+ *    weights -= learningRate * velocity
+ *
+ *  The weights may be of type half or float. The state may be of type float,
+ *  or of type half when the weights are of type half.
+ *
+ *  \param graph        The graph to add the vertices to.
+ *  \param weights      The weights to update in place.
+ *  \param grads        The loss scaled gradients, the same type and shape as
+ *                      \p weights.
+ *  \param velocity     The velocity state, the same shape as \p weights.
+ *  \param learningRate Scalar float tensor with the learning rate.
+ *  \param lossScale    Scalar float tensor with the loss scale the gradients
+ *                      are multiplied by.
+ *  \param params       Hyperparameters of the update.
+ *  \param prog         Sequence to add the update to.
+ *  \param debugContext Optional debug information.
+ */
+void momentumUpdate(poplar::Graph &graph, const poplar::Tensor &weights,
+                    const poplar::Tensor &grads,
+                    const poplar::Tensor &velocity,
+                    const poplar::Tensor &learningRate,
+                    const poplar::Tensor &lossScale,
+                    const MomentumParams &params,
+                    poplar::program::Sequence &prog,
+                    const poplar::DebugContext &debugContext = {});
+
+/** Adam update of the weights and the first and second moments in a single
+ *  pass:
+ *
+ *    g = grads / lossScale
+ *    m = beta1 * m + (1 - beta1) * g
+ *    v = beta2 * v + (1 - beta2) * g * g
+ *    u = m / (sqrt(v) + epsilon) + weightDecay * weights
+ *    weights -= learningRate * u
+ *
+ *  Bias correction is not applied, it can be folded into \p learningRate by
+ *  the caller. Types are as for momentumUpdate().
+ *
+ *  \param graph        The graph to add the vertices to.
+ *  \param weights      The weights to update in place.
+ *  \param grads        The loss scaled gradients.
+ *  \param m            The first moment state.
+ *  \param v            The second moment state.
+ *  \param learningRate Scalar float tensor with the learning rate.
+ *  \param lossScale    Scalar float tensor with the loss scale.
+ *  \param params       Hyperparameters of the update.
+ *  \param prog         Sequence to add the update to.
+ *  \param debugContext Optional debug information.
+ */
+void adamUpdate(poplar::Graph &graph, const poplar::Tensor &weights,
+                const poplar::Tensor &grads, const poplar::Tensor &m,
+                const poplar::Tensor &v, const poplar::Tensor &learningRate,
+                const poplar::Tensor &lossScale, const AdamParams &params,
+                poplar::program::Sequence &prog,
+                const poplar::DebugContext &debugContext = {});
+
+/** LAMB update, the Adam update scaled by the layer-wise trust ratio
+ *  |weights| / |u| where u is the Adam update direction. The trust ratio is 1
+ *  if either norm is zero. The whole of \p weights is treated as one layer.
+ *
+ *  This takes two passes: the first updates the moments and accumulates both
+ *  norms, the second applies the update.
+ *
+ *  Parameters are as for adamUpdate().
+ */
+void lambUpdate(poplar::Graph &graph, const poplar::Tensor &weights,
+                const poplar::Tensor &grads, const poplar::Tensor &m,
+                const poplar::Tensor &v, const poplar::Tensor &learningRate,
+                const poplar::Tensor &lossScale, const AdamParams &params,
+                poplar::program::Sequence &prog,
+                const poplar::DebugContext &debugContext = {});
+
+} // namespace popops
+
+#endif // popops_OptimiserUpdate_hpp
@@ -8,6 +8,7 @@
 #ifndef popops_Scatter_hpp
 #define popops_Scatter_hpp
 #include <poplar/Graph.hpp>
+#include <poplar/OptionFlags.hpp>
 #include <poplar/Program.hpp>
 
 namespace popops {
@@ -36,6 +37,17 @@ namespace popops {
  *                                      to be one-to-one and total.
  *  \param prog                         The program to be extended.
  *  \param debugContext                 Optional debug information.
+ *  \param options                      Scatter options.
+ *
+ * **Scatter options**
+ *
+ *    * `enableMultiUpdate` (true, false) [=true]
+ *
+ *      If true, a scatter where each index selects one whole slice of
+ *      \p operand in a single dimension is implemented with one
+ *      multiUpdate() of all the slices, and indices outside \p operand are
+ *      ignored. Otherwise, and for all other scatters, the indices are
+ *      processed one at a time in a loop.
  *
  *  \note This is a near direct port of
  * https://www.tensorflow.org/xla/operation_semantics#scatter from
@@ -47,7 +59,8 @@ void scatter(poplar::Graph &graph, const poplar::Tensor &operand,
              std::vector<std::size_t> insertWindowDims,
              std::vector<unsigned> scatterDimsToOperandDims,
              poplar::program::Sequence &prog,
-             const poplar::DebugContext &debugContext = {});
+             const poplar::DebugContext &debugContext = {},
+             const poplar::OptionFlags &options = {});
 
 using UpdateComputationFunc = std::function<poplar::Tensor(
     poplar::Graph &, poplar::Tensor &, poplar::Tensor &,
@@ -80,6 +93,7 @@ using UpdateComputationFunc = std::function<poplar::Tensor(
  *                           scatter.
  *  \param prog                         The program to be extended.
  *  \param debugContext                 Optional debug information.
+ *  \param options                      Scatter options, see scatter().
  *
  *  \note The first tensor parameter that is passed into the updateComputation
  *        will always be the current value from the operand tensor and the
@@ -94,7 +108,8 @@ void scatter(poplar::Graph &graph, const poplar::Tensor &operand,
              std::vector<unsigned> scatterDimsToOperandDims,
              UpdateComputationFunc &updateComputation,
              poplar::program::Sequence &prog,
-             const poplar::DebugContext &debugContext = {});
+             const poplar::DebugContext &debugContext = {},
+             const poplar::OptionFlags &options = {});
 
 } // namespace popops
 
@@ -46,6 +46,16 @@ namespace dynamic {
  *
  *      If set, forces the same buckets to be used for all three passes.
  *
+ *    * `allowDenseFallback` (true, false) [=false]
+ *
+ *      If set, the planner also estimates the cost of the equivalent dense
+ *      matrix multiplications and, if they are faster, holds the weights
+ *      densely and uses them instead. The non-zero values then hold all the
+ *      weights in row-major order and the meta-information holds a mask of
+ *      the sparsity pattern. Weights created this way must be written and
+ *      read through a host Partitioner created with the same options. Only
+ *      supported for a single group.
+ *
  *
  * \param graph The Poplar graph.
  * \param inputType The type for inputs to the operation.
@@ -40,6 +40,12 @@ class MatMulParams;
  *      sparse (left-hand) operand is transposed or not. Saves memory
  *      at the expense of runtime.
  *
+ *    * `allowDenseFallback` (true, false) [=false]
+ *
+ *      If set, the sparse operand may be held densely and the operation
+ *      implemented as a dense matrix multiplication when that is estimated
+ *      to be faster. See createFullyConnectedWeights() for details.
+ *
  * \param graph     The Poplar graph.
  * \param inputType The type for inputs to the operation.
  * \param params    Parameters for the matrix multiplication.
@@ -5,6 +5,8 @@
 #ifndef _poplibs_popsparse_SparseStorageFormats_hpp_
 #define _poplibs_popsparse_SparseStorageFormats_hpp_
 
+#include <array>
+#include <utility>
 #include <vector>
 
 namespace popsparse {
@@ -176,5 +178,46 @@ template <typename T> struct CSRMatrix : Block {
   CSRMatrix(const CSRMatrix &) = default;
 };
 
+/// Sparse matrix of size [M x K] with N:M structured sparsity: each group of
+/// \c m consecutive columns of a row has at most \c n non-zero values. Every
+/// group stores exactly \c n values, padded with zeros, so a row holds
+/// (K / m) * n values and the position of the values needs no row or column
+/// indices.
+template <typename T> struct NMMatrix {
+  /// Number of rows of the matrix.
+  std::size_t numRows;
+
+  /// Number of columns of the matrix, an integer multiple of \c m.
+  std::size_t numColumns;
+
+  /// Maximum number of non-zero values in each group.
+  unsigned n;
+
+  /// Number of columns in each group.
+  unsigned m;
+
+  /// The \c n values of each group, group by group in row-major order.
+  std::vector<T> nzValues;
+
+  /// One entry per group, in the same order as \c nzValues. The column in the
+  /// group of its i-th value is held in bits [i * b, (i + 1) * b) where b is
+  /// the number of bits needed to represent m - 1 (at least 1). Columns of
+  /// a group are distinct and in increasing order.
+  std::vector<unsigned short> metaInfo;
+
+  NMMatrix(std::size_t numRows, std::size_t numColumns, unsigned n, unsigned m,
+           std::vector<T> nzValues, std::vector<unsigned short> metaInfo)
+      : numRows(numRows), numColumns(numColumns), n(n), m(m),
+        nzValues(std::move(nzValues)), metaInfo(std::move(metaInfo)) {}
+
+  /// Constructor to allocate memory.
+  NMMatrix(std::size_t numRows, std::size_t numColumns, unsigned n, unsigned m)
+      : numRows(numRows), numColumns(numColumns), n(n), m(m),
+        nzValues(numRows * (numColumns / m) * n),
+        metaInfo(numRows * (numColumns / m)) {}
+
+  NMMatrix(const NMMatrix &) = default;
+};
+
 } // namespace popsparse
 #endif // _poplibs_popsparse_SparseStorageFormats_hpp_
@@ -238,7 +238,25 @@ poplar::Tensor createBSMatMulInputRHS(poplar::Graph &graph,
  *                          graph is created for each non zero blocks, a
  *                          greedy algorithm is used to partition the graph;
  *                          if it is "strip", the graph is created for columns
- *                          or rows.
+ *                          or rows;
+ *                          if it is "auto", the "strip", "block",
+ *                          "block-naive" and "block-group2" partitions are
+ *                          made in parallel and the one with the lowest
+ *                          estimated maximum memory and compute per tile,
+ *                          weighted by "memoryCycleRatio", is used.
+ *
+ *                        option "partitionCacheDir": partitions of identical
+ *                        hypergraphs are reused within a process; if this is
+ *                        set, they are also stored in and read from files in
+ *                        this directory, so later runs reuse them. The
+ *                        directory must exist.
+ *
+ *                        option "hypergraphPartitioner": the partitioner used
+ *                        by the "strip", "stripv0" and "block" partition
+ *                        methods. If it is "zoltan", the default, Zoltan is
+ *                        used; if it is "multilevel", the built-in multilevel
+ *                        hypergraph partitioner is used, which runs in
+ *                        parallel and usually cuts fewer hyperedges.
  *
  * \param debugContext    Optional debug information.
  * \returns               The tensor holding the result of the
@@ -255,6 +273,74 @@ poplar::Tensor bsMatMul(poplar::Graph &graph, const BSMatMulParams &bsMatMul,
                         const poplar::OptionFlags &options = {},
                         const poplar::DebugContext &debugContext = {});
 
+/* This function computes block-sparse attention,
+ * softmax(query * key^T) * value, where only the non zero blocks of the
+ * scores query * key^T are computed.
+ *
+ * It fuses a dense x dense = sparse bsMatMul, a bsSoftmax and a
+ * dense x sparse = dense bsMatMul. The graph is partitioned once: each block
+ * row of the scores is put on one tile, which computes its blocks, their
+ * softmax and the matching rows of the output. Only the query, key and value
+ * blocks are exchanged; the scores never leave their tile.
+ *
+ * \param graph           The Poplar graph.
+ *
+ * \param query           The query matrix, [query rows, depth].
+ *                        For group operation, it should be concatenated
+ *                        along 0 dimension for all groups.
+ *
+ * \param key             The key matrix, [key rows, depth].
+ *                        For group operation, it should be concatenated
+ *                        along 0 dimension for all groups.
+ *
+ * \param value           The value matrix, [key rows, value depth].
+ *                        For group operation, it should be concatenated
+ *                        along 0 dimension for all groups.
+ *
+ * \param blockSize       The block size of the query rows, of the depth and
+ *                        value depth, and of the key rows. The block
+ *                        multiplications need the block sizes of the depth
+ *                        and of the key rows to be multiples of 8 for FLOAT
+ *                        and of 16 for HALF, and the block size of the query
+ *                        rows to be even.
+ *
+ * \param sparsity        The 2D sparsity mask of the scores, [query rows /
+ *                        blockSize[0], key rows / blockSize[2]], in which '1'
+ *                        is a non zero block and '0' is a zero block.
+ *                        For group operation, the masks of all groups are
+ *                        concatenated.
+ *
+ * \param subBlockMask    Sub-block mask type of the scores, as for bsSoftmax.
+ *
+ * \param numGroups       The number of groups, for example batch x heads, or
+ *                        1 for non-group operation.
+ *
+ * \param prog            A reference to a program sequence which will
+ *                        be appended with the code to perform the attention.
+ *
+ * \param options         option "hypergraphPartitioner": the partitioner used
+ *                        to put the block rows on tiles so that the key and
+ *                        value blocks are shared by as few tiles as possible,
+ *                        "zoltan", the default, or "multilevel".
+ *
+ *                        option "partitionCacheDir": as for bsMatMul.
+ *
+ * \param debugContext    Optional debug information.
+ *
+ * \returns               The attention output, [query rows, value depth],
+ *                        concatenated along 0 dimension for all groups.
+ *                        The scores are not scaled; scale the query for that.
+ */
+poplar::Tensor bsAttention(poplar::Graph &graph, const poplar::Tensor &query,
+                           const poplar::Tensor &key,
+                           const poplar::Tensor &value,
+                           const std::array<int, 3> &blockSize,
+                           const std::vector<unsigned char> &sparsity,
+                           SubBlockMask subBlockMask, unsigned numGroups,
+                           poplar::program::Sequence &prog,
+                           const poplar::OptionFlags &options = {},
+                           const poplar::DebugContext &debugContext = {});
+
 } // namespace experimental
 } // namespace popsparse
 
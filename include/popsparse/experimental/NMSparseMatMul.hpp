@@ -0,0 +1,180 @@
+// Copyright (c) 2020 Graphcore Ltd. All rights reserved.
+
+#ifndef POPSPARSE_NM_SPARSE_MATMUL_H
+#define POPSPARSE_NM_SPARSE_MATMUL_H
+
+#include <poplar/Graph.hpp>
+#include <poplar/OptionFlags.hpp>
+#include <poplar/Program.hpp>
+#include <popsparse/SparseStorageFormats.hpp>
+
+namespace popsparse {
+namespace experimental {
+
+/**
+ * Shape of a fully connected layer whose weights have N:M structured
+ * sparsity: each group of \c m consecutive columns of a row of the weights has
+ * at most \c n non-zero values.
+ *
+ * The weights are [numRows x numColumns], the activations are
+ * [batchSize x numColumns] and the output is [batchSize x numRows].
+ *
+ * \c numColumns must be an integer multiple of \c m, and \c n times the
+ * number of bits needed to represent m - 1 must be at most 16 (so any n for
+ * m = 4, or n <= 4 for m = 16).
+ */
+struct NMMatMulParams {
+  unsigned n;
+  unsigned m;
+  std::size_t numRows;
+  std::size_t numColumns;
+  std::size_t batchSize;
+};
+
+/**
+ * N:M structured sparse weights on the device, in the layout of
+ * \c popsparse::NMMatrix.
+ *
+ * \c nzValues is [numRows x (numColumns / m) * n] and \c metaInfo is
+ * [numRows x numColumns / m] of type UNSIGNED_SHORT, so that an NMMatrix
+ * built on the host can be written to them directly.
+ */
+struct NMSparseTensor {
+  poplar::Tensor nzValues;
+  poplar::Tensor metaInfo;
+};
+
+/**
+ * Convert a dense matrix to the N:M format, keeping the \c n values of
+ * largest magnitude in each group of \c m columns (the lowest column wins
+ * a tie).
+ *
+ * \param dense       The values of the matrix in row-major order.
+ * \param numRows     Number of rows of the matrix.
+ * \param numColumns  Number of columns of the matrix.
+ * \param n           Number of values kept in each group.
+ * \param m           Number of columns in each group.
+ */
+template <typename T>
+NMMatrix<T> denseToNM(const std::vector<T> &dense, std::size_t numRows,
+                      std::size_t numColumns, unsigned n, unsigned m);
+
+/**
+ * Convert an element-wise sparse CSR matrix to the N:M format.
+ *
+ * Throws if a group of \c m columns of a row has more than \c n non-zero
+ * values. Groups with fewer are padded with zeros.
+ */
+template <typename T>
+NMMatrix<T> csrToNM(const CSRMatrix<T> &csr, std::size_t numRows,
+                    std::size_t numColumns, unsigned n, unsigned m);
+
+/// Convert an N:M matrix to a dense matrix in row-major order.
+template <typename T> std::vector<T> nmToDense(const NMMatrix<T> &nm);
+
+/**
+ * Create the weights of an N:M sparse fully connected layer.
+ *
+ * The following options are available:
+ *
+ *    * `partialsType` poplar::Type [=poplar::FLOAT]
+ *
+ *      The type to use for partial results. HALF is only allowed for HALF
+ *      inputs.
+ *
+ * \param graph        The Poplar graph.
+ * \param inputType    The type of the non-zero values.
+ * \param params       Parameters of the layer.
+ * \param debugContext Optional debug information.
+ * \param options      Implementation options.
+ *
+ * \returns The non-zero values and meta-information of the weights.
+ */
+NMSparseTensor createNMSparseWeights(
+    poplar::Graph &graph, const poplar::Type &inputType,
+    const NMMatMulParams &params, const poplar::DebugContext &debugContext = {},
+    const poplar::OptionFlags &options = {});
+
+/**
+ * Create the activations of an N:M sparse fully connected layer.
+ *
+ * \returns A tensor of shape [batchSize x numColumns].
+ */
+poplar::Tensor createNMSparseInput(
+    poplar::Graph &graph, const poplar::Type &inputType,
+    const NMMatMulParams &params, const poplar::DebugContext &debugContext = {},
+    const poplar::OptionFlags &options = {});
+
+/**
+ * Compute activations * transpose(weights) for N:M sparse weights.
+ *
+ * Every row of the weights holds the same number of non-zero values, so the
+ * work is split evenly over tiles: each tile computes the output of a range
+ * of rows of the weights for a range of the batch. The number of ranges is
+ * chosen from an estimate of the compute and exchange cycles, and is the one
+ * the weights and activations are created with.
+ *
+ * \param graph        The Poplar graph.
+ * \param weights      The N:M sparse weights.
+ * \param activations  Dense activations of shape [batchSize x numColumns].
+ * \param params       Parameters of the layer.
+ * \param prog         A reference to a program sequence which will be
+ *                     appended with the code to perform the multiplication.
+ * \param debugContext Optional debug information.
+ * \param options      Implementation options. See
+ *                     \c createNMSparseWeights().
+ *
+ * \returns A tensor of shape [batchSize x numRows].
+ */
+poplar::Tensor nmSparseMatMul(poplar::Graph &graph,
+                              const NMSparseTensor &weights,
+                              const poplar::Tensor &activations,
+                              const NMMatMulParams &params,
+                              poplar::program::Sequence &prog,
+                              const poplar::DebugContext &debugContext = {},
+                              const poplar::OptionFlags &options = {});
+
+/**
+ * Compute the gradient of the activations, gradients * weights, for N:M
+ * sparse weights.
+ *
+ * The ranges of rows and of the batch are chosen for this pass, including
+ * the reduction of the partial sums of the ranges of rows, so the weights
+ * may be exchanged from their forward layout.
+ *
+ * \param gradients    Gradients of the output of shape [batchSize x numRows].
+ *
+ * \returns A tensor of shape [batchSize x numColumns].
+ */
+poplar::Tensor nmSparseMatMulGradA(
+    poplar::Graph &graph, const NMSparseTensor &weights,
+    const poplar::Tensor &gradients, const NMMatMulParams &params,
+    poplar::program::Sequence &prog,
+    const poplar::DebugContext &debugContext = {},
+    const poplar::OptionFlags &options = {});
+
+/**
+ * Compute the gradient of the non-zero values of N:M sparse weights, that is
+ * transpose(gradients) * activations sampled at the positions given by the
+ * meta-information.
+ *
+ * The ranges of rows and of the batch are chosen for this pass, including
+ * the reduction of the partial sums of the ranges of the batch.
+ *
+ * \param metaInfo     Meta-information of the weights.
+ * \param gradients    Gradients of the output of shape [batchSize x numRows].
+ * \param activations  Activations of shape [batchSize x numColumns].
+ *
+ * \returns A tensor with the shape of the non-zero values of the weights.
+ */
+poplar::Tensor nmSparseMatMulGradW(
+    poplar::Graph &graph, const poplar::Tensor &metaInfo,
+    const poplar::Tensor &gradients, const poplar::Tensor &activations,
+    const NMMatMulParams &params, poplar::program::Sequence &prog,
+    const poplar::DebugContext &debugContext = {},
+    const poplar::OptionFlags &options = {});
+
+} // namespace experimental
+} // namespace popsparse
+
+#endif // POPSPARSE_NM_SPARSE_MATMUL_H
@@ -95,6 +95,60 @@ void iterateTensorPartitions(
     const std::function<void(const std::vector<std::size_t> &i,
                              const poplar::Tensor &s)> &f);
 
+/// Statistics of the layout introspection cache of a graph.
+struct IntrospectionCacheStats {
+  /// The number of queries answered from the cache.
+  std::size_t hits = 0;
+  /// The number of queries that had to inspect the graph.
+  std::size_t misses = 0;
+  /// The number of cached tensor layouts dropped by invalidation.
+  std::size_t invalidations = 0;
+};
+
+/** Cache layout introspection of tensors in \p graph for the lifetime of
+ *  this object.
+ *
+ *  detectInnermostGrouping() and detectDimGroupings() are called repeatedly
+ *  on the same tensors while a model is constructed, and each call inspects
+ *  the contiguity and tile mapping of the tensor again. While a scope is alive
+ *  their results are cached, keyed by the shape of the tensor and the
+ *  variable regions it is made from, so a tensor with the same layout as one
+ *  already inspected is served from the cache.
+ *
+ *  Poplar does not report changes to the tile mapping of a variable. The
+ *  functions in poputil that map tensors (mapTensorLinearly(),
+ *  TensorUseTracker::mapTensorsByUse(), cloneToIpu() and
+ *  createBroadcastOperand()) invalidate the cache themselves; other code
+ *  that calls Graph::setTileMapping() on a tensor that may already have been
+ *  inspected must call invalidateIntrospectionCache(). Scopes may be nested;
+ *  the cache is cleared when the outermost scope ends. Each virtual graph has
+ *  its own cache.
+ */
+class IntrospectionCacheScope {
+public:
+  explicit IntrospectionCacheScope(const poplar::Graph &graph);
+  ~IntrospectionCacheScope();
+  IntrospectionCacheScope(const IntrospectionCacheScope &) = delete;
+  IntrospectionCacheScope &operator=(const IntrospectionCacheScope &) = delete;
+
+private:
+  const poplar::Graph &graph;
+};
+
+/** Drop the cached layout of every tensor that shares a variable with \p t.
+ *  This must be called after changing the tile mapping of \p t while an
+ *  IntrospectionCacheScope is alive for \p graph.
+ */
+void invalidateIntrospectionCache(const poplar::Graph &graph,
+                                  const poplar::Tensor &t);
+
+/// Drop every cached layout of \p graph.
+void invalidateIntrospectionCache(const poplar::Graph &graph);
+
+/// The statistics of the introspection cache of \p graph since its outermost
+/// IntrospectionCacheScope began. All zero if there is no scope.
+IntrospectionCacheStats getIntrospectionCacheStats(const poplar::Graph &graph);
+
 } // end namespace poputil
 
 #endif // poputil_VarStructure_hpp
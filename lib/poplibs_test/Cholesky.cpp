@@ -0,0 +1,102 @@
+// Copyright (c) 2020 Graphcore Ltd. All rights reserved.
+#include "poplibs_test/Cholesky.hpp"
+
+#include <poputil/exceptions.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace poplibs_test {
+namespace cholesky {
+
+void cholesky(const boost::multi_array<double, 3> &a,
+              boost::multi_array<double, 3> &factor, bool lower) {
+  const auto batches = a.shape()[0];
+  const auto n = a.shape()[1];
+  if (a.shape()[2] != n) {
+    throw poputil::poplibs_error("Matrices must be square");
+  }
+  if (factor.shape()[0] != batches || factor.shape()[1] != n ||
+      factor.shape()[2] != n) {
+    throw poputil::poplibs_error("Factor shape does not match input shape");
+  }
+
+  // element (i, j) of the lower triangle, read from the upper triangle when
+  // factorising A = U' * U
+  const auto elem = [&](std::size_t b, std::size_t i, std::size_t j) {
+    return lower ? a[b][i][j] : a[b][j][i];
+  };
+
+  for (std::size_t b = 0; b != batches; ++b) {
+    boost::multi_array<double, 2> l(boost::extents[n][n]);
+    std::fill(l.data(), l.data() + l.num_elements(), 0.0);
+    for (std::size_t j = 0; j != n; ++j) {
+      double d = elem(b, j, j);
+      for (std::size_t k = 0; k != j; ++k) {
+        d -= l[j][k] * l[j][k];
+      }
+      if (d <= 0) {
+        throw poputil::poplibs_error("Matrix is not positive definite");
+      }
+      l[j][j] = std::sqrt(d);
+      for (std::size_t i = j + 1; i != n; ++i) {
+        double s = elem(b, i, j);
+        for (std::size_t k = 0; k != j; ++k) {
+          s -= l[i][k] * l[j][k];
+        }
+        l[i][j] = s / l[j][j];
+      }
+    }
+    for (std::size_t i = 0; i != n; ++i) {
+      for (std::size_t j = 0; j != n; ++j) {
+        factor[b][i][j] = lower ? l[i][j] : l[j][i];
+      }
+    }
+  }
+}
+
+void choleskySolve(const boost::multi_array<double, 3> &a,
+                   const boost::multi_array<double, 3> &b,
+                   boost::multi_array<double, 3> &x, bool lower) {
+  const auto batches = a.shape()[0];
+  const auto n = a.shape()[1];
+  const auto k = b.shape()[2];
+  if (b.shape()[0] != batches || b.shape()[1] != n) {
+    throw poputil::poplibs_error("Shape of B does not match shape of A");
+  }
+  if (x.shape()[0] != batches || x.shape()[1] != n || x.shape()[2] != k) {
+    throw poputil::poplibs_error("Shape of X does not match shape of B");
+  }
+
+  boost::multi_array<double, 3> factor(boost::extents[batches][n][n]);
+  cholesky(a, factor, lower);
+  const auto l = [&](std::size_t g, std::size_t i, std::size_t j) {
+    return lower ? factor[g][i][j] : factor[g][j][i];
+  };
+
+  for (std::size_t g = 0; g != batches; ++g) {
+    for (std::size_t c = 0; c != k; ++c) {
+      // L * Y = B
+      std::vector<double> y(n);
+      for (std::size_t i = 0; i != n; ++i) {
+        double s = b[g][i][c];
+        for (std::size_t j = 0; j != i; ++j) {
+          s -= l(g, i, j) * y[j];
+        }
+        y[i] = s / l(g, i, i);
+      }
+      // L' * X = Y
+      for (std::size_t i = n; i-- != 0;) {
+        double s = y[i];
+        for (std::size_t j = i + 1; j != n; ++j) {
+          s -= l(g, j, i) * x[g][j][c];
+        }
+        x[g][i][c] = s / l(g, i, i);
+      }
+    }
+  }
+}
+
+} // namespace cholesky
+} // namespace poplibs_test
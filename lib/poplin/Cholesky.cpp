@@ -0,0 +1,291 @@
+// Copyright (c) 2020 Graphcore Ltd. All rights reserved.
+#include "poplin/Cholesky.hpp"
+#include "poplin/MatMul.hpp"
+#include "poplin/TriangularSolve.hpp"
+#include "popops/ElementWise.hpp"
+#include "popops/Expr.hpp"
+#include "popops/Zero.hpp"
+#include "poputil/DebugInfo.hpp"
+#include "poputil/GraphFunction.hpp"
+#include "poputil/TileMapping.hpp"
+#include "poputil/exceptions.hpp"
+
+namespace pe = popops::expr;
+
+namespace poplin {
+namespace {
+
+struct CholeskyParams {
+  std::size_t blockSize;
+  poplar::OptionFlags options;
+  matmul::PlanningCache *cache;
+  poplar::Tensor l;
+  mutable std::unique_ptr<poputil::graphfn::VoidFunction> factoriser;
+
+  CholeskyParams(std::size_t blockSize, poplar::OptionFlags options,
+                 matmul::PlanningCache *cache)
+      : blockSize(blockSize), options(options), cache(cache) {}
+};
+
+poplar::Tensor transpose(const poplar::Tensor &a) {
+  auto ndims = a.rank();
+  return a.dimShufflePartial({ndims - 2, ndims - 1}, {ndims - 1, ndims - 2});
+}
+
+// Unblocked column by column factorisation of a [B, N, N] block, writing the
+// lower factor into l:
+//   L[j][j] = sqrt(A[j][j] - L[j][:j] * L[j][:j]^T)
+//   L[j+1:][j] = (A[j+1:][j] - L[j+1:][:j] * L[j][:j]^T) / L[j][j]
+void factoriseBlock(poplar::Graph &graph, const poplar::Tensor &a,
+                    const poplar::Tensor &l, const CholeskyParams &params,
+                    poplar::program::Sequence &prog,
+                    const poplar::DebugNameAndId &dnai) {
+  auto n = a.dim(2);
+  auto totalBatches = a.dim(0);
+
+  for (std::size_t j = 0; j < n; ++j) {
+    auto ajj = a.slice({0, j, j}, {totalBatches, j + 1, j + 1});
+    auto row = l.slice({0, j, 0}, {totalBatches, j + 1, j});
+
+    poplar::Tensor d;
+    if (j == 0) {
+      d = popops::sqrt(graph, ajj, prog, {dnai, "diag0"});
+    } else {
+      auto dot = poplin::matMulGrouped(
+          graph, row, row.dimShuffle({0, 2, 1}), prog, a.elementType(),
+          {dnai, "dotDiag" + std::to_string(j)}, params.options, params.cache);
+      d = popops::map(graph, pe::Sqrt(pe::Sub(pe::_1, pe::_2)), {ajj, dot},
+                      prog, {dnai, "diag" + std::to_string(j)});
+    }
+    prog.add(poplar::program::Copy(
+        d, l.slice({0, j, j}, {totalBatches, j + 1, j + 1}), false, {dnai}));
+
+    if (j + 1 == n) {
+      break;
+    }
+
+    auto aCol = a.slice({0, j + 1, j}, {totalBatches, n, j + 1});
+    auto dCol = d.broadcast(n - j - 1, 1);
+    poplar::Tensor col;
+    if (j == 0) {
+      col = popops::div(graph, aCol, dCol, prog, {dnai, "column0"});
+    } else {
+      auto below = l.slice({0, j + 1, 0}, {totalBatches, n, j});
+      auto dot = poplin::matMulGrouped(
+          graph, below, row.dimShuffle({0, 2, 1}), prog, a.elementType(),
+          {dnai, "dotColumn" + std::to_string(j)}, params.options,
+          params.cache);
+      col = popops::map(graph, pe::Divide(pe::Sub(pe::_1, pe::_2), pe::_3),
+                        {aCol, dot, dCol}, prog,
+                        {dnai, "column" + std::to_string(j)});
+    }
+    prog.add(poplar::program::Copy(
+        col, l.slice({0, j + 1, j}, {totalBatches, n, j + 1}), false, {dnai}));
+  }
+}
+
+void factorise(poplar::Graph &graph, const poplar::Tensor &a, std::size_t pos,
+               const CholeskyParams &params, poplar::program::Sequence &prog,
+               const poplar::DebugNameAndId &dnai) {
+  if (a.rank() != 3) {
+    throw poputil::poplibs_error("factorise: invalid rank of tensor A");
+  }
+
+  auto n = a.dim(2);
+  auto totalBatches = a.dim(0);
+
+  if (n > params.blockSize) {
+    // A11           L11           L11^T L21^T
+    // A21 A22   =   L21 L22   *         L22^T
+
+    // Recursively splitting it:
+    // A11 = L11 * L11^T
+    // L21 * L11^T = A21
+    // A22 - L21 * L21^T = L22 * L22^T
+    auto n2 = n >> 1;
+    auto a11 = a.slice({0, 0, 0}, {totalBatches, n2, n2});
+    auto a21 = a.slice({0, n2, 0}, {totalBatches, n, n2});
+    auto a22 = a.slice({0, n2, n2}, {totalBatches, n, n});
+
+    factorise(graph, a11, pos, params, prog, {dnai, "L11"});
+
+    auto l11 =
+        params.l.slice({0, pos, pos}, {totalBatches, pos + n2, pos + n2});
+    auto l21 = triangularSolve(graph, l11.dimShuffle({0, 2, 1}), a21, false,
+                               false, false, params.blockSize, prog,
+                               {dnai, "L21"}, params.options, params.cache);
+    prog.add(poplar::program::Copy(
+        l21,
+        params.l.slice({0, pos + n2, pos}, {totalBatches, pos + n, pos + n2}),
+        false, {dnai}));
+
+    auto l21l21t = matMulGrouped(graph, l21, l21.dimShuffle({0, 2, 1}), prog,
+                                 a.elementType(), {dnai, "L21*L21'"},
+                                 params.options, params.cache);
+    auto s22 = popops::sub(graph, a22, l21l21t, prog, {dnai, "A22-L21*L21'"});
+
+    factorise(graph, s22, pos + n2, params, prog, {dnai, "L22"});
+  } else {
+    // direct factorisation of the diagonal block
+    auto dst = params.l.slice({0, pos, pos}, {totalBatches, pos + n, pos + n});
+    if (!params.factoriser) {
+      params.factoriser.reset(new poputil::graphfn::VoidFunction(
+          graph, {poputil::graphfn::input(a), poputil::graphfn::inout(dst)},
+          [&graph, &params, &dnai](std::vector<poplar::Tensor> &args,
+                                   poplar::program::Sequence &prog) {
+            factoriseBlock(graph, args.at(0), args.at(1), params, prog, dnai);
+          },
+          false));
+    }
+
+    std::vector<poplar::Tensor> args{a, dst};
+    (*params.factoriser)(args, prog);
+  }
+}
+
+void validateInput(const poplar::Tensor &a) {
+  auto ndims = a.rank();
+  if (ndims < 2) {
+    throw poputil::poplibs_error("tensor A must have rank of 2 or higher.");
+  }
+
+  auto n = a.dim(ndims - 1);
+  auto m = a.dim(ndims - 2);
+  if (n != m) {
+    throw poputil::poplibs_error(
+        "2 minor dimension of tensor A must have the same size.");
+  }
+}
+
+} // anonymous namespace
+
+poplar::Tensor cholesky(poplar::Graph &graph, const poplar::Tensor &a,
+                        bool lower, std::size_t blockSize,
+                        poplar::program::Sequence &prog,
+                        const poplar::DebugContext &debugContext,
+                        poplar::OptionFlags options,
+                        matmul::PlanningCache *cache) {
+  poputil::PoplibsOpDebugInfo di(
+      debugContext, DI_ARGS(a, lower, blockSize, options, cache));
+
+  validateInput(a);
+  if (blockSize == 0) {
+    throw poputil::poplibs_error("blockSize must be greater than zero");
+  }
+
+  auto aRank = a.rank();
+  auto an = a.dim(aRank - 1);
+
+  // if we have any batch dimensions, flatten them into single one
+  // if we have tensors of rank 2, expand with singlular batch dimension
+  auto batchA = aRank >= 3 ? a.flatten(0, aRank - 2) : a.expand({0});
+
+  // A = U^T * U is effectively A^T = L * L^T with L = U^T, so the upper
+  // factorisation reads the transposed lower triangle.
+  if (!lower) {
+    batchA = batchA.dimShuffle({0, 2, 1});
+  }
+
+  auto totalBatches = batchA.dim(0);
+
+  // even though cache == null, matmul could benefit of planning cache,
+  // provide local ephemeral cache for the factorisation only.
+  matmul::PlanningCache localCache;
+  CholeskyParams params(blockSize, options, cache ? cache : &localCache);
+
+  std::size_t paddedSize = blockSize;
+  while (paddedSize < an) {
+    paddedSize <<= 1;
+  }
+  std::size_t toPad = an > blockSize ? paddedSize - an : 0;
+
+  if (toPad) {
+    // extend A with an identity block so the factor of the padded matrix is
+    // the factor of A extended with the same identity block:
+    //  A  A  A  0  0
+    //  A  A  A  0  0
+    //  A  A  A  0  0
+    //  0  0  0  1  0
+    //  0  0  0  0  1
+    auto zero = graph.addConstant(a.elementType(), {1, 1, 1}, 0.0f,
+                                  {di, "const:0"});
+    graph.setTileMapping(zero, 0);
+
+    std::vector<float> identityValues(toPad * toPad, 0.0f);
+    for (std::size_t i = 0; i < toPad; ++i) {
+      identityValues[i * toPad + i] = 1.0f;
+    }
+    auto identity =
+        graph.addConstant<float>(a.elementType(), {1, toPad, toPad},
+                                 identityValues, {di, "const:identity"});
+    graph.setTileMapping(identity, 0);
+
+    auto paddingRight = zero.broadcast(toPad, 2)
+                            .broadcast(an, 1)
+                            .broadcast(totalBatches, 0);
+    auto paddingBottom = poplar::concat(
+        zero.broadcast(an, 2).broadcast(toPad, 1).broadcast(totalBatches, 0),
+        identity.broadcast(totalBatches, 0), 2);
+
+    batchA = poplar::concat(batchA, paddingRight, 2);
+    batchA = poplar::concat(batchA, paddingBottom, 1);
+  }
+
+  auto l = graph.addVariable(a.elementType(), batchA.shape(), {di});
+  poputil::mapTensorLinearly(graph, l);
+  popops::zero(graph, l, prog, {di});
+  params.l = l;
+
+  factorise(graph, batchA, 0, params, prog, {di, "factorise"});
+
+  if (toPad) {
+    // remove padding
+    l = l.slice({0, 0, 0}, {totalBatches, an, an});
+  }
+
+  if (!lower) {
+    l = l.dimShuffle({0, 2, 1});
+  }
+
+  // restore batch dimensions
+  auto output = l.reshape(a.shape());
+  di.addOutput(output);
+  return output;
+}
+
+poplar::Tensor choleskySolve(poplar::Graph &graph, const poplar::Tensor &a,
+                             const poplar::Tensor &b, bool lower,
+                             std::size_t blockSize,
+                             poplar::program::Sequence &prog,
+                             const poplar::DebugContext &debugContext,
+                             poplar::OptionFlags options,
+                             matmul::PlanningCache *cache) {
+  poputil::PoplibsOpDebugInfo di(
+      debugContext, DI_ARGS(a, b, lower, blockSize, options, cache));
+
+  validateInput(a);
+  if (a.rank() != b.rank()) {
+    throw poputil::poplibs_error("ranks of tensors A and B must match");
+  }
+
+  // share the planning cache between the factorisation and both solves
+  matmul::PlanningCache localCache;
+  if (!cache) {
+    cache = &localCache;
+  }
+
+  // A = L * L^T: solve L * Y = B, then L^T * X = Y
+  auto factor = cholesky(graph, a, lower, blockSize, prog, {di, "cholesky"},
+                         options, cache);
+  auto l = lower ? factor : transpose(factor);
+
+  auto y = triangularSolve(graph, l, b, true, true, false, blockSize, prog,
+                           {di, "forwardSubstitution"}, options, cache);
+  auto x = triangularSolve(graph, transpose(l), y, true, false, false,
+                           blockSize, prog, {di, "backSubstitution"}, options,
+                           cache);
+  di.addOutput(x);
+  return x;
+}
+
+} // namespace poplin
@@ -5,6 +5,8 @@
 #include "poplibs_support/TileHierarchy.hpp"
 #include "poplibs_support/popopsPerformanceEstimation.hpp"
 #include <boost/functional/hash.hpp>
+#include <functional>
+#include <numeric>
 #include <poputil/exceptions.hpp>
 
 namespace poplin {
@@ -1638,6 +1640,31 @@ popsolver::Variable addCastEstimate(popsolver::Model &m,
       "castCycles");
 }
 
+// Each pass of the epilogue reads and writes every output of the tile once,
+// like the cast of the outputs.
+static popsolver::Variable
+addEpilogueEstimate(popsolver::Model &m, const poplar::Target &target,
+                    const popsolver::Variable outputsPerTile,
+                    const std::vector<ConvTypes> &types,
+                    const ConvOptions &options) {
+  const auto numPasses = options.numEpiloguePasses;
+  if (numPasses == 0) {
+    return m.addConstant(0, "epilogueCycles");
+  }
+  const auto numWorkers = target.getNumWorkerContexts();
+  const auto vectorWidth = target.getVectorWidth(types[0].resultType);
+  return m.call<unsigned>(
+      {outputsPerTile},
+      [numPasses, numWorkers,
+       vectorWidth](const std::vector<unsigned> &vars) -> popsolver::DataType {
+        const auto outputsPerTile = vars[0];
+        return popsolver::DataType{
+            numPasses * estimateCastCycles(outputsPerTile, vectorWidth,
+                                           vectorWidth, numWorkers)};
+      },
+      "epilogueCycles");
+}
+
 // estimation function for addInPlace accumulation of input-channel-serially
 // split convolution partials
 std::pair<popsolver::Variable, popsolver::Variable>
@@ -1946,6 +1973,10 @@ static SinglePassEstimates<popsolver::Variable> addEstimates(
   e.castCycles =
       addCastEstimate(m, target, outputsPerTile, intraTileSplits, types);
 
+  // The epilogue runs once on the whole output, after any serial splits.
+  e.epilogueCycles =
+      addEpilogueEstimate(m, target, outputsPerTile, types, options);
+
   e.totalExchangeCycles =
       m.sum({e.itemisedExchangeCycles.inputExchangeCycles,
              e.itemisedExchangeCycles.weightExchangeCycles,
@@ -1957,8 +1988,9 @@ static SinglePassEstimates<popsolver::Variable> addEstimates(
        e.totalExchangeCycles, e.tileLevelTransformCycles, e.partialCalcCycles,
        e.reduceCycles, e.dynamicUpdateCycles, e.addInPlaceCycles});
   e.totalCycles = m.product({e.totalCycles, serialSplits});
-  e.totalCycles = m.sum({e.memsetZeroBeforeAddInPlace, e.totalCycles,
-                         e.rearrangeBeforeSliceCycles, e.castCycles});
+  e.totalCycles =
+      m.sum({e.memsetZeroBeforeAddInPlace, e.totalCycles,
+             e.rearrangeBeforeSliceCycles, e.castCycles, e.epilogueCycles});
 
   // take the total amount of temp bytes alive at the same time.
   e.totalTempBytes =
@@ -2000,7 +2032,8 @@ static SinglePassEstimates<popsolver::Variable> addEstimates(
          posDiff(e.reduceCycles, c.reduceCycles),
          posDiff(e.dynamicUpdateCycles, c.dynamicUpdateCycles),
          posDiff(e.addInPlaceCycles, c.addInPlaceCycles),
-         posDiff(e.castCycles, c.castCycles)});
+         posDiff(e.castCycles, c.castCycles),
+         posDiff(e.epilogueCycles, c.epilogueCycles)});
   } else {
     e.totalPerStepCycleDiff = m.addConstant(popsolver::DataType::max());
   }
@@ -3364,4 +3397,35 @@ Estimates<popsolver::Variable> constructModel(
   return e;
 }
 
+popsolver::DataType
+getCyclesLowerBound(const poplar::Target &target,
+                    const std::vector<ConvTransform> &transforms,
+                    const std::vector<unsigned> &hierarchy,
+                    const ConvVertexType &convVertexType,
+                    const ConvParams &untransformedParams,
+                    PlanningCacheImpl::CycleEstimationImpl *cache) {
+  const auto convGroupGrainSize =
+      getConvGroupGrainSizes(transforms, convVertexType.convGroupsPerGroup);
+  const auto outChanGrainSize =
+      getOutChanGrainSizes(transforms, convVertexType.partialChansPerGroup);
+  const auto inChanGrainSize =
+      getInChanGrainSizes(transforms, convVertexType.inChansPerGroup);
+  const auto transformedOnceParams = std::get<1>(
+      applyTransform(untransformedParams, transforms[0], convGroupGrainSize[0],
+                     inChanGrainSize[0], outChanGrainSize[0]));
+
+  // The model requires the partial calculation on every used tile, repeated
+  // for each serial split, to take at least this many cycles. The total
+  // cycles include the partial calculation, so the same bound holds for them
+  // with every tile used. Exchange is not bounded: the operands may be laid
+  // out by the plan so no exchange is needed in the ideal case.
+  const auto numTiles = std::accumulate(hierarchy.begin(), hierarchy.end(),
+                                        std::uint64_t{1},
+                                        std::multiplies<std::uint64_t>());
+  const auto totalMacs = cache->mGetNumberOfMACs(transformedOnceParams);
+  const auto maxMACsPerCyclePerTile =
+      getMaxMACsPerCyclePerTile(target, convVertexType);
+  return popsolver::DataType{totalMacs / maxMACsPerCyclePerTile / numTiles};
+}
+
 } // namespace poplin
@@ -53,4 +53,15 @@ std::vector<ConvTypes> getConvTypesForDerivedJointPlan(
 unsigned getMaxMACsPerCyclePerTile(const poplar::Target &target,
                                    const ConvVertexType &convVertexType);
 
+// A lower bound on the total cycles of any plan that the model built by
+// constructModel() for these transforms and vertex type can find, from the
+// number of MACs and the peak MAC rate of the vertex type on every tile.
+popsolver::DataType
+getCyclesLowerBound(const poplar::Target &target,
+                    const std::vector<ConvTransform> &transforms,
+                    const std::vector<unsigned> &hierarchy,
+                    const ConvVertexType &convVertexType,
+                    const ConvParams &untransformedParams,
+                    PlanningCacheImpl::CycleEstimationImpl *cache);
+
 } // namespace poplin
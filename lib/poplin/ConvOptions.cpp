@@ -90,6 +90,8 @@ std::ostream &operator<<(std::ostream &os, const ConvOptions &opts) {
   os << opts.insertTransformsCycleCountProgs << "\n";
   os << "        enableTransformsConvTable       ";
   os << opts.enableTransformsConvTable << "\n";
+  os << "        numEpiloguePasses               ";
+  os << opts.numEpiloguePasses << "\n";
   return os;
 }
 
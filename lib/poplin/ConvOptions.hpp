@@ -65,6 +65,10 @@ public:
   bool insertTransformsCycleCountProgs = false;
   // Enables conversion table for transforms estimates
   bool enableTransformsConvTable = false;
+  // Number of elementwise passes over the output added by the epilogue of the
+  // convolution. Not an option flag, convolution() sets it from the Epilogue
+  // so that the planner costs those passes.
+  unsigned numEpiloguePasses = 0;
 
   void parseConvOptions(const poplar::OptionFlags &options);
 
@@ -80,7 +84,8 @@ private:
       &ConvOptions::remapOutputTensor, &ConvOptions::enableConvDithering,
       &ConvOptions::disableTransformations,
       &ConvOptions::insertTransformsCycleCountProgs,
-      &ConvOptions::enableTransformsConvTable);
+      &ConvOptions::enableTransformsConvTable,
+      &ConvOptions::numEpiloguePasses);
 
 public:
   bool operator<(const ConvOptions &other) const {
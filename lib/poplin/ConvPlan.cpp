@@ -27,10 +27,12 @@
 #include <boost/functional/hash.hpp>
 #include <boost/property_tree/ptree.hpp>
 #include <boost/range/adaptor/filtered.hpp>
+#include <atomic>
 #include <cassert>
 #include <cmath>
 #include <limits>
 #include <map>
+#include <mutex>
 #include <set>
 #include <string>
 #include <tuple>
@@ -385,6 +387,7 @@ getCostOfSolution(const popsolver::Solution &s,
   cost.dynamicUpdateCycles = s[e.dynamicUpdateCycles];
   cost.addInPlaceCycles = s[e.addInPlaceCycles];
   cost.castCycles = s[e.castCycles];
+  cost.epilogueCycles = s[e.epilogueCycles];
 
   cost.rearrangeBeforeSliceTempBytes = s[e.rearrangeBeforeSliceTempBytes];
   cost.rearrangeBeforeSliceTempDuringRearrangeBytes =
@@ -911,6 +914,8 @@ static void logPlanBreakdown(logging::Level l, const Plan &plan,
     // temporary memory for the purposes of the Conv Planner.
     logging::poplin::log(l, "{} - cast: {} cycles, 0 bytes", prefix,
                          passCost.castCycles, 0);
+    logging::poplin::log(l, "{} - epilogue: {} cycles, 0 bytes", prefix,
+                         passCost.epilogueCycles);
     logging::poplin::log(l, "{} - total: {} cycles, {} bytes", prefix,
                          passCost.totalCycles, passCost.totalTempBytes);
   };
@@ -940,6 +945,46 @@ static void logPlanBreakdown(logging::Level l, const Plan &plan,
   }
 }
 
+namespace {
+
+// A combination of transforms and vertex type to be solved for a plan.
+struct PlanCandidate {
+  std::vector<ConvTransform> transforms;
+  ConvVertexType convVertexType;
+  std::vector<ConvTypes> convTypes;
+  std::vector<unsigned> fieldGrainSize;
+  // No plan for the candidate can take fewer cycles than this.
+  popsolver::DataType cyclesLowerBound;
+};
+
+// The cost of the best plan found so far, shared by candidates solved in
+// parallel so that each solve is bounded by the best plan found by any of
+// them.
+class SharedCostBound {
+public:
+  explicit SharedCostBound(const PlanningObjective &objective)
+      : objective(objective) {}
+
+  Cost get() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return cost;
+  }
+
+  void update(const Cost &candidateCost) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (objective.lowerCost(candidateCost, cost)) {
+      cost = candidateCost;
+    }
+  }
+
+private:
+  const PlanningObjective &objective;
+  mutable std::mutex mutex;
+  Cost cost = highestCost;
+};
+
+} // end anonymous namespace
+
 static std::pair<Plan, Cost>
 createPlan(ConvParams params, const ConvOptions &options, bool isJointPlan,
            const PlanningObjective &objective, const poplar::Target &target,
@@ -988,6 +1033,7 @@ createPlan(ConvParams params, const ConvOptions &options, bool isJointPlan,
     addExtraDims(paramsWithExtraDims, addedFieldDims);
     numFieldDims = 2;
   }
+  std::vector<PlanCandidate> candidates;
   transforms[0].extraFieldDims = addedFieldDims;
   transforms[0].dilatePostConv =
       getDilatePostConvDims(paramsWithExtraDims, options);
@@ -1044,41 +1090,83 @@ createPlan(ConvParams params, const ConvOptions &options, bool isJointPlan,
               // layer.
               fieldGrainSize.back() = 2;
             }
-            Plan candidate;
-            Cost candidateCost;
             const auto convTypes = getConvTypes(
                 target, convVertexType.partialType, params.outputType, options);
-            popsolver::ConstraintEvaluationSummary constraintsEvaluated{};
-            std::tie(candidate, candidateCost, constraintsEvaluated) =
-                choosePlan(target, transforms, convTypes, hierarchy,
-                           perLevelExchangeBytesPerCycle, fieldGrainSize,
-                           convVertexType, params, isJointPlan, bestCost,
-                           objective, startTileIdxForVirtualHierarchy,
-                           referencePlan, referenceCost, cache, options);
-            logging::poplin::trace(
-                "Evaluated {} constraints for candidate plan",
-                constraintsEvaluated);
-            totalConstraintsEvaluated += constraintsEvaluated;
-            if (candidateCost == highestCost) {
-              continue;
-            }
-
-            if (objective.lowerCost(candidateCost, bestCost)) {
-              bestPlan = candidate;
-              bestCost = candidateCost;
-
-              logging::poplin::debug(
-                  "Found new best candidate plan using {}: {}",
-                  candidate.method, candidateCost);
-              logPlanBreakdown(logging::Level::Trace, bestPlan, bestCost,
-                               referenceCost);
-            }
+            const auto cyclesLowerBound =
+                getCyclesLowerBound(target, transforms, hierarchy,
+                                    convVertexType, params, cache);
+            candidates.push_back({transforms, convVertexType, convTypes,
+                                  std::move(fieldGrainSize),
+                                  cyclesLowerBound});
           }
         }
       }
     }
   }
 
+  // The candidates are independent apart from the bound on the cost, so they
+  // are solved in parallel. Each solve is bounded by the best cost found so
+  // far by any candidate; a candidate whose cost equals the bound is still
+  // solved, so the plan chosen below in the serial order of the candidates is
+  // the one the serial search would have chosen.
+  logging::poplin::debug("Solving {} candidate plans", candidates.size());
+  std::vector<std::tuple<Plan, Cost, popsolver::ConstraintEvaluationSummary>>
+      results(candidates.size());
+  SharedCostBound bound(objective);
+  std::atomic<std::size_t> numPruned{0};
+  tbb::parallel_for<std::size_t>(0u, candidates.size(), [&](std::size_t i) {
+    const auto &candidate = candidates[i];
+    const auto boundCost = bound.get();
+
+    // The model would have no solution for a candidate whose lower bound
+    // exceeds the cycles allowed, so skip building and solving it.
+    auto cyclesAllowed = objective.getCyclesBound();
+    if (objective.getType() == PlanningObjective::MINIMIZE_CYCLES) {
+      cyclesAllowed = std::min(cyclesAllowed, boundCost.totalCycles);
+    }
+    if (candidate.cyclesLowerBound > cyclesAllowed) {
+      ++numPruned;
+      std::get<1>(results[i]) = highestCost;
+      return;
+    }
+
+    results[i] = choosePlan(
+        target, candidate.transforms, candidate.convTypes, hierarchy,
+        perLevelExchangeBytesPerCycle, candidate.fieldGrainSize,
+        candidate.convVertexType, params, isJointPlan, boundCost, objective,
+        startTileIdxForVirtualHierarchy, referencePlan, referenceCost, cache,
+        options);
+    const auto &candidateCost = std::get<1>(results[i]);
+    if (candidateCost != highestCost) {
+      bound.update(candidateCost);
+    }
+  });
+  logging::poplin::debug("Pruned {} of {} candidate plans by their lower "
+                         "bound on cycles",
+                         numPruned.load(), candidates.size());
+
+  for (auto &result : results) {
+    Plan &candidate = std::get<0>(result);
+    const Cost &candidateCost = std::get<1>(result);
+    const auto &constraintsEvaluated = std::get<2>(result);
+    logging::poplin::trace("Evaluated {} constraints for candidate plan",
+                           constraintsEvaluated);
+    totalConstraintsEvaluated += constraintsEvaluated;
+    if (candidateCost == highestCost) {
+      continue;
+    }
+
+    if (objective.lowerCost(candidateCost, bestCost)) {
+      bestPlan = std::move(candidate);
+      bestCost = candidateCost;
+
+      logging::poplin::debug("Found new best candidate plan using {}: {}",
+                             bestPlan.method, candidateCost);
+      logPlanBreakdown(logging::Level::Trace, bestPlan, bestCost,
+                       referenceCost);
+    }
+  }
+
   const auto planIsValid = bestCost != highestCost;
 
   if (isJointPlan && planIsValid) {
@@ -1185,6 +1273,9 @@ static ConvOptions getFullyConnectedPassOptions(const ConvOptions &options,
                                                 Pass pass) {
   auto newOptions = options;
   newOptions.pass = pass;
+  if (pass != Pass::FC_TRAINING_FWD) {
+    newOptions.numEpiloguePasses = 0;
+  }
   return newOptions;
 }
 
@@ -99,6 +99,7 @@ template <typename T> struct SinglePassEstimates {
   T dynamicUpdateCycles;
   T addInPlaceCycles;
   T castCycles;
+  T epilogueCycles;
 
   T rearrangeBeforeSliceTempBytes;
   T rearrangeBeforeSliceTempDuringRearrangeBytes;
@@ -177,6 +178,7 @@ inline SinglePassCost maxPerStepCycles(SinglePassCost a,
       std::max(a.dynamicUpdateCycles, b.dynamicUpdateCycles);
   a.addInPlaceCycles = std::max(a.addInPlaceCycles, b.addInPlaceCycles);
   a.castCycles = std::max(a.castCycles, b.castCycles);
+  a.epilogueCycles = std::max(a.epilogueCycles, b.epilogueCycles);
 
   return a;
 }
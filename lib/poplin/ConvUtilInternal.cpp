@@ -1,19 +1,25 @@
 // Copyright (c) 2018 Graphcore Ltd. All rights reserved.
 #include "ConvUtilInternal.hpp"
 
+#include "../popops/ExprOpUtil.hpp"
+#include "poplibs_support/Algorithm.hpp"
 #include "poplibs_support/StructHelper.hpp"
 #include "poplibs_support/VectorUtils.hpp"
 #include "poplibs_support/gcd.hpp"
 #include "poplibs_support/logging.hpp"
 #include "poplin/ConvUtil.hpp"
+#include "popops/Cast.hpp"
+#include "popops/ElementWise.hpp"
 #include "popops/Rearrange.hpp"
 #include "poputil/Util.hpp"
+#include "poputil/VertexTemplates.hpp"
 #include "poputil/exceptions.hpp"
 
 #include <boost/icl/interval_map.hpp>
 
 #include <cassert>
 #include <cmath>
+#include <memory>
 #include <unordered_map>
 
 using namespace poplar;
@@ -950,6 +956,8 @@ ConvOptions getWeightUpdateOptions(ConvOptions fwdOptions) {
     fwdOptions.pass = Pass::TRAINING_WU;
     break;
   }
+  // The epilogue only applies to the output of the forward pass.
+  fwdOptions.numEpiloguePasses = 0;
   return fwdOptions;
 }
 
@@ -965,7 +973,262 @@ ConvOptions getGradientOptions(ConvOptions fwdOptions) {
     fwdOptions.pass = Pass::TRAINING_WU;
     break;
   }
+  // The epilogue only applies to the output of the forward pass.
+  fwdOptions.numEpiloguePasses = 0;
   return fwdOptions;
 }
 
+// The type the biases are added and the non-linearity is applied in.
+static Type getEpilogueComputeType(const Type &outType,
+                                   const Type &resultType) {
+  return outType == FLOAT || resultType == FLOAT ? FLOAT : outType;
+}
+
+// True if the ConvEpilogue vertices apply the whole epilogue in one pass.
+static bool isEpilogueFused(const Epilogue &epilogue, const Type &outType,
+                            const Type &resultType) {
+  using popops::expr::UnaryOpType;
+  const auto isFloatingPoint = [](const Type &type) {
+    return type == FLOAT || type == HALF;
+  };
+  return epilogue.biases.valid() && epilogue.nonLinearity &&
+         (*epilogue.nonLinearity == UnaryOpType::RELU ||
+          *epilogue.nonLinearity == UnaryOpType::SIGMOID ||
+          *epilogue.nonLinearity == UnaryOpType::TANH) &&
+         isFloatingPoint(outType) && isFloatingPoint(resultType);
+}
+
+unsigned getNumEpiloguePasses(const Epilogue &epilogue, const Type &outType) {
+  const auto resultType = epilogue.outputType ? *epilogue.outputType : outType;
+  if (isEpilogueFused(epilogue, outType, resultType)) {
+    return 1;
+  }
+  const auto computeType = getEpilogueComputeType(outType, resultType);
+  return (computeType != outType) + epilogue.biases.valid() +
+         (epilogue.nonLinearity || computeType != resultType);
+}
+
+namespace {
+
+// Intervals of the output that follow each other in memory, where element j
+// of the region is in channel (firstChan + j % period) % numChans.
+struct EpilogueRegion {
+  std::vector<Interval> intervals;
+  std::size_t size;
+  std::size_t firstChan;
+  std::size_t period;
+  // A worker can start at this region without sharing a word of the output
+  // with the previous one.
+  bool canSplitBefore;
+};
+
+} // end anonymous namespace
+
+// Split the contiguous regions of the output on a tile, flattened with the
+// channels innermost, into regions of the ConvEpilogue vertices of at most
+// about maxRegionSize elements. A region of several intervals covers the same
+// channels in each, as the output of a convolution does with its channels
+// grouped innermost.
+static std::vector<EpilogueRegion>
+getEpilogueRegions(const std::vector<std::vector<Interval>> &contiguousRegions,
+                   std::size_t numChans, std::size_t maxRegionSize,
+                   std::size_t grainSize) {
+  std::vector<EpilogueRegion> regions;
+  for (const auto &contiguousRegion : contiguousRegions) {
+    std::size_t offset = 0;
+    for (const auto &interval : contiguousRegion) {
+      const auto firstChan = interval.begin() % numChans;
+      const auto size = interval.size();
+      const bool extends =
+          offset != 0 && regions.back().firstChan == firstChan &&
+          regions.back().intervals.front().size() == size &&
+          regions.back().intervals.back().size() == size &&
+          firstChan + size <= numChans &&
+          regions.back().size + size <= maxRegionSize;
+      if (extends) {
+        auto &last = regions.back();
+        last.intervals.push_back(interval);
+        last.size += size;
+        last.period = size;
+      } else {
+        // Long intervals are split where a worker can start.
+        for (auto begin = interval.begin(); begin != interval.end();) {
+          const auto regionOffset = offset + (begin - interval.begin());
+          const auto end =
+              std::min(interval.end(),
+                       begin + maxRegionSize - regionOffset % maxRegionSize);
+          regions.push_back({{{begin, end}},
+                             end - begin,
+                             begin % numChans,
+                             numChans,
+                             regionOffset % grainSize == 0});
+          begin = end;
+        }
+      }
+      offset += size;
+    }
+  }
+  return regions;
+}
+
+// Apply an epilogue with biases and a non-linearity in a single compute set
+// of ConvEpilogue vertices, which also cast the result.
+static Tensor applyFusedEpilogue(Graph &graph, const Tensor &out,
+                                 unsigned channelDim, const Epilogue &epilogue,
+                                 const Type &resultType,
+                                 program::Sequence &prog,
+                                 const DebugNameAndId &dnai) {
+  const auto &target = graph.getTarget();
+  const auto outType = out.elementType();
+  const bool inPlace = outType == resultType;
+  const auto numChans = out.dim(channelDim);
+  auto biases = epilogue.biases;
+  if (biases.elementType() != FLOAT) {
+    biases =
+        popops::cast(graph, biases, FLOAT, prog, {dnai, "EpilogueBiases"});
+  }
+  const auto result =
+      inPlace ? out : graph.clone(resultType, out, {dnai, "Epilogue"});
+
+  // With the channels innermost, element i of the flattened output is in
+  // channel i % numChans.
+  const auto outFlat = out.dimRoll(channelDim, out.rank() - 1).flatten();
+  const auto resultFlat =
+      result.dimRoll(channelDim, result.rank() - 1).flatten();
+  const auto vertexClass =
+      inPlace ? templateVertex("poplin::ConvEpilogueInPlace", outType,
+                               *epilogue.nonLinearity)
+              : templateVertex("poplin::ConvEpilogue", outType, resultType,
+                               *epilogue.nonLinearity);
+  const auto numWorkers = target.getNumWorkerContexts();
+  const std::size_t grainSize = std::max(target.getVectorWidth(outType),
+                                         target.getVectorWidth(resultType));
+  const auto cs = graph.addComputeSet({dnai, "Epilogue"});
+  const auto mapping = graph.getTileMapping(outFlat);
+  for (unsigned tile = 0; tile != mapping.size(); ++tile) {
+    const auto tileElements = intervalSequenceNumElements(mapping[tile]);
+    if (tileElements == 0) {
+      continue;
+    }
+    const auto maxRegionSize =
+        poplibs_support::roundUp(
+            poplibs_support::ceildiv(tileElements, numWorkers), grainSize);
+    const auto regions = getEpilogueRegions(
+        graph.getSortedContiguousRegions(outFlat, mapping[tile]), numChans,
+        maxRegionSize, grainSize);
+
+    // Each worker takes regions until it has about an equal share of the
+    // elements of the tile.
+    std::vector<std::vector<const EpilogueRegion *>> workerRegions(1);
+    std::size_t workerElements = 0;
+    for (const auto &region : regions) {
+      if (!workerRegions.back().empty() && region.canSplitBefore &&
+          workerElements + region.size > maxRegionSize) {
+        workerRegions.emplace_back();
+        workerElements = 0;
+      }
+      workerRegions.back().push_back(&region);
+      workerElements += region.size;
+    }
+
+    for (const auto &vertexRegions : workerRegions) {
+      // The biases of the channels the regions use, all of them if a region
+      // wraps past the last channel.
+      std::size_t chanBegin = numChans, chanEnd = 0;
+      for (const auto *region : vertexRegions) {
+        const auto regionChans = std::min(region->size, region->period);
+        if (region->firstChan + regionChans > numChans) {
+          chanBegin = 0;
+          chanEnd = numChans;
+        } else {
+          chanBegin = std::min(chanBegin, region->firstChan);
+          chanEnd = std::max(chanEnd, region->firstChan + regionChans);
+        }
+      }
+      std::vector<Tensor> in, res;
+      std::vector<unsigned> firstChan, period;
+      for (const auto *region : vertexRegions) {
+        in.push_back(concat(outFlat.slices(region->intervals)));
+        res.push_back(concat(resultFlat.slices(region->intervals)));
+        firstChan.push_back(region->firstChan - chanBegin);
+        period.push_back(region->period);
+      }
+      auto v = graph.addVertex(cs, vertexClass);
+      if (inPlace) {
+        graph.connect(v["data"], in);
+      } else {
+        graph.connect(v["in"], in);
+        graph.connect(v["out"], res);
+      }
+      graph.connect(v["biases"], biases.slice(chanBegin, chanEnd));
+      graph.setInitialValue(v["firstChan"], std::move(firstChan));
+      graph.setInitialValue(v["period"], std::move(period));
+      graph.setInitialValue(v["numChans"], numChans);
+      graph.setTileMapping(v, tile);
+    }
+  }
+  prog.add(program::Execute(cs, {dnai}));
+  return result;
+}
+
+Tensor applyEpilogue(Graph &graph, const Tensor &out, unsigned channelDim,
+                     const Epilogue &epilogue, program::Sequence &prog,
+                     const DebugNameAndId &dnai) {
+  namespace logging = poplibs_support::logging;
+  namespace pe = popops::expr;
+  const auto outType = out.elementType();
+  const auto resultType = epilogue.outputType ? *epilogue.outputType : outType;
+  const auto computeType = getEpilogueComputeType(outType, resultType);
+  const auto numPasses = getNumEpiloguePasses(epilogue, outType);
+  if (numPasses == 0) {
+    return out;
+  }
+  logging::poplin::debug("  epilogue: biases={}, nonLinearity={}, {} -> {}, "
+                         "{} passes",
+                         epilogue.biases.valid(), bool(epilogue.nonLinearity),
+                         outType.toString(), resultType.toString(), numPasses);
+
+  if (epilogue.biases.valid()) {
+    const auto &biases = epilogue.biases;
+    const auto numChans = out.dim(channelDim);
+    if (biases.rank() != 1 || biases.dim(0) != numChans) {
+      throw poplibs_error("Epilogue biases must have shape {" +
+                          std::to_string(numChans) + "}");
+    }
+  }
+  if (isEpilogueFused(epilogue, outType, resultType)) {
+    return applyFusedEpilogue(graph, out, channelDim, epilogue, resultType,
+                              prog, dnai);
+  }
+
+  auto result = out;
+  if (computeType != outType) {
+    result = popops::cast(graph, out, computeType, prog, {dnai, "Epilogue"});
+  }
+  if (epilogue.biases.valid()) {
+    auto biases = epilogue.biases;
+    if (biases.elementType() != computeType) {
+      biases = popops::cast(graph, biases, computeType, prog,
+                            {dnai, "EpilogueBiases"});
+    }
+    // Leave the broadcast of the biases to addInPlace, as addBias() does, so
+    // that it can use the vertices that broadcast a vector of channels rather
+    // than a copy of the biases for every output.
+    std::vector<std::size_t> broadcastDims(out.rank() - 1 - channelDim, 1);
+    popops::addInPlace(graph, result, biases.expand(broadcastDims), prog,
+                       {dnai, "EpilogueBiases"});
+  }
+  if (epilogue.nonLinearity || computeType != resultType) {
+    auto e = epilogue.nonLinearity
+                 ? pe::UnaryOp(*epilogue.nonLinearity, pe::_1).clone()
+                 : pe::_1.clone();
+    if (computeType != resultType) {
+      e = pe::Cast(*e, resultType).clone();
+      return popops::map(graph, *e, {result}, prog, {dnai, "Epilogue"});
+    }
+    popops::mapInPlace(graph, *e, {result}, prog, {dnai, "Epilogue"});
+  }
+  return result;
+}
+
 } // namespace poplin
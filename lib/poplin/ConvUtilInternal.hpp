@@ -10,6 +10,7 @@
 #include "ConvPlan.hpp"
 #include "MultiConvolutionInternal.hpp"
 #include "poplin/ConvUtil.hpp"
+#include "poplin/Epilogue.hpp"
 #include "poplin/MultiConvolution.hpp"
 #include "poputil/VarStructure.hpp"
 
@@ -288,6 +289,23 @@ ConvOptions getGradientOptions(ConvOptions fwdOptions);
 
 std::string convSuffix(const CanonicalConvParams &params);
 
+/// Number of elementwise passes over the output that applyEpilogue() adds for
+/// \p epilogue, on an output of type \p outType.
+unsigned getNumEpiloguePasses(const Epilogue &epilogue,
+                              const poplar::Type &outType);
+
+/// Apply \p epilogue to \p out. Biases followed by a RELU, SIGMOID or TANH
+/// are applied together with any cast in a single pass over \p out added to
+/// \p prog. Otherwise a pass is added for each of: a cast when the result is
+/// wider than \p out, the biases, and the non-linearity together with any
+/// narrowing cast. The biases are broadcast along every dimension of \p out
+/// other than \p channelDim. \p out is updated in place if the epilogue does
+/// not change its type.
+poplar::Tensor applyEpilogue(poplar::Graph &graph, const poplar::Tensor &out,
+                             unsigned channelDim, const Epilogue &epilogue,
+                             poplar::program::Sequence &prog,
+                             const poplar::DebugNameAndId &dnai);
+
 } // End namespace poplin
 
 #endif // poplin_ConvUtilInternal_hpp
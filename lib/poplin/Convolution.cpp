@@ -53,6 +53,18 @@ template <>
 poplar::ProfileValue toProfileValue(const poplin::PlanningCache &t) {
   return poplar::ProfileValue("<PlanningCache>");
 }
+
+template <> poplar::ProfileValue toProfileValue(const poplin::Epilogue &t) {
+  poplar::ProfileValue::Map v;
+  v.insert({"biases", toProfileValue(t.biases)});
+  if (t.nonLinearity) {
+    v.insert({"nonLinearity", toProfileValue(*t.nonLinearity)});
+  }
+  if (t.outputType) {
+    v.insert({"outputType", toProfileValue(*t.outputType)});
+  }
+  return v;
+}
 } // namespace poputil
 
 namespace poplin {
@@ -2623,12 +2635,24 @@ Tensor convolution(Graph &graph, const poplar::Tensor &in,
                    bool transposeAndFlipWeights, Sequence &prog,
                    const poplar::DebugContext &debugContext,
                    const poplar::OptionFlags &options_, PlanningCache *cache) {
-  poputil::PoplibsOpDebugInfo di(
-      debugContext,
-      DI_ARGS(in, weights, params_, transposeAndFlipWeights, options_, cache));
+  return convolution(graph, in, weights, params_, transposeAndFlipWeights,
+                     Epilogue(), prog, debugContext, options_, cache);
+}
+
+Tensor convolution(Graph &graph, const poplar::Tensor &in,
+                   const poplar::Tensor &weights, const ConvParams &params_,
+                   bool transposeAndFlipWeights, const Epilogue &epilogue,
+                   Sequence &prog, const poplar::DebugContext &debugContext,
+                   const poplar::OptionFlags &options_, PlanningCache *cache) {
+  poputil::PoplibsOpDebugInfo di(debugContext,
+                                 DI_ARGS(in, weights, params_,
+                                         transposeAndFlipWeights, epilogue,
+                                         options_, cache));
 
   const CanonicalConvParams params(params_);
-  const ConvOptions options(options_);
+  ConvOptions options(options_);
+  options.numEpiloguePasses =
+      getNumEpiloguePasses(epilogue, params->outputType);
 
   const std::string layerName = "Conv_" + convSuffix(params);
   poplar::ProfileValue::Map pv;
@@ -2639,6 +2663,10 @@ Tensor convolution(Graph &graph, const poplar::Tensor &in,
   auto out =
       convolution(graph, in, weights, plan, params, transposeAndFlipWeights,
                   cpt, {di, layerName}, options);
+  // The epilogue is the last step of the convolution's program tree, after
+  // any remapping of the output, so it is a separate pass from the reduction.
+  out = applyEpilogue(graph, out, 1, epilogue, cpt.finalizeProg,
+                      {di, layerName});
 
   cpt.lower(graph, prog, options.insertTransformsCycleCountProgs, {di});
   di.addOutput(out);
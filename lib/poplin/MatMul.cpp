@@ -1,6 +1,8 @@
 // Copyright (c) 2017 Graphcore Ltd. All rights reserved.
 #include "poplin/MatMul.hpp"
+#include "CanonicalConvParams.hpp"
 #include "ConvOptions.hpp"
+#include "ConvPlan.hpp"
 #include "MatMulInternal.hpp"
 #include "poplibs_support/Compiler.hpp"
 #include "poplibs_support/StructHelper.hpp"
@@ -373,7 +375,8 @@ static poplar::Tensor
 matMulImpl(poplar::Graph &graph, const poplar::Tensor &A,
            const poplar::Tensor &B, poplar::program::Sequence &prog,
            const DebugNameAndId &dnai, const MatMulOptions &options,
-           matmul::PlanningCache *cache, const Type &outputType) {
+           matmul::PlanningCache *cache, const Type &outputType,
+           const Epilogue &epilogue = Epilogue()) {
   assert(A.rank() == 3 && B.rank() == 3);
   const auto inputType = A.elementType();
   const auto convOptions = getConvOptionFlags(options);
@@ -394,8 +397,9 @@ matMulImpl(poplar::Graph &graph, const poplar::Tensor &A,
         graph, weightsView.dimShuffle({0, 2, 1, 3}), convParams, prog,
         {dnai, "weightTranspose"}, convOptions, linCache);
   }
-  auto out = poplin::convolution(graph, actsView, weightsView, convParams,
-                                 false, prog, {dnai}, convOptions, linCache);
+  auto out =
+      poplin::convolution(graph, actsView, weightsView, convParams, false,
+                          epilogue, prog, {dnai}, convOptions, linCache);
   out = matrixFromConvActivations(out, numGroups);
   assert(out.rank() == 3);
   assert(out.dim(0) == A.dim(0));
@@ -620,8 +624,18 @@ poplar::Tensor matMul(poplar::Graph &graph, const poplar::Tensor &A_,
                       const poplar::DebugContext &debugContext,
                       const poplar::OptionFlags &options_,
                       matmul::PlanningCache *cache) {
-  poputil::PoplibsOpDebugInfo di(debugContext,
-                                 DI_ARGS(A_, B_, outputType, options_, cache));
+  return matMul(graph, A_, B_, prog, outputType, Epilogue(), debugContext,
+                options_, cache);
+}
+
+poplar::Tensor matMul(poplar::Graph &graph, const poplar::Tensor &A_,
+                      const poplar::Tensor &B_, poplar::program::Sequence &prog,
+                      const Type &outputType, const Epilogue &epilogue,
+                      const poplar::DebugContext &debugContext,
+                      const poplar::OptionFlags &options_,
+                      matmul::PlanningCache *cache) {
+  poputil::PoplibsOpDebugInfo di(
+      debugContext, DI_ARGS(A_, B_, outputType, epilogue, options_, cache));
 
   const auto options = parseMatMulOptions(options_);
   logging::poplin::info("matMul {} x {}, pass={}, name={}", A_.shape(),
@@ -631,8 +645,10 @@ poplar::Tensor matMul(poplar::Graph &graph, const poplar::Tensor &A_,
   matMulDimChecks(A_.shape(), B_.shape());
   const auto A = A_.expand({0});
   const auto B = B_.expand({0});
-  auto output =
-      matMulImpl(graph, A, B, prog, {di}, options, cache, outputType)[0];
+  // With a single group the output channels of the convolution are the
+  // columns of the result, so the epilogue's biases index the columns.
+  auto output = matMulImpl(graph, A, B, prog, {di}, options, cache,
+                           outputType, epilogue)[0];
   di.addOutput(output);
   return output;
 }
@@ -716,6 +732,23 @@ std::pair<unsigned, unsigned> matMulOutputSerialSplits(
   return std::make_pair(std::get<1>(serialSplits), std::get<2>(serialSplits));
 }
 
+std::pair<std::uint64_t, std::uint64_t> groupedMatMulEstimatedCost(
+    const poplar::Target &target, const Type &inputType, const Type &outputType,
+    const std::vector<std::size_t> &aShape,
+    const std::vector<std::size_t> &bShape, const poplar::OptionFlags &options_,
+    matmul::PlanningCache *cache) {
+  matMulGroupedDimChecks(aShape, bShape);
+  // An empty result is produced via special handling without any compute
+  if (!bShape[2]) {
+    return {0, 0};
+  }
+  const ConvOptions convOptions(getConvOptionFlags(options_));
+  const auto convParams = getConvParams(inputType, outputType, aShape, bShape);
+  auto linCache = getLinCache(cache);
+  const auto plan = getPlan(target, convParams, convOptions, linCache);
+  return estimateConvCost(target, convParams, convOptions, linCache, plan);
+}
+
 void matMulGroupedReportPlan(std::ostream &out, const poplar::Graph &graph,
                              const Type &inputType, const Type &outputType,
                              const std::vector<std::size_t> &aShape,
@@ -4,6 +4,7 @@
 #define poplin_FullyConnectedInternal_hpp
 
 #include "poplin/ConvParams.hpp"
+#include <cstdint>
 #include <poplar/Graph.hpp>
 #include <poplar/OptionFlags.hpp>
 
@@ -56,6 +57,19 @@ std::pair<unsigned, unsigned> matMulOutputSerialSplits(
     const poplar::OptionFlags &options_ = {},
     matmul::PlanningCache *cache = nullptr);
 
+/** Estimate the cost of a grouped matrix multiplication of given size and
+ *  options, as planned by matMulGrouped().
+ *
+ *  \returns The estimated number of cycles and the estimated temporary
+ *           memory in bytes.
+ */
+std::pair<std::uint64_t, std::uint64_t> groupedMatMulEstimatedCost(
+    const poplar::Target &target, const poplar::Type &inputType,
+    const poplar::Type &outputType, const std::vector<std::size_t> &aShape,
+    const std::vector<std::size_t> &bShape,
+    const poplar::OptionFlags &options_ = {},
+    matmul::PlanningCache *cache = nullptr);
+
 } // namespace poplin
 
 #endif // poplin_FullyConnectedInternal_hpp
@@ -11,6 +11,8 @@
 #include "poputil/GraphFunction.hpp"
 #include "poputil/TileMapping.hpp"
 #include "poputil/exceptions.hpp"
+#include <numeric>
+#include <set>
 #include <sstream>
 
 namespace pe = popops::expr;
@@ -277,6 +279,40 @@ void solve(poplar::Graph &graph, const poplar::Tensor &a,
   }
 }
 
+// Shapes of all matmuls issued by solve() for a [batches, an, an] A and
+// [batches, an, bn] B (after any transposition for the right side solve).
+std::vector<MatMulParams>
+getSolveMatMulParams(const poplar::Type &type, std::size_t batches,
+                     std::size_t an, std::size_t bn, std::size_t blockSize) {
+  std::vector<MatMulParams> matmuls;
+
+  bool needPadding = an > blockSize || bn > blockSize;
+  std::size_t paddedSize = blockSize;
+  while (paddedSize < an || paddedSize < bn) {
+    paddedSize <<= 1;
+  }
+
+  // recursive levels: A21 * X11, A21 * X12, A12 * X21 and A12 * X22 all have
+  // the same square shape once padded to a power of two multiple of blockSize
+  std::size_t directAn = an, directBn = bn;
+  if (needPadding) {
+    for (auto size = paddedSize; size > blockSize; size >>= 1) {
+      auto half = size >> 1;
+      matmuls.push_back(
+          {type, type, {batches, half, half}, {batches, half, half}});
+    }
+    directAn = blockSize;
+    directBn = blockSize;
+  }
+
+  // direct solver: one row by already substituted X per row
+  for (std::size_t idx = 1; idx < directAn; ++idx) {
+    matmuls.push_back(
+        {type, type, {batches, 1, idx}, {batches, idx, directBn}});
+  }
+  return matmuls;
+}
+
 void validateInput(poplar::Graph &graph, const poplar::Tensor &a) {
   auto ndims = a.rank();
   if (ndims < 2) {
@@ -293,6 +329,39 @@ void validateInput(poplar::Graph &graph, const poplar::Tensor &a) {
 
 } // anonymous namespace
 
+std::vector<std::pair<MatMulParams, poplar::OptionFlags>>
+getTriangularSolveMatMulPrePlanParameters(
+    const poplar::Type &inputType, const poplar::Type &outputType,
+    const std::vector<std::size_t> &aShape,
+    const std::vector<std::size_t> &bShape, bool leftSide, bool /* lower */,
+    std::size_t blockSize, const poplar::OptionFlags &options) {
+  if (inputType != outputType) {
+    throw poputil::poplibs_error(
+        "triangularSolve: input and output types must match");
+  }
+  if (aShape.size() < 2 || aShape.size() != bShape.size()) {
+    throw poputil::poplibs_error(
+        "triangularSolve: ranks of A and B must match and be at least 2");
+  }
+  if (blockSize == 0) {
+    throw poputil::poplibs_error("blockSize must be greater than zero");
+  }
+
+  const auto rank = aShape.size();
+  const auto an = aShape[rank - 1];
+  const auto bn = leftSide ? bShape[rank - 1] : bShape[rank - 2];
+  const auto batches =
+      std::accumulate(aShape.begin(), aShape.end() - 2, std::size_t(1),
+                      std::multiplies<std::size_t>());
+
+  std::vector<std::pair<MatMulParams, poplar::OptionFlags>> matmuls;
+  for (auto &params :
+       getSolveMatMulParams(inputType, batches, an, bn, blockSize)) {
+    matmuls.emplace_back(std::move(params), options);
+  }
+  return matmuls;
+}
+
 poplar::Tensor triangularMask(poplar::Graph &graph, const poplar::Tensor &a,
                               bool lower, bool unitDiagonal,
                               poplar::program::Sequence &prog,
@@ -379,6 +448,18 @@ poplar::Tensor triangularSolve(
   SolveParams params(bn, lower, unitDiagonal, blockSize, options,
                      cache ? cache : &localCache);
 
+  // all matmul shapes of the recursion are known up front, plan them together
+  // so they are planned in parallel rather than serially at each level.
+  {
+    std::set<MatMulPlanParams> matmuls;
+    const auto &target = graph.getTarget();
+    for (auto &matmul : getSolveMatMulParams(a.elementType(), batchA.dim(0),
+                                             an, bn, blockSize)) {
+      matmuls.emplace(&target, std::move(matmul), &params.options);
+    }
+    preplanMatMuls(matmuls, *params.cache);
+  }
+
   bool needPadding = an > blockSize || bn > blockSize;
   std::size_t paddedSize = blockSize;
   while (paddedSize < an || paddedSize < bn) {
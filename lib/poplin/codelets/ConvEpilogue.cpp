@@ -0,0 +1,103 @@
+// Copyright (c) 2020 Graphcore Ltd. All rights reserved.
+#include <cassert>
+#include <cmath>
+#include <poplar/HalfFloat.hpp>
+#include <poplar/Vertex.hpp>
+
+#include "popops/ExprOp.hpp"
+
+using namespace poplar;
+
+static constexpr auto ONE_PTR = poplar::VectorLayout::ONE_PTR;
+static constexpr auto SPAN = poplar::VectorLayout::SPAN;
+
+namespace poplin {
+
+template <popops::expr::UnaryOpType op> static float nonLinearity(float x);
+
+template <>
+float nonLinearity<popops::expr::UnaryOpType::RELU>(float x) {
+  return x > 0.0f ? x : 0.0f;
+}
+
+template <>
+float nonLinearity<popops::expr::UnaryOpType::SIGMOID>(float x) {
+  return 1.0f / (1.0f + std::exp(-x));
+}
+
+template <>
+float nonLinearity<popops::expr::UnaryOpType::TANH>(float x) {
+  return std::tanh(x);
+}
+
+// Adds the biases of the output channels, applies the non-linearity and
+// converts the result to the output type, in a single pass over the output
+// of a convolution or matrix multiplication.
+//
+// Element j of region i is in channel (firstChan[i] + j % period[i]) %
+// numChans. The biases of the vertex start at channel 0 whenever a region
+// wraps past the last channel, and otherwise at the first channel it uses.
+template <class InType, class OutType, popops::expr::UnaryOpType op>
+class ConvEpilogue : public Vertex {
+public:
+  ConvEpilogue();
+
+  Vector<Input<Vector<InType, SPAN>>> in;
+  Vector<Output<Vector<OutType, ONE_PTR>>, ONE_PTR> out;
+  Input<Vector<float, ONE_PTR>> biases;
+  Vector<unsigned, ONE_PTR> firstChan;
+  Vector<unsigned, ONE_PTR> period;
+  const unsigned numChans;
+
+  bool compute() {
+    for (unsigned i = 0; i != in.size(); ++i) {
+      for (unsigned j = 0; j != in[i].size(); ++j) {
+        unsigned chan = firstChan[i] + j % period[i];
+        if (chan >= numChans) {
+          chan -= numChans;
+        }
+        out[i][j] = OutType(nonLinearity<op>(float(in[i][j]) + biases[chan]));
+      }
+    }
+    return true;
+  }
+};
+
+// As ConvEpilogue, when the output has the type of the input.
+template <class FPType, popops::expr::UnaryOpType op>
+class ConvEpilogueInPlace : public Vertex {
+public:
+  ConvEpilogueInPlace();
+
+  Vector<InOut<Vector<FPType, SPAN>>> data;
+  Input<Vector<float, ONE_PTR>> biases;
+  Vector<unsigned, ONE_PTR> firstChan;
+  Vector<unsigned, ONE_PTR> period;
+  const unsigned numChans;
+
+  bool compute() {
+    for (unsigned i = 0; i != data.size(); ++i) {
+      for (unsigned j = 0; j != data[i].size(); ++j) {
+        unsigned chan = firstChan[i] + j % period[i];
+        if (chan >= numChans) {
+          chan -= numChans;
+        }
+        data[i][j] =
+            FPType(nonLinearity<op>(float(data[i][j]) + biases[chan]));
+      }
+    }
+    return true;
+  }
+};
+
+#define INSTANTIATE_CONV_EPILOGUE(op)                                          \
+  template class ConvEpilogue<float, half, popops::expr::UnaryOpType::op>;     \
+  template class ConvEpilogue<half, float, popops::expr::UnaryOpType::op>;     \
+  template class ConvEpilogueInPlace<float, popops::expr::UnaryOpType::op>;    \
+  template class ConvEpilogueInPlace<half, popops::expr::UnaryOpType::op>;
+
+INSTANTIATE_CONV_EPILOGUE(RELU)
+INSTANTIATE_CONV_EPILOGUE(SIGMOID)
+INSTANTIATE_CONV_EPILOGUE(TANH)
+
+} // end namespace poplin
@@ -1,8 +1,10 @@
 // Copyright (c) 2017 Graphcore Ltd. All rights reserved.
 #include "poplinCycleEstimators.hpp"
+#include "../popops/ExprOpUtil.hpp"
 #include "PerformanceEstimation.hpp"
 
 #include <cassert>
+#include <vector>
 
 using namespace poplar;
 
@@ -445,6 +447,43 @@ std::uint64_t MAKE_CYCLE_ESTIMATOR_NAME(InverseStdDeviation)(
   return cycles;
 }
 
+// Cycles of a ConvEpilogue vertex with regions of the given sizes. Each
+// element is converted to float, added to its bias, passed through the
+// non-linearity and converted to the output type one at a time.
+static std::uint64_t
+getConvEpilogueCycles(const std::vector<unsigned> &regionSizes,
+                      popops::expr::UnaryOpType op) {
+  const std::uint64_t cyclesPerElement =
+      op == popops::expr::UnaryOpType::RELU ? 8 : 24;
+  std::uint64_t cycles = 7;
+  for (const auto size : regionSizes) {
+    cycles += 6 + size * cyclesPerElement;
+  }
+  return cycles;
+}
+
+std::uint64_t MAKE_CYCLE_ESTIMATOR_NAME(ConvEpilogue)(
+    const VertexIntrospector &vertex, const Target &target, const Type &inType,
+    const Type &outType, popops::expr::UnaryOpType op) {
+  CODELET_FIELD(in);
+  std::vector<unsigned> regionSizes;
+  for (unsigned i = 0; i != in.size(); ++i) {
+    regionSizes.push_back(in[i].size());
+  }
+  return getConvEpilogueCycles(regionSizes, op);
+}
+
+std::uint64_t MAKE_CYCLE_ESTIMATOR_NAME(ConvEpilogueInPlace)(
+    const VertexIntrospector &vertex, const Target &target, const Type &type,
+    popops::expr::UnaryOpType op) {
+  CODELET_FIELD(data);
+  std::vector<unsigned> regionSizes;
+  for (unsigned i = 0; i != data.size(); ++i) {
+    regionSizes.push_back(data[i].size());
+  }
+  return getConvEpilogueCycles(regionSizes, op);
+}
+
 std::uint64_t MAKE_CYCLE_ESTIMATOR_NAME(OuterProduct)(
     const VertexIntrospector &vertex, const Target &target, const Type &type) {
   CODELET_FIELD(in);
@@ -478,6 +517,12 @@ std::uint64_t MAKE_CYCLE_ESTIMATOR_NAME(ReduceAdd)(
                                 target.getNumWorkerContexts());
 }
 
+#define CONV_EPILOGUE_CYCLE_ESTIM_ENTRIES(op)                                  \
+  CYCLE_ESTIMATOR_ENTRY(poplin, ConvEpilogue, FLOAT, HALF, op),                \
+      CYCLE_ESTIMATOR_ENTRY(poplin, ConvEpilogue, HALF, FLOAT, op),            \
+      CYCLE_ESTIMATOR_ENTRY(poplin, ConvEpilogueInPlace, FLOAT, op),           \
+      CYCLE_ESTIMATOR_ENTRY(poplin, ConvEpilogueInPlace, HALF, op)
+
 poplibs::CycleEstimatorTable makeCyclesFunctionTable() {
   return {
       CYCLE_ESTIMATOR_ENTRY(poplin, OuterProduct, FLOAT),
@@ -501,6 +546,10 @@ poplibs::CycleEstimatorTable makeCyclesFunctionTable() {
       CYCLE_ESTIMATOR_ENTRY(poplin, InverseStdDeviation, HALF, HALF, HALF,
                             false),
 
+      CONV_EPILOGUE_CYCLE_ESTIM_ENTRIES(popops::expr::UnaryOpType::RELU),
+      CONV_EPILOGUE_CYCLE_ESTIM_ENTRIES(popops::expr::UnaryOpType::SIGMOID),
+      CONV_EPILOGUE_CYCLE_ESTIM_ENTRIES(popops::expr::UnaryOpType::TANH),
+
       CYCLE_ESTIMATOR_ENTRY(poplin, WgdConvComplete, FLOAT),
       CYCLE_ESTIMATOR_ENTRY(poplin, WgdConvComplete, HALF),
 
@@ -1,4 +1,6 @@
 // Copyright (c) 2020 Graphcore Ltd. All rights reserved.
+#include "popnn/LogSoftmax.hpp"
+
 #include "NonLinearityInternal.hpp"
 #include "poplibs_support/logging.hpp"
 #include "popops/ElementWise.hpp"
@@ -9,8 +11,11 @@
 #include "poputil/Util.hpp"
 #include "poputil/VertexTemplates.hpp"
 #include "poputil/exceptions.hpp"
+#include <algorithm>
 #include <cassert>
 #include <cmath>
+#include <limits>
+#include <vector>
 
 using namespace poplar;
 using namespace poplar::program;
@@ -21,6 +26,111 @@ namespace logging = poplibs_support::logging;
 
 namespace {
 
+// Computes the normaliser of the softmax of each row of t, reading t once.
+// Returns the maximum and the rescaled sum of exponentials of each row as
+// FLOAT tensors of shape {rows}.
+std::pair<Tensor, Tensor> softmaxNormaliserImpl(Graph &graph, const Tensor &t,
+                                                Sequence &prog,
+                                                const DebugNameAndId &dnai) {
+  const auto &target = graph.getTarget();
+  const auto dType = t.elementType();
+  const auto rowSize = t.dim(t.rank() - 1);
+  const auto numRows = t.numElements() / rowSize;
+  const auto flat = t.flatten();
+  const auto mapping = graph.getTileMapping(flat);
+  const auto vectorWidth = target.getVectorWidth(dType);
+
+  // Split the regions on each tile at row boundaries so that every region
+  // handed to a worker lies in a single row and gives one partial pair.
+  std::vector<std::pair<unsigned, std::vector<std::vector<Interval>>>> work;
+  std::size_t numPartials = 0;
+  for (unsigned tile = 0; tile < mapping.size(); ++tile) {
+    std::vector<Interval> rowRegions;
+    for (const auto &interval : mapping[tile]) {
+      auto begin = interval.begin();
+      while (begin != interval.end()) {
+        const auto end =
+            std::min(interval.end(), (begin / rowSize + 1) * rowSize);
+        rowRegions.emplace_back(begin, end);
+        begin = end;
+      }
+    }
+    if (rowRegions.empty()) {
+      continue;
+    }
+    auto vertexRegions = splitRegionsBetweenWorkers(
+        target, rowRegions, vectorWidth, 2 * vectorWidth);
+    for (const auto &regions : vertexRegions) {
+      numPartials += regions.size();
+    }
+    work.emplace_back(tile, std::move(vertexRegions));
+  }
+
+  auto partials =
+      graph.addVariable(FLOAT, {numPartials, 2}, {dnai, "partials"});
+  std::vector<std::vector<std::size_t>> rowPartials(numRows);
+  const auto vertexName =
+      templateVertex("popnn::SoftmaxNormaliserPartials", dType);
+  auto cs = graph.addComputeSet({dnai, "partials"});
+  std::size_t partial = 0;
+  for (const auto &entry : work) {
+    const auto tile = entry.first;
+    for (const auto &regions : entry.second) {
+      const auto out = partials.slice(partial, partial + regions.size());
+      for (const auto &region : regions) {
+        rowPartials[region.begin() / rowSize].push_back(partial++);
+      }
+      graph.setTileMapping(out, tile);
+      auto v = graph.addVertex(
+          cs, vertexName,
+          {{"in", flat.slices(regions)}, {"out", out.flatten()}});
+      graph.setTileMapping(v, tile);
+    }
+  }
+  prog.add(Execute(cs, {dnai}));
+
+  // Gather the partials of each row, padding rows with fewer partials with
+  // pairs that do not change the result.
+  std::size_t maxRowPartials = 0;
+  for (const auto &row : rowPartials) {
+    maxRowPartials = std::max(maxRowPartials, row.size());
+  }
+  Tensor pad;
+  std::vector<Tensor> grouped;
+  grouped.reserve(numRows * maxRowPartials);
+  for (const auto &row : rowPartials) {
+    for (const auto p : row) {
+      grouped.push_back(partials.slice(p, p + 1));
+    }
+    if (row.size() != maxRowPartials) {
+      if (!pad.valid()) {
+        const float padValues[] = {std::numeric_limits<float>::lowest(), 0};
+        pad = graph.addConstant(FLOAT, {1, 2}, padValues, {dnai, "pad"});
+        graph.setTileMapping(pad, 0);
+      }
+      grouped.push_back(pad.broadcast(maxRowPartials - row.size(), 0));
+    }
+  }
+  const auto rows = concat(grouped).reshape({numRows, maxRowPartials, 2});
+  const auto rowMaxes = rows.slice(0, 1, 2).squeeze({2});
+  const auto rowSums = rows.slice(1, 2, 2).squeeze({2});
+  if (maxRowPartials == 1) {
+    return {rowMaxes.squeeze({1}), rowSums.squeeze({1})};
+  }
+
+  // The sum of a row is the sum of the partial sums, each rescaled from its
+  // own maximum to the maximum of the row.
+  auto max = popops::reduce(graph, rowMaxes, FLOAT, {1},
+                            popops::Operation::MAX, prog, {dnai, "max"});
+  auto rescaled = popops::map(
+      graph, expr::Mul(expr::_2, expr::Exp(expr::Sub(expr::_1, expr::_3))),
+      {rowMaxes, rowSums, max.expand({1}).broadcast(maxRowPartials, 1)}, prog,
+      {dnai, "rescale"});
+  auto sum = popops::reduce(graph, rescaled, FLOAT, {1},
+                            popops::Operation::ADD, prog, {dnai, "sumExp"});
+  return {max, sum};
+}
+
 // computes log of the softmax along the innermost dimension
 Tensor logSoftmaxImpl(Graph &graph, Tensor t, bool inPlace, Sequence &prog,
                       const DebugNameAndId &dnai) {
@@ -38,45 +148,37 @@ Tensor logSoftmaxImpl(Graph &graph, Tensor t, bool inPlace, Sequence &prog,
     t = t.expand({0});
   }
 
-  // Switch innermost dimension to outer as softmax is done over it
   const auto rank = t.rank();
-  auto tShuf = t.dimShufflePartial({0, rank - 1}, {rank - 1, 0});
   const auto innerDimSize = t.dim(rank - 1);
-
-  bool needsCopy = !inPlace;
-  auto max = popops::reduce(graph, tShuf, {0}, popops::Operation::MAX, prog,
-                            {dnai, fnStr})
-                 .expand({0})
-                 .broadcast(innerDimSize, 0);
-
-  if (needsCopy) {
-    tShuf = popops::sub(graph, tShuf, max, prog, {dnai, fnStr});
+  auto rowShape = t.shape();
+  rowShape.pop_back();
+
+  // The offset max + log(sumExp) is kept in FLOAT and subtracted from t in
+  // FLOAT, so that only the result is rounded to the type of t. Rounding the
+  // offset would lose most of the precision of a HALF result when the inputs
+  // are large.
+  const auto normaliser = softmaxNormaliserImpl(graph, t, prog, {dnai, fnStr});
+  auto offset =
+      popops::map(graph, expr::Add(expr::_1, expr::Log(expr::_2)),
+                  {normaliser.first, normaliser.second}, prog, {dnai, fnStr})
+          .reshape(rowShape)
+          .expand({rank - 1})
+          .broadcast(innerDimSize, rank - 1);
+  const auto logSoftmaxExpr =
+      dType == FLOAT
+          ? expr::Sub(expr::_1, expr::_2).clone()
+          : expr::Cast(expr::Sub(expr::Cast(expr::_1, FLOAT), expr::_2), dType)
+                .clone();
+
+  Tensor tRet;
+  if (inPlace) {
+    popops::mapInPlace(graph, *logSoftmaxExpr, {t, offset}, prog,
+                       {dnai, fnStr});
+    tRet = t;
   } else {
-    popops::subInPlace(graph, tShuf, max, prog, {dnai, fnStr});
+    tRet =
+        popops::map(graph, *logSoftmaxExpr, {t, offset}, prog, {dnai, fnStr});
   }
-
-  auto tExp = popops::exp(graph, tShuf, prog, {dnai, fnStr});
-
-  // For half types we can improve accuracy by scaling the result so that the
-  // sum of the values is max half instead of 1.0.
-  auto sumF = popops::reduce(graph, tExp, poplar::FLOAT, {0},
-                             popops::Operation::ADD, prog, {dnai, fnStr});
-
-  // Keep at higher precision though is strictly not necessary as the input is
-  // always guaranteed to be > 1. The tensor dimension is already smaller than
-  // the original; so the cost of doing this in higher precision should be low
-  // as long as the outer dimension is not large compared to the number of tiles
-  // this is split over.
-  auto sum = popops::map(graph, expr::Cast(expr::Log(expr::_1), dType), {sumF},
-                         prog, {dnai, fnStr});
-
-  // Do not fuse with above expression to allow efficient use of broadcast
-  // vertices.
-  popops::subInPlace(graph, tShuf, sum, prog, {dnai, fnStr});
-
-  // Shuffle dimensions back to original ordering and return.
-  // If inPlace == true then this is the same as the original tensor.
-  auto tRet = tShuf.dimShufflePartial({0, rank - 1}, {rank - 1, 0});
   assert(tRet.shape() == t.shape());
   return expandDimension ? tRet.squeeze({0}) : tRet;
 }
@@ -85,6 +187,33 @@ Tensor logSoftmaxImpl(Graph &graph, Tensor t, bool inPlace, Sequence &prog,
 
 namespace popnn {
 
+SoftmaxNormaliser softmaxNormaliser(Graph &graph, const Tensor &t,
+                                    Sequence &prog,
+                                    const poplar::DebugContext &debugContext) {
+  poputil::PoplibsOpDebugInfo di(debugContext, DI_ARGS(t));
+
+  logging::popnn::info("softmaxNormaliser t={}, name={}", t.shape(),
+                       debugContext.getPathName());
+  if (t.rank() < 1 || t.dim(t.rank() - 1) == 0) {
+    throw poplibs_error("input tensor to softmaxNormaliser must have at least "
+                        "1 dimension and a non-empty innermost dimension");
+  }
+  if (t.elementType() != FLOAT && t.elementType() != HALF) {
+    throw poplibs_error("softmaxNormaliser: unsupported type " +
+                        t.elementType().toString() + ", must be FLOAT or HALF");
+  }
+
+  auto outShape = t.shape();
+  outShape.pop_back();
+  const auto normaliser = softmaxNormaliserImpl(graph, t, prog, {di});
+  SoftmaxNormaliser result;
+  result.max = normaliser.first.reshape(outShape);
+  result.sumExp = normaliser.second.reshape(outShape);
+  di.addOutputs({{"max", toProfileValue(result.max)},
+                 {"sumExp", toProfileValue(result.sumExp)}});
+  return result;
+}
+
 void logSoftmaxInPlace(Graph &graph, Tensor t, Sequence &prog,
                        const poplar::DebugContext &debugContext) {
   poputil::PoplibsOpDebugInfo di(debugContext, DI_ARGS(t));
@@ -1,6 +1,7 @@
 // Copyright (c) 2016 Graphcore Ltd. All rights reserved.
 #include "popnn/Loss.hpp"
 
+#include "StreamingTopK.hpp"
 #include "poplar/Graph.hpp"
 #include "poplibs_support/Algorithm.hpp"
 #include "poplibs_support/Algorithms.hpp"
@@ -9,8 +10,10 @@
 #include "popops/ElementWise.hpp"
 #include "popops/Encoding.hpp"
 #include "popops/Reduce.hpp"
+#include "popops/SelectScalarFromRows.hpp"
 #include "poputil/Broadcast.hpp"
 #include "poputil/DebugInfo.hpp"
+#include "poputil/OptionParsing.hpp"
 #include "poputil/TileMapping.hpp"
 #include "poputil/Util.hpp"
 #include "poputil/VarStructure.hpp"
@@ -19,8 +22,11 @@
 
 #include <boost/optional.hpp>
 #include <boost/optional/optional_io.hpp>
+#include <algorithm>
 #include <cassert>
 #include <limits>
+#include <map>
+#include <string>
 
 using namespace poplar;
 using namespace poplar::program;
@@ -130,6 +136,39 @@ Tensor onTileTransform(Graph &graph, const Tensor &modelOutputs,
   return transformed;
 }
 
+enum class TopKMethod { AUTO, HEAP, STREAMING };
+
+TopKMethod parseTopKOptions(const OptionFlags &options) {
+  TopKMethod method = TopKMethod::HEAP;
+  const std::map<std::string, TopKMethod> methodMap{
+      {"auto", TopKMethod::AUTO},
+      {"heap", TopKMethod::HEAP},
+      {"streaming", TopKMethod::STREAMING}};
+  /*
+   * Any changes to spec must be reflected in the documentation comment in
+   * the header.
+   */
+  const OptionSpec spec{
+      {"method", OptionHandler::createWithEnum(method, methodMap)}};
+  for (const auto &entry : options) {
+    spec.parse(entry.first, entry.second);
+  }
+  return method;
+}
+
+bool useStreamingTopK(const Target &target, TopKMethod method,
+                      std::size_t numClasses, std::size_t k) {
+  switch (method) {
+  case TopKMethod::HEAP:
+    return false;
+  case TopKMethod::STREAMING:
+    return true;
+  case TopKMethod::AUTO:
+    break;
+  }
+  return preferStreamingTopK(target, numClasses, k);
+}
+
 // Parameters needed to create one ReduceXxxClassGather vertex, for the first
 // stage reduction in argMinOrMax().
 struct ClassGatherVertexInfo {
@@ -391,6 +430,148 @@ Program calcLoss(Graph &graph, const Tensor &modelOutputs,
                   modelOutputScaling, lossType, {di});
 }
 
+Program calcSparseSoftmaxCrossEntropyLoss(
+    Graph &graph, const Tensor &logits, const Tensor &labels,
+    const Tensor &loss, const Tensor &deltasScale,
+    const poplar::DebugContext &debugContext) {
+  poputil::PoplibsOpDebugInfo di(debugContext,
+                                 DI_ARGS(logits, labels, loss, deltasScale));
+  const std::string layerPrefix = "SparseSoftmaxCrossEntropy";
+  logging::popnn::info("calcSparseSoftmaxCrossEntropyLoss logits={}, "
+                       "labels={}, name={}",
+                       logits.shape(), labels.shape(),
+                       debugContext.getPathName());
+
+  if (logits.rank() != 2) {
+    throw poplibs_error("calcSparseSoftmaxCrossEntropyLoss: 'logits' must be "
+                        "a 2D tensor");
+  }
+  const auto dType = logits.elementType();
+  if (dType != FLOAT && dType != HALF) {
+    throw poplibs_error("calcSparseSoftmaxCrossEntropyLoss: 'logits' must be "
+                        "of type FLOAT or HALF");
+  }
+  const auto batchSize = logits.dim(0);
+  if (labels.rank() != 1 || labels.dim(0) != batchSize) {
+    throw poplibs_error("calcSparseSoftmaxCrossEntropyLoss: 'labels' must be "
+                        "a 1D tensor with the same number of rows as "
+                        "'logits': " +
+                        std::to_string(batchSize));
+  }
+  if (labels.elementType() != UNSIGNED_INT && labels.elementType() != INT) {
+    throw poplibs_error("calcSparseSoftmaxCrossEntropyLoss: 'labels' must be "
+                        "of type UNSIGNED_INT or INT");
+  }
+  if (loss.rank() != 1 || loss.dim(0) != batchSize) {
+    throw poplibs_error("calcSparseSoftmaxCrossEntropyLoss: 'loss' must be a "
+                        "1D tensor with the same number of rows as "
+                        "'logits': " +
+                        std::to_string(batchSize));
+  }
+  if (deltasScale.numElements() != 1) {
+    throw poplibs_error("calcSparseSoftmaxCrossEntropyLoss: 'deltasScale' "
+                        "must have a single element");
+  }
+
+  Sequence prog({}, {di});
+  namespace pe = popops::expr;
+  // Negative labels are out of range, as are labels of MASKED_LABEL_CODE.
+  const auto labelsU = labels.reinterpret(UNSIGNED_INT);
+  const auto masked = pe::Equal(
+      pe::_1, pe::Const(static_cast<unsigned>(MASKED_LABEL_CODE)));
+
+  // Read the logit at each label before the logits are overwritten. This is
+  // zero for a masked label and NaN for a label out of range.
+  const auto labelLogits = popops::cast(
+      graph,
+      popops::selectScalarFromRows(graph, logits, labelsU, prog,
+                                   {di, layerPrefix + "/labelLogits"}),
+      FLOAT, prog, {di, layerPrefix});
+
+  // The softmax is shifted by the largest logit of each row so that the
+  // exponentials cannot overflow. They replace the logits.
+  const auto maxLogits =
+      popops::reduce(graph, logits, FLOAT, {1}, popops::Operation::MAX, prog,
+                     {di, layerPrefix + "/maxLogits"});
+  popops::mapInPlace(
+      graph, pe::Exp(pe::Sub(pe::_1, pe::Cast(pe::_2, dType))),
+      {logits, maxLogits.expand({1}).broadcast(logits.dim(1), 1)}, prog,
+      {di, layerPrefix + "/exp"});
+  const auto sumExps =
+      popops::reduce(graph, logits, FLOAT, {1}, popops::Operation::ADD, prog,
+                     {di, layerPrefix + "/sumExps"});
+
+  // loss = log(sum(exp(x - max))) + max - x[label], zero for masked labels.
+  const auto lossValues = popops::map(
+      graph,
+      pe::Select(pe::Const(0.0f),
+                 pe::Add(pe::Log(pe::_2), pe::Sub(pe::_3, pe::_4)), masked),
+      {labelsU, sumExps, maxLogits, labelLogits}, prog,
+      {di, layerPrefix + "/loss"});
+  if (loss.elementType() == FLOAT) {
+    prog.add(Copy(lossValues, loss, false, {di}));
+  } else {
+    auto castCS = graph.addComputeSet({di, layerPrefix + "/castLoss"});
+    popops::cast(graph, lossValues, loss, castCS);
+    prog.add(Execute(castCS, {di}));
+  }
+
+  // The gradient of each row is deltasScale * (softmax - onehot(label)), and
+  // zero for masked labels.
+  const auto rowScales = popops::map(
+      graph,
+      pe::Select(pe::Const(0.0f), pe::Divide(pe::Cast(pe::_3, FLOAT), pe::_2),
+                 masked),
+      {labelsU, sumExps, deltasScale.reshape({1}).broadcast(batchSize, 0)},
+      prog, {di, layerPrefix + "/rowScales"});
+  const auto scale = deltasScale.reshape({});
+
+  const auto &target = graph.getTarget();
+  const auto numWorkers = target.getNumWorkerContexts();
+  const auto grainSize = target.getVectorWidth(dType);
+  const auto vertexClass =
+      templateVertex("popnn::LossSoftmaxCrossEntropyTransform", dType);
+  auto cs = graph.addComputeSet({di, layerPrefix + "/gradient"});
+  for (std::size_t b = 0; b < batchSize; ++b) {
+    const auto row = logits[b];
+    const auto mapping = graph.getTileMapping(row);
+    for (unsigned tile = 0; tile < mapping.size(); ++tile) {
+      std::size_t tileElements = 0;
+      for (const auto &interval : mapping[tile]) {
+        tileElements += interval.size();
+      }
+      const auto workerElements = std::max<std::size_t>(
+          grainSize, poplibs_support::ceildiv(tileElements, numWorkers));
+      for (const auto &interval : mapping[tile]) {
+        for (auto begin = interval.begin(); begin < interval.end();
+             begin += workerElements) {
+          const auto end = std::min(begin + workerElements, interval.end());
+          auto v = graph.addVertex(cs, vertexClass,
+                                   {{"deltas", row.slice(begin, end)},
+                                    {"rowScale", rowScales[b]},
+                                    {"deltasScale", scale},
+                                    {"label", labelsU[b]}});
+          graph.setInitialValue(v["offset"], begin);
+          graph.setTileMapping(v, tile);
+        }
+      }
+    }
+  }
+  prog.add(Execute(cs, {di}));
+  return std::move(prog);
+}
+
+Program calcSparseSoftmaxCrossEntropyLoss(
+    Graph &graph, const Tensor &logits, const Tensor &labels,
+    const Tensor &loss, const poplar::DebugContext &debugContext) {
+  poputil::PoplibsOpDebugInfo di(debugContext, DI_ARGS(logits, labels, loss));
+  auto deltasScale =
+      graph.addConstant(logits.elementType(), {}, 1.0f, {di, "deltasScale"});
+  graph.setTileMapping(deltasScale, 0);
+  return calcSparseSoftmaxCrossEntropyLoss(graph, logits, labels, loss,
+                                           deltasScale, {di});
+}
+
 /// Returns the indices of the max (or min) values for each row of a 2-D tensor.
 ///
 /// \param[in] graph       the graph for the tensor
@@ -689,10 +870,10 @@ static Tensor TopKImpl(Graph &graph, const poplar::Tensor &input,
 }
 
 Tensor topK(Graph &graph, const Tensor &input, Tensor &indices, unsigned K,
-            bool sort, Sequence &prog,
-            const poplar::DebugContext &debugContext) {
+            bool sort, Sequence &prog, const poplar::DebugContext &debugContext,
+            const poplar::OptionFlags &options) {
   poputil::PoplibsOpDebugInfo di(debugContext,
-                                 DI_ARGS(input, indices, K, sort));
+                                 DI_ARGS(input, indices, K, sort, options));
 
   logging::popnn::info("topK input={}, k={}, sort={}, name={}", input.shape(),
                        K, sort, debugContext.getPathName());
@@ -711,17 +892,24 @@ Tensor topK(Graph &graph, const Tensor &input, Tensor &indices, unsigned K,
                         "dimensions which the TopK is being calculated for.");
   }
 
-  // TODO: T12906 Map the output tensor.
-  unsigned numCorrectTile = 0;
-  auto output = TopKImpl(graph, input, indices, K, sort, UNSIGNED_INT, prog,
-                         numCorrectTile, {di});
+  const auto method = parseTopKOptions(options);
+  Tensor output;
+  if (useStreamingTopK(graph.getTarget(), method, input.dim(1), K)) {
+    output = streamingTopK(graph, input, indices, K, sort, prog, {di});
+  } else {
+    // TODO: T12906 Map the output tensor.
+    unsigned numCorrectTile = 0;
+    output = TopKImpl(graph, input, indices, K, sort, UNSIGNED_INT, prog,
+                      numCorrectTile, {di});
+  }
   di.addOutput(output);
   return output;
 }
 
 Tensor argMax(Graph &graph, const Tensor &input, Sequence &prog,
-              const poplar::DebugContext &debugContext) {
-  poputil::PoplibsOpDebugInfo di(debugContext, DI_ARGS(input));
+              const poplar::DebugContext &debugContext,
+              const poplar::OptionFlags &options) {
+  poputil::PoplibsOpDebugInfo di(debugContext, DI_ARGS(input, options));
 
   logging::popnn::info("argMax input={}, name={}", input.shape(),
                        debugContext.getPathName());
@@ -738,8 +926,16 @@ Tensor argMax(Graph &graph, const Tensor &input, Sequence &prog,
     throw poplibs_error("arg max on input type is not supported");
   }
 
-  auto output =
-      argMinOrMax(graph, input, UNSIGNED_INT, prog, numCorrectTile, {di});
+  const auto method = parseTopKOptions(options);
+  Tensor output;
+  if (useStreamingTopK(graph.getTarget(), method, input.dim(1), 1)) {
+    Tensor indices;
+    streamingTopK(graph, input, indices, 1, false, prog, {di});
+    output = indices.flatten();
+  } else {
+    output =
+        argMinOrMax(graph, input, UNSIGNED_INT, prog, numCorrectTile, {di});
+  }
   di.addOutput(output);
   return output;
 }
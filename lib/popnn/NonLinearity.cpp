@@ -4,6 +4,7 @@
 #include "NonLinearityInternal.hpp"
 #include "poplibs_support/logging.hpp"
 #include "poplin/MatMul.hpp"
+#include "popnn/LogSoftmax.hpp"
 #include "popnn/NonLinearityDef.hpp"
 #include "popnn/NonLinearityDefUtil.hpp"
 #include "popops/Cast.hpp"
@@ -77,36 +78,45 @@ Tensor softmaxImpl(Graph &graph, Tensor t, bool stableAlgo, bool inPlace,
     t = t.expand({0});
   }
 
-  // Switch innermost dimension to outer as softmax is done over it
   const auto rank = t.rank();
-  auto tShuf = t.dimShufflePartial({0, rank - 1}, {rank - 1, 0});
   const auto innerDimSize = t.dim(rank - 1);
 
-  bool needsCopy = !inPlace;
   if (stableAlgo) {
-    auto max = popops::reduce(graph, tShuf, {0}, popops::Operation::MAX, prog,
-                              {dnai, fnStr})
-                   .expand({0})
-                   .broadcast(innerDimSize, 0);
-
-    // Split subtract from max and addition with std::log(SOFTMAX_SCALING)
-    // to avoid rounding errors in expression max - std::log(SOFTMAX_SCALING)
-    // causing exp to exceed max half.
-    // Note: We could do max - std::log(SOFTMAX_SCALING) for float type but
-    //       is not done here to keep the code clean.
-    if (needsCopy) {
-      tShuf = popops::sub(graph, tShuf, max, prog, {dnai, fnStr});
-      needsCopy = false;
-    } else {
-      popops::subInPlace(graph, tShuf, max, prog, {dnai, fnStr});
-    }
-
-    if (scaled) {
-      popops::addInPlace(graph, tShuf, std::log(SOFTMAX_SCALING), prog,
+    // The maximum and the sum of exponentials come from a single read of t,
+    // after which the softmax is exp(t - max - log(sumExp)), scaled by
+    // adding log(SOFTMAX_SCALING) to the exponent. The exponent is computed
+    // in FLOAT so the result cannot exceed max half through rounding.
+    const auto normaliser = softmaxNormaliser(graph, t, prog, {dnai, fnStr});
+    const float logScale = scaled ? std::log(SOFTMAX_SCALING) : 0.0f;
+    auto offset =
+        popops::map(graph,
+                    expr::Sub(expr::Add(expr::_1, expr::Log(expr::_2)),
+                              expr::Const(logScale)),
+                    {normaliser.max, normaliser.sumExp}, prog, {dnai, fnStr})
+            .expand({rank - 1})
+            .broadcast(innerDimSize, rank - 1);
+    const auto softmaxExpr =
+        dType == FLOAT
+            ? expr::Exp(expr::Sub(expr::_1, expr::_2)).clone()
+            : expr::Cast(
+                  expr::Exp(expr::Sub(expr::Cast(expr::_1, FLOAT), expr::_2)),
+                  dType)
+                  .clone();
+    Tensor tRet;
+    if (inPlace) {
+      popops::mapInPlace(graph, *softmaxExpr, {t, offset}, prog,
                          {dnai, fnStr});
+      tRet = t;
+    } else {
+      tRet = popops::map(graph, *softmaxExpr, {t, offset}, prog, {dnai, fnStr});
     }
+    return expandDimension ? tRet.squeeze({0}) : tRet;
   }
 
+  // Switch innermost dimension to outer as softmax is done over it
+  auto tShuf = t.dimShufflePartial({0, rank - 1}, {rank - 1, 0});
+
+  bool needsCopy = !inPlace;
   if (needsCopy) {
     tShuf = popops::exp(graph, tShuf, prog, {dnai, fnStr});
   } else {
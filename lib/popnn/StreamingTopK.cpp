@@ -0,0 +1,251 @@
+// Copyright (c) 2020 Graphcore Ltd. All rights reserved.
+#include "StreamingTopK.hpp"
+
+#include "poplibs_support/Algorithm.hpp"
+#include "poplibs_support/logging.hpp"
+#include "poputil/Util.hpp"
+#include "poputil/VertexTemplates.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+#include <string>
+#include <vector>
+
+using namespace poplar;
+using namespace poplar::program;
+using namespace poputil;
+
+namespace logging = poplibs_support::logging;
+
+namespace popnn {
+
+namespace {
+
+// Below this number of classes the heap-based top-k is used.
+constexpr std::size_t streamingMinClasses = 4096;
+
+// Rough costs used to choose the merge fan-in: the cycles to read and test
+// an element of a candidate list, most of which are rejected by the
+// threshold, and the cycles of the sync and exchange of each merge stage.
+constexpr double mergeCyclesPerElement = 4;
+constexpr double mergeStageCycles = 150;
+constexpr std::size_t maxMergeFanIn = 64;
+
+// A list of at most k candidates of one batch.
+struct CandidateList {
+  Tensor values;
+  Tensor indices;
+  unsigned tile;
+};
+
+// A chunk of the classes of a batch read by one first stage vertex.
+struct Chunk {
+  unsigned tile;
+  Interval classes;
+};
+
+} // end anonymous namespace
+
+std::ostream &operator<<(std::ostream &os, const StreamingTopKPlan &p) {
+  os << "StreamingTopKPlan{minChunkSize=" << p.minChunkSize
+     << ", mergeFanIn=" << p.mergeFanIn << "}";
+  return os;
+}
+
+StreamingTopKPlan planStreamingTopK(const Target &target,
+                                    std::size_t numClasses, std::size_t k) {
+  StreamingTopKPlan plan;
+  plan.minChunkSize = std::max<std::size_t>(4 * k, 32);
+
+  // The number of candidates left after the first stage, in units of k.
+  const auto numThreads = target.getNumTiles() * target.getNumWorkerContexts();
+  const auto numChunks =
+      std::min<std::size_t>(numThreads, poplibs_support::ceildiv(
+                                            numClasses, plan.minChunkSize));
+  const auto numLists = std::max<std::size_t>(
+      1, poplibs_support::ceildiv(std::min(numClasses, numChunks * k), k));
+
+  // A larger fan-in means fewer stages but more work in each. The stages run
+  // one after the other, so minimise the cycles of one vertex per stage
+  // times the number of stages.
+  plan.mergeFanIn = 2;
+  double bestCycles = std::numeric_limits<double>::max();
+  for (std::size_t fanIn = 2; fanIn <= maxMergeFanIn; ++fanIn) {
+    std::size_t stages = 0;
+    for (auto n = numLists; n > 1; n = poplibs_support::ceildiv(n, fanIn)) {
+      ++stages;
+    }
+    const double cycles =
+        stages * (fanIn * k * mergeCyclesPerElement + mergeStageCycles);
+    if (cycles < bestCycles) {
+      bestCycles = cycles;
+      plan.mergeFanIn = fanIn;
+    }
+  }
+  return plan;
+}
+
+bool preferStreamingTopK(const Target &target, std::size_t numClasses,
+                         std::size_t k) {
+  // The heap-based top-k gathers the input onto tiles in round-robin order
+  // regardless of its layout, which only pays off when the input is small.
+  return target.getNumTiles() > 1 &&
+         numClasses >= std::max<std::size_t>(16 * k, streamingMinClasses);
+}
+
+Tensor streamingTopK(Graph &graph, const Tensor &input, Tensor &indices,
+                     std::size_t k, bool sort, Sequence &prog,
+                     const DebugNameAndId &dnai) {
+  const std::string layerPrefix = "topk";
+  const auto &target = graph.getTarget();
+  const auto type = input.elementType();
+  const auto batchSize = input.dim(0);
+  const auto numClasses = input.dim(1);
+  const auto numWorkers = target.getNumWorkerContexts();
+  const auto plan = planStreamingTopK(target, numClasses, k);
+  logging::popnn::debug("Streaming topK {}: {}", dnai.getPathName(), plan);
+
+  // Split the classes each tile holds into chunks so that all workers are
+  // used, while each chunk has enough elements to prune.
+  std::vector<std::vector<Chunk>> chunks(batchSize);
+  for (std::size_t b = 0; b < batchSize; ++b) {
+    const auto mapping = graph.getTileMapping(input[b]);
+    for (unsigned tile = 0; tile < mapping.size(); ++tile) {
+      std::size_t tileClasses = 0;
+      for (const auto &interval : mapping[tile]) {
+        tileClasses += interval.size();
+      }
+      const auto chunkSize = std::max(
+          plan.minChunkSize, poplibs_support::ceildiv(tileClasses, numWorkers));
+      for (const auto &interval : mapping[tile]) {
+        for (auto begin = interval.begin(); begin < interval.end();
+             begin += chunkSize) {
+          const auto end = std::min(begin + chunkSize, interval.end());
+          chunks[b].push_back({tile, Interval(begin, end)});
+        }
+      }
+    }
+    // Keep the chunks, and so the candidate lists, in class order. With k = 1
+    // the vertices keep the first of equal values, so argMax ties resolve to
+    // the lowest class as in the heap-based argMax, whatever the tile
+    // mapping.
+    std::sort(chunks[b].begin(), chunks[b].end(),
+              [](const Chunk &lhs, const Chunk &rhs) {
+                return lhs.classes.begin() < rhs.classes.begin();
+              });
+  }
+
+  const auto partialVertexClass =
+      templateVertex("popnn::TopKPartial", type, sort);
+  const auto mergeVertexClass =
+      templateVertex("popnn::ReduceMaxNClassSparse", type, sort);
+
+  std::vector<std::vector<CandidateList>> lists(batchSize);
+  const auto addOutputs = [&](std::size_t numK, unsigned tile,
+                              const std::string &name) {
+    CandidateList list;
+    list.values = graph.addVariable(type, {numK}, {dnai, name + "Values"});
+    list.indices =
+        graph.addVariable(UNSIGNED_INT, {numK}, {dnai, name + "Indices"});
+    list.tile = tile;
+    graph.setTileMapping(list.values, tile);
+    graph.setTileMapping(list.indices, tile);
+    return list;
+  };
+
+  auto cs = graph.addComputeSet({dnai, layerPrefix + "/Partial"});
+  for (std::size_t b = 0; b < batchSize; ++b) {
+    const auto name = layerPrefix + "/Partials[" + std::to_string(b) + "]";
+    for (const auto &chunk : chunks[b]) {
+      const auto numK = std::min(k, chunk.classes.size());
+      auto list = addOutputs(numK, chunk.tile, name);
+      auto v = graph.addVertex(
+          cs, partialVertexClass,
+          {{"activations", input[b].slice(chunk.classes)},
+           {"maxValues", list.values},
+           {"maxValuesIndices", list.indices}});
+      graph.setInitialValue(v["index"], chunk.classes.begin());
+      graph.setInitialValue(v["numK"], numK);
+      graph.setInitialValue(v["shouldSort"], sort && chunks[b].size() == 1);
+      graph.setTileMapping(v, chunk.tile);
+      lists[b].push_back(std::move(list));
+    }
+  }
+  prog.add(Execute(cs, {dnai}));
+
+  // Merge consecutive lists, which are usually on the same or nearby tiles,
+  // until each batch has one list. A group is closed once it holds mergeFanIn * k
+  // candidates so lists shorter than k are merged in larger groups. Only the
+  // last group of a batch can hold a single list, which is passed on to the
+  // next stage unchanged.
+  const auto groupCapacity = plan.mergeFanIn * k;
+  for (std::size_t stage = 0;; ++stage) {
+    const bool done =
+        std::all_of(lists.begin(), lists.end(),
+                    [](const std::vector<CandidateList> &l) {
+                      return l.size() == 1;
+                    });
+    if (done) {
+      break;
+    }
+    const auto stageStr = "[" + std::to_string(stage) + "]";
+    cs = graph.addComputeSet({dnai, layerPrefix + "/Merge" + stageStr});
+    for (std::size_t b = 0; b < batchSize; ++b) {
+      if (lists[b].size() == 1) {
+        continue;
+      }
+      const auto name = layerPrefix + "/Merged" + stageStr + "[" +
+                        std::to_string(b) + "]";
+      std::vector<std::vector<CandidateList>> groups(1);
+      std::size_t groupSize = 0;
+      for (auto &list : lists[b]) {
+        if (groupSize >= groupCapacity) {
+          groups.emplace_back();
+          groupSize = 0;
+        }
+        groupSize += list.values.numElements();
+        groups.back().push_back(std::move(list));
+      }
+      const bool isLastMerge = groups.size() == 1;
+      std::vector<CandidateList> nextLists;
+      for (const auto &group : groups) {
+        if (group.size() == 1) {
+          nextLists.push_back(group.front());
+          continue;
+        }
+        std::vector<Tensor> values, labels;
+        for (const auto &list : group) {
+          values.push_back(list.values);
+          labels.push_back(list.indices);
+        }
+        auto groupValues = concat(values);
+        const auto numK = std::min(k, groupValues.numElements());
+        const auto tile = group.front().tile;
+        auto list = addOutputs(numK, tile, name);
+        auto v = graph.addVertex(cs, mergeVertexClass,
+                                 {{"activations", groupValues},
+                                  {"labels", concat(labels)},
+                                  {"maxValues", list.values},
+                                  {"maxValuesIndices", list.indices}});
+        graph.setInitialValue(v["numK"], numK);
+        graph.setInitialValue(v["shouldSort"], sort && isLastMerge);
+        graph.setTileMapping(v, tile);
+        nextLists.push_back(std::move(list));
+      }
+      lists[b] = std::move(nextLists);
+    }
+    prog.add(Execute(cs, {dnai}));
+  }
+
+  std::vector<Tensor> values, labels;
+  for (const auto &l : lists) {
+    assert(l.size() == 1 && l.front().values.numElements() == k);
+    values.push_back(l.front().values.expand({0}));
+    labels.push_back(l.front().indices.expand({0}));
+  }
+  indices = concat(labels);
+  return concat(values);
+}
+
+} // end namespace popnn
@@ -0,0 +1,52 @@
+// Copyright (c) 2020 Graphcore Ltd. All rights reserved.
+
+#ifndef popnn_StreamingTopK_hpp
+#define popnn_StreamingTopK_hpp
+
+#include <poplar/Graph.hpp>
+#include <poplar/Program.hpp>
+#include <poplar/Target.hpp>
+
+#include <cstddef>
+#include <ostream>
+
+namespace popnn {
+
+// The streaming top-k finds the top k of each batch in two phases:
+//
+//  1. Each tile finds the top k of chunks of the classes it holds, without
+//     exchanging the input. Each chunk produces a list of at most k
+//     candidates.
+//  2. The candidate lists are merged in a tree: each stage combines up to
+//     mergeFanIn consecutive lists of a batch on the tile of the first list,
+//     until one list remains per batch.
+struct StreamingTopKPlan {
+  // The fewest elements read by each first stage vertex, so that each chunk
+  // reduces the data by a useful factor.
+  std::size_t minChunkSize;
+  // The number of candidate lists combined by each merge vertex.
+  std::size_t mergeFanIn;
+};
+
+std::ostream &operator<<(std::ostream &os, const StreamingTopKPlan &p);
+
+// Plan the streaming top-k of \p numClasses classes per batch spread over the
+// tiles of \p target.
+StreamingTopKPlan planStreamingTopK(const poplar::Target &target,
+                                    std::size_t numClasses, std::size_t k);
+
+// Returns true if the streaming top-k is expected to be cheaper than the
+// heap-based top-k for the given size.
+bool preferStreamingTopK(const poplar::Target &target, std::size_t numClasses,
+                         std::size_t k);
+
+// Find the top \p k values of each row of the 2D tensor \p input. \p indices
+// is set to their classes, with the same shape {batch, k} as the result.
+poplar::Tensor streamingTopK(poplar::Graph &graph, const poplar::Tensor &input,
+                             poplar::Tensor &indices, std::size_t k, bool sort,
+                             poplar::program::Sequence &prog,
+                             const poplar::DebugNameAndId &dnai);
+
+} // end namespace popnn
+
+#endif // popnn_StreamingTopK_hpp
@@ -56,4 +56,39 @@ public:
 template class LossCrossEntropyTransform<float>;
 template class LossCrossEntropyTransform<half>;
 
+// Turn part of a row of exponentials of logits into the gradient of the
+// softmax cross-entropy loss with respect to the logits, in place. Each
+// element is multiplied by rowScale, which is deltasScale over the sum of
+// the exponentials of the row, and deltasScale is subtracted at the label.
+// |offset| is the class of the first element.
+template <typename FPType>
+class LossSoftmaxCrossEntropyTransform : public Vertex {
+public:
+  LossSoftmaxCrossEntropyTransform();
+
+  InOut<Vector<FPType>> deltas;
+  Input<float> rowScale;
+  Input<FPType> deltasScale;
+  Input<unsigned> label;
+  const unsigned offset;
+
+  IS_EXTERNAL_CODELET(false);
+
+  bool compute() {
+    const float scale = *rowScale;
+    for (unsigned i = 0; i < deltas.size(); ++i) {
+      deltas[i] = FPType(float(deltas[i]) * scale);
+    }
+    // A masked label is never in range.
+    const unsigned l = *label;
+    if (l >= offset && l - offset < deltas.size()) {
+      deltas[l - offset] -= *deltasScale;
+    }
+    return true;
+  }
+};
+
+template class LossSoftmaxCrossEntropyTransform<float>;
+template class LossSoftmaxCrossEntropyTransform<half>;
+
 } // namespace popnn
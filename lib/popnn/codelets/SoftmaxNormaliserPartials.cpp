@@ -0,0 +1,51 @@
+// Copyright (c) 2020 Graphcore Ltd. All rights reserved.
+#include <poplar/HalfFloat.hpp>
+#include <poplar/Vertex.hpp>
+
+#include <cmath>
+
+using namespace poplar;
+
+static constexpr auto SPAN = VectorLayout::SPAN;
+static constexpr auto ONE_PTR = VectorLayout::ONE_PTR;
+
+namespace popnn {
+
+/*
+  Calculate the softmax normaliser of each region of |in| in a single pass.
+  For region i, out[2*i] is the largest value and out[2*i+1] the sum of the
+  exponentials of the values minus that maximum. The sum is rescaled whenever
+  a larger value is found, so each element is read once. Every region must
+  have at least one element.
+*/
+template <typename FPType> class SoftmaxNormaliserPartials : public Vertex {
+public:
+  SoftmaxNormaliserPartials();
+
+  Vector<Input<Vector<FPType, SPAN, 8>>> in;
+  Output<Vector<float, ONE_PTR>> out;
+
+  bool compute() {
+    for (unsigned i = 0; i < in.size(); ++i) {
+      float max = float(in[i][0]);
+      float sum = 1;
+      for (unsigned j = 1; j < in[i].size(); ++j) {
+        const float x = float(in[i][j]);
+        if (x > max) {
+          sum = sum * std::exp(max - x) + 1;
+          max = x;
+        } else {
+          sum += std::exp(x - max);
+        }
+      }
+      out[2 * i] = max;
+      out[2 * i + 1] = sum;
+    }
+    return true;
+  }
+};
+
+template class SoftmaxNormaliserPartials<float>;
+template class SoftmaxNormaliserPartials<half>;
+
+} // namespace popnn
@@ -0,0 +1,79 @@
+// Copyright (c) 2020 Graphcore Ltd. All rights reserved.
+#include "MinHeapView.hpp"
+#include "poplibs_support/ExternalCodelet.hpp"
+#include <poplar/HalfFloat.hpp>
+#include <poplar/Vertex.hpp>
+
+using namespace poplar;
+static constexpr auto ONE_PTR = poplar::VectorLayout::ONE_PTR;
+
+namespace popnn {
+
+/*
+  Calculate the top |numK| values of a contiguous chunk of the classes of one
+  batch, as the first stage of the streaming top-k. |index| is the class of
+  the first element of |activations| and |numK| must not be greater than the
+  size of |activations|.
+
+  The min heap of the ReduceMaxNClassSparse vertex is used, but the smallest
+  value in the heap is held as a threshold so most elements are rejected with
+  a single comparison once the heap is full.
+*/
+template <typename DataType, bool Sort = false>
+class TopKPartial : public Vertex {
+public:
+  TopKPartial();
+
+  Input<Vector<DataType>> activations;
+  const unsigned index;
+
+  Output<Vector<DataType, ONE_PTR>> maxValues;
+
+  Output<Vector<unsigned, ONE_PTR>> maxValuesIndices;
+
+  unsigned numK;
+  const bool shouldSort;
+
+  IS_EXTERNAL_CODELET(false);
+
+  bool compute() {
+    MinHeapView<decltype(maxValuesIndices), decltype(activations), unsigned>
+        heapView{maxValuesIndices, activations};
+
+    for (unsigned i = 0; i < numK; ++i) {
+      heapView.Push(i, i);
+    }
+    DataType threshold = activations[maxValuesIndices[0]];
+    for (unsigned i = numK; i < activations.size(); ++i) {
+      if (activations[i] > threshold) {
+        heapView.ReplaceAndRepair(i, numK);
+        threshold = activations[maxValuesIndices[0]];
+      }
+    }
+
+    // Sort if template parameter Sort is true and the runtime flag is set.
+    if (Sort && shouldSort) {
+      heapView.Sort(numK);
+    }
+
+    for (unsigned i = 0; i < numK; ++i) {
+      maxValues[i] = activations[maxValuesIndices[i]];
+      maxValuesIndices[i] += index;
+    }
+    return true;
+  }
+};
+
+// Unsorted.
+template class TopKPartial<float>;
+template class TopKPartial<half>;
+template class TopKPartial<int>;
+template class TopKPartial<unsigned int>;
+
+// Sorted outputs.
+template class TopKPartial<float, true>;
+template class TopKPartial<half, true>;
+template class TopKPartial<int, true>;
+template class TopKPartial<unsigned int, true>;
+
+} // namespace popnn
@@ -328,6 +328,31 @@ std::uint64_t MAKE_CYCLE_ESTIMATOR_NAME(LossCrossEntropyTransform)(
   return getLossTransformCycles(isFloat, isSoftmax, size);
 }
 
+std::uint64_t MAKE_CYCLE_ESTIMATOR_NAME(LossSoftmaxCrossEntropyTransform)(
+    const VertexIntrospector &vertex, const Target &target,
+    const Type &fpType) {
+  CODELET_FIELD(deltas);
+  // Load the scale and label, then load, convert if half, scale and store
+  // each element, and finally check the label and update one element.
+  const unsigned cyclesPerElement = fpType == FLOAT ? 3 : 5;
+  return 15 + deltas.size() * cyclesPerElement + 10;
+}
+
+// Per element: load, convert if half, compare with the running maximum and
+// add the exponential to the sum. A new maximum also rescales the sum with a
+// second exponential, which happens rarely once a region is under way.
+std::uint64_t MAKE_CYCLE_ESTIMATOR_NAME(SoftmaxNormaliserPartials)(
+    const VertexIntrospector &vertex, const Target &target,
+    const Type &fpType) {
+  CODELET_FIELD(in);
+  const unsigned cyclesPerElement = fpType == FLOAT ? 14 : 16;
+  std::uint64_t cycles = 10;
+  for (unsigned i = 0; i < in.size(); ++i) {
+    cycles += 8 + cyclesPerElement * in[i].size();
+  }
+  return cycles;
+}
+
 std::uint64_t MAKE_CYCLE_ESTIMATOR_NAME(ReduceMaxClassGather)(
     const VertexIntrospector &vertex, const Target &target, const Type &inType,
     const Type &labelType) {
@@ -453,6 +478,42 @@ std::uint64_t MAKE_CYCLE_ESTIMATOR_NAME(ReduceMaxNClassSparse)(
   return cycles;
 }
 
+std::uint64_t MAKE_CYCLE_ESTIMATOR_NAME(TopKPartial)(
+    const VertexIntrospector &vertex, const Target &target, const Type &type,
+    const bool sorted) {
+  CODELET_SCALAR_VAL(numK, unsigned);
+  CODELET_FIELD(activations);
+  const auto size = activations.size();
+
+  std::uint64_t cycles = 12; // Initial set up.
+
+  // For the first K we have a guaranteed push op.
+  for (unsigned i = 1; i < numK; ++i) {
+    cycles += 13 +              // Setup
+              std::log(i) * 20; // log(i) loop.
+  }
+
+  // The remaining elements are compared with the threshold held in a
+  // register. For inputs in random order about K * ln(size / K) of them are
+  // larger and replace the smallest value in the heap.
+  if (size > numK) {
+    cycles += (size - numK) * 4;
+    const double replacements = numK * std::log(double(size) / numK);
+    cycles += replacements * (15 + std::log(numK) * 20);
+  }
+
+  // Store the values and offset the indices.
+  cycles += 8 * numK;
+
+  if (sorted) {
+    for (int i = numK; i >= 1; --i) {
+      cycles += 10;               // Setup.
+      cycles += 20 * std::log(i); // log(k-1) pop operation.
+    }
+  }
+  return cycles;
+}
+
 std::uint64_t MAKE_CYCLE_ESTIMATOR_NAME(ReduceMaxClassSparse)(
     const VertexIntrospector &vertex, const Target &target,
     const Type &inOutType, const Type &labelType) {
@@ -573,6 +634,11 @@ poplibs::CycleEstimatorTable makeCyclesFunctionTable() {
 
       CYCLE_ESTIMATOR_ENTRY(popnn, LossCrossEntropyTransform, FLOAT),
       CYCLE_ESTIMATOR_ENTRY(popnn, LossCrossEntropyTransform, HALF),
+      CYCLE_ESTIMATOR_ENTRY(popnn, LossSoftmaxCrossEntropyTransform, FLOAT),
+      CYCLE_ESTIMATOR_ENTRY(popnn, LossSoftmaxCrossEntropyTransform, HALF),
+
+      CYCLE_ESTIMATOR_ENTRY(popnn, SoftmaxNormaliserPartials, FLOAT),
+      CYCLE_ESTIMATOR_ENTRY(popnn, SoftmaxNormaliserPartials, HALF),
 
       CYCLE_ESTIMATOR_ENTRY(popnn, ReduceMaxClassGather, FLOAT, UNSIGNED_INT),
       CYCLE_ESTIMATOR_ENTRY(popnn, ReduceMaxClassGather, HALF, UNSIGNED_INT),
@@ -616,6 +682,18 @@ poplibs::CycleEstimatorTable makeCyclesFunctionTable() {
       CYCLE_ESTIMATOR_ENTRY(popnn, ReduceMaxNClassSparse, UNSIGNED_INT, false),
       CYCLE_ESTIMATOR_ENTRY(popnn, ReduceMaxNClassSparse, UNSIGNED_INT, true),
 
+      CYCLE_ESTIMATOR_ENTRY(popnn, TopKPartial, FLOAT, false),
+      CYCLE_ESTIMATOR_ENTRY(popnn, TopKPartial, FLOAT, true),
+
+      CYCLE_ESTIMATOR_ENTRY(popnn, TopKPartial, HALF, false),
+      CYCLE_ESTIMATOR_ENTRY(popnn, TopKPartial, HALF, true),
+
+      CYCLE_ESTIMATOR_ENTRY(popnn, TopKPartial, INT, false),
+      CYCLE_ESTIMATOR_ENTRY(popnn, TopKPartial, INT, true),
+
+      CYCLE_ESTIMATOR_ENTRY(popnn, TopKPartial, UNSIGNED_INT, false),
+      CYCLE_ESTIMATOR_ENTRY(popnn, TopKPartial, UNSIGNED_INT, true),
+
       CYCLE_ESTIMATOR_ENTRY(popnn, ReduceMinClassGather, FLOAT, UNSIGNED_INT),
       CYCLE_ESTIMATOR_ENTRY(popnn, ReduceMinClassGather, HALF, UNSIGNED_INT),
       CYCLE_ESTIMATOR_ENTRY(popnn, ReduceMinClassGather, INT, UNSIGNED_INT),
@@ -1,6 +1,7 @@
 // Copyright (c) 2017 Graphcore Ltd. All rights reserved.
 #include "popops/DynamicSlice.hpp"
 #include "DynamicSliceInternal.hpp"
+#include "OperationDefUtil.hpp"
 #include "poplar/Interval.hpp"
 #include "poplar/Program.hpp"
 #include "poplar/Tensor.hpp"
@@ -13,8 +14,10 @@
 #include "popops/Cast.hpp"
 #include "popops/ElementWise.hpp"
 #include "popops/Encoding.hpp"
+#include "popops/Fill.hpp"
 #include "popops/Reduce.hpp"
 #include "popops/ScaledAdd.hpp"
+#include "popops/Sort.hpp"
 #include "popops/Zero.hpp"
 #include "popsolver/Model.hpp"
 #include "poputil/DebugInfo.hpp"
@@ -30,7 +33,10 @@
 #include <algorithm>
 #include <boost/range/adaptor/reversed.hpp>
 #include <cassert>
+#include <cmath>
+#include <limits>
 #include <numeric>
+#include <tuple>
 #include <type_traits>
 
 using namespace poplar;
@@ -51,6 +57,8 @@ template <> poplar::ProfileValue toProfileValue(const popops::SlicePlan &p) {
               toProfileValue(p.internal->partition.unslicedDimSplit)});
     v.insert({"unslicedGrainSize",
               toProfileValue(p.internal->partition.unslicedGrainSize)});
+    v.insert({"coalesceDuplicates",
+              toProfileValue(p.internal->coalesceDuplicates)});
   }
   return v;
 }
@@ -62,6 +70,9 @@ namespace {
 
 constexpr std::size_t minIndicesPerTile = 32;
 
+// When duplicate indices are summed before a multiUpdateAdd.
+enum class CoalesceDuplicates { NEVER, ALWAYS, AUTO };
+
 struct SliceOptions {
   SliceOptions() = default;
 
@@ -74,6 +85,12 @@ struct SliceOptions {
   // The target maximum temporary memory usage for the operation. This
   // may not be satisfiable.
   double availableMemoryProportion = 0.6;
+
+  // Whether updates to the same index are summed before a multiUpdateAdd,
+  // and the proportion of indices expected to be unique which the planner
+  // uses to decide when this is set to AUTO.
+  CoalesceDuplicates coalesceDuplicates = CoalesceDuplicates::NEVER;
+  double expectedUniqueLookupProportion = 1.0;
 };
 
 struct ValidateSlicePlanConstraintsOption {
@@ -103,6 +120,7 @@ std::ostream &operator<<(std::ostream &o, const SlicePlanInternal &p) {
   o << "    slicedDimSplit=" << p.partition.slicedDimSplit << "\n";
   o << "    unslicedDimSplit=" << p.partition.unslicedDimSplit << "\n";
   o << "    unslicedGrainSize=" << p.partition.unslicedGrainSize << "\n";
+  o << "  coalesceDuplicates=" << p.coalesceDuplicates << "\n";
   return o;
 }
 
@@ -149,7 +167,16 @@ static SliceOptions parseSliceOptions(const OptionFlags &optionFlags) {
        makeSlicePlanConstraintsOptionHandler(options.planConstraints)},
       {"usedForUpdate", OptionHandler::createWithBool(options.usedForUpdate)},
       {"availableMemoryProportion",
-       OptionHandler::createWithDouble(options.availableMemoryProportion)}};
+       OptionHandler::createWithDouble(options.availableMemoryProportion)},
+      {"coalesceDuplicates",
+       OptionHandler::createWithEnum(
+           options.coalesceDuplicates,
+           {{"never", CoalesceDuplicates::NEVER},
+            {"always", CoalesceDuplicates::ALWAYS},
+            {"auto", CoalesceDuplicates::AUTO}})},
+      {"expectedUniqueLookupProportion",
+       OptionHandler::createWithDouble(
+           options.expectedUniqueLookupProportion)}};
 
   for (const auto &entry : optionFlags) {
     spec.parse(entry.first, entry.second);
@@ -375,8 +402,9 @@ static void generateMultiSliceVerticesOnTile(
 
 static void generateMultiSliceVertices(
     const std::string &vertexNameUntemplated, bool isUpdate, bool isUpdateAdd,
-    Graph &graph, Sequence &prog, const Tensor &offsets, Tensor base,
-    Tensor slices, const boost::optional<Tensor> &scale, unsigned baseSlicedDim,
+    boost::optional<Operation> updateOp, Graph &graph, Sequence &prog,
+    const Tensor &offsets, Tensor base, Tensor slices,
+    const boost::optional<Tensor> &scale, unsigned baseSlicedDim,
     boost::optional<unsigned> baseOffset, const OptionFlags &optionFlags,
     const DebugNameAndId &dnai) {
 
@@ -547,6 +575,9 @@ static void generateMultiSliceVertices(
               templateVertex(vertexNameUntemplated, base.elementType(), false);
         }
       }
+    } else if (updateOp) {
+      vertexName =
+          templateVertex(vertexNameUntemplated, base.elementType(), *updateOp);
     } else {
       vertexName = templateVertex(vertexNameUntemplated, base.elementType());
     }
@@ -569,14 +600,66 @@ static void generateMultiSliceVertices(
   }
 }
 
-static void generatePlannedMultiUpdateAdd(
-    const std::string &vertexNameUntemplated, const SlicePlanInternal &plan,
-    Graph &graph, Sequence &seq, const Tensor &offsets, Tensor base,
-    Tensor slices, const Tensor scale, unsigned baseSlicedDim,
-    const OptionFlags &options, const DebugNameAndId &dnai) {
+// Fill \a t with the identity of \a op so it can be used as the initial value
+// of partials.
+static void fillWithIdentity(Graph &graph, const Tensor &t, Operation op,
+                             Sequence &seq, const DebugNameAndId &dnai) {
+  const auto type = t.elementType();
+  switch (op) {
+  case Operation::ADD:
+    zero(graph, t, seq, {dnai});
+    break;
+  case Operation::MUL:
+    if (type == INT) {
+      fill(graph, t, seq, 1, {dnai});
+    } else if (type == UNSIGNED_INT) {
+      fill(graph, t, seq, 1u, {dnai});
+    } else {
+      fill(graph, t, seq, 1.0f, {dnai});
+    }
+    break;
+  case Operation::MIN:
+    if (type == INT) {
+      fill(graph, t, seq, std::numeric_limits<int>::max(), {dnai});
+    } else if (type == UNSIGNED_INT) {
+      fill(graph, t, seq, std::numeric_limits<unsigned>::max(), {dnai});
+    } else {
+      fill(graph, t, seq, std::numeric_limits<float>::infinity(), {dnai});
+    }
+    break;
+  case Operation::MAX:
+    if (type == INT) {
+      fill(graph, t, seq, std::numeric_limits<int>::lowest(), {dnai});
+    } else if (type == UNSIGNED_INT) {
+      fill(graph, t, seq, 0u, {dnai});
+    } else {
+      fill(graph, t, seq, -std::numeric_limits<float>::infinity(), {dnai});
+    }
+    break;
+  default:
+    throw poputil::poplibs_error("Unsupported multi-update operation");
+  }
+}
 
-  // When a two-stage update is perform we use 32bit partials
-  const auto twoStagePartialType = FLOAT;
+// Planned multi-update combining the slices into the base with \a op. For ADD
+// the slices are scaled by \a scale, which must be given.
+static void generatePlannedMultiUpdateOp(
+    const std::string &vertexNameUntemplated, Operation op,
+    const SlicePlanInternal &plan, Graph &graph, Sequence &seq,
+    const Tensor &offsets, Tensor base, Tensor slices,
+    const boost::optional<Tensor> &scale, unsigned baseSlicedDim,
+    const OptionFlags &options, const DebugNameAndId &dnai) {
+  assert(op != Operation::ADD || scale);
+
+  // When a two-stage update is perform we use 32bit partials. MIN and MAX are
+  // exact in the base type, and integer partials stay in the base type so
+  // that products and sums are not rounded to a float mantissa.
+  const auto baseType = base.elementType();
+  const auto twoStagePartialType =
+      op == Operation::MIN || op == Operation::MAX || baseType == INT ||
+              baseType == UNSIGNED_INT
+          ? baseType
+          : FLOAT;
 
   const auto csU = graph.addComputeSet({dnai, "Update"});
 
@@ -682,7 +765,8 @@ static void generatePlannedMultiUpdateAdd(
   Tensor slicesInput, stage0Output;
   // Scaling is applied in the update when there's a single stage, but in a
   // later add when there is an lookupSplit
-  Tensor stage0Scale, stage1Scale;
+  boost::optional<Tensor> stage0Scale;
+  Tensor stage1Scale;
   if (!multipleStages) {
     slicesInput = slices;
     stage0Output = base.expand({0}); // insert lookupSplit dimension
@@ -693,10 +777,12 @@ static void generatePlannedMultiUpdateAdd(
     // with temporary input and accumulation buffers if the base/slice tensors
     // have type half.
     stage0OutputType = twoStagePartialType;
-    stage0Scale = graph.addConstant(stage0OutputType, {}, 1., {dnai, "one"});
-    graph.setTileMapping(stage0Scale, 0);
-    stage1Scale =
-        cast(graph, scale, stage0OutputType, seq, {dnai, "CastScale"});
+    if (scale) {
+      stage0Scale = graph.addConstant(stage0OutputType, {}, 1., {dnai, "one"});
+      graph.setTileMapping(*stage0Scale, 0);
+      stage1Scale =
+          cast(graph, *scale, stage0OutputType, seq, {dnai, "CastScale"});
+    }
 
     // lookupSplit copies of the base tensor
     auto wantedShape = base.shape();
@@ -715,9 +801,9 @@ static void generatePlannedMultiUpdateAdd(
         {nonEmptyLookupSplits, p.slicedDimSplit, p.unslicedDimSplit},
         {dnai, "gathered"});
 
-    // stage0Output is zeroed before stage0 executes; the zero program
-    // is added after we've added the stage0 vertices and mapped the output
-    // but is sequenced before `csU`.
+    // stage0Output is filled with the identity of `op` before stage0
+    // executes; the fill program is added after we've added the stage0
+    // vertices and mapped the output but is sequenced before `csU`.
   }
 
   for (unsigned lookupSplitIdx = 0; lookupSplitIdx != nonEmptyLookupSplits;
@@ -770,10 +856,13 @@ static void generatePlannedMultiUpdateAdd(
           multiUpdateSubwordTiles.emplace_back(tile);
         }
 
-        const auto vertexName = templateVertex(
-            vertexNameUntemplated, stage0OutputType, needSubwordWrites);
+        const auto vertexName =
+            op == Operation::ADD
+                ? templateVertex(vertexNameUntemplated, stage0OutputType,
+                                 needSubwordWrites)
+                : templateVertex(vertexNameUntemplated, stage0OutputType, op);
 
-        logging::popops::trace("generatePlannedMultiUpdateAdd: "
+        logging::popops::trace("generatePlannedMultiUpdateOp: "
                                "Offsets {}/{} ({}); "
                                "BaseIdx {}/{} ({}), "
                                "SubIdx {}/{} ({}) "
@@ -820,11 +909,11 @@ static void generatePlannedMultiUpdateAdd(
 
   if (multipleStages) {
     // Reduce dense partials
-    zero(graph, stage0Output, seq);
+    fillWithIdentity(graph, stage0Output, op, seq, {dnai, "initPartials"});
     seq.add(Execute(csU, {dnai}));
 
     const auto cumulativeUpdate =
-        graph.clone(twoStagePartialType, base, {dnai, "sumUpdates"});
+        graph.clone(twoStagePartialType, base, {dnai, "reducedUpdates"});
 
     // Given we know that partials for a set of columns on each tile are always
     // contiguous in the same way, we can use our knowledge to reorder the
@@ -843,10 +932,10 @@ static void generatePlannedMultiUpdateAdd(
         });
 
     reduceWithOutput(graph, concat(stage0OutputReordered, 1u),
-                     concat(cumulativeUpdateReordered), {0}, {Operation::ADD},
-                     seq, {dnai, "Reduce"});
+                     concat(cumulativeUpdateReordered), {0}, {op}, seq,
+                     {dnai, "Reduce"});
 
-    // Add the sum of the partials to the base tensor
+    // Combine the reduced partials with the base tensor
     bool baseCastRequired = base.elementType() != twoStagePartialType;
     const Tensor addDst = [&] {
       if (baseCastRequired) {
@@ -855,8 +944,23 @@ static void generatePlannedMultiUpdateAdd(
         return base;
       }
     }();
-    scaledAddTo(graph, addDst, cumulativeUpdate, stage1Scale, seq,
-                {dnai, "Add"});
+    switch (op) {
+    case Operation::ADD:
+      scaledAddTo(graph, addDst, cumulativeUpdate, stage1Scale, seq,
+                  {dnai, "Add"});
+      break;
+    case Operation::MUL:
+      mulInPlace(graph, addDst, cumulativeUpdate, seq, {dnai, "Mul"});
+      break;
+    case Operation::MIN:
+      minInPlace(graph, addDst, cumulativeUpdate, seq, {dnai, "Min"});
+      break;
+    case Operation::MAX:
+      maxInPlace(graph, addDst, cumulativeUpdate, seq, {dnai, "Max"});
+      break;
+    default:
+      POPLIB_UNREACHABLE();
+    }
 
     // cast the final result back into base; when !castBase the addTo was
     // directly into base anyway
@@ -2018,9 +2122,9 @@ Tensor multiSlice(Graph &graph, const Tensor &t, const Tensor &offset,
   // For now only 1d slices of 2d base tensors are supported.
   if (t.rank() == 2 && dims.size() == 1 && sMulti.rank() == 3 &&
       offset.rank() == 2 && offset.dim(1) == 1 && offset.dim(0) > 6) {
-    generateMultiSliceVertices("popops::MultiSlice", false, false, graph, prog,
-                               offset, t, sMulti, boost::none, dims[0],
-                               boost::none, options, {di, dName});
+    generateMultiSliceVertices("popops::MultiSlice", false, false, boost::none,
+                               graph, prog, offset, t, sMulti, boost::none,
+                               dims[0], boost::none, options, {di, dName});
     di.addOutput(sMulti);
     return sMulti;
   }
@@ -2093,9 +2197,9 @@ void multiUpdate(Graph &graph, const Tensor &t, const Tensor &sMulti,
   // For now only 1d slices of 2d base tensors are supported.
   if (t.rank() == 2 && dims.size() == 1 && sMulti.rank() == 3 &&
       offset.rank() == 2 && offset.dim(1) == 1 && offset.dim(0) > 6) {
-    generateMultiSliceVertices("popops::MultiUpdate", true, false, graph, prog,
-                               offset, t, sMulti, boost::none, dims[0],
-                               boost::none, options, dName);
+    generateMultiSliceVertices("popops::MultiUpdate", true, false, boost::none,
+                               graph, prog, offset, t, sMulti, boost::none,
+                               dims[0], boost::none, options, dName);
     return;
   }
   // looping case
@@ -2115,6 +2219,74 @@ void multiUpdate(Graph &graph, const Tensor &t, const Tensor &sMulti,
       }));
 }
 
+// Sort the updates by index and sum each run of updates to the same index
+// into the last update of the run. The indices of the other updates in the run
+// are replaced with an out-of-range index which the update vertices skip, so
+// each row of the base tensor is read, modified and written at most once.
+// Returns the new offsets and slices.
+static std::pair<Tensor, Tensor>
+coalesceDuplicateUpdates(Graph &graph, const Tensor &offsets,
+                         const Tensor &slices, std::size_t numBaseIndices,
+                         Sequence &prog, const DebugNameAndId &dnai) {
+  namespace pe = popops::expr;
+  const auto numUpdates = offsets.dim(0);
+  const auto updateSize = slices[0].numElements();
+  const auto type = slices.elementType();
+
+  // The sort vertices only take signed keys and values; the indices are
+  // always small enough to be reinterpreted.
+  const auto offsets1d = offsets.squeeze({1});
+  auto keys = graph.clone(INT, offsets1d, {dnai, "sortedOffsets"});
+  prog.add(Copy(offsets1d.reinterpret(INT), keys, false, {dnai}));
+  auto permutation = graph.clone(keys, {dnai, "permutation"});
+  iota(graph, permutation, 0, prog, {dnai});
+  sortKeyValueInPlace(graph, keys, permutation, 0, prog, {dnai, "sort"});
+
+  // Gather the updates in index order. Half updates are summed in single
+  // precision as the update vertices do.
+  auto sums = multiSlice(graph, slices.reshape({numUpdates, updateSize}),
+                         permutation.reinterpret(UNSIGNED_INT).expand({1}),
+                         {0}, {1}, prog, SlicePlan(), {}, {dnai, "gather"})
+                  .reshape({numUpdates, updateSize});
+  if (type == HALF) {
+    sums = cast(graph, sums, FLOAT, prog, {dnai, "castUpdates"});
+  }
+
+  // Segmented inclusive scan: after the pass with a given shift each update
+  // holds the sum of up to 2 * shift updates to the same index ending at it.
+  // Because the keys are sorted, equal keys `shift` apart mean every update
+  // between them is to the same index.
+  for (std::size_t shift = 1; shift < numUpdates; shift *= 2) {
+    const auto n = numUpdates - shift;
+    const auto sameIndex =
+        eq(graph, keys.slice(shift, numUpdates), keys.slice(0, n), prog,
+           {dnai, "sameIndex"});
+    const auto partials =
+        map(graph, pe::Select(pe::Add(pe::_1, pe::_2), pe::_1, pe::_3),
+            {sums.slice(shift, numUpdates), sums.slice(0, n),
+             sameIndex.expand({1}).broadcast(updateSize, 1)},
+            prog, {dnai, "segmentSum"});
+    sums = concat(sums.slice(0, shift), partials);
+  }
+
+  // Only the last update of each run is applied.
+  const auto outOfRange = static_cast<int>(numBaseIndices);
+  const auto lastOffsets =
+      map(graph,
+          pe::Select(pe::Const(outOfRange), pe::_1,
+                     pe::Equal(pe::_1, pe::_2)),
+          {keys.slice(0, numUpdates - 1), keys.slice(1, numUpdates)}, prog,
+          {dnai, "lastOfRun"});
+  const auto newOffsets =
+      concat(lastOffsets, keys.slice(numUpdates - 1, numUpdates))
+          .reinterpret(UNSIGNED_INT)
+          .expand({1});
+  if (type == HALF) {
+    sums = cast(graph, sums, HALF, prog, {dnai, "castSums"});
+  }
+  return {newOffsets, sums.reshape(slices.shape())};
+}
+
 // This is derived from multiUpdate, but s is added to t rather than replacing
 // it
 // Currently only a single dimension may be sliced
@@ -2156,14 +2328,84 @@ void multiUpdateAdd(Graph &graph, const Tensor &t, const Tensor &sMulti,
         "multiUpdateAdd expects t, sMulti and scale to have the same type");
   if (scale.rank() != 0)
     throw poputil::poplibs_error("multiUpdateAdd scale must be a scaler");
+
+  // Without a plan there is nothing to cost the coalescing against so it is
+  // only done when asked for explicitly.
+  const bool coalesce =
+      offset.dim(0) > 1 &&
+      (plan.getImpl().isNull ? parseSliceOptions(options).coalesceDuplicates ==
+                                   CoalesceDuplicates::ALWAYS
+                             : plan.getImpl().coalesceDuplicates);
+  Tensor updateOffsets = offset, updateSlices = sMulti;
+  if (coalesce) {
+    std::tie(updateOffsets, updateSlices) = coalesceDuplicateUpdates(
+        graph, offset, sMulti, t.dim(dims[0]), prog, {di, dName + "/coalesce"});
+  }
   if (plan.getImpl().isNull) {
-    generateMultiSliceVertices("popops::MultiUpdateAdd", true, true, graph,
-                               prog, offset, t, sMulti, scale, dims[0],
+    generateMultiSliceVertices("popops::MultiUpdateAdd", true, true,
+                               boost::none, graph, prog, updateOffsets, t,
+                               updateSlices, scale, dims[0], boost::none,
+                               options, {di, dName});
+  } else {
+    generatePlannedMultiUpdateOp("popops::MultiUpdateAdd", Operation::ADD,
+                                 plan.getImpl(), graph, prog, updateOffsets, t,
+                                 updateSlices, scale, dims[0], options,
+                                 {di, dName});
+  }
+}
+
+void multiUpdateOp(Graph &graph, const Tensor &t, const Tensor &sMulti,
+                   const Tensor &offset, const std::vector<std::size_t> &dims,
+                   const std::vector<std::size_t> &sizes, Sequence &prog,
+                   const SlicePlan &plan, Operation op,
+                   const OptionFlags &options,
+                   const poplar::DebugContext &debugContext) {
+  poputil::PoplibsOpDebugInfo di(
+      debugContext, DI_ARGS(t, sMulti, offset, dims, sizes, plan, op, options));
+
+  logging::popops::info("multiUpdateOp {} {} into {}, name={}, nullplan={}",
+                        op, sMulti.shape(), t.shape(),
+                        debugContext.getPathName(), plan.getImpl().isNull);
+  const std::string dName = "multiUpdateOp";
+  if (op == Operation::ADD) {
+    const auto one = graph.addConstant(t.elementType(), {}, 1, {di, "one"});
+    graph.setTileMapping(one, 0);
+    multiUpdateAdd(graph, t, sMulti, offset, one, dims, sizes, prog, plan,
+                   options, {di});
+    return;
+  }
+  if (op != Operation::MUL && op != Operation::MIN && op != Operation::MAX) {
+    std::stringstream ss;
+    ss << "multiUpdateOp does not support operation " << op;
+    throw poputil::poplibs_error(ss.str());
+  }
+  if (offset.rank() != 2)
+    throw poputil::poplibs_error(
+        "multiUpdateOp expects offset.rank() == 2 but it is" +
+        std::to_string(offset.rank()));
+  if (offset.dim(1) != dims.size())
+    throw poputil::poplibs_error(
+        "multiUpdateOp expects offset.dim(1) == dims.size(); offset.dim(1)==" +
+        std::to_string(offset.dim(1)) +
+        ", dims.size()== " + std::to_string(dims.size()));
+  validateParams("multiUpdateOp", plan, options, t.shape(), offset[0], dims,
+                 sizes);
+  if (t.rank() != 2 || dims.size() != 1 || offset.dim(1) != 1)
+    throw poputil::poplibs_error(
+        "multiUpdateOp requires t to have 2 dimensions and dims to specify "
+        "1 dimension");
+  if (t.elementType() != sMulti.elementType())
+    throw poputil::poplibs_error(
+        "multiUpdateOp expects t and sMulti to have the same type");
+
+  if (plan.getImpl().isNull) {
+    generateMultiSliceVertices("popops::MultiUpdateOp", true, false, op, graph,
+                               prog, offset, t, sMulti, boost::none, dims[0],
                                boost::none, options, {di, dName});
   } else {
-    generatePlannedMultiUpdateAdd("popops::MultiUpdateAdd", plan.getImpl(),
-                                  graph, prog, offset, t, sMulti, scale,
-                                  dims[0], options, {di, dName});
+    generatePlannedMultiUpdateOp("popops::MultiUpdateOp", op, plan.getImpl(),
+                                 graph, prog, offset, t, sMulti, boost::none,
+                                 dims[0], options, {di, dName});
   }
 }
 
@@ -2187,6 +2429,64 @@ static void applyPlanConstraints(popsolver::Model &m,
   constrainVar("lookupSplit", mLookupSplit);
 }
 
+// Rough estimate of the cycles for a planned multiUpdateAdd of `numIndices`
+// updates when `uniqueProportion` of them are to distinct indices, with and
+// without first coalescing the duplicates. The update vertices spend a fixed
+// number of cycles on each index they see and only do the per-element work
+// for indices they apply, so coalescing saves the per-element work of the
+// duplicates at the cost of a sort of the indices, a gather of the updates
+// and log2(numIndices) dense passes over them.
+static bool coalescingIsCheaper(const Target &target, const Type &dataType,
+                                std::size_t numIndices,
+                                std::size_t outputSize,
+                                const sliceInternal::Partition &partition,
+                                double uniqueProportion) {
+  if (numIndices < 2) {
+    return false;
+  }
+  constexpr double cyclesPerIndex = 10;
+  constexpr double cyclesPerSkippedIndex = 4;
+  const double numTiles = target.getNumTiles();
+  const double numWorkers = target.getNumWorkerContexts();
+  const double exchangeBytesPerCycle = target.getExchangeBytesPerCycle();
+  const double vectorWidth = target.getVectorWidth(dataType);
+  const double floatVectorWidth = target.getVectorWidth(FLOAT);
+
+  const double elemsPerTile = ceildiv(outputSize, partition.unslicedDimSplit);
+  const double lookupsPerTile = ceildiv(numIndices, partition.lookupSplit);
+  const auto updateCycles = [&](double applied) {
+    return lookupsPerTile *
+           (applied * (cyclesPerIndex + elemsPerTile / vectorWidth) +
+            (1 - applied) * cyclesPerSkippedIndex);
+  };
+
+  // The coalescing is spread over all tiles.
+  const double totalElems = double(numIndices) * outputSize;
+  const double elemsPerTileAllTiles = std::ceil(totalElems / numTiles);
+  const double indicesPerTile = std::max<double>(
+      minIndicesPerTile, std::ceil(double(numIndices) / numTiles));
+  const double indexTiles = std::ceil(numIndices / indicesPerTile);
+  // Odd/even exchange between tiles repeats the sort on each tile.
+  const double sortCycles = indexTiles * indicesPerTile *
+                            std::log2(indicesPerTile + 1) * cyclesPerIndex;
+  const double gatherCycles = elemsPerTileAllTiles *
+                              target.getTypeSize(dataType) /
+                              exchangeBytesPerCycle;
+  const double scanPassCycles =
+      elemsPerTileAllTiles / (numWorkers * floatVectorWidth) +
+      elemsPerTileAllTiles * target.getTypeSize(FLOAT) / exchangeBytesPerCycle;
+  const double scanCycles = std::ceil(std::log2(numIndices)) * scanPassCycles;
+
+  const double plainCycles = updateCycles(1.0);
+  const double coalescedCycles =
+      updateCycles(uniqueProportion) + sortCycles + gatherCycles + scanCycles;
+  logging::popops::debug("multiUpdateAdd estimates: plain {} cycles, "
+                         "coalesced {} cycles (sort {}, gather {}, scan {})",
+                         plainCycles, coalescedCycles, sortCycles,
+                         gatherCycles, scanCycles);
+  return coalescedCycles < plainCycles;
+}
+
 // Plan an embedding layer for slicing/updating.
 // This planner aims to minimise the persistent tile memory while keeping
 // temporary memory below a bound.
@@ -2451,6 +2751,21 @@ SlicePlan plan(const Graph &graph, const Type &dataType,
   p.slicedDims = {0};
   p.slicedDimSizes = {1};
   p.isNull = false;
+  if (options.usedForUpdate) {
+    switch (options.coalesceDuplicates) {
+    case CoalesceDuplicates::NEVER:
+      p.coalesceDuplicates = false;
+      break;
+    case CoalesceDuplicates::ALWAYS:
+      p.coalesceDuplicates = true;
+      break;
+    case CoalesceDuplicates::AUTO:
+      p.coalesceDuplicates = coalescingIsCheaper(
+          target, dataType, plannedNumIndices, outputSize, p.partition,
+          options.expectedUniqueLookupProportion);
+      break;
+    }
+  }
 
   logging::popops::debug("Embedding {}", p);
   logging::popops::debug("UsedTiles {}", s[mUsedTiles]);
@@ -30,6 +30,8 @@ public:
 public:
   bool isNull;
   sliceInternal::Partition partition;
+  // Sum updates to the same index before a multiUpdateAdd.
+  bool coalesceDuplicates = false;
 
   // For validation, to identify the restrictions on what this
   // plan can be used to implement,
@@ -0,0 +1,279 @@
+// Copyright (c) 2020 Graphcore Ltd. All rights reserved.
+#include "popops/ElementWiseBuilder.hpp"
+
+#include "poplibs_support/logging.hpp"
+#include "popops/ElementWise.hpp"
+#include "poputil/DebugInfo.hpp"
+#include "poputil/exceptions.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <numeric>
+#include <set>
+
+using namespace poplar;
+using namespace poplar::program;
+using namespace poplibs_support;
+
+namespace popops {
+
+namespace {
+
+// Call f with the value (placeholder index - 1) read by each placeholder of
+// an expression.
+template <typename F> void forEachRead(const expr::Expr &e, const F &f) {
+  if (e.isA<expr::Const>()) {
+    return;
+  } else if (const expr::PlaceHolder *p = e.getAs<expr::PlaceHolder>()) {
+    f(p->getIndex() - 1);
+  } else if (const expr::Cast *c = e.getAs<expr::Cast>()) {
+    forEachRead(c->getLHS(), f);
+  } else if (const expr::UnaryOp *u = e.getAs<expr::UnaryOp>()) {
+    forEachRead(u->getArg(), f);
+  } else if (const expr::BinaryOp *b = e.getAs<expr::BinaryOp>()) {
+    forEachRead(b->getLHS(), f);
+    forEachRead(b->getRHS(), f);
+  } else if (const expr::TernaryOp *t = e.getAs<expr::TernaryOp>()) {
+    forEachRead(t->getArg0(), f);
+    forEachRead(t->getArg1(), f);
+    forEachRead(t->getArg2(), f);
+  } else {
+    throw poputil::poplibs_error("Unsupported expression");
+  }
+}
+
+// Clone an expression, replacing each placeholder with the expression
+// returned by the given function.
+template <typename F>
+std::unique_ptr<expr::Expr> substitute(const expr::Expr &e, const F &f) {
+  if (const expr::PlaceHolder *p = e.getAs<expr::PlaceHolder>()) {
+    return f(*p);
+  } else if (const expr::Cast *c = e.getAs<expr::Cast>()) {
+    return std::unique_ptr<expr::Expr>(
+        new expr::Cast(*substitute(c->getLHS(), f), c->getRHSType()));
+  } else if (const expr::UnaryOp *u = e.getAs<expr::UnaryOp>()) {
+    return std::unique_ptr<expr::Expr>(
+        new expr::UnaryOp(u->getOpType(), *substitute(u->getArg(), f)));
+  } else if (const expr::BinaryOp *b = e.getAs<expr::BinaryOp>()) {
+    return std::unique_ptr<expr::Expr>(
+        new expr::BinaryOp(b->getOpType(), *substitute(b->getLHS(), f),
+                           *substitute(b->getRHS(), f)));
+  } else if (const expr::TernaryOp *t = e.getAs<expr::TernaryOp>()) {
+    return std::unique_ptr<expr::Expr>(new expr::TernaryOp(
+        t->getOpType(), *substitute(t->getArg0(), f),
+        *substitute(t->getArg1(), f), *substitute(t->getArg2(), f)));
+  }
+  return e.clone();
+}
+
+std::unique_ptr<expr::Expr> placeHolder(unsigned index) {
+  return std::unique_ptr<expr::Expr>(new expr::PlaceHolder(index));
+}
+
+} // end anonymous namespace
+
+ElementWiseBuilder::ElementWiseBuilder(Graph &graph,
+                                       const DebugContext &debugContext,
+                                       OptionFlags options_)
+    : graph(graph), options(std::move(options_)) {
+  poputil::PoplibsOpDebugInfo di(debugContext, DI_ARGS(options));
+  dnai = DebugNameAndId(di);
+}
+
+ElementWiseBuilder::~ElementWiseBuilder() {
+  if (numPending()) {
+    logging::popops::warn("ElementWiseBuilder destroyed with {} pending "
+                          "writes that were never flushed",
+                          numPending());
+  }
+}
+
+ElementWiseBuilder::TensorId
+ElementWiseBuilder::addTensor(const poplar::Tensor &t) {
+  if (!tensors.empty() && t.shape() != tensors.front().shape()) {
+    throw poputil::poplibs_error(
+        "ElementWiseBuilder: all tensors must have the same shape");
+  }
+  tensors.push_back(t);
+  current.push_back(values.size());
+  values.emplace_back();
+  valueOf.push_back(tensors.size() - 1);
+  return tensors.size() - 1;
+}
+
+ElementWiseBuilder::TensorId
+ElementWiseBuilder::addOutput(const Type &type, TensorId like,
+                              const DebugContext &debugContext) {
+  poputil::PoplibsOpDebugInfo di(debugContext, DI_ARGS(type, like));
+  auto t = graph.clone(type, getTensor(like), {di, "output"});
+  return addTensor(t);
+}
+
+const poplar::Tensor &ElementWiseBuilder::getTensor(TensorId id) const {
+  if (id >= tensors.size()) {
+    throw poputil::poplibs_error("ElementWiseBuilder: invalid tensor id");
+  }
+  return tensors[id];
+}
+
+expr::Any ElementWiseBuilder::get(TensorId id) const {
+  getTensor(id);
+  return expr::PlaceHolder(current[id] + 1);
+}
+
+void ElementWiseBuilder::set(TensorId id, const expr::Expr &e) {
+  getTensor(id);
+  forEachRead(e, [&](std::size_t v) {
+    if (v >= values.size()) {
+      throw poputil::poplibs_error("ElementWiseBuilder: expression refers to "
+                                   "a placeholder not returned by get()");
+    }
+  });
+  current[id] = values.size();
+  values.push_back(e.clone());
+  valueOf.push_back(id);
+}
+
+std::size_t ElementWiseBuilder::numPending() const {
+  return std::count_if(current.begin(), current.end(),
+                       [&](std::size_t v) { return values[v] != nullptr; });
+}
+
+void ElementWiseBuilder::flush(Sequence &prog) {
+  // Count the reads of the values needed by the pending writes. A value only
+  // reads earlier values, so one pass from the last value finds them all.
+  const auto numValues = values.size();
+  std::vector<bool> needed(numValues, false);
+  std::vector<unsigned> numReads(numValues, 0);
+  for (const auto v : current) {
+    needed[v] = true;
+  }
+  for (std::size_t v = numValues; v-- != 0;) {
+    if (needed[v] && values[v]) {
+      forEachRead(*values[v], [&](std::size_t r) {
+        needed[r] = true;
+        ++numReads[r];
+      });
+    }
+  }
+
+  // The tensors read by the fused expressions: the registered tensors, which
+  // hold their original values until the writes below, followed by
+  // temporaries holding the values read by more than one expression. Every
+  // other value is inlined into the one expression which reads it, so the
+  // size of the expressions is linear in the length of the chain.
+  std::vector<Tensor> sources(tensors);
+  std::vector<std::size_t> sourceOf(valueOf);
+  std::vector<bool> isShared(numValues, false);
+  std::function<std::unique_ptr<expr::Expr>(std::size_t)> read;
+  const auto expand = [&](std::size_t v) {
+    return substitute(*values[v], [&](const expr::PlaceHolder &p) {
+      return read(p.getIndex() - 1);
+    });
+  };
+  read = [&](std::size_t v) {
+    if (!values[v] || isShared[v]) {
+      return placeHolder(sourceOf[v] + 1);
+    }
+    return expand(v);
+  };
+
+  // Write the value of an expression of the sources to target, updated in
+  // place when it is the source targetSource.
+  const auto noSource = std::numeric_limits<std::size_t>::max();
+  const auto write = [&](const expr::Expr &e, const Tensor &target,
+                         std::size_t targetSource, const std::string &name) {
+    if (const expr::PlaceHolder *p = e.getAs<expr::PlaceHolder>()) {
+      if (p->getIndex() - 1 != targetSource) {
+        prog.add(Copy(sources[p->getIndex() - 1], target, false, {dnai}));
+      }
+      return;
+    }
+    // the written tensor must be the first placeholder of mapInPlace, the
+    // remaining reads follow in source order.
+    std::vector<Tensor> ts = {target};
+    std::vector<unsigned> placeHolderOf(sources.size(), 0);
+    if (targetSource != noSource) {
+      placeHolderOf[targetSource] = 1;
+    }
+    std::set<std::size_t> reads;
+    forEachRead(e, [&](std::size_t r) { reads.insert(r); });
+    for (const auto r : reads) {
+      if (!placeHolderOf[r]) {
+        ts.push_back(sources[r]);
+        placeHolderOf[r] = ts.size();
+      }
+    }
+    auto mapped = substitute(e, [&](const expr::PlaceHolder &p) {
+      return placeHolder(placeHolderOf[p.getIndex() - 1]);
+    });
+    mapInPlace(graph, *mapped, ts, prog, {dnai, name}, options);
+  };
+
+  std::size_t numShared = 0;
+  for (std::size_t v = 0; v != numValues; ++v) {
+    if (needed[v] && values[v] && numReads[v] > 1) {
+      auto temp = graph.clone(tensors[valueOf[v]], {dnai, "fusedShared"});
+      write(*expand(v), temp, noSource, "fusedShared" + std::to_string(v));
+      sourceOf[v] = sources.size();
+      sources.push_back(temp);
+      isShared[v] = true;
+      ++numShared;
+    }
+  }
+
+  std::vector<std::unique_ptr<expr::Expr>> writes(tensors.size());
+  std::vector<std::set<std::size_t>> reads(tensors.size());
+  std::set<std::size_t> remaining;
+  for (std::size_t i = 0; i != tensors.size(); ++i) {
+    if (values[current[i]]) {
+      writes[i] = read(current[i]);
+      forEachRead(*writes[i], [&](std::size_t r) {
+        if (r < tensors.size()) {
+          reads[i].insert(r);
+        }
+      });
+      remaining.insert(i);
+    }
+  }
+  logging::popops::debug("ElementWiseBuilder: flushing {} fused writes and "
+                         "{} shared values",
+                         remaining.size(), numShared);
+
+  const auto readByOther = [&](std::size_t i) {
+    return std::any_of(remaining.begin(), remaining.end(), [&](std::size_t j) {
+      return j != i && reads[j].count(i);
+    });
+  };
+
+  // Tensors written through a temporary to break a cycle of reads, copied
+  // into place once all other writes are done.
+  std::vector<std::pair<Tensor, Tensor>> deferredCopies;
+  while (!remaining.empty()) {
+    auto it = std::find_if(remaining.begin(), remaining.end(),
+                           [&](std::size_t i) { return !readByOther(i); });
+    const bool inPlace = it != remaining.end();
+    const auto i = inPlace ? *it : *remaining.begin();
+
+    auto target = inPlace ? tensors[i]
+                          : graph.clone(tensors[i], {dnai, "fusedTemp"});
+    write(*writes[i], target, inPlace ? i : noSource,
+          "fused" + std::to_string(i));
+    if (!inPlace) {
+      deferredCopies.emplace_back(target, tensors[i]);
+    }
+    remaining.erase(i);
+  }
+
+  for (const auto &copy : deferredCopies) {
+    prog.add(Copy(copy.first, copy.second, false, {dnai}));
+  }
+  values.clear();
+  values.resize(tensors.size());
+  valueOf.resize(tensors.size());
+  std::iota(valueOf.begin(), valueOf.end(), 0);
+  current = valueOf;
+}
+
+} // namespace popops
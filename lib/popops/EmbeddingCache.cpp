@@ -0,0 +1,259 @@
+// Copyright (c) 2020 Graphcore Ltd. All rights reserved.
+#include "popops/EmbeddingCache.hpp"
+
+#include "poplibs_support/logging.hpp"
+#include "popops/DynamicSlice.hpp"
+#include "popops/ElementWise.hpp"
+#include "popops/Encoding.hpp"
+#include "popops/Fill.hpp"
+#include "popops/HostSliceTensor.hpp"
+#include "popops/Reduce.hpp"
+#include "popops/Sort.hpp"
+#include "popops/Zero.hpp"
+#include "poputil/DebugInfo.hpp"
+#include "poputil/OptionParsing.hpp"
+#include "poputil/exceptions.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+#include <string>
+
+using namespace poplar;
+using namespace poplar::program;
+
+namespace logging = poplibs_support::logging;
+namespace pe = popops::expr;
+
+namespace popops {
+
+namespace {
+
+struct EmbeddingCacheOptions {
+  unsigned associativity = 1;
+  // 0 means one fetch of every lookup
+  unsigned maxMissesPerFetch = 0;
+  std::string handle = "embeddingCacheTable";
+};
+
+EmbeddingCacheOptions parseOptions(const OptionFlags &optionFlags) {
+  EmbeddingCacheOptions options;
+
+  using poplibs::OptionHandler;
+  using poplibs::OptionSpec;
+
+  /*
+   * Any changes to spec must be reflected in the documentation comment in
+   * the header.
+   */
+  const OptionSpec spec{
+      {"associativity",
+       OptionHandler::createWithInteger(options.associativity)},
+      {"maxMissesPerFetch",
+       OptionHandler::createWithInteger(options.maxMissesPerFetch)},
+      {"handle", OptionHandler::createWithString(options.handle)}};
+
+  for (const auto &entry : optionFlags) {
+    spec.parse(entry.first, entry.second);
+  }
+  return options;
+}
+
+} // end anonymous namespace
+
+EmbeddingCache::EmbeddingCache(Graph &graph, const Type &type,
+                               std::size_t numEntries,
+                               std::size_t embeddingSize, std::size_t numLines,
+                               std::size_t numLookups,
+                               const OptionFlags &optionFlags,
+                               const DebugContext &debugContext)
+    : graph(graph), type(type), numEntries(numEntries),
+      embeddingSize(embeddingSize), numLookups(numLookups) {
+  poputil::PoplibsOpDebugInfo di(
+      debugContext, DI_ARGS(type, numEntries, embeddingSize, numLines,
+                            numLookups, optionFlags));
+  dnai = DebugNameAndId(di);
+  const auto options = parseOptions(optionFlags);
+  associativity = options.associativity;
+  maxMissesPerFetch = options.maxMissesPerFetch == 0
+                          ? numLookups
+                          : options.maxMissesPerFetch;
+
+  if (numEntries == 0 || embeddingSize == 0 || numLookups == 0) {
+    throw poputil::poplibs_error(
+        "EmbeddingCache: the table and lookups must not be empty");
+  }
+  if (associativity == 0 || numLines % associativity != 0 || numLines == 0) {
+    throw poputil::poplibs_error(
+        "EmbeddingCache: the number of lines (" + std::to_string(numLines) +
+        ") must be a non-zero multiple of the associativity (" +
+        std::to_string(associativity) + ")");
+  }
+  if (maxMissesPerFetch > numLookups) {
+    throw poputil::poplibs_error(
+        "EmbeddingCache: maxMissesPerFetch (" +
+        std::to_string(maxMissesPerFetch) +
+        ") must not be greater than the number of lookups (" +
+        std::to_string(numLookups) + ")");
+  }
+  if (numEntries > std::numeric_limits<int>::max()) {
+    throw poputil::poplibs_error(
+        "EmbeddingCache: the table has too many rows to be indexed");
+  }
+  numSets = numLines / associativity;
+
+  logging::popops::debug("EmbeddingCache {}: {} rows of {}, {} sets of {} "
+                         "lines, {} lookups, {} misses per fetch",
+                         dnai.getPathName(), numEntries, embeddingSize,
+                         numSets, associativity, numLookups,
+                         maxMissesPerFetch);
+
+  table = graph.addRemoteBuffer(options.handle, type, embeddingSize,
+                                numEntries);
+  lines = createSliceableTensor(graph, type, {numLines, embeddingSize}, {0},
+                                {1}, 0, {dnai, "lines"});
+  tags = createSliceableTensor(graph, INT, {numLines, 1}, {0}, {1}, 0,
+                               {dnai, "tags"});
+  hits = graph.addVariable(INT, {}, {dnai, "hits"});
+  graph.setTileMapping(hits, 0);
+  misses = graph.addVariable(INT, {}, {dnai, "misses"});
+  graph.setTileMapping(misses, 0);
+}
+
+void EmbeddingCache::initialise(Sequence &prog) {
+  fill(graph, tags, prog, -1, {dnai, "invalidate"});
+  zero(graph, concat(hits.expand({0}), misses.expand({0})), prog,
+       {dnai, "zeroCounters"});
+}
+
+Tensor EmbeddingCache::lookup(const Tensor &indices, Sequence &prog,
+                              const DebugContext &debugContext) {
+  poputil::PoplibsOpDebugInfo di(debugContext, DI_ARGS(indices));
+
+  if (indices.rank() != 1 || indices.dim(0) != numLookups) {
+    throw poputil::poplibs_error(
+        "EmbeddingCache::lookup: indices must have shape {" +
+        std::to_string(numLookups) + "}");
+  }
+  if (indices.elementType() != UNSIGNED_INT) {
+    throw poputil::poplibs_error(
+        "EmbeddingCache::lookup: indices must be of type UNSIGNED_INT");
+  }
+  const auto n = numLookups;
+  const auto ways = static_cast<int>(associativity);
+  const auto sets = static_cast<int>(numSets);
+  const auto asOffsets = [](const Tensor &t) {
+    return t.reinterpret(UNSIGNED_INT).expand({1});
+  };
+
+  // The row indices are less than numEntries so may be used as signed
+  // integers, which the sort vertices require.
+  const auto idx = indices.reinterpret(INT);
+  const auto setIdx =
+      map(graph, pe::Rem(pe::_1, pe::Const(sets)), {idx}, prog, {di, "set"});
+
+  // The way of the set holding each row plus one, or zero on a miss. A row
+  // is held in at most one line so the sum over the ways is the matching way.
+  const auto setTags =
+      multiSlice(graph, tags.reshape({numSets, associativity}),
+                 asOffsets(setIdx), {0}, {1}, prog, SlicePlan(), {},
+                 {di, "setTags"})
+          .reshape({n, associativity});
+  std::vector<int> wayIds(associativity);
+  std::iota(wayIds.begin(), wayIds.end(), 1);
+  auto wayIdsT = graph.addConstant(INT, {1, associativity}, wayIds.data(),
+                                   {di, "wayIds"});
+  graph.setTileMapping(wayIdsT, 0);
+  const auto matchedWay = reduce(
+      graph,
+      map(graph, pe::Select(pe::_3, pe::Const(0), pe::Equal(pe::_1, pe::_2)),
+          {setTags, idx.expand({1}).broadcast(associativity, 1),
+           wayIdsT.broadcast(n, 0)},
+          prog, {di, "match"}),
+      INT, {1}, Operation::ADD, prog, {di, "matchedWay"});
+
+  // The line of each row: the matching line on a hit, otherwise the line it
+  // replaces. The replaced way is chosen from the higher bits of the index
+  // and the number of misses so far, which is the same for every lookup of
+  // the same row in this call so duplicates share a line.
+  const auto missesSoFar = misses.expand({0}).broadcast(n, 0);
+  const auto lineIdx = map(
+      graph,
+      pe::Add(pe::Mul(pe::_2, pe::Const(ways)),
+              pe::Select(pe::Sub(pe::_1, pe::Const(1)),
+                         pe::Rem(pe::Add(pe::Divide(pe::_3, pe::Const(sets)),
+                                         pe::_4),
+                                 pe::Const(ways)),
+                         pe::Gt(pe::_1, pe::Const(0)))),
+      {matchedWay, setIdx, idx, missesSoFar}, prog, {di, "line"});
+
+  // Read every lookup from the cache. The rows of misses are overwritten by
+  // the fetches below.
+  auto result = multiSlice(graph, lines, asOffsets(lineIdx), {0}, {1}, prog,
+                           SlicePlan(), {}, {di, "readLines"});
+
+  const auto isMiss = map(graph, pe::Cast(pe::Equal(pe::_1, pe::Const(0)), INT),
+                          {matchedWay}, prog, {di, "isMiss"});
+  const auto numMisses =
+      reduce(graph, isMiss, INT, {0}, Operation::ADD, prog, {di, "numMisses"});
+  mapInPlace(graph, pe::Add(pe::_1, pe::Sub(pe::Const(static_cast<int>(n)),
+                                            pe::_2)),
+             {hits, numMisses}, prog, {di, "countHits"});
+  mapInPlace(graph, pe::Add(pe::_1, pe::_2), {misses, numMisses}, prog,
+             {di, "countMisses"});
+
+  // Order the lookups so that the misses come first, keeping their relative
+  // order so that the last of any conflicting misses wins in both the lines
+  // and the tags.
+  auto positions = graph.clone(idx, {di, "positions"});
+  iota(graph, positions, 0, prog, {di});
+  auto keys = map(graph,
+                  pe::Add(pe::Mul(pe::Sub(pe::Const(1), pe::_1),
+                                  pe::Const(static_cast<int>(n))),
+                          pe::_2),
+                  {isMiss, positions}, prog, {di, "missesFirst"});
+  const auto order = sortKeyValue(graph, keys, positions, 0, prog, {di});
+  const auto rowsAndLines =
+      multiSlice(graph, concat(idx.expand({1}), lineIdx.expand({1}), 1),
+                 asOffsets(order), {0}, {1}, prog, SlicePlan(), {},
+                 {di, "gatherMisses"})
+          .reshape({n, 2});
+
+  // Fetch the misses in chunks of maxMissesPerFetch. The last chunk is moved
+  // back to end at the last lookup; refetching the overlapped lookups writes
+  // the same values again. Any hits in a chunk are refetched in the same way.
+  const auto m = maxMissesPerFetch;
+  auto fetchBuffer = createHostSliceableTensor(graph, type, {m, embeddingSize},
+                                               false, {di, "fetchBuffer"});
+  const auto numChunks = (n + m - 1) / m;
+  for (std::size_t c = 0; c < numChunks; ++c) {
+    const auto begin = std::min(c * m, n - m);
+    const auto chunkName = "fetch" + std::to_string(c);
+    Sequence fetch({}, {di, chunkName});
+    const auto chunkRows = rowsAndLines.slice(begin, begin + m);
+    fetch.add(Copy(chunkRows.slice(0, 1, 1).flatten().reinterpret(UNSIGNED_INT),
+                   fetchBuffer.indices, false, {di, chunkName}));
+    fetch.add(Copy(table, fetchBuffer.tensor, fetchBuffer.indices,
+                   {di, chunkName}));
+    const auto fetched = fetchBuffer.tensor.expand({1});
+    multiUpdate(graph, result, fetched,
+                asOffsets(order.slice(begin, begin + m)), {0}, {1}, fetch,
+                SlicePlan(), {}, {di, "return"});
+    const auto chunkLines = chunkRows.slice(1, 2, 1);
+    multiUpdate(graph, lines, fetched, asOffsets(chunkLines.flatten()), {0},
+                {1}, fetch, SlicePlan(), {}, {di, "install"});
+    multiUpdate(graph, tags, chunkRows.slice(0, 1, 1).expand({1}),
+                asOffsets(chunkLines.flatten()), {0}, {1}, fetch, SlicePlan(),
+                {}, {di, "setTags"});
+
+    const auto needed = gt(graph, numMisses, static_cast<int>(c * m), prog,
+                           {di, chunkName + "/needed"});
+    prog.add(If(needed, fetch, Sequence({}, {di}), {di, chunkName}));
+  }
+
+  auto output = result.reshape({n, embeddingSize});
+  di.addOutput(output);
+  return output;
+}
+
+} // namespace popops
@@ -8,8 +8,12 @@
 #include "poputil/OptionParsing.hpp"
 #include "poputil/Util.hpp"
 #include "poputil/VertexTemplates.hpp"
+#include "poputil/exceptions.hpp"
 #include <poputil/TileMapping.hpp>
 
+#include <limits>
+#include <map>
+
 using namespace poplar;
 using namespace poplar::program;
 using namespace poputil;
@@ -71,18 +75,19 @@ VertexType chooseVertexType(const std::vector<std::vector<Interval>> &intervals,
   return VertexType::WORKER_2D;
 }
 
-poplar::Tensor histogramImpl(poplar::Graph &graph, const poplar::Tensor &input,
-                             const poplar::Tensor &levels, bool absoluteOfInput,
-                             poplar::program::Sequence &prog,
-                             const DebugNameAndId &dnai) {
+// Add vertices to `cs` that count the elements of `input` in each histogram
+// entry, appending a partial histogram per vertex to `results`.
+void addHistogramVertices(poplar::Graph &graph, const ComputeSet &cs,
+                          const poplar::Tensor &input,
+                          const poplar::Tensor &levels, bool absoluteOfInput,
+                          std::vector<Tensor> &results,
+                          const DebugNameAndId &dnai) {
   const auto &target = graph.getTarget();
   const auto numTiles = target.getNumTiles();
   const auto inType = input.elementType();
   const auto vectorWidth = target.getVectorWidth(inType);
   const auto numWorkers = target.getNumWorkerContexts();
 
-  const auto cs = graph.addComputeSet({dnai, "Histogram"});
-
   // As work is split by "limits" not data size, the rpt count is a severe
   // limitation on the input size when rptMax is small.  So in that case the
   // vertex overcomes the limitation.  In other cases we must split work by
@@ -98,8 +103,6 @@ poplar::Tensor histogramImpl(poplar::Graph &graph, const poplar::Tensor &input,
       std::min<std::size_t>(graph.getMaxFieldDim(codeletName2D, "data", 1),
                             target.getRptCountMax() * vectorWidth);
 
-  // Gather a vector of results from each vertex created
-  std::vector<Tensor> results;
   const auto mapping = graph.getTileMapping(input);
   for (unsigned tile = 0; tile < numTiles; tile++) {
     const auto tileContiguousRegions =
@@ -152,9 +155,140 @@ poplar::Tensor histogramImpl(poplar::Graph &graph, const poplar::Tensor &input,
       }
     }
   }
+}
+
+// Add vertices to `cs` that count the elements of `input` by the binary
+// exponent of their absolute value, appending a partial histogram per vertex
+// to `results`.
+void addExponentHistogramVertices(poplar::Graph &graph, const ComputeSet &cs,
+                                  const poplar::Tensor &input,
+                                  int minExponent, unsigned numBins,
+                                  std::vector<Tensor> &results,
+                                  const DebugNameAndId &dnai) {
+  const auto &target = graph.getTarget();
+  const auto inType = input.elementType();
+  const auto vectorWidth = target.getVectorWidth(inType);
+  const auto codeletName =
+      templateVertex("popops::HistogramByExponent2D", inType);
+  const auto maxElemsPerRegion =
+      graph.getMaxFieldDim(codeletName, "data", 1);
+
+  const auto mapping = graph.getTileMapping(input);
+  for (unsigned tile = 0; tile < mapping.size(); tile++) {
+    const auto tileContiguousRegions =
+        graph.getSortedContiguousRegions(input, mapping[tile]);
+    auto vertexRegions = splitRegionsBetweenWorkers(
+        target, tileContiguousRegions, vectorWidth, 2 * vectorWidth,
+        UINT32_MAX, maxElemsPerRegion);
+    for (const auto &regions : vertexRegions) {
+      auto v = graph.addVertex(cs, codeletName);
+      graph.setTileMapping(v, tile);
+      results.push_back(graph.addVariable(FLOAT, {numBins}, {dnai}));
+      graph.setTileMapping(results.back(), tile);
+
+      graph.setInitialValue(v["histogramCount"], numBins);
+      graph.setInitialValue(v["minExponent"], minExponent);
+      graph.connect(v["histogram"], results.back());
+      graph.connect(v["data"], input.slices(regions));
+    }
+  }
+}
+
+poplar::Tensor stackPartials(poplar::Graph &graph,
+                             const std::vector<Tensor> &results,
+                             std::size_t histogramSize,
+                             const DebugNameAndId &dnai) {
+  if (results.empty()) {
+    // Every input was empty so every entry is zero
+    auto zeros = graph.addConstant(FLOAT, {1, histogramSize}, 0.0f, {dnai});
+    graph.setTileMapping(zeros, 0);
+    return zeros;
+  }
+  return concat(results).reshape({results.size(), histogramSize});
+}
+
+poplar::Tensor histogramImpl(poplar::Graph &graph, const poplar::Tensor &input,
+                             const poplar::Tensor &levels, bool absoluteOfInput,
+                             poplar::program::Sequence &prog,
+                             const DebugNameAndId &dnai) {
+  const auto cs = graph.addComputeSet({dnai, "Histogram"});
+  // Gather a vector of results from each vertex created
+  std::vector<Tensor> results;
+  addHistogramVertices(graph, cs, input, levels, absoluteOfInput, results,
+                       dnai);
+  prog.add(Execute(cs, {dnai}));
+  return stackPartials(graph, results, levels.numElements() + 1, dnai);
+}
+
+// Flatten and concatenate the inputs of each element type so that each type
+// is processed as one tensor.
+std::map<Type, Tensor> concatByType(const std::string &fnName,
+                                    const std::vector<Tensor> &inputs) {
+  std::map<Type, std::vector<Tensor>> byType;
+  for (const auto &input : inputs) {
+    const auto type = input.elementType();
+    if (type != FLOAT && type != HALF) {
+      throw poputil::poplibs_error(fnName + ": inputs must be of type " +
+                                   "float or half");
+    }
+    byType[type].push_back(input.flatten());
+  }
+  std::map<Type, Tensor> result;
+  for (const auto &entry : byType) {
+    result[entry.first] = concat(entry.second);
+  }
+  return result;
+}
+
+poplar::Tensor multiHistogramImpl(poplar::Graph &graph,
+                                  const std::vector<poplar::Tensor> &inputs,
+                                  const poplar::Tensor &levels,
+                                  bool absoluteOfInput,
+                                  poplar::program::Sequence &prog,
+                                  const DebugNameAndId &dnai) {
+  const auto groups = concatByType("histogram", inputs);
+  // The vertices compare against levels of the same type as the data.
+  std::map<Type, Tensor> levelsByType;
+  for (const auto &group : groups) {
+    const auto type = group.first;
+    levelsByType[type] = type == levels.elementType()
+                             ? levels
+                             : cast(graph, levels, type, prog, {dnai});
+  }
+  const auto cs = graph.addComputeSet({dnai, "Histogram"});
+  std::vector<Tensor> results;
+  for (const auto &group : groups) {
+    addHistogramVertices(graph, cs, group.second, levelsByType.at(group.first),
+                         absoluteOfInput, results, dnai);
+  }
   prog.add(Execute(cs, {dnai}));
+  return stackPartials(graph, results, levels.numElements() + 1, dnai);
+}
 
-  return concat(results).reshape({results.size(), results[0].numElements()});
+poplar::Tensor exponentHistogramImpl(poplar::Graph &graph,
+                                     const std::vector<poplar::Tensor> &inputs,
+                                     int minExponent, unsigned numBins,
+                                     poplar::program::Sequence &prog,
+                                     const DebugNameAndId &dnai) {
+  // Zero and denormal floats are not decoded, so counting them in the lowest
+  // bin is only correct if it holds everything below 2^-126.
+  if (minExponent < -126) {
+    throw poputil::poplibs_error("exponentHistogram: minExponent must be at "
+                                 "least -126");
+  }
+  if (numBins < 2 || numBins > std::numeric_limits<unsigned short>::max()) {
+    throw poputil::poplibs_error("exponentHistogram: the number of bins must "
+                                 "be between 2 and 65535");
+  }
+  const auto groups = concatByType("exponentHistogram", inputs);
+  const auto cs = graph.addComputeSet({dnai, "ExponentHistogram"});
+  std::vector<Tensor> results;
+  for (const auto &group : groups) {
+    addExponentHistogramVertices(graph, cs, group.second, minExponent,
+                                 numBins, results, dnai);
+  }
+  prog.add(Execute(cs, {dnai}));
+  return stackPartials(graph, results, numBins, dnai);
 }
 
 } // anonymous namespace
@@ -190,83 +324,177 @@ poplar::Tensor histogramImpl(poplar::Graph &graph, const poplar::Tensor &input,
 // we must use unsigned or int values.
 constexpr unsigned maxElementsForFloatReduction = 16777216u;
 
-poplar::Tensor histogram(poplar::Graph &graph, const poplar::Tensor &input,
-                         const poplar::Tensor &levels, bool absoluteOfInput,
-                         poplar::program::Sequence &prog,
-                         const poplar::DebugContext &debugContext,
-                         const poplar::OptionFlags &options) {
-  poputil::PoplibsOpDebugInfo di(
-      debugContext, DI_ARGS(input, levels, absoluteOfInput, options));
-
-  const auto opts = parseOptionFlags(options);
-  auto histogramResult =
-      histogramImpl(graph, input, levels, absoluteOfInput, prog, {di});
-
-  if (opts.useFloatArithmetic) {
+// Reduce the partial histograms to a single histogram, as described above.
+static poplar::Tensor reduceHistogram(poplar::Graph &graph,
+                                      poplar::Tensor histogramResult,
+                                      std::size_t numElements,
+                                      bool useFloatArithmetic,
+                                      poplar::program::Sequence &prog,
+                                      const DebugNameAndId &dnai) {
+  if (useFloatArithmetic) {
     // Override all concerns over inaccurate integer representation as float,
     // but tolerate possible inaccurate results
-    auto output = reduce(graph, histogramResult, FLOAT, {0},
-                         popops::Operation::ADD, prog, {di});
-    di.addOutput(output);
-    return output;
+    return reduce(graph, histogramResult, FLOAT, {0}, popops::Operation::ADD,
+                  prog, {dnai});
   }
   // See the above explanation on numeric limits for exact integer
   // representation using float vs unsigned
-  if (input.numElements() > maxElementsForFloatReduction) {
+  if (numElements > maxElementsForFloatReduction) {
     // Reduce as INT, cast to unsigned to return
-    histogramResult = cast(graph, histogramResult, INT, prog, {di});
+    histogramResult = cast(graph, histogramResult, INT, prog, {dnai});
   }
   // Reduce, cast to unsigned to return
   auto output = reduce(graph, histogramResult, histogramResult.elementType(),
-                       {0}, popops::Operation::ADD, prog, {di});
+                       {0}, popops::Operation::ADD, prog, {dnai});
   // When casting int to unsigned this appears to generate nothing
-  auto output_ = cast(graph, output, UNSIGNED_INT, prog, {di});
-  di.addOutput(output_);
-  return output_;
+  return cast(graph, output, UNSIGNED_INT, prog, {dnai});
 }
 
-void histogram(poplar::Graph &graph, const poplar::Tensor &input,
-               poplar::Tensor &output, bool updateOutput,
-               const poplar::Tensor &levels, bool absoluteOfInput,
-               poplar::program::Sequence &prog,
-               const poplar::DebugContext &debugContext) {
-  poputil::PoplibsOpDebugInfo di(
-      debugContext,
-      DI_ARGS(input, output, levels, updateOutput, absoluteOfInput));
-
+// Reduce the partial histograms into `output`, as described above.
+static void reduceHistogramToOutput(poplar::Graph &graph,
+                                    poplar::Tensor histogramResult,
+                                    std::size_t numElements,
+                                    poplar::Tensor &output, bool updateOutput,
+                                    poplar::program::Sequence &prog,
+                                    const DebugNameAndId &dnai) {
   const auto useFloatArithmetic = (output.elementType() == FLOAT);
-  auto histogramResult =
-      histogramImpl(graph, input, levels, absoluteOfInput, prog, {di});
-
   if (useFloatArithmetic) {
     // Override all concerns over inaccurate integer representation as float,
     // but tolerate possible inaccurate results
     reduceWithOutput(graph, histogramResult, output, {0},
-                     {popops::Operation::ADD, updateOutput}, prog, {di});
+                     {popops::Operation::ADD, updateOutput}, prog, {dnai});
     return;
   }
   // See the above explanation on numeric limits for exact integer
   // representation using float vs unsigned
-  if (input.numElements() > maxElementsForFloatReduction) {
+  if (numElements > maxElementsForFloatReduction) {
     // Reduce as INT, cast to unsigned to return
-    output = cast(graph, output, INT, prog, {di});
-    histogramResult = cast(graph, histogramResult, INT, prog, {di});
+    output = cast(graph, output, INT, prog, {dnai});
+    histogramResult = cast(graph, histogramResult, INT, prog, {dnai});
     reduceWithOutput(graph, histogramResult, output, {0},
-                     {popops::Operation::ADD, updateOutput}, prog, {di});
-    output = cast(graph, output, UNSIGNED_INT, prog, {di});
+                     {popops::Operation::ADD, updateOutput}, prog, {dnai});
+    output = cast(graph, output, UNSIGNED_INT, prog, {dnai});
   } else {
     // Reduce as float
     auto result = reduce(graph, histogramResult, FLOAT, {0},
-                         popops::Operation::ADD, prog, {di});
+                         popops::Operation::ADD, prog, {dnai});
     if (updateOutput) {
       // Cast to unsigned and add to the result to return
-      result = cast(graph, result, UNSIGNED_INT, prog, {di});
-      addInPlace(graph, output, result, prog, {di});
+      result = cast(graph, result, UNSIGNED_INT, prog, {dnai});
+      addInPlace(graph, output, result, prog, {dnai});
     } else {
       // Cast to unsigned to return
-      output = cast(graph, result, UNSIGNED_INT, prog, {di});
+      output = cast(graph, result, UNSIGNED_INT, prog, {dnai});
     }
   }
 }
 
+static std::size_t totalElements(const std::vector<poplar::Tensor> &inputs) {
+  std::size_t total = 0;
+  for (const auto &input : inputs) {
+    total += input.numElements();
+  }
+  return total;
+}
+
+poplar::Tensor histogram(poplar::Graph &graph, const poplar::Tensor &input,
+                         const poplar::Tensor &levels, bool absoluteOfInput,
+                         poplar::program::Sequence &prog,
+                         const poplar::DebugContext &debugContext,
+                         const poplar::OptionFlags &options) {
+  poputil::PoplibsOpDebugInfo di(
+      debugContext, DI_ARGS(input, levels, absoluteOfInput, options));
+
+  const auto opts = parseOptionFlags(options);
+  auto histogramResult =
+      histogramImpl(graph, input, levels, absoluteOfInput, prog, {di});
+  auto output =
+      reduceHistogram(graph, histogramResult, input.numElements(),
+                      opts.useFloatArithmetic, prog, {di});
+  di.addOutput(output);
+  return output;
+}
+
+void histogram(poplar::Graph &graph, const poplar::Tensor &input,
+               poplar::Tensor &output, bool updateOutput,
+               const poplar::Tensor &levels, bool absoluteOfInput,
+               poplar::program::Sequence &prog,
+               const poplar::DebugContext &debugContext) {
+  poputil::PoplibsOpDebugInfo di(
+      debugContext,
+      DI_ARGS(input, output, levels, updateOutput, absoluteOfInput));
+
+  auto histogramResult =
+      histogramImpl(graph, input, levels, absoluteOfInput, prog, {di});
+  reduceHistogramToOutput(graph, histogramResult, input.numElements(), output,
+                          updateOutput, prog, {di});
+}
+
+poplar::Tensor histogram(poplar::Graph &graph,
+                         const std::vector<poplar::Tensor> &inputs,
+                         const poplar::Tensor &levels, bool absoluteOfInput,
+                         poplar::program::Sequence &prog,
+                         const poplar::DebugContext &debugContext,
+                         const poplar::OptionFlags &options) {
+  poputil::PoplibsOpDebugInfo di(
+      debugContext, DI_ARGS(inputs, levels, absoluteOfInput, options));
+
+  const auto opts = parseOptionFlags(options);
+  auto histogramResult = multiHistogramImpl(graph, inputs, levels,
+                                            absoluteOfInput, prog, {di});
+  auto output =
+      reduceHistogram(graph, histogramResult, totalElements(inputs),
+                      opts.useFloatArithmetic, prog, {di});
+  di.addOutput(output);
+  return output;
+}
+
+void histogram(poplar::Graph &graph, const std::vector<poplar::Tensor> &inputs,
+               poplar::Tensor &output, bool updateOutput,
+               const poplar::Tensor &levels, bool absoluteOfInput,
+               poplar::program::Sequence &prog,
+               const poplar::DebugContext &debugContext) {
+  poputil::PoplibsOpDebugInfo di(
+      debugContext,
+      DI_ARGS(inputs, output, levels, updateOutput, absoluteOfInput));
+
+  auto histogramResult = multiHistogramImpl(graph, inputs, levels,
+                                            absoluteOfInput, prog, {di});
+  reduceHistogramToOutput(graph, histogramResult, totalElements(inputs),
+                          output, updateOutput, prog, {di});
+}
+
+poplar::Tensor exponentHistogram(poplar::Graph &graph,
+                                 const std::vector<poplar::Tensor> &inputs,
+                                 int minExponent, unsigned numBins,
+                                 poplar::program::Sequence &prog,
+                                 const poplar::DebugContext &debugContext,
+                                 const poplar::OptionFlags &options) {
+  poputil::PoplibsOpDebugInfo di(
+      debugContext, DI_ARGS(inputs, minExponent, numBins, options));
+
+  const auto opts = parseOptionFlags(options);
+  auto histogramResult =
+      exponentHistogramImpl(graph, inputs, minExponent, numBins, prog, {di});
+  auto output =
+      reduceHistogram(graph, histogramResult, totalElements(inputs),
+                      opts.useFloatArithmetic, prog, {di});
+  di.addOutput(output);
+  return output;
+}
+
+void exponentHistogram(poplar::Graph &graph,
+                       const std::vector<poplar::Tensor> &inputs,
+                       poplar::Tensor &output, bool updateOutput,
+                       int minExponent, poplar::program::Sequence &prog,
+                       const poplar::DebugContext &debugContext) {
+  poputil::PoplibsOpDebugInfo di(
+      debugContext, DI_ARGS(inputs, output, updateOutput, minExponent));
+
+  auto histogramResult = exponentHistogramImpl(
+      graph, inputs, minExponent, output.numElements(), prog, {di});
+  reduceHistogramToOutput(graph, histogramResult, totalElements(inputs),
+                          output, updateOutput, prog, {di});
+}
+
 } // namespace popops
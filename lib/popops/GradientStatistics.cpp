@@ -0,0 +1,143 @@
+// Copyright (c) 2020 Graphcore Ltd. All rights reserved.
+#include "popops/GradientStatistics.hpp"
+
+#include "poplibs_support/logging.hpp"
+#include "popops/ElementWise.hpp"
+#include "popops/Reduce.hpp"
+#include "poputil/DebugInfo.hpp"
+#include "poputil/TileMapping.hpp"
+#include "poputil/Util.hpp"
+#include "poputil/VertexTemplates.hpp"
+#include "poputil/exceptions.hpp"
+
+#include <string>
+#include <vector>
+
+using namespace poplar;
+using namespace poplar::program;
+using namespace poputil;
+
+namespace logging = poplibs_support::logging;
+namespace pe = popops::expr;
+
+namespace popops {
+
+// The columns of the partial statistics written by each vertex.
+static constexpr unsigned nonFiniteColumn = 0;
+static constexpr unsigned maxAbsColumn = 1;
+static constexpr unsigned sumSquaresColumn = 2;
+static constexpr unsigned numColumns = 3;
+
+// Add vertices to \p cs gathering the statistics of \p t, and return their
+// partial statistics with one row per vertex. A tensor with no elements has
+// a single row of zeros.
+static Tensor addStatisticsVertices(Graph &graph, ComputeSet &cs,
+                                    const Tensor &t,
+                                    const DebugNameAndId &dnai) {
+  const auto &target = graph.getTarget();
+  const auto type = t.elementType();
+  const auto vectorWidth = target.getVectorWidth(type);
+  auto flat = t.flatten();
+  graph.reorderToSimplify(&flat, {}, false);
+  const auto mapping = graph.getTileMapping(flat);
+
+  std::vector<std::pair<unsigned, std::vector<std::vector<Interval>>>> work;
+  std::size_t numVertices = 0;
+  for (unsigned tile = 0; tile < mapping.size(); ++tile) {
+    if (mapping[tile].empty()) {
+      continue;
+    }
+    const auto tileRegions =
+        graph.getSortedContiguousRegions(flat, mapping[tile]);
+    auto vertexRegions = splitRegionsBetweenWorkers(
+        target, tileRegions, vectorWidth, 2 * vectorWidth);
+    numVertices += vertexRegions.size();
+    work.emplace_back(tile, std::move(vertexRegions));
+  }
+  if (numVertices == 0) {
+    auto zeros = graph.addConstant(FLOAT, {1, numColumns}, 0, {dnai, "empty"});
+    graph.setTileMapping(zeros, 0);
+    return zeros;
+  }
+
+  auto partials =
+      graph.addVariable(FLOAT, {numVertices, numColumns}, {dnai, "partials"});
+  const auto vertexName = templateVertex("popops::GradientStatistics2D", type);
+  std::size_t row = 0;
+  for (const auto &entry : work) {
+    const auto tile = entry.first;
+    for (const auto &regions : entry.second) {
+      const auto out = partials[row++];
+      graph.setTileMapping(out, tile);
+      auto v = graph.addVertex(cs, vertexName,
+                               {{"in", flat.slices(regions)}, {"out", out}});
+      graph.setTileMapping(v, tile);
+    }
+  }
+  return partials;
+}
+
+GradientStatistics gradientStatistics(Graph &graph,
+                                      const std::vector<Tensor> &ts,
+                                      Sequence &prog,
+                                      const DebugContext &debugContext,
+                                      const OptionFlags &options) {
+  poputil::PoplibsOpDebugInfo di(debugContext, DI_ARGS(ts, options));
+
+  if (ts.empty()) {
+    throw poplibs_error("gradientStatistics: no tensors given");
+  }
+  for (const auto &t : ts) {
+    if (t.elementType() != FLOAT && t.elementType() != HALF) {
+      throw poplibs_error("gradientStatistics: unsupported type " +
+                          t.elementType().toString() +
+                          ", must be FLOAT or HALF");
+    }
+  }
+  const auto n = ts.size();
+  logging::popops::info("gradientStatistics numTensors={}, name={}", n,
+                        debugContext.getPathName());
+
+  auto cs = graph.addComputeSet({di, "partials"});
+  std::vector<Tensor> partials;
+  partials.reserve(n);
+  for (const auto &t : ts) {
+    partials.push_back(addStatisticsVertices(graph, cs, t, {di}));
+  }
+  prog.add(Execute(cs, {di}));
+
+  // The flag and the maximum are both reduced with MAX, so each tensor needs
+  // two reductions, all of which share compute sets.
+  auto maxes = graph.addVariable(FLOAT, {n, 2}, {di, "maxes"});
+  auto sumSquares = graph.addVariable(FLOAT, {n}, {di, "sumSquares"});
+  mapTensorLinearly(graph, maxes);
+  mapTensorLinearly(graph, sumSquares);
+  std::vector<ComputeSet> css;
+  for (std::size_t i = 0; i < n; ++i) {
+    const auto name = std::to_string(i);
+    reduceWithOutput(
+        graph, partials[i].slice(nonFiniteColumn, maxAbsColumn + 1, 1),
+        maxes[i], {0}, Operation::MAX, css, {di, "max" + name}, options);
+    reduceWithOutput(
+        graph, partials[i].slice(sumSquaresColumn, sumSquaresColumn + 1, 1),
+        sumSquares.slice(i, i + 1), {0}, Operation::ADD, css,
+        {di, "sumSquares" + name}, options);
+  }
+  for (const auto &reduceCs : css) {
+    prog.add(Execute(reduceCs, {di}));
+  }
+
+  GradientStatistics result;
+  result.hasNonFinite =
+      map(graph, pe::Gt(pe::_1, pe::Const(0.0f)),
+          {maxes.slice(nonFiniteColumn, nonFiniteColumn + 1, 1).flatten()},
+          prog, {di, "hasNonFinite"});
+  result.maxAbs = maxes.slice(maxAbsColumn, maxAbsColumn + 1, 1).flatten();
+  result.sumSquares = sumSquares;
+  di.addOutputs({{"hasNonFinite", toProfileValue(result.hasNonFinite)},
+                 {"maxAbs", toProfileValue(result.maxAbs)},
+                 {"sumSquares", toProfileValue(result.sumSquares)}});
+  return result;
+}
+
+} // namespace popops
@@ -0,0 +1,143 @@
+// Copyright (c) 2020 Graphcore Ltd. All rights reserved.
+#include "popops/MultiTensor.hpp"
+
+#include "poplibs_support/logging.hpp"
+#include "popops/ElementWise.hpp"
+#include "popops/ScaledAdd.hpp"
+#include "poputil/DebugInfo.hpp"
+#include "poputil/exceptions.hpp"
+
+#include <map>
+
+using namespace poplar;
+using namespace poplar::program;
+
+namespace logging = poplibs_support::logging;
+
+namespace popops {
+
+namespace {
+
+// The operands of each group of tensors sharing the same operand types,
+// flattened and concatenated so they can be processed as a single tensor.
+std::vector<std::vector<Tensor>>
+concatByType(const std::string &fnName,
+             const std::vector<std::vector<Tensor>> &ts) {
+  if (ts.empty()) {
+    throw poputil::poplibs_error(fnName + ": no operands given");
+  }
+  const auto n = ts[0].size();
+  // a single scalar used for all of the destination tensors
+  const auto isShared = [&](std::size_t i) {
+    return i != 0 && ts[i].size() == 1 && ts[i][0].numElements() == 1;
+  };
+  for (std::size_t i = 1; i < ts.size(); ++i) {
+    if (!isShared(i) && ts[i].size() != n) {
+      throw poputil::poplibs_error(
+          fnName + ": operand " + std::to_string(i) +
+          " must have one tensor per destination tensor or a single scalar");
+    }
+  }
+
+  // the key is the element type of every operand that is not shared
+  std::map<std::vector<Type>, std::vector<std::vector<Tensor>>> groups;
+  for (std::size_t t = 0; t < n; ++t) {
+    std::vector<Type> key;
+    std::vector<Tensor> operands;
+    for (std::size_t i = 0; i < ts.size(); ++i) {
+      if (isShared(i)) {
+        continue;
+      }
+      const auto &operand = ts[i][t];
+      if (operand.numElements() != ts[0][t].numElements()) {
+        throw poputil::poplibs_error(
+            fnName + ": operand " + std::to_string(i) + " of tensor " +
+            std::to_string(t) + " has a different number of elements");
+      }
+      key.push_back(operand.elementType());
+      operands.push_back(operand.flatten());
+    }
+    auto &group = groups[key];
+    group.resize(operands.size());
+    for (std::size_t i = 0; i < operands.size(); ++i) {
+      group[i].push_back(operands[i]);
+    }
+  }
+
+  std::vector<std::vector<Tensor>> result;
+  for (const auto &group : groups) {
+    std::vector<Tensor> concatenated;
+    std::size_t perTensor = 0;
+    for (std::size_t i = 0; i < ts.size(); ++i) {
+      if (isShared(i)) {
+        concatenated.push_back(ts[i][0].flatten());
+      } else {
+        concatenated.push_back(concat(group.second[perTensor++]));
+      }
+    }
+    result.push_back(std::move(concatenated));
+  }
+  logging::popops::debug("{}: {} tensors in {} groups", fnName, n,
+                         result.size());
+  return result;
+}
+
+// Scaled add of each group of B into the matching group of A. ScaleType is
+// either a scalar Tensor or a float, as for scaledAddTo().
+template <typename ScaleType>
+void multiTensorScaledAddToImpl(Graph &graph, const std::vector<Tensor> &A,
+                                const std::vector<Tensor> &B,
+                                const ScaleType &scaleB, Sequence &prog,
+                                const DebugNameAndId &dnai,
+                                const OptionFlags &options) {
+  if (A.size() != B.size()) {
+    throw poputil::poplibs_error(
+        "multiTensorScaledAddTo: A and B must have the same number of tensors");
+  }
+  if (A.empty()) {
+    return;
+  }
+  const auto groups = concatByType("multiTensorScaledAddTo", {A, B});
+  for (std::size_t g = 0; g < groups.size(); ++g) {
+    scaledAddTo(graph, groups[g][0], groups[g][1], scaleB, prog,
+                {dnai, "group" + std::to_string(g)}, options);
+  }
+}
+
+} // end anonymous namespace
+
+void multiTensorMapInPlace(Graph &graph, const expr::Expr &expr,
+                           const std::vector<std::vector<Tensor>> &ts,
+                           Sequence &prog, const DebugContext &debugContext,
+                           const OptionFlags &options) {
+  poputil::PoplibsOpDebugInfo di(debugContext, DI_ARGS(expr, ts, options));
+
+  if (!ts.empty() && ts[0].empty()) {
+    return;
+  }
+  const auto groups = concatByType("multiTensorMapInPlace", ts);
+  for (std::size_t g = 0; g < groups.size(); ++g) {
+    mapInPlace(graph, expr, groups[g], prog, {di, "group" + std::to_string(g)},
+               options);
+  }
+}
+
+void multiTensorScaledAddTo(Graph &graph, const std::vector<Tensor> &A,
+                            const std::vector<Tensor> &B, const Tensor &scaleB,
+                            Sequence &prog, const DebugContext &debugContext,
+                            const OptionFlags &options) {
+  poputil::PoplibsOpDebugInfo di(debugContext,
+                                 DI_ARGS(A, B, scaleB, options));
+  multiTensorScaledAddToImpl(graph, A, B, scaleB, prog, {di}, options);
+}
+
+void multiTensorScaledAddTo(Graph &graph, const std::vector<Tensor> &A,
+                            const std::vector<Tensor> &B, float scaleB,
+                            Sequence &prog, const DebugContext &debugContext,
+                            const OptionFlags &options) {
+  poputil::PoplibsOpDebugInfo di(debugContext,
+                                 DI_ARGS(A, B, scaleB, options));
+  multiTensorScaledAddToImpl(graph, A, B, scaleB, prog, {di}, options);
+}
+
+} // namespace popops
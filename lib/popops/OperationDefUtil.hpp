@@ -0,0 +1,35 @@
+// Copyright (c) 2020 Graphcore Ltd. All rights reserved.
+#ifndef poplibs_OperationDefUtil_hpp_
+#define poplibs_OperationDefUtil_hpp_
+#include <poplibs_support/Compiler.hpp>
+#include <popops/Operation.hpp>
+#include <poputil/VertexTemplates.hpp>
+
+// Specialize vertex template stringification for reduction operations.
+namespace poputil {
+
+template <> struct VertexTemplateToString<popops::Operation> {
+  static std::string to_string(const popops::Operation &op) {
+    switch (op) {
+    case popops::Operation::ADD:
+      return "popops::Operation::ADD";
+    case popops::Operation::MUL:
+      return "popops::Operation::MUL";
+    case popops::Operation::MIN:
+      return "popops::Operation::MIN";
+    case popops::Operation::MAX:
+      return "popops::Operation::MAX";
+    case popops::Operation::LOGICAL_AND:
+      return "popops::Operation::LOGICAL_AND";
+    case popops::Operation::LOGICAL_OR:
+      return "popops::Operation::LOGICAL_OR";
+    case popops::Operation::SQUARE_ADD:
+      return "popops::Operation::SQUARE_ADD";
+    }
+    POPLIB_UNREACHABLE();
+  }
+};
+
+} // end namespace poputil
+
+#endif // poplibs_OperationDefUtil_hpp_
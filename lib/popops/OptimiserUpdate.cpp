@@ -0,0 +1,251 @@
+// Copyright (c) 2020 Graphcore Ltd. All rights reserved.
+#include "popops/OptimiserUpdate.hpp"
+
+#include "poplibs_support/logging.hpp"
+#include "popops/ElementWise.hpp"
+#include "popops/Reduce.hpp"
+#include "poputil/DebugInfo.hpp"
+#include "poputil/Util.hpp"
+#include "poputil/VertexTemplates.hpp"
+#include "poputil/exceptions.hpp"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace poplar;
+using namespace poplar::program;
+using namespace poputil;
+
+namespace pe = popops::expr;
+namespace logging = poplibs_support::logging;
+
+namespace poputil {
+template <>
+poplar::ProfileValue toProfileValue(const popops::MomentumParams &p) {
+  poplar::ProfileValue::Map v;
+  v.insert({"momentum", toProfileValue(p.momentum)});
+  v.insert({"weightDecay", toProfileValue(p.weightDecay)});
+  return v;
+}
+
+template <> poplar::ProfileValue toProfileValue(const popops::AdamParams &p) {
+  poplar::ProfileValue::Map v;
+  v.insert({"beta1", toProfileValue(p.beta1)});
+  v.insert({"beta2", toProfileValue(p.beta2)});
+  v.insert({"epsilon", toProfileValue(p.epsilon)});
+  v.insert({"weightDecay", toProfileValue(p.weightDecay)});
+  return v;
+}
+} // namespace poputil
+
+namespace popops {
+
+namespace {
+
+using NamedTensors = std::vector<std::pair<std::string, Tensor>>;
+using UpdateVertices = std::vector<std::pair<VertexRef, unsigned>>;
+
+void validateScalar(const Tensor &t, const std::string &name) {
+  if (t.numElements() != 1 || t.elementType() != FLOAT) {
+    throw poplibs_error(name + " must be a scalar tensor of type float");
+  }
+}
+
+// Check the operands of an update and return the state type.
+Type validateOperands(const std::string &fnName, const Tensor &weights,
+                      const Tensor &grads, const std::vector<Tensor> &state,
+                      const Tensor &learningRate, const Tensor &lossScale) {
+  const auto wType = weights.elementType();
+  if (wType != FLOAT && wType != HALF) {
+    throw poplibs_error(fnName + ": weights must be of type half or float");
+  }
+  if (grads.elementType() != wType || grads.shape() != weights.shape()) {
+    throw poplibs_error(fnName + ": gradients must have the same type and "
+                                 "shape as the weights");
+  }
+  const auto sType = state.front().elementType();
+  if (sType != FLOAT && !(sType == HALF && wType == HALF)) {
+    throw poplibs_error(fnName + ": state must be of type float, or of type "
+                                 "half with weights of type half");
+  }
+  for (const auto &s : state) {
+    if (s.elementType() != sType || s.shape() != weights.shape()) {
+      throw poplibs_error(fnName + ": all state tensors must have the same "
+                                   "type and the same shape as the weights");
+    }
+  }
+  if (!weights.isParallelWriteable()) {
+    throw poplibs_error(fnName + ": weights must be parallel writeable");
+  }
+  validateScalar(learningRate, fnName + ": learningRate");
+  validateScalar(lossScale, fnName + ": lossScale");
+  return sType;
+}
+
+// Add vertices to cs that update the weights and the state element-wise, each
+// vertex working on regions of the weights that are contiguous on one tile.
+// Returns the vertices added together with the tiles they are mapped to.
+UpdateVertices addUpdateVertices(Graph &graph, const ComputeSet &cs,
+                                 const std::string &vertexName,
+                                 const Tensor &weights,
+                                 const NamedTensors &elementwise,
+                                 const NamedTensors &scalars) {
+  auto wFlat = weights.flatten();
+  std::vector<Tensor> flat;
+  flat.reserve(elementwise.size());
+  for (const auto &t : elementwise) {
+    flat.push_back(t.second.flatten());
+  }
+  std::vector<Tensor *> others;
+  for (auto &t : flat) {
+    others.push_back(&t);
+  }
+  graph.reorderToSimplify(&wFlat, others, false);
+
+  const auto &target = graph.getTarget();
+  const auto grainSize = target.getVectorWidth(weights.elementType());
+  const auto mapping = graph.getTileMapping(wFlat);
+  UpdateVertices vertices;
+  for (unsigned tile = 0; tile < mapping.size(); ++tile) {
+    if (mapping[tile].empty()) {
+      continue;
+    }
+    const auto tileRegions =
+        graph.getSortedContiguousRegions(wFlat, mapping[tile]);
+    const auto vertexRegions = splitRegionsBetweenWorkers(
+        target, tileRegions, grainSize, 2 * grainSize);
+    for (const auto &regions : vertexRegions) {
+      auto v =
+          graph.addVertex(cs, vertexName, {{"weights", wFlat.slices(regions)}});
+      for (std::size_t i = 0; i < elementwise.size(); ++i) {
+        graph.connect(v[elementwise[i].first], flat[i].slices(regions));
+      }
+      for (const auto &s : scalars) {
+        graph.connect(v[s.first], s.second.reshape({}));
+      }
+      graph.setTileMapping(v, tile);
+      vertices.emplace_back(v, tile);
+    }
+  }
+  return vertices;
+}
+
+void setAdamParams(Graph &graph, const UpdateVertices &vertices,
+                   const AdamParams &params, bool setBetas) {
+  for (const auto &entry : vertices) {
+    const auto &v = entry.first;
+    if (setBetas) {
+      graph.setInitialValue(v["beta1"], params.beta1);
+      graph.setInitialValue(v["beta2"], params.beta2);
+    }
+    graph.setInitialValue(v["epsilon"], params.epsilon);
+    graph.setInitialValue(v["weightDecay"], params.weightDecay);
+  }
+}
+
+} // end anonymous namespace
+
+void momentumUpdate(Graph &graph, const Tensor &weights, const Tensor &grads,
+                    const Tensor &velocity, const Tensor &learningRate,
+                    const Tensor &lossScale, const MomentumParams &params,
+                    Sequence &prog, const DebugContext &debugContext) {
+  poputil::PoplibsOpDebugInfo di(
+      debugContext,
+      DI_ARGS(weights, grads, velocity, learningRate, lossScale, params));
+  logging::popops::info("momentumUpdate weights={}, name={}", weights.shape(),
+                        debugContext.getPathName());
+
+  const auto sType = validateOperands("momentumUpdate", weights, grads,
+                                      {velocity}, learningRate, lossScale);
+  const auto cs = graph.addComputeSet({di, "momentumUpdate"});
+  const auto vertexName =
+      templateVertex("popops::MomentumUpdate", weights.elementType(), sType);
+  const auto vertices = addUpdateVertices(
+      graph, cs, vertexName, weights,
+      {{"grads", grads}, {"velocity", velocity}},
+      {{"learningRate", learningRate}, {"lossScale", lossScale}});
+  for (const auto &v : vertices) {
+    graph.setInitialValue(v.first["momentum"], params.momentum);
+    graph.setInitialValue(v.first["weightDecay"], params.weightDecay);
+  }
+  prog.add(Execute(cs, {di}));
+}
+
+void adamUpdate(Graph &graph, const Tensor &weights, const Tensor &grads,
+                const Tensor &m, const Tensor &v, const Tensor &learningRate,
+                const Tensor &lossScale, const AdamParams &params,
+                Sequence &prog, const DebugContext &debugContext) {
+  poputil::PoplibsOpDebugInfo di(
+      debugContext,
+      DI_ARGS(weights, grads, m, v, learningRate, lossScale, params));
+  logging::popops::info("adamUpdate weights={}, name={}", weights.shape(),
+                        debugContext.getPathName());
+
+  const auto sType = validateOperands("adamUpdate", weights, grads, {m, v},
+                                      learningRate, lossScale);
+  const auto cs = graph.addComputeSet({di, "adamUpdate"});
+  const auto vertexName =
+      templateVertex("popops::AdamUpdate", weights.elementType(), sType);
+  const auto vertices = addUpdateVertices(
+      graph, cs, vertexName, weights, {{"grads", grads}, {"m", m}, {"v", v}},
+      {{"learningRate", learningRate}, {"lossScale", lossScale}});
+  setAdamParams(graph, vertices, params, true);
+  prog.add(Execute(cs, {di}));
+}
+
+void lambUpdate(Graph &graph, const Tensor &weights, const Tensor &grads,
+                const Tensor &m, const Tensor &v, const Tensor &learningRate,
+                const Tensor &lossScale, const AdamParams &params,
+                Sequence &prog, const DebugContext &debugContext) {
+  poputil::PoplibsOpDebugInfo di(
+      debugContext,
+      DI_ARGS(weights, grads, m, v, learningRate, lossScale, params));
+  logging::popops::info("lambUpdate weights={}, name={}", weights.shape(),
+                        debugContext.getPathName());
+
+  const auto sType = validateOperands("lambUpdate", weights, grads, {m, v},
+                                      learningRate, lossScale);
+  const auto wType = weights.elementType();
+
+  // Update the moments, each vertex producing partial sums of squares of the
+  // weights and of the update which are then reduced to the two norms.
+  const auto momentsCs = graph.addComputeSet({di, "lambMoments"});
+  const auto moments = addUpdateVertices(
+      graph, momentsCs,
+      templateVertex("popops::LambUpdateMoments", wType, sType), weights,
+      {{"grads", grads}, {"m", m}, {"v", v}}, {{"lossScale", lossScale}});
+  setAdamParams(graph, moments, params, true);
+  auto partials = graph.addVariable(FLOAT, {moments.size(), 2},
+                                    {di, "normPartials"});
+  for (std::size_t i = 0; i < moments.size(); ++i) {
+    graph.connect(moments[i].first["partials"], partials[i]);
+    graph.setTileMapping(partials[i], moments[i].second);
+  }
+  prog.add(Execute(momentsCs, {di}));
+
+  const auto sumsOfSquares =
+      popops::reduce(graph, partials, FLOAT, {0}, Operation::ADD, prog,
+                     {di, "lambNorms"});
+
+  // lr * |w| / |u|, or lr if either norm is zero
+  const auto trustRatio =
+      pe::Select(pe::Sqrt(pe::Divide(pe::_1, pe::_2)), pe::Const(1.0f),
+                 pe::And(pe::Gt(pe::_1, pe::Const(0.0f)),
+                         pe::Gt(pe::_2, pe::Const(0.0f))));
+  const auto scaledLearningRate = popops::map(
+      graph, pe::Mul(pe::_3, trustRatio),
+      {sumsOfSquares.slice(0, 1), sumsOfSquares.slice(1, 2),
+       learningRate.reshape({1})},
+      prog, {di, "lambLearningRate"});
+
+  const auto weightsCs = graph.addComputeSet({di, "lambWeights"});
+  const auto apply = addUpdateVertices(
+      graph, weightsCs,
+      templateVertex("popops::LambUpdateWeights", wType, sType), weights,
+      {{"m", m}, {"v", v}}, {{"learningRate", scaledLearningRate}});
+  setAdamParams(graph, apply, params, false);
+  prog.add(Execute(weightsCs, {di}));
+}
+
+} // namespace popops
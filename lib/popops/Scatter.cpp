@@ -1,9 +1,11 @@
 // Copyright (c) 2019 Graphcore Ltd. All rights reserved.
 #include "popops/Scatter.hpp"
 
+#include "poplibs_support/logging.hpp"
 #include "popops/DynamicSlice.hpp"
 #include "popops/ElementWise.hpp"
 #include "poputil/Loop.hpp"
+#include "poputil/OptionParsing.hpp"
 #include "poputil/TileMapping.hpp"
 #include "poputil/exceptions.hpp"
 
@@ -13,7 +15,24 @@
 
 using namespace poplar;
 
+namespace logging = poplibs_support::logging;
+
 namespace {
+
+struct ScatterOptions {
+  bool enableMultiUpdate = true;
+};
+
+ScatterOptions parseScatterOptions(const OptionFlags &options) {
+  ScatterOptions scatterOpts;
+  const poplibs::OptionSpec spec{
+      {"enableMultiUpdate",
+       poplibs::OptionHandler::createWithBool(scatterOpts.enableMultiUpdate)}};
+  for (const auto &entry : options) {
+    spec.parse(entry.first, entry.second);
+  }
+  return scatterOpts;
+}
 // Transposes the given scatterIndices such that the indexVectorDim becomes
 // the most-minor dimension.
 Tensor transposeIndexVectorDimToLast(Tensor indices, unsigned indexVectorDim) {
@@ -269,6 +288,71 @@ poplar::Tensor padVectorWithZeros(poplar::Graph &graph, poplar::Tensor t,
   return poplar::concat({prefix, t, suffix});
 }
 
+// multiUpdate only uses the MultiUpdate vertices, which skip indices outside
+// the base tensor, above this number of indices. Fewer indices are written
+// with dynamicUpdate, which wraps them into the base tensor instead.
+constexpr std::size_t minMultiUpdateIndices = 7;
+
+// Returns true if each index selects one whole slice of the operand in a
+// single dimension, so the scatter updates rows of the operand.
+bool isRowUpdate(const Tensor &operand, const Tensor &canonicalIndices,
+                 const Tensor &canonicalUpdates,
+                 const std::vector<std::size_t> &insertWindowDims,
+                 const std::vector<unsigned> &scatterDimsToOperandDims) {
+  if (scatterDimsToOperandDims.size() != 1 || insertWindowDims.size() != 1 ||
+      insertWindowDims[0] != scatterDimsToOperandDims[0]) {
+    return false;
+  }
+  if (canonicalIndices.rank() == 2 && canonicalIndices.dim(1) != 1) {
+    return false;
+  }
+  const auto type = operand.elementType();
+  if (type != FLOAT && type != HALF && type != INT && type != UNSIGNED_INT) {
+    return false;
+  }
+  if (canonicalUpdates.elementType() != type) {
+    return false;
+  }
+  const auto indexType = canonicalIndices.elementType();
+  if (indexType != INT && indexType != UNSIGNED_INT) {
+    return false;
+  }
+  auto rowShape = operand.shape();
+  rowShape.erase(rowShape.begin() + scatterDimsToOperandDims[0]);
+  auto windowShape = canonicalUpdates.shape();
+  windowShape.erase(windowShape.begin());
+  return rowShape == windowShape;
+}
+
+// Scatter rows with a single multiUpdate instead of a loop over the indices.
+// Indices outside the operand are ignored, as for the XLA scatter.
+void scatterRows(Graph &graph, const Tensor &operand,
+                 const Tensor &canonicalIndices, const Tensor &canonicalUpdates,
+                 unsigned dim, program::Sequence &prog,
+                 const DebugNameAndId &dnai) {
+  const auto numIndices = canonicalIndices.dim(0);
+  auto offsets = canonicalIndices.reshape({numIndices, 1});
+  if (offsets.elementType() == INT) {
+    offsets = offsets.reinterpret(UNSIGNED_INT);
+  }
+  auto rows = operand.dimRoll(dim, 0);
+  rows = rows.reshape({rows.dim(0), rows.numElements() / rows.dim(0)});
+  const auto slices = canonicalUpdates.reshape({numIndices, 1, rows.dim(1)});
+  if (numIndices < minMultiUpdateIndices) {
+    // Send the indices outside the operand, negative ones included, to a
+    // scratch row past its end so they are skipped as by the vertices.
+    namespace pe = popops::expr;
+    const unsigned numRows = rows.dim(0);
+    offsets = popops::map(graph, pe::Min(pe::_1, pe::Const(numRows)),
+                          {offsets}, prog, {dnai, "clampIndices"});
+    rows = concat(rows, graph.clone(rows.slice(0, 1), {dnai, "scratchRow"}));
+  }
+  logging::popops::debug("scatter: {} rows of {} into {} using multiUpdate",
+                         numIndices, rows.dim(1), operand.shape());
+  popops::multiUpdate(graph, rows, slices, offsets, {0}, {1}, prog,
+                      popops::SlicePlan(), {}, {dnai, "multiUpdate"});
+}
+
 // High Level Algorithm.
 //
 // 1. Canonicalize the scatterIndices tensor such that it has rank 2, where
@@ -290,11 +374,13 @@ void scatterInternal(
     std::vector<std::size_t> insertWindowDims,
     std::vector<unsigned> scatterDimsToOperandDims,
     boost::optional<popops::UpdateComputationFunc &> updateComputation,
-    poplar::program::Sequence &prog, const DebugNameAndId &dnai) {
+    poplar::program::Sequence &prog, const DebugNameAndId &dnai,
+    const OptionFlags &options) {
+  const auto scatterOpts = parseScatterOptions(options);
 
   // If the updates tensor is empty, there is no need to update the operand. We
   // can return the operand as is.
-  if (updates.numElements() == 0) {
+  if (updates.numElements() == 0 || operand.numElements() == 0) {
     return;
   }
 
@@ -315,6 +401,19 @@ void scatterInternal(
   poplar::Tensor adjustedCanonicalUpdates =
       adjustScatterDims(indices.shape(), canonicalUpdates, indexVectorDim);
 
+  // Rows that are replaced whole can all be written at once; the order in
+  // which duplicate indices are applied is implementation defined, as for the
+  // XLA scatter. An update computation has to see the result of earlier
+  // updates to the same row, so it keeps the loop.
+  if (!updateComputation && scatterOpts.enableMultiUpdate &&
+      isRowUpdate(operand, canonicalScatterIndices, adjustedCanonicalUpdates,
+                  insertWindowDims, scatterDimsToOperandDims)) {
+    scatterRows(graph, operand, canonicalScatterIndices,
+                adjustedCanonicalUpdates, scatterDimsToOperandDims[0], prog,
+                dnai);
+    return;
+  }
+
   const bool hasScalarIndices = canonicalScatterIndices.rank() == 1;
 
   // The while loop that implements the scatter operation.
@@ -393,15 +492,17 @@ void scatter(poplar::Graph &graph, const poplar::Tensor &operand,
              std::vector<std::size_t> insertWindowDims,
              std::vector<unsigned> scatterDimsToOperandDims,
              poplar::program::Sequence &prog,
-             const poplar::DebugContext &debugContext) {
+             const poplar::DebugContext &debugContext,
+             const poplar::OptionFlags &options) {
   poputil::PoplibsOpDebugInfo di(
       debugContext,
       DI_ARGS(operand, indices, updates, indexVectorDim, updateWindowDims,
-              insertWindowDims, scatterDimsToOperandDims));
+              insertWindowDims, scatterDimsToOperandDims, options));
 
   return scatterInternal(graph, operand, indices, updates, indexVectorDim,
                          updateWindowDims, insertWindowDims,
-                         scatterDimsToOperandDims, boost::none, prog, {di});
+                         scatterDimsToOperandDims, boost::none, prog, {di},
+                         options);
 }
 
 void scatter(poplar::Graph &graph, const poplar::Tensor &operand,
@@ -411,16 +512,17 @@ void scatter(poplar::Graph &graph, const poplar::Tensor &operand,
              std::vector<unsigned> scatterDimsToOperandDims,
              UpdateComputationFunc &updateComputation,
              poplar::program::Sequence &prog,
-             const poplar::DebugContext &debugContext) {
+             const poplar::DebugContext &debugContext,
+             const poplar::OptionFlags &options) {
   poputil::PoplibsOpDebugInfo di(
       debugContext,
       DI_ARGS(operand, indices, updates, indexVectorDim, updateWindowDims,
-              insertWindowDims, scatterDimsToOperandDims));
+              insertWindowDims, scatterDimsToOperandDims, options));
 
   return scatterInternal(graph, operand, indices, updates, indexVectorDim,
                          updateWindowDims, insertWindowDims,
                          scatterDimsToOperandDims, {updateComputation}, prog,
-                         {di});
+                         {di}, options);
 }
 
 } // namespace popops
@@ -0,0 +1,50 @@
+// Copyright (c) 2020 Graphcore Ltd. All rights reserved.
+#include <poplar/HalfFloat.hpp>
+#include <poplar/Vertex.hpp>
+
+#include <cmath>
+
+using namespace poplar;
+
+static constexpr auto SPAN = VectorLayout::SPAN;
+static constexpr auto ONE_PTR = VectorLayout::ONE_PTR;
+
+namespace popops {
+
+// Gather the statistics of a set of regions in a single pass: out[0] is 1 if
+// any element is a NaN or infinite and 0 otherwise, out[1] the largest
+// absolute value of the finite elements and out[2] the sum of their squares.
+template <typename InType> class GradientStatistics2D : public Vertex {
+public:
+  GradientStatistics2D();
+
+  Vector<Input<Vector<InType, SPAN, 8>>> in;
+  Output<Vector<float, ONE_PTR>> out;
+
+  bool compute() {
+    float nonFinite = 0;
+    float maxAbs = 0;
+    float sumSquares = 0;
+    for (unsigned i = 0; i < in.size(); ++i) {
+      for (unsigned j = 0; j < in[i].size(); ++j) {
+        const float x = float(in[i][j]);
+        if (std::isnan(x) || std::isinf(x)) {
+          nonFinite = 1;
+          continue;
+        }
+        const float absX = std::fabs(x);
+        maxAbs = absX > maxAbs ? absX : maxAbs;
+        sumSquares += x * x;
+      }
+    }
+    out[0] = nonFinite;
+    out[1] = maxAbs;
+    out[2] = sumSquares;
+    return true;
+  }
+};
+
+template class GradientStatistics2D<float>;
+template class GradientStatistics2D<half>;
+
+} // namespace popops
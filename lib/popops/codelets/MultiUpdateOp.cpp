@@ -0,0 +1,74 @@
+// Copyright (c) 2020 Graphcore Ltd. All rights reserved.
+#include "popops/Operation.hpp"
+#include <cassert>
+#include <poplar/HalfFloat.hpp>
+#include <poplar/Vertex.hpp>
+
+using namespace poplar;
+
+static constexpr auto ONE_PTR = poplar::VectorLayout::ONE_PTR;
+
+namespace popops {
+
+template <Operation op, typename T> static inline T combine(T a, T b) {
+  switch (op) {
+  case Operation::MUL:
+    return a * b;
+  case Operation::MIN:
+    return a < b ? a : b;
+  case Operation::MAX:
+    return a > b ? a : b;
+  default:
+    return a + b;
+  }
+}
+
+// Combine single slices from multiple offsets \a subT into \a baseT with
+// \a op, as MultiUpdateAdd does for addition without a scale. Indices that
+// are not within the range of [baseOffset, baseOffset + numBaseElements) are
+// ignored.
+template <typename Type, Operation op> class MultiUpdateOp : public Vertex {
+public:
+  MultiUpdateOp();
+
+  Input<Vector<unsigned>> offsets; // in \a baseT
+  Input<Vector<Type, ONE_PTR>> subT;
+  InOut<Vector<Type, ONE_PTR>> baseT;
+  const unsigned short regionSize; // stride between slices
+  const unsigned baseOffset;       // in the slice dimension
+  const unsigned numBaseElements;  // in the slice dimension
+
+  bool compute() {
+    for (unsigned o = 0; o != offsets.size(); ++o) {
+      auto baseIdx = offsets[o];
+      assert(baseIdx < (1 << 31));
+      assert(numBaseElements < (1 << 31));
+      baseIdx -= baseOffset;
+      if (baseIdx >= numBaseElements) {
+        // this slice is not a part of baseT so we can skip it.
+        continue;
+      }
+
+      for (unsigned e = 0; e != regionSize; ++e) {
+        auto &dst = baseT[baseIdx * regionSize + e];
+        dst = combine<op>(Type(dst), Type(subT[o * regionSize + e]));
+      }
+    }
+    return true;
+  }
+};
+
+template class MultiUpdateOp<half, Operation::MUL>;
+template class MultiUpdateOp<half, Operation::MIN>;
+template class MultiUpdateOp<half, Operation::MAX>;
+template class MultiUpdateOp<float, Operation::MUL>;
+template class MultiUpdateOp<float, Operation::MIN>;
+template class MultiUpdateOp<float, Operation::MAX>;
+template class MultiUpdateOp<int, Operation::MUL>;
+template class MultiUpdateOp<int, Operation::MIN>;
+template class MultiUpdateOp<int, Operation::MAX>;
+template class MultiUpdateOp<unsigned, Operation::MUL>;
+template class MultiUpdateOp<unsigned, Operation::MIN>;
+template class MultiUpdateOp<unsigned, Operation::MAX>;
+
+} // namespace popops
@@ -0,0 +1,168 @@
+// Copyright (c) 2020 Graphcore Ltd. All rights reserved.
+#include <poplar/HalfFloat.hpp>
+#include <poplar/Vertex.hpp>
+
+#include <cmath>
+
+using namespace poplar;
+
+static constexpr auto ONE_PTR = VectorLayout::ONE_PTR;
+
+namespace popops {
+
+// Fused optimiser updates. Each vertex updates the weights and the optimiser
+// state for a set of regions in a single pass, reading the gradients once.
+// Gradients are multiplied by 1 / lossScale before use so the loss scaling
+// does not need a separate pass.
+
+template <typename WType, typename SType>
+class MomentumUpdate : public Vertex {
+public:
+  MomentumUpdate();
+
+  Vector<InOut<Vector<WType>>> weights;
+  Vector<Input<Vector<WType, ONE_PTR>>, ONE_PTR> grads;
+  Vector<InOut<Vector<SType, ONE_PTR>>, ONE_PTR> velocity;
+  Input<float> learningRate;
+  Input<float> lossScale;
+  const float momentum;
+  const float weightDecay;
+
+  bool compute() {
+    const float lr = *learningRate;
+    const float invLossScale = 1.0f / *lossScale;
+    for (unsigned i = 0; i < weights.size(); ++i) {
+      for (unsigned j = 0; j < weights[i].size(); ++j) {
+        const float w = float(weights[i][j]);
+        const float g = float(grads[i][j]) * invLossScale + weightDecay * w;
+        const float vel = momentum * float(velocity[i][j]) + g;
+        velocity[i][j] = SType(vel);
+        weights[i][j] = WType(w - lr * vel);
+      }
+    }
+    return true;
+  }
+};
+
+template class MomentumUpdate<float, float>;
+template class MomentumUpdate<half, float>;
+template class MomentumUpdate<half, half>;
+
+template <typename WType, typename SType>
+class AdamUpdate : public Vertex {
+public:
+  AdamUpdate();
+
+  Vector<InOut<Vector<WType>>> weights;
+  Vector<Input<Vector<WType, ONE_PTR>>, ONE_PTR> grads;
+  Vector<InOut<Vector<SType, ONE_PTR>>, ONE_PTR> m;
+  Vector<InOut<Vector<SType, ONE_PTR>>, ONE_PTR> v;
+  Input<float> learningRate;
+  Input<float> lossScale;
+  const float beta1;
+  const float beta2;
+  const float epsilon;
+  const float weightDecay;
+
+  bool compute() {
+    const float lr = *learningRate;
+    const float invLossScale = 1.0f / *lossScale;
+    for (unsigned i = 0; i < weights.size(); ++i) {
+      for (unsigned j = 0; j < weights[i].size(); ++j) {
+        const float w = float(weights[i][j]);
+        const float g = float(grads[i][j]) * invLossScale;
+        const float mNew = beta1 * float(m[i][j]) + (1 - beta1) * g;
+        const float vNew = beta2 * float(v[i][j]) + (1 - beta2) * g * g;
+        m[i][j] = SType(mNew);
+        v[i][j] = SType(vNew);
+        const float u = mNew / (std::sqrt(vNew) + epsilon) + weightDecay * w;
+        weights[i][j] = WType(w - lr * u);
+      }
+    }
+    return true;
+  }
+};
+
+template class AdamUpdate<float, float>;
+template class AdamUpdate<half, float>;
+template class AdamUpdate<half, half>;
+
+// First pass of a LAMB update: update the moments and accumulate the squared
+// norms of the weights and of the update for the trust ratio.
+template <typename WType, typename SType>
+class LambUpdateMoments : public Vertex {
+public:
+  LambUpdateMoments();
+
+  Vector<Input<Vector<WType>>> weights;
+  Vector<Input<Vector<WType, ONE_PTR>>, ONE_PTR> grads;
+  Vector<InOut<Vector<SType, ONE_PTR>>, ONE_PTR> m;
+  Vector<InOut<Vector<SType, ONE_PTR>>, ONE_PTR> v;
+  Input<float> lossScale;
+  // Sum of squares of the weights followed by the sum of squares of the update
+  Output<Vector<float, ONE_PTR>> partials;
+  const float beta1;
+  const float beta2;
+  const float epsilon;
+  const float weightDecay;
+
+  bool compute() {
+    const float invLossScale = 1.0f / *lossScale;
+    float weightsSquared = 0;
+    float updateSquared = 0;
+    for (unsigned i = 0; i < weights.size(); ++i) {
+      for (unsigned j = 0; j < weights[i].size(); ++j) {
+        const float w = float(weights[i][j]);
+        const float g = float(grads[i][j]) * invLossScale;
+        const float mNew = beta1 * float(m[i][j]) + (1 - beta1) * g;
+        const float vNew = beta2 * float(v[i][j]) + (1 - beta2) * g * g;
+        m[i][j] = SType(mNew);
+        v[i][j] = SType(vNew);
+        const float u = mNew / (std::sqrt(vNew) + epsilon) + weightDecay * w;
+        weightsSquared += w * w;
+        updateSquared += u * u;
+      }
+    }
+    partials[0] = weightsSquared;
+    partials[1] = updateSquared;
+    return true;
+  }
+};
+
+template class LambUpdateMoments<float, float>;
+template class LambUpdateMoments<half, float>;
+template class LambUpdateMoments<half, half>;
+
+// Second pass of a LAMB update: apply the update recomputed from the already
+// updated moments. The learning rate includes the trust ratio.
+template <typename WType, typename SType>
+class LambUpdateWeights : public Vertex {
+public:
+  LambUpdateWeights();
+
+  Vector<InOut<Vector<WType>>> weights;
+  Vector<Input<Vector<SType, ONE_PTR>>, ONE_PTR> m;
+  Vector<Input<Vector<SType, ONE_PTR>>, ONE_PTR> v;
+  Input<float> learningRate;
+  const float epsilon;
+  const float weightDecay;
+
+  bool compute() {
+    const float lr = *learningRate;
+    for (unsigned i = 0; i < weights.size(); ++i) {
+      for (unsigned j = 0; j < weights[i].size(); ++j) {
+        const float w = float(weights[i][j]);
+        const float u = float(m[i][j]) / (std::sqrt(float(v[i][j])) + epsilon) +
+                        weightDecay * w;
+        weights[i][j] = WType(w - lr * u);
+      }
+    }
+    return true;
+  }
+};
+
+template class LambUpdateWeights<float, float>;
+template class LambUpdateWeights<half, float>;
+template class LambUpdateWeights<half, half>;
+
+} // namespace popops
@@ -698,4 +698,50 @@ template class HistogramSupervisor<float, true, false>;
 template class HistogramSupervisor<half, true, false>;
 template class HistogramSupervisor<float, false, false>;
 template class HistogramSupervisor<half, false, false>;
+
+// Count elements by the binary exponent of their absolute value. Bin 0 holds
+// elements below 2^minExponent, bin i elements in
+// [2^(minExponent + i - 1), 2^(minExponent + i)) and the last bin larger
+// elements, infinities and NaNs. minExponent must be at least -126 so that
+// zeros and denormals, which are not decoded, belong in bin 0.
+template <typename InType> class HistogramByExponent2D : public Vertex {
+public:
+  Vector<Input<Vector<InType, SPAN_TYPE>>, SPAN_TYPE> data;
+  Output<Vector<float, PTR_ALIGN32, 4>> histogram;
+  unsigned short histogramCount;
+  short minExponent;
+
+  bool compute() {
+    const int lastBin = histogramCount - 1;
+    for (unsigned i = 0; i < histogramCount; i++) {
+      histogram[i] = 0;
+    }
+    for (unsigned j = 0; j < data.size(); j++) {
+      for (unsigned k = 0; k < data[j].size(); k++) {
+        // Half values are exactly representable as normal floats
+        const float x = static_cast<float>(data[j][k]);
+        union {
+          float f;
+          unsigned u;
+        } bits;
+        bits.f = x;
+        const int biasedExponent = (bits.u >> 23) & 0xff;
+        int bin;
+        if (biasedExponent == 0xff) {
+          bin = lastBin;
+        } else if (biasedExponent == 0) {
+          bin = 0;
+        } else {
+          bin = biasedExponent - 127 - minExponent + 1;
+          bin = bin < 0 ? 0 : (bin > lastBin ? lastBin : bin);
+        }
+        histogram[bin] += 1;
+      }
+    }
+    return true;
+  }
+};
+
+template class HistogramByExponent2D<float>;
+template class HistogramByExponent2D<half>;
 } // namespace popops
@@ -1,6 +1,7 @@
 // Copyright (c) 2017 Graphcore Ltd. All rights reserved.
 #include "popopsCycleEstimators.hpp"
 #include "ExprOpUtil.hpp"
+#include "OperationDefUtil.hpp"
 #include "PerformanceEstimation.hpp"
 #include "poplibs_support/gcd.hpp"
 #include "poplibs_support/logging.hpp"
@@ -1725,6 +1726,21 @@ MAKE_CYCLE_ESTIMATOR_NAME(Histogram2D)(const VertexIntrospector &vertex,
   return cycles;
 }
 
+std::uint64_t MAKE_CYCLE_ESTIMATOR_NAME(HistogramByExponent2D)(
+    const VertexIntrospector &vertex, const Target &target, const Type &type) {
+  CODELET_FIELD(data);
+  CODELET_SCALAR_VAL(histogramCount, unsigned);
+
+  // Zero the histogram, then per element: load, convert if half, extract the
+  // exponent, clamp and increment the bin.
+  std::uint64_t cycles = 10 + histogramCount;
+  const unsigned cyclesPerElement = type == HALF ? 9 : 8;
+  for (unsigned i = 0; i < data.size(); i++) {
+    cycles += 5 + cyclesPerElement * data[i].size();
+  }
+  return cycles;
+}
+
 std::uint64_t MAKE_CYCLE_ESTIMATOR_NAME(HistogramSupervisor)(
     const VertexIntrospector &vertex, const Target &target, const Type &type,
     const bool isAbsolute, const bool splitByLimits) {
@@ -1982,6 +1998,25 @@ std::uint64_t MAKE_CYCLE_ESTIMATOR_NAME(MultiUpdateAdd)(
   return cycles;
 }
 
+std::uint64_t MAKE_CYCLE_ESTIMATOR_NAME(MultiUpdateOp)(
+    const VertexIntrospector &vertex, const Target &target, const Type &type,
+    const popops::Operation &op) {
+  // C++ implementation: a compare or multiply per element with the load and
+  // store of the base element.
+  CODELET_FIELD(offsets);
+  CODELET_SCALAR_VAL(regionSize, unsigned short);
+
+  std::uint64_t cycles = 3; // load size, zero check and exitz.
+  if (offsets.size() == 0) {
+    return cycles;
+  }
+  cycles += 15;
+  const std::uint64_t cyclesPerElement = type == HALF ? 8 : 6;
+  const std::uint64_t outerLoopCycles = 12 + regionSize * cyclesPerElement;
+  cycles += outerLoopCycles * offsets.size();
+  return cycles;
+}
+
 std::uint64_t
 MAKE_CYCLE_ESTIMATOR_NAME(CircBufIncrIndex)(const VertexIntrospector &vertex,
                                             const Target &target) {
@@ -2239,6 +2274,64 @@ MAKE_CYCLE_ESTIMATOR_NAME(HasNaN)(const VertexIntrospector &vertex,
   return cycles * target.getNumWorkerContexts();
 }
 
+// Per element: load, convert if half, check for a NaN or infinity, then
+// update the maximum and the sum of squares.
+std::uint64_t MAKE_CYCLE_ESTIMATOR_NAME(GradientStatistics2D)(
+    const VertexIntrospector &vertex, const Target &target, const Type &type) {
+  CODELET_FIELD(in);
+  std::uint64_t cycles = 12;
+  const unsigned cyclesPerElement = type == HALF ? 7 : 6;
+  for (unsigned i = 0; i < in.size(); ++i) {
+    cycles += 5 + cyclesPerElement * in[i].size();
+  }
+  return cycles;
+}
+
+// The optimiser update vertices process one element per inner loop
+// iteration, with extra cycles to convert each half operand to and from float.
+static std::uint64_t
+optimiserUpdateCycles(const VertexIntrospector &vertex, const Type &wType,
+                      const Type &sType, unsigned numStateTensors,
+                      unsigned cyclesPerElement) {
+  CODELET_FIELD(weights);
+  const unsigned conversionCycles =
+      2 * (wType == HALF) + numStateTensors * (sType == HALF);
+  // initial overhead, loading the scalars and exit
+  std::uint64_t cycles = 12;
+  for (unsigned i = 0; i < weights.size(); ++i) {
+    // outer loop overhead
+    cycles += 6 + weights[i].size() * (cyclesPerElement + conversionCycles);
+  }
+  return cycles;
+}
+
+std::uint64_t MAKE_CYCLE_ESTIMATOR_NAME(MomentumUpdate)(
+    const VertexIntrospector &vertex, const Target &target, const Type &wType,
+    const Type &sType) {
+  return optimiserUpdateCycles(vertex, wType, sType, 1, 6);
+}
+
+std::uint64_t
+MAKE_CYCLE_ESTIMATOR_NAME(AdamUpdate)(const VertexIntrospector &vertex,
+                                      const Target &target, const Type &wType,
+                                      const Type &sType) {
+  // sqrt and divide dominate
+  return optimiserUpdateCycles(vertex, wType, sType, 2, 24);
+}
+
+std::uint64_t MAKE_CYCLE_ESTIMATOR_NAME(LambUpdateMoments)(
+    const VertexIntrospector &vertex, const Target &target, const Type &wType,
+    const Type &sType) {
+  // as Adam plus accumulating the squared norms
+  return optimiserUpdateCycles(vertex, wType, sType, 2, 26) + 4;
+}
+
+std::uint64_t MAKE_CYCLE_ESTIMATOR_NAME(LambUpdateWeights)(
+    const VertexIntrospector &vertex, const Target &target, const Type &wType,
+    const Type &sType) {
+  return optimiserUpdateCycles(vertex, wType, sType, 2, 20);
+}
+
 std::uint64_t
 MAKE_CYCLE_ESTIMATOR_NAME(Transpose2d)(const VertexIntrospector &vertex,
                                        const Target &target, const Type &type) {
@@ -2633,6 +2726,21 @@ poplibs::CycleEstimatorTable makeCyclesFunctionTable() {
       CYCLE_ESTIMATOR_ENTRY(popops, MultiUpdateAdd, FLOAT, false),
       CYCLE_ESTIMATOR_ENTRY(popops, MultiUpdateAdd, INT, false),
       CYCLE_ESTIMATOR_ENTRY(popops, MultiUpdateAdd, UNSIGNED_INT, false),
+      CYCLE_ESTIMATOR_ENTRY(popops, MultiUpdateOp, HALF, Operation::MUL),
+      CYCLE_ESTIMATOR_ENTRY(popops, MultiUpdateOp, HALF, Operation::MIN),
+      CYCLE_ESTIMATOR_ENTRY(popops, MultiUpdateOp, HALF, Operation::MAX),
+      CYCLE_ESTIMATOR_ENTRY(popops, MultiUpdateOp, FLOAT, Operation::MUL),
+      CYCLE_ESTIMATOR_ENTRY(popops, MultiUpdateOp, FLOAT, Operation::MIN),
+      CYCLE_ESTIMATOR_ENTRY(popops, MultiUpdateOp, FLOAT, Operation::MAX),
+      CYCLE_ESTIMATOR_ENTRY(popops, MultiUpdateOp, INT, Operation::MUL),
+      CYCLE_ESTIMATOR_ENTRY(popops, MultiUpdateOp, INT, Operation::MIN),
+      CYCLE_ESTIMATOR_ENTRY(popops, MultiUpdateOp, INT, Operation::MAX),
+      CYCLE_ESTIMATOR_ENTRY(popops, MultiUpdateOp, UNSIGNED_INT,
+                            Operation::MUL),
+      CYCLE_ESTIMATOR_ENTRY(popops, MultiUpdateOp, UNSIGNED_INT,
+                            Operation::MIN),
+      CYCLE_ESTIMATOR_ENTRY(popops, MultiUpdateOp, UNSIGNED_INT,
+                            Operation::MAX),
 
       CYCLE_ESTIMATOR_ENTRY_NOPARAMS(popops, CircBufIncrIndex),
       CYCLE_ESTIMATOR_ENTRY_NOPARAMS(popops, CircOffset),
@@ -2667,6 +2775,9 @@ poplibs::CycleEstimatorTable makeCyclesFunctionTable() {
       CYCLE_ESTIMATOR_ENTRY(popops, Histogram2D, FLOAT, false),
       CYCLE_ESTIMATOR_ENTRY(popops, Histogram2D, HALF, false),
 
+      CYCLE_ESTIMATOR_ENTRY(popops, HistogramByExponent2D, FLOAT),
+      CYCLE_ESTIMATOR_ENTRY(popops, HistogramByExponent2D, HALF),
+
       CYCLE_ESTIMATOR_ENTRY(popops, HistogramSupervisor, FLOAT, true, true),
       CYCLE_ESTIMATOR_ENTRY(popops, HistogramSupervisor, HALF, true, true),
       CYCLE_ESTIMATOR_ENTRY(popops, HistogramSupervisor, FLOAT, false, true),
@@ -2747,11 +2858,26 @@ poplibs::CycleEstimatorTable makeCyclesFunctionTable() {
       CYCLE_ESTIMATOR_ENTRY(popops, SelectFromIntervals, HALF),
       CYCLE_ESTIMATOR_ENTRY(popops, SelectFromRowsInColumns, HALF),
 
+      CYCLE_ESTIMATOR_ENTRY(popops, GradientStatistics2D, FLOAT),
+      CYCLE_ESTIMATOR_ENTRY(popops, GradientStatistics2D, HALF),
       CYCLE_ESTIMATOR_ENTRY(popops, HasNaN, FLOAT),
       CYCLE_ESTIMATOR_ENTRY(popops, HasNaN, HALF),
       CYCLE_ESTIMATOR_ENTRY(popops, HasNaNSupervisor, FLOAT),
       CYCLE_ESTIMATOR_ENTRY(popops, HasNaNSupervisor, HALF),
 
+      CYCLE_ESTIMATOR_ENTRY(popops, MomentumUpdate, FLOAT, FLOAT),
+      CYCLE_ESTIMATOR_ENTRY(popops, MomentumUpdate, HALF, FLOAT),
+      CYCLE_ESTIMATOR_ENTRY(popops, MomentumUpdate, HALF, HALF),
+      CYCLE_ESTIMATOR_ENTRY(popops, AdamUpdate, FLOAT, FLOAT),
+      CYCLE_ESTIMATOR_ENTRY(popops, AdamUpdate, HALF, FLOAT),
+      CYCLE_ESTIMATOR_ENTRY(popops, AdamUpdate, HALF, HALF),
+      CYCLE_ESTIMATOR_ENTRY(popops, LambUpdateMoments, FLOAT, FLOAT),
+      CYCLE_ESTIMATOR_ENTRY(popops, LambUpdateMoments, HALF, FLOAT),
+      CYCLE_ESTIMATOR_ENTRY(popops, LambUpdateMoments, HALF, HALF),
+      CYCLE_ESTIMATOR_ENTRY(popops, LambUpdateWeights, FLOAT, FLOAT),
+      CYCLE_ESTIMATOR_ENTRY(popops, LambUpdateWeights, HALF, FLOAT),
+      CYCLE_ESTIMATOR_ENTRY(popops, LambUpdateWeights, HALF, HALF),
+
       CYCLE_ESTIMATOR_ENTRY(popops, Transpose2d, FLOAT),
       CYCLE_ESTIMATOR_ENTRY(popops, Transpose2d, UNSIGNED_INT),
       CYCLE_ESTIMATOR_ENTRY(popops, Transpose2d, INT),
@@ -17,6 +17,8 @@ public:
   virtual float partitionGraph(const HyperGraphData &graphData, int nPartition,
                                std::vector<int> &nodeAssignment) override;
 
+  virtual std::string getName() const override { return "balanced"; }
+
 public:
   static void partition(const std::vector<float> &nodeW, int nPartition,
                         std::vector<int> &nodeAssignment);
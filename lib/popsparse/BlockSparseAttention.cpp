@@ -0,0 +1,520 @@
+// Copyright (c) 2020 Graphcore Ltd. All rights reserved.
+
+#include "BSMatrix.hpp"
+#include "CachedPartitioner.hpp"
+#include "HyperGraphBlockPinned.hpp"
+#include "MultilevelPartitioner.hpp"
+#include "ZoltanPartitioner.hpp"
+#include "popsparse/experimental/BlockSparseMatMul.hpp"
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <poplibs_support/logging.hpp>
+#include <popops/Cast.hpp>
+#include <popops/ElementWise.hpp>
+#include <popops/Rearrange.hpp>
+#include <popops/Reduce.hpp>
+#include <poputil/DebugInfo.hpp>
+#include <poputil/OptionParsing.hpp>
+#include <poputil/exceptions.hpp>
+#include <string>
+#include <tuple>
+
+namespace logging = poplibs_support::logging;
+
+namespace poputil {
+template <>
+poplar::ProfileValue
+toProfileValue(const popsparse::experimental::SubBlockMask &t);
+} // namespace poputil
+
+namespace popsparse {
+namespace experimental {
+
+namespace {
+
+constexpr float minHalfValue = -65504.0f;
+constexpr float minFloatValue = -3.4028235e+38f;
+
+void parseAttentionOptions(const poplar::OptionFlags &options,
+                           std::string &partitionCacheDir,
+                           std::string &hypergraphPartitioner) {
+  using poplibs::OptionHandler;
+  using poplibs::OptionSpec;
+  const OptionSpec attentionSpec{
+      {"partitionCacheDir",
+       OptionHandler::createWithString(partitionCacheDir)},
+      {"hypergraphPartitioner",
+       OptionHandler::createWithEnum(hypergraphPartitioner,
+                                     {{"zoltan", "zoltan"},
+                                      {"multilevel", "multilevel"}})},
+  };
+  for (const auto &entry : options) {
+    attentionSpec.parse(entry.first, entry.second);
+  }
+}
+
+// Assigns the query block rows of one group to tiles. The nodes of the
+// hypergraph are the block rows, weighted by their number of non zero blocks,
+// and each block column is a hyperedge joining the block rows that read its
+// key and value blocks, so the cut is the number of key and value blocks
+// exchanged.
+std::vector<unsigned> partitionBlockRows(const unsigned char *sparsity,
+                                         unsigned blockRows, unsigned blockCols,
+                                         unsigned numTiles,
+                                         HyperGraphPartitioner &partitioner) {
+  HyperGraphData graphData;
+  graphData.nodes = blockRows;
+  for (unsigned r = 0; r < blockRows; ++r) {
+    const auto nz = std::count_if(sparsity + r * blockCols,
+                                  sparsity + (r + 1) * blockCols,
+                                  [](unsigned char s) { return s != 0; });
+    graphData.weights.push_back(std::max<float>(nz, 1.0f));
+  }
+  for (unsigned c = 0; c < blockCols; ++c) {
+    std::vector<unsigned> rows;
+    for (unsigned r = 0; r < blockRows; ++r) {
+      if (sparsity[r * blockCols + c]) {
+        rows.push_back(r);
+      }
+    }
+    if (rows.size() > 1) {
+      graphData.hyperEdges.push_back(graphData.pins.size());
+      graphData.pins.insert(graphData.pins.end(), rows.begin(), rows.end());
+    }
+  }
+
+  // Parts are spread evenly over the tiles when there are fewer block rows
+  // than tiles
+  const unsigned nPartition = std::min(numTiles, blockRows);
+  std::vector<int> assignment;
+  const float balance =
+      partitioner.partitionGraph(graphData, nPartition, assignment);
+  logging::popsparse::debug("Attention block rows: {}, parts: {}, balance: {}",
+                            blockRows, nPartition, balance);
+
+  std::vector<unsigned> tiles(blockRows);
+  for (unsigned r = 0; r < blockRows; ++r) {
+    tiles[r] = static_cast<unsigned>(assignment[r]) * numTiles / nPartition;
+  }
+  return tiles;
+}
+
+// Computes the softmax of each row of the block-sparse scores, in place.
+// The blocks of a block row are all on the tile of the block row, so every
+// reduction and element-wise op runs where the data is.
+void softmaxInPlace(poplar::Graph &graph,
+                    const std::vector<poplar::Tensor> &scores,
+                    const std::vector<std::vector<unsigned>> &rowTiles,
+                    unsigned blockRow, unsigned blockCol, unsigned blockRows,
+                    unsigned blockCols,
+                    const std::vector<unsigned char> &sparsity,
+                    SubBlockMask subBlockMask, poplar::program::Sequence &prog,
+                    const poplar::DebugNameAndId &dnai) {
+  const std::string layer = "softmax";
+  const auto dataType = scores[0].elementType();
+  const float minValue = dataType == poplar::FLOAT ? minFloatValue
+                                                    : minHalfValue;
+  const unsigned blockArea = blockRow * blockCol;
+
+  struct Row {
+    poplar::Tensor values;
+    unsigned tile;
+  };
+  // Block rows, grouped by their number of non zero blocks
+  std::map<unsigned, std::vector<Row>> rowsByLength;
+
+  std::vector<poplar::Tensor> maskedBlocks, zeroMasks, minValueMasks;
+  // Constant masks, by diagonal offset, tile and masked value
+  std::map<std::tuple<int, unsigned, bool>, poplar::Tensor> maskPool;
+  const auto getMask = [&](int offset, unsigned tile, bool asMinValue) {
+    const auto key = std::make_tuple(offset, tile, asMinValue);
+    auto iter = maskPool.find(key);
+    if (iter != maskPool.end()) {
+      return iter->second;
+    }
+    std::vector<float> values(blockArea);
+    for (int i = 0, idx = 0; i < static_cast<int>(blockRow); ++i) {
+      for (int j = 0; j < static_cast<int>(blockCol); ++j, ++idx) {
+        const bool masked = subBlockMask == SubBlockMask::ZeroUpperTriangle
+                                ? j - offset > i
+                                : j - offset < i;
+        values[idx] = asMinValue ? (masked ? minValue : 0.0f)
+                                 : (masked ? 0.0f : 1.0f);
+      }
+    }
+    auto mask = graph.addConstant(dataType, {1, blockArea}, values.data(),
+                                  {dnai, layer + "/mask"});
+    graph.setTileMapping(mask, tile);
+    maskPool.emplace(key, mask);
+    return mask;
+  };
+
+  bool hasEmptyRows = false;
+  const unsigned numGroups = scores.size();
+  for (unsigned g = 0; g < numGroups; ++g) {
+    const unsigned char *groupSparsity =
+        sparsity.data() + g * blockRows * blockCols;
+    unsigned idxBlock = 0;
+    for (unsigned r = 0; r < blockRows; ++r) {
+      const unsigned tile = rowTiles[g][r];
+      const unsigned top = r * blockRow, bottom = top + blockRow;
+      std::vector<poplar::Tensor> blocks;
+      unsigned firstCol = blockCols * blockCol, lastCol = 0;
+      for (unsigned c = 0; c < blockCols; ++c) {
+        if (!groupSparsity[r * blockCols + c]) {
+          continue;
+        }
+        const auto block = scores[g][idxBlock++];
+        blocks.push_back(block.reshape({blockRow, blockCol}));
+        const unsigned left = c * blockCol, right = left + blockCol;
+        firstCol = std::min(firstCol, left);
+        lastCol = std::max(lastCol, right - 1);
+        if (subBlockMask == SubBlockMask::None) {
+          continue;
+        }
+        if (left < bottom && right > top) {
+          const int offset = static_cast<int>(top) - static_cast<int>(left);
+          maskedBlocks.push_back(block.expand({0}));
+          zeroMasks.push_back(getMask(offset, tile, false));
+          minValueMasks.push_back(getMask(offset, tile, true));
+        } else if ((left >= bottom &&
+                    subBlockMask == SubBlockMask::ZeroUpperTriangle) ||
+                   (right <= top &&
+                    subBlockMask == SubBlockMask::ZeroLowerTriangle)) {
+          throw poputil::poplibs_error(
+              "Incorrect sparsity mask is provided. The whole block [" +
+              std::to_string(r) + "," + std::to_string(c) +
+              "] of group " + std::to_string(g) + " is masked out");
+        }
+      }
+      if (blocks.empty()) {
+        continue;
+      }
+      // A row with every element masked gets the uniform distribution from
+      // the softmax, and is zeroed by the mask afterwards
+      if ((subBlockMask == SubBlockMask::ZeroUpperTriangle &&
+           firstCol > top) ||
+          (subBlockMask == SubBlockMask::ZeroLowerTriangle &&
+           lastCol < bottom - 1)) {
+        hasEmptyRows = true;
+      }
+      rowsByLength[blocks.size()].push_back(
+          {poplar::concat(blocks, 1), tile});
+    }
+  }
+
+  poplar::Tensor maskedFlat, zeroMaskFlat;
+  if (!maskedBlocks.empty()) {
+    maskedFlat = poplar::concat(maskedBlocks);
+    zeroMaskFlat = poplar::concat(zeroMasks);
+    // unchanged_element * 1 + 0 = unchanged_element
+    // changed_element * 0 + minValue = minValue
+    popops::mulInPlace(graph, maskedFlat, zeroMaskFlat, prog,
+                       {dnai, layer + "/subBlockZeroMasked"});
+    popops::addInPlace(graph, maskedFlat, poplar::concat(minValueMasks), prog,
+                       {dnai, layer + "/subBlockMinValueMasked"});
+  }
+
+  if (rowsByLength.empty()) {
+    return;
+  }
+
+  // The values of the rows of each length, and the maxima and sums of the
+  // rows mapped to the tiles of the rows
+  std::vector<poplar::Tensor> values, maxima, sums;
+  for (const auto &entry : rowsByLength) {
+    std::vector<poplar::Tensor> rows;
+    for (const auto &row : entry.second) {
+      rows.push_back(row.values);
+    }
+    values.push_back(poplar::concat(rows));
+    const std::size_t numRows = entry.second.size() * blockRow;
+    maxima.push_back(
+        graph.addVariable(dataType, {numRows}, {dnai, layer + "/max"}));
+    sums.push_back(
+        graph.addVariable(poplar::FLOAT, {numRows}, {dnai, layer + "/sum"}));
+    for (std::size_t i = 0; i < entry.second.size(); ++i) {
+      const auto begin = i * blockRow, end = begin + blockRow;
+      graph.setTileMapping(maxima.back().slice(begin, end),
+                           entry.second[i].tile);
+      graph.setTileMapping(sums.back().slice(begin, end),
+                           entry.second[i].tile);
+    }
+  }
+
+  std::vector<poplar::ComputeSet> css;
+  for (std::size_t i = 0; i < values.size(); ++i) {
+    popops::reduceWithOutput(graph, values[i], maxima[i], {1},
+                             popops::Operation::MAX, css, {dnai, layer});
+  }
+  for (const auto &cs : css) {
+    prog.add(poplar::program::Execute(cs, {dnai}));
+  }
+
+  const auto broadcastFlat = [&](const std::vector<poplar::Tensor> &perRow) {
+    std::vector<poplar::Tensor> flat;
+    for (std::size_t i = 0; i < values.size(); ++i) {
+      flat.push_back(
+          perRow[i].expand({1}).broadcast(values[i].dim(1), 1).flatten());
+    }
+    return poplar::concat(flat);
+  };
+  std::vector<poplar::Tensor> valuesFlatVec;
+  for (const auto &v : values) {
+    valuesFlatVec.push_back(v.flatten());
+  }
+  const auto valuesFlat = poplar::concat(valuesFlatVec);
+
+  popops::subInPlace(graph, valuesFlat, broadcastFlat(maxima), prog,
+                     {dnai, layer});
+  popops::expInPlace(graph, valuesFlat, prog, {dnai, layer});
+
+  css.clear();
+  for (std::size_t i = 0; i < values.size(); ++i) {
+    popops::reduceWithOutput(graph, values[i], sums[i], {1},
+                             popops::Operation::ADD, css, {dnai, layer});
+  }
+  for (const auto &cs : css) {
+    prog.add(poplar::program::Execute(cs, {dnai}));
+  }
+
+  auto sumsFlat = poplar::concat(sums);
+  popops::invInPlace(graph, sumsFlat, prog, {dnai, layer});
+  if (dataType != poplar::FLOAT) {
+    sumsFlat = popops::cast(graph, sumsFlat, dataType, prog, {dnai, layer});
+  }
+  std::vector<poplar::Tensor> oneOverSums;
+  for (std::size_t i = 0, begin = 0; i < sums.size(); ++i) {
+    oneOverSums.push_back(sumsFlat.slice(begin, begin + sums[i].dim(0)));
+    begin += sums[i].dim(0);
+  }
+  popops::mulInPlace(graph, valuesFlat, broadcastFlat(oneOverSums), prog,
+                     {dnai, layer});
+
+  if (hasEmptyRows) {
+    popops::mulInPlace(graph, maskedFlat, zeroMaskFlat, prog,
+                       {dnai, layer + "/emptyRows"});
+  }
+}
+
+} // end anonymous namespace
+
+poplar::Tensor bsAttention(poplar::Graph &graph, const poplar::Tensor &queryIn,
+                           const poplar::Tensor &keyIn,
+                           const poplar::Tensor &valueIn,
+                           const std::array<int, 3> &blockSize,
+                           const std::vector<unsigned char> &sparsity,
+                           SubBlockMask subBlockMask, unsigned numGroups,
+                           poplar::program::Sequence &prog,
+                           const poplar::OptionFlags &options,
+                           const poplar::DebugContext &debugContext) {
+  poputil::PoplibsOpDebugInfo di(
+      debugContext, DI_ARGS(queryIn, keyIn, valueIn, blockSize, sparsity,
+                            subBlockMask, numGroups, options));
+  const std::string layer = "bsAttention";
+
+  if (queryIn.rank() != 2 || keyIn.rank() != 2 || valueIn.rank() != 2) {
+    throw poputil::poplibs_error(
+        "The rank of the query, key and value matrices must be 2");
+  }
+  const auto dataType = queryIn.elementType();
+  if (dataType != poplar::FLOAT && dataType != poplar::HALF) {
+    throw poputil::poplibs_error("Only FLOAT and HALF types are supported");
+  }
+  if (keyIn.elementType() != dataType || valueIn.elementType() != dataType) {
+    throw poputil::poplibs_error(
+        "The query, key and value matrices must have the same type");
+  }
+  if (numGroups == 0) {
+    throw poputil::poplibs_error("Input error: zero number of groups.");
+  }
+  if (queryIn.dim(0) % numGroups != 0 || keyIn.dim(0) % numGroups != 0) {
+    throw poputil::poplibs_error(
+        "The rows of the query and key matrices are not divisible by the "
+        "number of groups " +
+        std::to_string(numGroups));
+  }
+  if (keyIn.dim(1) != queryIn.dim(1) || valueIn.dim(0) != keyIn.dim(0)) {
+    throw poputil::poplibs_error(
+        "The key matrix must have the columns of the query matrix and the "
+        "rows of the value matrix");
+  }
+  for (auto b : blockSize) {
+    if (b <= 0) {
+      throw poputil::poplibs_error("Block dimension cannot be zero");
+    }
+  }
+
+  const int seqQ = queryIn.dim(0) / numGroups;
+  const int seqK = keyIn.dim(0) / numGroups;
+  const int depth = queryIn.dim(1);
+  const int depthV = valueIn.dim(1);
+  const int blockQ = blockSize[0], blockD = blockSize[1],
+            blockK = blockSize[2];
+  // The depth and key rows are the input channels of the block
+  // multiplications, and the query rows the output channels of the second one
+  const int inChansPerGroup = dataType == poplar::HALF ? 16 : 8;
+  if (blockD % inChansPerGroup != 0 || blockK % inChansPerGroup != 0 ||
+      blockQ % 2 != 0) {
+    throw poputil::poplibs_error(
+        "Input error: the block sizes of the depth and of the key rows must "
+        "be multiples of " +
+        std::to_string(inChansPerGroup) +
+        " and the block size of the query rows must be even");
+  }
+  if (seqQ % blockQ != 0 || seqK % blockK != 0 || depth % blockD != 0 ||
+      depthV % blockD != 0) {
+    throw poputil::poplibs_error(
+        "Input error: the query, key and value matrices are not divisible by "
+        "the block size");
+  }
+  const unsigned blockRows = seqQ / blockQ;
+  const unsigned blockCols = seqK / blockK;
+  if (sparsity.size() != numGroups * blockRows * blockCols) {
+    throw poputil::poplibs_error(
+        "Input error: sparsity mask size " + std::to_string(sparsity.size()) +
+        " does not match total number of blocks: " +
+        std::to_string(numGroups * blockRows * blockCols));
+  }
+
+  logging::popsparse::info(
+      "bsAttention: query {} x {}, key {} x {}, value {} x {}, block: {} x {} "
+      "x {}, {} group(s)",
+      seqQ, depth, seqK, depth, seqK, depthV, blockQ, blockD, blockK,
+      numGroups);
+
+  std::string partitionCacheDir;
+  std::string hypergraphPartitioner = "zoltan";
+  parseAttentionOptions(options, partitionCacheDir, hypergraphPartitioner);
+  std::unique_ptr<HyperGraphPartitioner> basePartitioner;
+  if (hypergraphPartitioner == "multilevel") {
+    basePartitioner = std::make_unique<MultilevelPartitioner>();
+  } else {
+    basePartitioner = std::make_unique<ZoltanPartitioner>(
+        ZoltanPartitioner::PartitionType::HYPERGRAPH);
+  }
+  CachedPartitioner partitioner(std::move(basePartitioner), partitionCacheDir);
+
+  // Each group runs on its own range of tiles, as for grouped bsMatMul
+  const unsigned numTilesTotal = graph.getTarget().getTilesPerIPU();
+  const unsigned numTilesPerGroupLow = numTilesTotal / numGroups;
+  const unsigned numTilesPerGroupLeftover = numTilesTotal % numGroups;
+
+  std::vector<unsigned> groupLowerTile(numGroups), groupNumTiles(numGroups);
+  const auto getSubGraph = [&](unsigned g) {
+    return graph.createVirtualGraph(groupLowerTile[g],
+                                    groupLowerTile[g] + groupNumTiles[g]);
+  };
+  std::vector<std::vector<unsigned>> localTiles(numGroups), rowTiles(numGroups);
+  std::vector<std::unique_ptr<BlockMatrix>> matrices;
+  std::vector<std::unique_ptr<HyperGraph>> scoresGraphs, outGraphs;
+  for (unsigned g = 0, idxLowerTile = 0; g < numGroups; ++g) {
+    const unsigned numTiles = (g < numTilesPerGroupLeftover)
+                                  ? numTilesPerGroupLow + 1
+                                  : numTilesPerGroupLow;
+    groupLowerTile[g] = idxLowerTile;
+    groupNumTiles[g] = numTiles;
+    poplar::Graph subGraph = getSubGraph(g);
+    const unsigned char *groupSparsity =
+        sparsity.data() + g * blockRows * blockCols;
+
+    // The block rows of the scores, and so the block columns of the
+    // transposed output, are pinned to the same tiles
+    localTiles[g] = partitionBlockRows(groupSparsity, blockRows, blockCols,
+                                       numTiles, partitioner);
+    for (auto tile : localTiles[g]) {
+      rowTiles[g].push_back(idxLowerTile + tile);
+    }
+
+    // scores = query * key^T, sparsified
+    matrices.emplace_back(
+        new BlockDenseMatrix(seqQ, depth, blockQ, blockD, false));
+    auto &queryMatrix = *matrices.back();
+    matrices.emplace_back(
+        new BlockDenseMatrix(depth, seqK, blockD, blockK, false));
+    auto &keyMatrix = *matrices.back();
+    scoresGraphs.emplace_back(new HyperGraphBlockPinned(
+        queryMatrix, keyMatrix, dataType, dataType, poplar::FLOAT, numTiles,
+        HyperGraphBlockPinned::PinnedDim::ROW, localTiles[g]));
+    scoresGraphs.back()->createGraphMatMulSparsifyResult(
+        subGraph, groupSparsity, {di, layer + "/scores"});
+
+    // output^T = value^T * softmax(scores)^T
+    matrices.emplace_back(
+        new BlockDenseMatrix(depthV, seqK, blockD, blockK, false));
+    auto &valueMatrix = *matrices.back();
+    matrices.emplace_back(new BlockSparseMatrix(seqQ, seqK, blockQ, blockK,
+                                                true, groupSparsity));
+    auto &probsMatrix = *matrices.back();
+    outGraphs.emplace_back(new HyperGraphBlockPinned(
+        valueMatrix, probsMatrix, dataType, dataType, poplar::FLOAT, numTiles,
+        HyperGraphBlockPinned::PinnedDim::COL, localTiles[g]));
+    outGraphs.back()->createGraphMatMul(subGraph, {di, layer + "/output"});
+
+    idxLowerTile += numTiles;
+  }
+
+  const int groupSize = dataType == poplar::HALF ? 16 : 8;
+  const auto query = popops::rearrange::regroupIfBeneficial(
+      graph, queryIn, groupSize, prog, {di, layer + "/regroup-query"});
+  const auto keyT = popops::rearrange::regroupIfBeneficial(
+      graph, keyIn.transpose(), groupSize, prog, {di, layer + "/regroup-key"});
+  const auto valueT = popops::rearrange::regroupIfBeneficial(
+      graph, valueIn.transpose(), groupSize, prog,
+      {di, layer + "/regroup-value"});
+
+  // 1. scores
+  std::vector<poplar::Tensor> scores;
+  {
+    poplar::ComputeSet transposeCS =
+        graph.addComputeSet({di, layer + "/scores/transposeCS"});
+    prog.add(poplar::program::Execute(transposeCS, {di}));
+    poplar::ComputeSet mulCS =
+        graph.addComputeSet({di, layer + "/scores/mulCS"});
+    poplar::ComputeSet reduceCS =
+        graph.addComputeSet({di, layer + "/scores/reduceCS"});
+    for (unsigned g = 0; g < numGroups; ++g) {
+      auto *hg = scoresGraphs[g].get();
+      hg->matA.setBlockTensor(query.slice(g * seqQ, (g + 1) * seqQ, 0));
+      hg->matB.setBlockTensor(keyT.slice(g * seqK, (g + 1) * seqK, 1));
+      poplar::Graph subGraph = getSubGraph(g);
+      hg->createProgramMatMul(subGraph, &transposeCS, mulCS, reduceCS,
+                              prog, {di, layer + "/scores"});
+      scores.push_back(hg->getResultTensor());
+    }
+    prog.add(poplar::program::Execute(mulCS, {di}));
+    prog.add(poplar::program::Execute(reduceCS, {di}));
+  }
+
+  // 2. softmax, where the scores are
+  softmaxInPlace(graph, scores, rowTiles, blockQ, blockK, blockRows,
+                 blockCols, sparsity, subBlockMask, prog, {di});
+
+  // 3. output
+  std::vector<poplar::Tensor> outputs;
+  {
+    poplar::ComputeSet mulCS =
+        graph.addComputeSet({di, layer + "/output/mulCS"});
+    poplar::ComputeSet reduceCS =
+        graph.addComputeSet({di, layer + "/output/reduceCS"});
+    for (unsigned g = 0; g < numGroups; ++g) {
+      auto *hg = outGraphs[g].get();
+      hg->matA.setBlockTensor(valueT.slice(g * seqK, (g + 1) * seqK, 1));
+      hg->matB.setBlockTensor(scores[g]);
+      poplar::Graph subGraph = getSubGraph(g);
+      hg->createProgramMatMul(subGraph, nullptr, mulCS, reduceCS, prog,
+                              {di, layer + "/output"});
+      outputs.push_back(hg->getResultTensor().transpose());
+    }
+    prog.add(poplar::program::Execute(mulCS, {di}));
+    prog.add(poplar::program::Execute(reduceCS, {di}));
+  }
+
+  auto output = poplar::concat(outputs);
+  di.addOutput(output);
+  return output;
+}
+
+} // namespace experimental
+} // namespace popsparse
@@ -3,18 +3,23 @@
 #include "popsparse/experimental/BlockSparseMatMul.hpp"
 #include "BSMatrix.hpp"
 #include "BSOps.hpp"
+#include "CachedPartitioner.hpp"
 #include "HyperGraphBlockGroup2.hpp"
 #include "HyperGraphBlockNaive.hpp"
 #include "HyperGraphBlockZoltan.hpp"
 #include "HyperGraphStrip.hpp"
 #include "HyperGraphStripV0.hpp"
+#include "MultilevelPartitioner.hpp"
+#include <boost/optional.hpp>
 #include <iostream>
+#include <limits>
 #include <memory>
 #include <poplibs_support/logging.hpp>
 #include <popops/Rearrange.hpp>
 #include <poputil/DebugInfo.hpp>
 #include <poputil/OptionParsing.hpp>
 #include <poputil/exceptions.hpp>
+#include <tbb/parallel_for.h>
 
 namespace logging = poplibs_support::logging;
 
@@ -196,13 +201,21 @@ BSMatMulParams::~BSMatMulParams() = default;
 
 static void parseOptions(const poplar::OptionFlags &options,
                          double &memoryCycleRatio, int &nPass,
-                         std::string &partitionMethod) {
+                         std::string &partitionMethod,
+                         std::string &partitionCacheDir,
+                         std::string &hypergraphPartitioner) {
   using poplibs::OptionHandler;
   using poplibs::OptionSpec;
   const OptionSpec bsSpec{
       {"memoryCycleRatio", OptionHandler::createWithDouble(memoryCycleRatio)},
       {"numberOfPass", OptionHandler::createWithInteger(nPass)},
       {"partitionMethod", OptionHandler::createWithString(partitionMethod)},
+      {"partitionCacheDir",
+       OptionHandler::createWithString(partitionCacheDir)},
+      {"hypergraphPartitioner",
+       OptionHandler::createWithEnum(hypergraphPartitioner,
+                                     {{"zoltan", "zoltan"},
+                                      {"multilevel", "multilevel"}})},
   };
   for (const auto &entry : options) {
     bsSpec.parse(entry.first, entry.second);
@@ -215,7 +228,10 @@ void BSMatMulImpl::createPartitionPlan(poplar::Graph &graph,
   double memoryCycleRatio = 0.2;
   int nPass = 1;
   std::string partitionMethod = std::string("strip");
-  parseOptions(options, memoryCycleRatio, nPass, partitionMethod);
+  std::string partitionCacheDir;
+  std::string hypergraphPartitioner = "zoltan";
+  parseOptions(options, memoryCycleRatio, nPass, partitionMethod,
+               partitionCacheDir, hypergraphPartitioner);
 
   if (nPass > 1 && numGroups > 1) {
     throw poputil::poplibs_error(
@@ -228,6 +244,7 @@ void BSMatMulImpl::createPartitionPlan(poplar::Graph &graph,
     BLOCK,
     BLOCK_NAIVE,
     BLOCK_GROUP2,
+    AUTO,
   };
 
   PartitionMethod pm = PartitionMethod::STRIP;
@@ -243,6 +260,8 @@ void BSMatMulImpl::createPartitionPlan(poplar::Graph &graph,
     pm = PartitionMethod::STRIPV0;
   } else if (partitionMethod.compare("strip") == 0) {
     pm = PartitionMethod::STRIP;
+  } else if (partitionMethod.compare("auto") == 0) {
+    pm = PartitionMethod::AUTO;
   } else {
     logging::popsparse::warn(
         "Unknown partition method {}. Default method strip will be used.",
@@ -282,11 +301,12 @@ void BSMatMulImpl::createPartitionPlan(poplar::Graph &graph,
                              1.0 - (float)nonZeros / (float)blocks);
   }
 
-  std::function<HyperGraph *(BlockMatrix &, BlockMatrix &, unsigned int)>
-      createHyperGraph = [&](BlockMatrix &lhs, BlockMatrix &rhs,
-                             unsigned int numTiles) {
+  std::function<HyperGraph *(PartitionMethod, BlockMatrix &, BlockMatrix &,
+                             unsigned int)>
+      createHyperGraph = [&](PartitionMethod method, BlockMatrix &lhs,
+                             BlockMatrix &rhs, unsigned int numTiles) {
         HyperGraph *hg;
-        switch (pm) {
+        switch (method) {
         case (PartitionMethod::BLOCK):
           hg = new HyperGraphBlockZoltan(lhs, rhs, inDataType, outDataType,
                                          partialDataType, numTiles,
@@ -309,10 +329,101 @@ void BSMatMulImpl::createPartitionPlan(poplar::Graph &graph,
                                    partialDataType, numTiles, nPass);
           break;
         };
+        if (hg->partitioner && hypergraphPartitioner == "multilevel") {
+          hg->partitioner = std::make_unique<MultilevelPartitioner>();
+        }
+        // Reuse the partitions of identical hypergraphs
+        if (hg->partitioner) {
+          hg->partitioner = std::make_unique<CachedPartitioner>(
+              std::move(hg->partitioner), partitionCacheDir);
+        }
         return hg;
       };
 
   const std::string layer = "bsMatMul";
+  // Partition of the first group chosen by the automatic method
+  std::unique_ptr<HyperGraph> autoHyperGraph;
+  if (pm == PartitionMethod::AUTO) {
+    // Partition the first group with each candidate method on a scratch
+    // graph, in parallel, and use the method with the lowest cost for every
+    // group. The estimates of maximum memory and block multiplications per
+    // tile are normalised by the best candidate and weighted like the nodes
+    // of the block partitioner. Partitioning only depends on the target of
+    // the graph, so the partition of the chosen method is kept for the first
+    // group.
+    const std::vector<std::pair<PartitionMethod, std::string>> candidates = {
+        {PartitionMethod::STRIP, "strip"},
+        {PartitionMethod::BLOCK, "block"},
+        {PartitionMethod::BLOCK_NAIVE, "block-naive"},
+        {PartitionMethod::BLOCK_GROUP2, "block-group2"},
+    };
+    const unsigned numTilesTotal = graph.getTarget().getTilesPerIPU();
+    const unsigned numTiles =
+        numTilesTotal / numGroups + (numTilesTotal % numGroups ? 1 : 0);
+    std::vector<boost::optional<HyperGraph::PartitionCost>> costs(
+        candidates.size());
+    std::vector<std::unique_ptr<HyperGraph>> candidateGraphs(candidates.size());
+    tbb::parallel_for(std::size_t(0), candidates.size(), [&](std::size_t i) {
+      poplar::Graph scratchGraph(graph.getTarget());
+      std::unique_ptr<HyperGraph> hg(createHyperGraph(
+          candidates[i].first, *lhsMatrices[0], *rhsMatrices[0], numTiles));
+      try {
+        if (!isResSparse) {
+          hg->createGraphMatMul(scratchGraph, {dnai, layer});
+        } else {
+          hg->createGraphMatMulSparsifyResult(scratchGraph, resSparsity.data(),
+                                              {dnai, layer});
+        }
+        costs[i] = hg->getPartitionCost();
+        candidateGraphs[i] = std::move(hg);
+      } catch (const poputil::poplibs_error &e) {
+        logging::popsparse::debug("Partition method {} is not applicable: {}",
+                                  candidates[i].second, e.what());
+      }
+    });
+
+    std::size_t minMuls = std::numeric_limits<std::size_t>::max();
+    std::size_t minBytes = std::numeric_limits<std::size_t>::max();
+    for (const auto &cost : costs) {
+      if (cost) {
+        minMuls =
+            std::min(minMuls, std::max<std::size_t>(cost->maxMulsPerTile, 1));
+        minBytes =
+            std::min(minBytes, std::max<std::size_t>(cost->maxBytesPerTile, 1));
+      }
+    }
+    pm = PartitionMethod::STRIP;
+    std::string chosen = "strip";
+    double bestScore = std::numeric_limits<double>::max();
+    std::size_t best = 0;
+    for (std::size_t i = 0; i < candidates.size(); ++i) {
+      if (!costs[i]) {
+        continue;
+      }
+      const double score =
+          memoryCycleRatio * costs[i]->maxBytesPerTile / minBytes +
+          (1.0 - memoryCycleRatio) * costs[i]->maxMulsPerTile / minMuls;
+      logging::popsparse::info(
+          "Partition method {}: max muls per tile {}, max bytes per tile {}, "
+          "score {}",
+          candidates[i].second, costs[i]->maxMulsPerTile,
+          costs[i]->maxBytesPerTile, score);
+      if (score < bestScore) {
+        bestScore = score;
+        pm = candidates[i].first;
+        chosen = candidates[i].second;
+        best = i;
+      }
+    }
+    if (bestScore == std::numeric_limits<double>::max()) {
+      logging::popsparse::warn("No partition method could be compared. "
+                               "Default method strip will be used.");
+    } else {
+      logging::popsparse::info("Partition method chosen: {}", chosen);
+      autoHyperGraph = std::move(candidateGraphs[best]);
+    }
+  }
+
   if (numGroups == 1) {
     hyperGraphs.resize(1);
 
@@ -325,16 +436,20 @@ void BSMatMulImpl::createPartitionPlan(poplar::Graph &graph,
         isResSparse ? "dds" : "dsd", lhs.getRowCount(), lhs.getColCount(),
         rhs.getColCount(), lhs.getBlockRow(), lhs.getBlockCol(),
         rhs.getBlockCol(), numTiles);
-    HyperGraph *hg = createHyperGraph(lhs, rhs, numTiles);
-
-    if (!isResSparse) {
-      hg->createGraphMatMul(graph, {dnai, layer});
+    if (autoHyperGraph) {
+      hyperGraphs[0] = std::move(autoHyperGraph);
     } else {
-      hg->createGraphMatMulSparsifyResult(graph, resSparsity.data(),
-                                          {dnai, layer});
-    }
+      HyperGraph *hg = createHyperGraph(pm, lhs, rhs, numTiles);
+
+      if (!isResSparse) {
+        hg->createGraphMatMul(graph, {dnai, layer});
+      } else {
+        hg->createGraphMatMulSparsifyResult(graph, resSparsity.data(),
+                                            {dnai, layer});
+      }
 
-    hyperGraphs[0].reset(hg);
+      hyperGraphs[0].reset(hg);
+    }
   } else {
     hyperGraphs.resize(numGroups);
 
@@ -355,19 +470,22 @@ void BSMatMulImpl::createPartitionPlan(poplar::Graph &graph,
 
       auto &lhs = *lhsMatrices[idxGroup];
       auto &rhs = *rhsMatrices[idxGroup];
-      HyperGraph *hg = createHyperGraph(lhs, rhs, numTiles);
-
-      if (!isResSparse) {
-        hg->createGraphMatMul(subGraph, {dnai, layer});
+      if (idxGroup == 0 && autoHyperGraph) {
+        hyperGraphs[idxGroup] = std::move(autoHyperGraph);
       } else {
-        hg->createGraphMatMulSparsifyResult(subGraph, sparsityBuf,
-                                            {dnai, layer});
+        HyperGraph *hg = createHyperGraph(pm, lhs, rhs, numTiles);
+
+        if (!isResSparse) {
+          hg->createGraphMatMul(subGraph, {dnai, layer});
+        } else {
+          hg->createGraphMatMulSparsifyResult(subGraph, sparsityBuf,
+                                              {dnai, layer});
+        }
+        hyperGraphs[idxGroup].reset(hg);
       }
 
       sparsityBuf += sparsitySizePerGroup;
       idxLowerTile = idxUpperTile;
-
-      hyperGraphs[idxGroup].reset(hg);
     }
   }
 }
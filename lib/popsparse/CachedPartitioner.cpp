@@ -0,0 +1,273 @@
+// Copyright (c) 2020 Graphcore Ltd. All rights reserved.
+
+#include "CachedPartitioner.hpp"
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iterator>
+#include <list>
+#include <mutex>
+#include <poplibs_support/logging.hpp>
+#include <sstream>
+#include <unistd.h>
+#include <unordered_map>
+
+namespace logging = poplibs_support::logging;
+
+namespace popsparse {
+namespace experimental {
+
+namespace {
+
+struct CacheEntry {
+  std::uint64_t key;
+  std::string name;
+  int nPartition;
+  HyperGraphData graphData;
+  std::vector<int> nodeAssignment;
+  float balance;
+};
+
+bool isSameProblem(const CacheEntry &entry, const std::string &name,
+                   const HyperGraphData &graphData, int nPartition) {
+  return entry.name == name && entry.nPartition == nPartition &&
+         entry.graphData.nodes == graphData.nodes &&
+         entry.graphData.weights == graphData.weights &&
+         entry.graphData.hyperEdges == graphData.hyperEdges &&
+         entry.graphData.pins == graphData.pins;
+}
+
+// The entries are kept most recently used first, and indexed by key.
+std::mutex cacheMutex;
+std::list<CacheEntry> memoryCache;
+std::unordered_multimap<std::uint64_t, std::list<CacheEntry>::iterator>
+    memoryCacheIndex;
+std::atomic<std::size_t> hitCount(0);
+std::atomic<std::size_t> tmpFileCount(0);
+
+// Returns the entry for the problem, made the most recently used, or nullptr.
+// cacheMutex must be held.
+const CacheEntry *findInMemory(std::uint64_t key, const std::string &name,
+                               const HyperGraphData &graphData,
+                               int nPartition) {
+  const auto range = memoryCacheIndex.equal_range(key);
+  for (auto it = range.first; it != range.second; ++it) {
+    if (isSameProblem(*it->second, name, graphData, nPartition)) {
+      memoryCache.splice(memoryCache.begin(), memoryCache, it->second);
+      return &*it->second;
+    }
+  }
+  return nullptr;
+}
+
+// Drops the least recently used entries beyond the capacity of the cache.
+// cacheMutex must be held.
+void evictFromMemory() {
+  while (memoryCache.size() > CachedPartitioner::maxMemoryCacheEntries) {
+    const auto last = std::prev(memoryCache.end());
+    const auto range = memoryCacheIndex.equal_range(last->key);
+    for (auto it = range.first; it != range.second; ++it) {
+      if (it->second == last) {
+        memoryCacheIndex.erase(it);
+        break;
+      }
+    }
+    memoryCache.erase(last);
+  }
+}
+
+// Cache file layout, in host byte order:
+// magic, version, name, nPartition, nodes, weights, hyperEdges, pins,
+// balance, node assignment
+// where the name and each vector are preceded by their number of elements.
+// The whole problem is stored so that a file whose key collides with that of
+// another problem is not mistaken for it.
+constexpr std::uint32_t fileMagic = 0x43505350;
+constexpr std::uint32_t fileVersion = 2;
+
+std::string getCacheFilePath(const std::string &cacheDir, std::uint64_t key) {
+  std::stringstream ss;
+  ss << cacheDir << "/" << std::hex << std::setw(16) << std::setfill('0')
+     << key << ".partition";
+  return ss.str();
+}
+
+template <typename T> void writeValue(std::ostream &os, const T &value) {
+  os.write(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+template <typename T> bool readValue(std::istream &is, T &value) {
+  is.read(reinterpret_cast<char *>(&value), sizeof(value));
+  return static_cast<bool>(is);
+}
+
+template <typename T>
+void writeVector(std::ostream &os, const std::vector<T> &values) {
+  writeValue(os, static_cast<std::uint32_t>(values.size()));
+  os.write(reinterpret_cast<const char *>(values.data()),
+           values.size() * sizeof(T));
+}
+
+// Reads a vector and checks that it is equal to expected.
+template <typename T>
+bool readAndCompareVector(std::istream &is, const std::vector<T> &expected) {
+  std::uint32_t size;
+  if (!readValue(is, size) || size != expected.size()) {
+    return false;
+  }
+  std::vector<T> values(size);
+  is.read(reinterpret_cast<char *>(values.data()), size * sizeof(T));
+  return static_cast<bool>(is) && values == expected;
+}
+
+bool readCacheFile(const std::string &path, const std::string &name,
+                   const HyperGraphData &graphData, int nPartition,
+                   std::vector<int> &nodeAssignment, float &balance) {
+  std::ifstream is(path, std::ios::binary);
+  if (!is) {
+    return false;
+  }
+  std::uint32_t magic, version, nodes;
+  std::int32_t parts;
+  if (!readValue(is, magic) || magic != fileMagic ||
+      !readValue(is, version) || version != fileVersion ||
+      !readAndCompareVector(is, std::vector<char>(name.begin(), name.end())) ||
+      !readValue(is, parts) || parts != nPartition ||
+      !readValue(is, nodes) || nodes != graphData.nodes ||
+      !readAndCompareVector(is, graphData.weights) ||
+      !readAndCompareVector(is, graphData.hyperEdges) ||
+      !readAndCompareVector(is, graphData.pins) || !readValue(is, balance)) {
+    return false;
+  }
+  std::vector<int> assignment(nodes);
+  for (auto &a : assignment) {
+    std::int32_t part;
+    if (!readValue(is, part) || part < 0 || part >= nPartition) {
+      return false;
+    }
+    a = part;
+  }
+  nodeAssignment = std::move(assignment);
+  return true;
+}
+
+void writeCacheFile(const std::string &path, const std::string &name,
+                    const HyperGraphData &graphData, int nPartition,
+                    const std::vector<int> &nodeAssignment, float balance) {
+  // Write to a temporary file and rename it, so that a process reading the
+  // cache never sees a partially written file. The temporary file is unique
+  // to this process and write, so concurrent writers of the same key do not
+  // interleave their output.
+  const auto tmpPath = path + "." + std::to_string(getpid()) + "." +
+                       std::to_string(tmpFileCount++) + ".tmp";
+  {
+    std::ofstream os(tmpPath, std::ios::binary | std::ios::trunc);
+    writeValue(os, fileMagic);
+    writeValue(os, fileVersion);
+    writeVector(os, std::vector<char>(name.begin(), name.end()));
+    writeValue(os, static_cast<std::int32_t>(nPartition));
+    writeValue(os, static_cast<std::uint32_t>(graphData.nodes));
+    writeVector(os, graphData.weights);
+    writeVector(os, graphData.hyperEdges);
+    writeVector(os, graphData.pins);
+    writeValue(os, balance);
+    for (auto a : nodeAssignment) {
+      writeValue(os, static_cast<std::int32_t>(a));
+    }
+    if (!os) {
+      logging::popsparse::warn("Could not write partition cache file {}",
+                               tmpPath);
+      os.close();
+      std::remove(tmpPath.c_str());
+      return;
+    }
+  }
+  if (std::rename(tmpPath.c_str(), path.c_str()) != 0) {
+    logging::popsparse::warn("Could not write partition cache file {}", path);
+    std::remove(tmpPath.c_str());
+  }
+}
+
+} // end anonymous namespace
+
+std::uint64_t CachedPartitioner::hash(const std::string &name,
+                                      const HyperGraphData &graphData,
+                                      int nPartition) {
+  // 64 bit FNV-1a
+  std::uint64_t h = 14695981039346656037ull;
+  const auto add = [&](const void *data, std::size_t size) {
+    const auto *bytes = static_cast<const unsigned char *>(data);
+    for (std::size_t i = 0; i < size; ++i) {
+      h = (h ^ bytes[i]) * 1099511628211ull;
+    }
+  };
+  add(name.data(), name.size());
+  add(&nPartition, sizeof(nPartition));
+  add(&graphData.nodes, sizeof(graphData.nodes));
+  add(graphData.weights.data(), graphData.weights.size() * sizeof(float));
+  add(graphData.hyperEdges.data(),
+      graphData.hyperEdges.size() * sizeof(unsigned int));
+  add(graphData.pins.data(), graphData.pins.size() * sizeof(unsigned int));
+  return h;
+}
+
+float CachedPartitioner::partitionGraph(const HyperGraphData &graphData,
+                                        int nPartition,
+                                        std::vector<int> &nodeAssignment) {
+  const auto name = getName();
+  const auto key = hash(name, graphData, nPartition);
+
+  {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    if (const auto *entry = findInMemory(key, name, graphData, nPartition)) {
+      logging::popsparse::debug("Partition of {} nodes into {} parts by {} "
+                                "found in memory",
+                                graphData.nodes, nPartition, name);
+      ++hitCount;
+      nodeAssignment = entry->nodeAssignment;
+      return entry->balance;
+    }
+  }
+
+  float balance;
+  bool found = false;
+  const auto path = cacheDir.empty() ? "" : getCacheFilePath(cacheDir, key);
+  if (!path.empty() && readCacheFile(path, name, graphData, nPartition,
+                                     nodeAssignment, balance)) {
+    logging::popsparse::debug("Partition of {} nodes into {} parts by {} "
+                              "read from {}",
+                              graphData.nodes, nPartition, name, path);
+    ++hitCount;
+    found = true;
+  }
+  if (!found) {
+    balance =
+        partitioner->partitionGraph(graphData, nPartition, nodeAssignment);
+    if (!path.empty()) {
+      writeCacheFile(path, name, graphData, nPartition, nodeAssignment,
+                     balance);
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(cacheMutex);
+  // Another thread may have partitioned the same problem meanwhile.
+  if (!findInMemory(key, name, graphData, nPartition)) {
+    memoryCache.push_front(
+        CacheEntry{key, name, nPartition, graphData, nodeAssignment, balance});
+    memoryCacheIndex.emplace(key, memoryCache.begin());
+    evictFromMemory();
+  }
+  return balance;
+}
+
+std::size_t CachedPartitioner::getHitCount() { return hitCount; }
+
+void CachedPartitioner::clearMemoryCache() {
+  std::lock_guard<std::mutex> lock(cacheMutex);
+  memoryCacheIndex.clear();
+  memoryCache.clear();
+}
+
+} // namespace experimental
+} // namespace popsparse
@@ -0,0 +1,68 @@
+// Copyright (c) 2020 Graphcore Ltd. All rights reserved.
+
+#ifndef popsparse_CachedPartitioner_hpp
+#define popsparse_CachedPartitioner_hpp
+
+#include "HyperGraphPartitioner.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace popsparse {
+namespace experimental {
+
+/*
+A partitioner that reuses the partitions made by another one.
+
+The hypergraph of a block-sparse matmul is a function of its dimensions,
+block size, sparsity mask, options and number of tiles, so a partition is
+looked up by a hash of the hypergraph, the number of partitions and the name
+of the wrapped partitioner, and the whole problem is compared on a match.
+Up to maxMemoryCacheEntries partitions are kept in memory, dropping the least
+recently used, and shared between all block-sparse matmuls, so layers with
+the same sparsity mask are partitioned once.
+
+If cacheDir is not empty, partitions are also read from and written to files
+in that directory, so they are reused by later runs. Each file holds the
+whole problem, which is compared before its partition is used.
+*/
+class CachedPartitioner : public HyperGraphPartitioner {
+public:
+  CachedPartitioner(std::unique_ptr<HyperGraphPartitioner> partitionerIn,
+                    std::string cacheDirIn = "")
+      : partitioner(std::move(partitionerIn)), cacheDir(std::move(cacheDirIn)) {
+  }
+
+  virtual ~CachedPartitioner() = default;
+
+  virtual float partitionGraph(const HyperGraphData &graphData, int nPartition,
+                               std::vector<int> &nodeAssignment) override;
+
+  virtual std::string getName() const override {
+    return partitioner->getName();
+  }
+
+  // Number of partitions kept in memory
+  static constexpr std::size_t maxMemoryCacheEntries = 64;
+
+  // Hash of a partitioning problem, used to key the cache
+  static std::uint64_t hash(const std::string &name,
+                            const HyperGraphData &graphData, int nPartition);
+
+  // Number of partitions served from the cache, in memory or on disk, by all
+  // cached partitioners since the process started
+  static std::size_t getHitCount();
+
+  // Drops every partition held in memory
+  static void clearMemoryCache();
+
+private:
+  std::unique_ptr<HyperGraphPartitioner> partitioner;
+  std::string cacheDir;
+};
+
+} // namespace experimental
+} // namespace popsparse
+
+#endif
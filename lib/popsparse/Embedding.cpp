@@ -416,6 +416,10 @@ fullyconnected::Plan getFullyConnectedPlan(Graph &graph, Type inputType,
   fullyconnected::Cost cost;
   std::tie(plan, cost) =
       fullyconnected::getPlan(target, inputType, params, optionFlags, cache);
+  if (plan.useDense) {
+    throw poputil::poplibs_error("Sparse embedding does not support weights "
+                                 "held densely (allowDenseFallback)");
+  }
   return plan;
 }
 
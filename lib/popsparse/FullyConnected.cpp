@@ -34,6 +34,9 @@
 #include "poplibs_support/VectorUtils.hpp"
 #include "poplibs_support/logging.hpp"
 
+#include <algorithm>
+#include <numeric>
+
 using namespace poplar;
 using namespace poplar::program;
 using namespace poplibs_support;
@@ -2520,6 +2523,106 @@ fullyConnectedDenseGradWSerialSplits(const Graph &graph, const Type &inputType,
       matMulOptions);
 }
 
+// When the plan uses a dense matrix multiply the non-zero values hold all the
+// weights densely in row-major {G, O, I} order and the meta-info is a mask of
+// the sparsity pattern with one bit per block, blocks in row-major order.
+static std::size_t getNumDenseBlocks(const FullyConnectedParams &params) {
+  const auto &blockDims = params.getSparsityParams().blockDimensions;
+  return params.getNumGroups() *
+         (params.getOutputChannelsPerGroup() / blockDims[0]) *
+         (params.getInputChannelsPerGroup() / blockDims[1]);
+}
+
+static Tensor getDenseWeights(const Tensor &nzValues,
+                              const FullyConnectedParams &params) {
+  return nzValues.reshape({params.getNumGroups(),
+                           params.getOutputChannelsPerGroup(),
+                           params.getInputChannelsPerGroup()});
+}
+
+static SparseTensor createDenseWeights(Graph &graph, const Type &inputType,
+                                       const FullyConnectedParams &params,
+                                       const Options &options,
+                                       const DebugNameAndId &dnai) {
+  const auto &target = graph.getTarget();
+  const std::vector<std::size_t> aShape = {params.getNumGroups(),
+                                           params.getBatchSize(),
+                                           params.getInputChannelsPerGroup()};
+  const std::vector<std::size_t> bShape = {params.getNumGroups(),
+                                           params.getInputChannelsPerGroup(),
+                                           params.getOutputChannelsPerGroup()};
+  const auto nzValues =
+      poplin::createMatMulGroupedInputRHS(graph, inputType, inputType, aShape,
+                                          bShape, {dnai, "nzValues"},
+                                          getDenseMatMulOptions(options))
+          .dimShuffle({0, 2, 1})
+          .flatten();
+  const auto metaInfo = graph.addVariable(
+      UNSIGNED_SHORT,
+      {getNumDenseMaskElems(target.getTypeSize(UNSIGNED_SHORT) * 8,
+                            getNumDenseBlocks(params))},
+      {dnai, "metaInfo"});
+  mapTensorLinearly(graph, metaInfo);
+
+  std::unique_ptr<TensorMetaDataBase> opMetaData =
+      std::make_unique<FullyConnectedTensorMetaData>(params, options);
+  return SparseTensor(metaInfo, nzValues, std::move(opMetaData));
+}
+
+// Zero the elements of dense weights {G, O, I} which are outside the sparsity
+// pattern given by the mask.
+static void applyDenseMask(Graph &graph, const Tensor &weights,
+                           const Tensor &mask,
+                           const FullyConnectedParams &params, Sequence &prog,
+                           const DebugNameAndId &dnai) {
+  const auto &blockDims = params.getSparsityParams().blockDimensions;
+  const auto numGroups = params.getNumGroups();
+  const auto numRowBlocks = params.getOutputChannelsPerGroup() / blockDims[0];
+  const auto numColumnBlocks =
+      params.getInputChannelsPerGroup() / blockDims[1];
+  const auto numBlocks = numGroups * numRowBlocks * numColumnBlocks;
+  const auto bitsPerElem = graph.getTarget().getTypeSize(UNSIGNED_SHORT) * 8;
+
+  // Extract the bit of each block from the mask. Each tile holding part of
+  // the mask gets its own copy of the shifts for the words it holds.
+  std::vector<unsigned> shifts(bitsPerElem);
+  std::iota(shifts.begin(), shifts.end(), 0u);
+  const auto maskWords = mask.flatten();
+  const auto maskMapping = graph.getTileMapping(maskWords);
+  std::vector<Tensor> wordShifts(maskWords.numElements());
+  for (unsigned tile = 0; tile != maskMapping.size(); ++tile) {
+    if (maskMapping[tile].empty()) {
+      continue;
+    }
+    const auto tileShifts = graph.addConstant(
+        UNSIGNED_INT, {bitsPerElem}, shifts.data(), {dnai, "maskShifts"});
+    graph.setTileMapping(tileShifts, tile);
+    for (const auto &interval : maskMapping[tile]) {
+      std::fill(wordShifts.begin() + interval.begin(),
+                wordShifts.begin() + interval.end(), tileShifts);
+    }
+  }
+  const auto blockWords = maskWords.expand({1})
+                              .broadcast(bitsPerElem, 1)
+                              .flatten()
+                              .slice(0, numBlocks);
+  const auto blockShifts = concat(wordShifts).slice(0, numBlocks);
+  using namespace popops::expr;
+  const auto blockMask = popops::map(
+      graph,
+      Cast(BitwiseAnd(Shr(Cast(_1, UNSIGNED_INT), _2), Const(1u)),
+           weights.elementType()),
+      {blockWords, blockShifts}, prog, {dnai, "blockMask"});
+
+  popops::mulInPlace(
+      graph, weights,
+      blockMask.reshape({numGroups, numRowBlocks, 1, numColumnBlocks, 1})
+          .broadcast(blockDims[0], 2)
+          .broadcast(blockDims[1], 4)
+          .reshape(weights.shape()),
+      prog, {dnai, "applyMask"});
+}
+
 SparseTensor createFullyConnectedWeights(
     Graph &graph, const Type &inputType, const FullyConnectedParams &params,
     const poplar::DebugContext &debugContext, const OptionFlags &optionFlags,
@@ -2536,6 +2639,9 @@ SparseTensor createFullyConnectedWeights(
   Cost cost;
   std::tie(plan, cost) =
       getPlan(graph.getTarget(), inputType, params, optionFlags, cache);
+  if (plan.useDense) {
+    return createDenseWeights(graph, inputType, params, options, {di});
+  }
   const auto &target = graph.getTarget();
   const auto hierarchy = poplibs::getTileHierarchy(target);
 
@@ -2603,6 +2709,18 @@ Tensor createFullyConnectedInput(Graph &graph, const Type &inputType,
   Cost cost;
   std::tie(plan, cost) =
       getPlan(graph.getTarget(), inputType, params, optionFlags, cache);
+  if (plan.useDense) {
+    const auto input =
+        poplin::createMatMulGroupedInputLHS(
+            graph, inputType, inputType,
+            {params.getNumGroups(), params.getBatchSize(),
+             params.getInputChannelsPerGroup()},
+            {params.getNumGroups(), params.getInputChannelsPerGroup(),
+             params.getOutputChannelsPerGroup()},
+            {di}, getDenseMatMulOptions(options))
+            .dimShuffle({0, 2, 1});
+    return inputInternalToExternalShape(input, params.getNumGroups());
+  }
   const auto &target = graph.getTarget();
   const auto hierarchy = poplibs::getTileHierarchy(target);
 
@@ -2684,6 +2802,16 @@ Tensor fullyConnectedFwd(Graph &graph, const SparseTensor &weights,
       static_cast<unsigned>(params.getBatchSize())};
   const auto input = inputExternalToInternalShape(activations, shape.groups);
 
+  if (plan.useDense) {
+    const auto weightsDense =
+        getDenseWeights(weights.getNzValuesTensor(), params);
+    const auto outputActivations = poplin::matMulGrouped(
+        graph, input.dimShuffle({0, 2, 1}), weightsDense.dimShuffle({0, 2, 1}),
+        prog, inputType, {di}, getDenseMatMulOptions(options));
+    return inputInternalToExternalShape(outputActivations.dimShuffle({0, 2, 1}),
+                                        shape.groups);
+  }
+
   const auto overflowInfoElems = getNumOverflowInfoElems(
       target.getTypeSize(UNSIGNED_SHORT), plan.partition.x, plan.partition.y,
       plan.partition.z);
@@ -2739,6 +2867,16 @@ Tensor fullyConnectedGradA(Graph &graph, const SparseTensor &weights,
 
   const auto input = inputExternalToInternalShape(activations, shape.groups);
 
+  if (plan.useDense) {
+    const auto weightsDense =
+        getDenseWeights(weights.getNzValuesTensor(), params);
+    const auto inputGradients = poplin::matMulGrouped(
+        graph, input.dimShuffle({0, 2, 1}), weightsDense, prog, inputType,
+        {di}, getDenseMatMulOptions(options));
+    return inputInternalToExternalShape(inputGradients.dimShuffle({0, 2, 1}),
+                                        shape.groups);
+  }
+
   const auto overflowInfoElems = getNumOverflowInfoElems(
       target.getTypeSize(UNSIGNED_SHORT), plan.partition.x, plan.partition.y,
       plan.partition.z);
@@ -2819,6 +2957,15 @@ Tensor fullyConnectedSparseGradW(Graph &graph, const Tensor sparsityMetaInfo,
       inputExternalToInternalShape(activations, shape.groups).dimRoll(1, 2);
   const auto outputGrad = inputExternalToInternalShape(gradA, shape.groups);
 
+  if (plan.useDense) {
+    const auto weightGradients =
+        poplin::matMulGrouped(graph, outputGrad, input, prog, inputType, {di},
+                              getDenseMatMulOptions(options));
+    applyDenseMask(graph, weightGradients, sparsityMetaInfo, params, prog,
+                   {di});
+    return weightGradients.flatten();
+  }
+
   const auto overflowInfoElems = getNumOverflowInfoElems(
       target.getTypeSize(UNSIGNED_SHORT), plan.partition.x, plan.partition.y,
       plan.partition.z);
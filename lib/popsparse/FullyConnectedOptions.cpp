@@ -25,6 +25,7 @@ std::ostream &operator<<(std::ostream &os, const Options &o) {
      << ",\n sharedBuckets: " << o.sharedBuckets
      << ",\n enableGradWStructuredRearrangements: "
      << o.enableStructuredRearrangements
+     << ",\n allowDenseFallback: " << o.allowDenseFallback
      << ",\n partitioner.optimiseForSpeed: " << o.partitioner.optimiseForSpeed
      << ",\n partitioner.forceBucketSpills: " << o.partitioner.forceBucketSpills
      << ",\n partitioner.useActualWorkerSplitCosts: "
@@ -91,6 +92,8 @@ struct ValidatePlanConstraintsOption {
         validatePlanConstraintsExchange(child.first, child.second);
       } else if (child.first == "partition") {
         validatePlanConstraintsPartition(child.first, child.second);
+      } else if (child.first == "useDense") {
+        validatePlanConstraintsBoolean(child.first, child.second);
       } else {
         throw poplar::invalid_option(
             child.first + " is not currently handled or does not exist");
@@ -122,6 +125,8 @@ Options parseOptionFlags(const OptionFlags &flags) {
       {"sharedBuckets", OptionHandler::createWithBool(options.sharedBuckets)},
       {"enableStructuredRearrangements",
        OptionHandler::createWithBool(options.enableStructuredRearrangements)},
+      {"allowDenseFallback",
+       OptionHandler::createWithBool(options.allowDenseFallback)},
       {"partitioner.optimiseForSpeed",
        OptionHandler::createWithBool(options.partitioner.optimiseForSpeed)},
       {"partitioner.forceBucketSpills",
@@ -137,11 +142,20 @@ Options parseOptionFlags(const OptionFlags &flags) {
   return options;
 }
 
+poplar::OptionFlags getDenseMatMulOptions(const Options &options) {
+  return poplar::OptionFlags{
+      {"availableMemoryProportion",
+       std::to_string(options.availableMemoryProportion)},
+      {"partialsType", options.partialsType.toString()},
+      {"fullyConnectedPass", "NONE"}};
+}
+
 static constexpr auto optionsHelper = poplibs_support::makeStructHelper(
     &Options::availableMemoryProportion,
     &Options::metaInfoBucketOversizeProportion, &Options::doGradAPass,
     &Options::doGradWPass, &Options::partialsType, &Options::sharedBuckets,
-    &Options::enableStructuredRearrangements, &Options::partitioner);
+    &Options::enableStructuredRearrangements, &Options::allowDenseFallback,
+    &Options::partitioner);
 
 bool operator<(const Options &a, const Options &b) {
   return optionsHelper.lt(a, b);
@@ -34,6 +34,9 @@ struct Options {
   bool sharedBuckets = true;
   // Enable structured rearrangements
   bool enableStructuredRearrangements = true;
+  // If set, the weights may be held densely and the layer implemented with
+  // dense matrix multiplications when that is estimated to be faster.
+  bool allowDenseFallback = false;
   PartitionerOptions partitioner;
   // Constraints on the plan used
   poplibs_support::PlanConstraints planConstraints;
@@ -46,6 +49,10 @@ struct Options {
 
 Options parseOptionFlags(const poplar::OptionFlags &flags);
 
+// Options for the dense matrix multiplications used to implement the layer
+// when the weights are held densely.
+poplar::OptionFlags getDenseMatMulOptions(const Options &options);
+
 } // end namespace fullyconnected
 } // end namespace popsparse
 
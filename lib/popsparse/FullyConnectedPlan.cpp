@@ -20,6 +20,10 @@
 #include "PlanningCacheImpl.hpp"
 #include "popsparse/FullyConnected.hpp"
 
+// Internal includes from other poplibs libraries
+#include "MatMulInternal.hpp"
+
+#include <algorithm>
 #include <map>
 #include <utility>
 #include <vector>
@@ -1927,6 +1931,47 @@ createPlan(const PlanningObjective &objective, const Target &target,
   return std::make_tuple(best, bestCost, bestCostBreakdown);
 }
 
+// Estimated cost of implementing all the passes of the layer with dense
+// matrix multiplications, with the weights held densely. The memory is that
+// of the largest pass plus the dense weights, spread over all tiles, which
+// are live across every pass. The cost of masking the gradient of the
+// weights is small in comparison and is not included.
+static Cost getDenseCost(const Target &target, const Type &inputType,
+                         const FullyConnectedParams &params,
+                         const Options &options) {
+  const std::size_t numGroups = params.getNumGroups();
+  const std::size_t batchSize = params.getBatchSize();
+  const std::size_t inputChannels = params.getInputChannelsPerGroup();
+  const std::size_t outputChannels = params.getOutputChannelsPerGroup();
+  using Shape = std::vector<std::size_t>;
+  std::vector<std::pair<Shape, Shape>> passes = {
+      {{numGroups, batchSize, inputChannels},
+       {numGroups, inputChannels, outputChannels}}};
+  if (options.doGradAPass) {
+    passes.push_back({{numGroups, batchSize, outputChannels},
+                      {numGroups, outputChannels, inputChannels}});
+  }
+  if (options.doGradWPass) {
+    passes.push_back({{numGroups, outputChannels, batchSize},
+                      {numGroups, batchSize, inputChannels}});
+  }
+
+  const auto matMulOptions = getDenseMatMulOptions(options);
+  Cost cost(popsolver::DataType{0}, popsolver::DataType{0});
+  for (const auto &pass : passes) {
+    const auto passCost = poplin::groupedMatMulEstimatedCost(
+        target, inputType, inputType, pass.first, pass.second, matMulOptions);
+    cost.cycles += popsolver::DataType{passCost.first};
+    cost.tempBytes =
+        std::max(cost.tempBytes, popsolver::DataType{passCost.second});
+  }
+  const std::size_t weightBytes = numGroups * inputChannels * outputChannels *
+                                  target.getTypeSize(inputType);
+  cost.tempBytes +=
+      popsolver::DataType{ceildiv(weightBytes, target.getNumTiles())};
+  return cost;
+}
+
 static std::tuple<Plan, Cost> runPlanner(const Target &target,
                                          const Type &inputType,
                                          const FullyConnectedParams &params,
@@ -1987,6 +2032,29 @@ static std::tuple<Plan, Cost> runPlanner(const Target &target,
   logging::popsparse::debug("  for params:\n{}", params);
   logging::popsparse::debug("  and input type: {}", inputType);
   logging::popsparse::debug("  with options:\n{}", options);
+
+  // The dense weights are laid out as a single matrix so only one group is
+  // supported. The dense plan must be faster and fit in the per-tile memory
+  // limit, or at least need no more memory than the sparse plan when that
+  // does not fit either. A useDense plan constraint overrides the comparison.
+  if (options.allowDenseFallback && params.getNumGroups() == 1) {
+    const auto denseCost = getDenseCost(target, inputType, params, options);
+    logging::popsparse::debug("Estimated cost of the equivalent dense matrix "
+                              "multiply: {}.",
+                              denseCost);
+    const bool denseFits =
+        availableTileMem == 0 ||
+        denseCost.tempBytes < popsolver::DataType{availableTileMem} ||
+        denseCost.tempBytes <= cost.tempBytes;
+    const auto useDenseConstraint =
+        options.planConstraints.get_optional<bool>("useDense");
+    if (useDenseConstraint ? *useDenseConstraint
+                           : denseFits && denseCost.cycles < cost.cycles) {
+      logging::popsparse::debug("Using a dense matrix multiply.");
+      plan.useDense = true;
+      cost = denseCost;
+    }
+  }
   logging::popsparse::debug("{}", plan);
 
   return std::make_tuple(std::move(plan), std::move(cost));
@@ -2065,7 +2133,8 @@ std::ostream &operator<<(std::ostream &os, const Plan &p) {
      << "\n  no. of meta-info elements per bucket (forward): "
      << p.fwdMetaInfoElemsPerBucket
      << "\n  no. of meta-info elements per bucket (grad-a): "
-     << p.gradAMetaInfoElemsPerBucket << "\n";
+     << p.gradAMetaInfoElemsPerBucket
+     << "\n  use dense matrix multiply: " << p.useDense << "\n";
   return os;
 }
 
@@ -119,6 +119,9 @@ struct Plan {
   unsigned fwdMetaInfoElemsPerBucket;
   // Number of meta-info elements per bucket (GradA pass).
   unsigned gradAMetaInfoElemsPerBucket;
+  // If set, the weights are held densely and all passes are implemented as
+  // dense matrix multiplications. The rest of the plan is then unused.
+  bool useDense = false;
   // returns true if the same bucket is shared between passes
   bool sharedBuckets() const {
     return method.gradA == OnTileMethod::Transpose ||
@@ -165,6 +165,11 @@ std::size_t getNumOverflowInfoElems(std::size_t metaInfoTypeBits,
   return 3 + poplibs_support::ceildiv(xSplits, metaInfoTypeBits);
 }
 
+std::size_t getNumDenseMaskElems(std::size_t metaInfoTypeBits,
+                                 std::size_t numBlocks) {
+  return poplibs_support::ceildiv(numBlocks, metaInfoTypeBits);
+}
+
 std::vector<Tile>
 splitTileBetweenWorkers(std::size_t numRows, std::size_t numColumns,
                         std::size_t numWorkers,
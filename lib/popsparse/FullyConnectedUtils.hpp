@@ -71,6 +71,11 @@ std::size_t getNumOverflowInfoElems(std::size_t metaInfoTypeBits,
                                     std::size_t xSplits, std::size_t ySplits,
                                     std::size_t zSplits);
 
+// Get the number of meta-info elements of the mask describing the sparsity
+// pattern when the weights are held densely. There is one bit per block.
+std::size_t getNumDenseMaskElems(std::size_t metaInfoTypeBits,
+                                 std::size_t numBlocks);
+
 // Splits the work for the output tile given by size 'numRows' x 'numColumns'.
 // The work is split at most across a given number of workers. 'rowWeights' is
 //  'numRows' sized vector  that computes the number of non zero elements in
@@ -68,6 +68,18 @@ public:
   virtual void setTileMappingRHS(poplar::Graph &graph,
                                  poplar::Tensor &rhsTensor) = 0;
 
+  // Estimated cost of the partition made by createGraphMatMul() or
+  // createGraphMatMulSparsifyResult(), used to compare partition methods
+  struct PartitionCost {
+    // The largest number of block multiplications on a tile
+    std::size_t maxMulsPerTile = 0;
+    // The largest number of bytes of blocks and partials on a tile
+    std::size_t maxBytesPerTile = 0;
+  };
+
+  // Gets the estimated cost of the partition
+  virtual PartitionCost getPartitionCost() const = 0;
+
   // Gets output matmul tensor result
   poplar::Tensor getResultTensor() const;
 
@@ -507,29 +507,8 @@ void HyperGraphBlock::mapCNodes(poplar::Graph &graph) {
   nodeCTileId.resize(nodeC.size());
   const std::vector<poplar::Tensor> &blockDataC = matC->getBlockTensor();
   for (std::size_t i = 0; i < nodeC.size(); i++) {
-    // Put node C in the tile that most of children are located
-    std::map<int, int> tileMap;
-    for (std::size_t v = 0; v < edgeC[i].in.size(); v++) {
-      unsigned int idV = edgeC[i].in[v];
-      if (tileAssignment[idV] < 0) {
-        throw poputil::poplibs_error(
-            "Invalid tile id: " + std::to_string(tileAssignment[idV]) +
-            "For nodeV");
-      }
-      unsigned int tileId = static_cast<unsigned int>(tileAssignment[idV]);
-      ++tileMap[tileId];
-    }
-
-    unsigned int tileId;
-    int max = -1;
-    for (const auto &t : tileMap) {
-      if (max < t.second) {
-        max = t.second;
-        tileId = t.first;
-      }
-    }
-
-    if (max == -1) {
+    int tileId = getCNodeTile(i);
+    if (tileId == -1) {
       // This node does not have any input, so it is zero block
       // put it on a random tile
       tileId = getRandomTile(nTile);
@@ -542,6 +521,30 @@ void HyperGraphBlock::mapCNodes(poplar::Graph &graph) {
   }
 }
 
+int HyperGraphBlock::getCNodeTile(std::size_t idx) const {
+  // Put node C in the tile that most of children are located
+  std::map<int, int> tileMap;
+  for (std::size_t v = 0; v < edgeC[idx].in.size(); v++) {
+    unsigned int idV = edgeC[idx].in[v];
+    if (tileAssignment[idV] < 0) {
+      throw poputil::poplibs_error(
+          "Invalid tile id: " + std::to_string(tileAssignment[idV]) +
+          "For nodeV");
+    }
+    ++tileMap[tileAssignment[idV]];
+  }
+
+  int tileId = -1;
+  int max = -1;
+  for (const auto &t : tileMap) {
+    if (max < t.second) {
+      max = t.second;
+      tileId = t.first;
+    }
+  }
+  return tileId;
+}
+
 void HyperGraphBlock::createComputeSetReduce(
     poplar::Graph &graph,
     const std::map<unsigned int, poplar::Tensor> &partialDataIn,
@@ -1052,8 +1055,25 @@ void HyperGraphBlock::logTileAssignment(
   }
 }
 
+HyperGraph::PartitionCost HyperGraphBlock::getPartitionCost() const {
+  MemoryStatistics stats;
+  computeBytesByTile(stats);
+
+  std::vector<std::size_t> mulsByTile(nTile, 0);
+  for (const auto &n : nodeV) {
+    const int idxTile = tileAssignment[n.id];
+    assert(idxTile >= 0 && idxTile < nTile);
+    mulsByTile[idxTile] += n.idxA.size();
+  }
+
+  PartitionCost cost;
+  cost.maxMulsPerTile = *std::max_element(mulsByTile.begin(), mulsByTile.end());
+  cost.maxBytesPerTile = stats.maxBytesOnTile;
+  return cost;
+}
+
 void HyperGraphBlock::computeBytesByTile(
-    HyperGraphBlock::MemoryStatistics &stats) {
+    HyperGraphBlock::MemoryStatistics &stats) const {
   stats.bytesAByTiles.resize(nTile, 0);
   stats.bytesBByTiles.resize(nTile, 0);
   stats.bytesVaByTiles.resize(nTile, 0);
@@ -1080,10 +1100,17 @@ void HyperGraphBlock::computeBytesByTile(
   const int memWeightV =
       matC->getBlockRow() * matC->getBlockCol() * partialDataTypeSize;
 
+  // Before the program is created the nodes C are not mapped yet, so they are
+  // counted on the tiles mapCNodes() will put them on. Zero blocks go on a
+  // random tile, counted as tile 0.
   std::unordered_map<unsigned int, int> tileAssignmentC;
   for (std::size_t i = 0; i < nodeC.size(); ++i) {
     const auto &n = nodeC[i];
-    tileAssignmentC[n.id] = nodeCTileId[i];
+    if (i < nodeCTileId.size()) {
+      tileAssignmentC[n.id] = nodeCTileId[i];
+    } else {
+      tileAssignmentC[n.id] = std::max(getCNodeTile(i), 0);
+    }
   }
 
   for (std::size_t i = 0; i < nodeA.size(); ++i) {
@@ -215,6 +215,10 @@ public:
 
   unsigned int getTotalNodes() const { return gNodeId; }
 
+  // Gets the estimated cost of the partition from the tile assignment of
+  // the nodes, with the bytes counted by computeBytesByTile()
+  PartitionCost getPartitionCost() const override;
+
   void setTileAssignment(std::vector<int> &tileAssignmentIn) {
     tileAssignment = tileAssignmentIn;
   }
@@ -272,6 +276,10 @@ protected:
   // Map C nodes to tiles after partitioning
   virtual void mapCNodes(poplar::Graph &graph);
 
+  // Gets the tile mapCNodes() puts the node C with the given index on, or -1
+  // if it has no inputs and goes on a random tile
+  virtual int getCNodeTile(std::size_t idx) const;
+
   // Logs tile assignment
   virtual void logTileAssignment(const std::vector<int> &tileAssignment);
 
@@ -297,7 +305,7 @@ protected:
   };
 
   // Computes estimated data breakdowh per each tile
-  void computeBytesByTile(MemoryStatistics &stats);
+  void computeBytesByTile(MemoryStatistics &stats) const;
 };
 
 static const float KBf = 1024.0f;
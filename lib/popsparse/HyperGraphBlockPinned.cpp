@@ -0,0 +1,131 @@
+// Copyright (c) 2020 Graphcore Ltd. All rights reserved.
+
+#include "HyperGraphBlockPinned.hpp"
+#include <algorithm>
+#include <cassert>
+#include <limits>
+#include <poplibs_support/logging.hpp>
+#include <poputil/exceptions.hpp>
+
+namespace logging = poplibs_support::logging;
+
+namespace popsparse {
+namespace experimental {
+
+HyperGraphBlockPinned::HyperGraphBlockPinned(
+    BlockMatrix &A, BlockMatrix &B, poplar::Type inDataTypeIn,
+    poplar::Type outDataTypeIn, poplar::Type partialDataTypeIn, int nTileIn,
+    PinnedDim pinnedDimIn, std::vector<unsigned> pinnedTilesIn)
+    : HyperGraphBlock(A, B, inDataTypeIn, outDataTypeIn, partialDataTypeIn,
+                      nTileIn),
+      pinnedDim(pinnedDimIn), pinnedTiles(std::move(pinnedTilesIn)) {
+  for (auto tile : pinnedTiles) {
+    if (tile >= static_cast<unsigned>(nTile)) {
+      throw poputil::poplibs_error("Invalid pinned tile id: " +
+                                   std::to_string(tile));
+    }
+  }
+  logging::popsparse::info("HyperGraphBlockPinned is created");
+}
+
+void HyperGraphBlockPinned::populateNodesV(
+    int nRowC, int nColC, const std::vector<std::vector<int>> &blockIdMatrixC) {
+  const int nColA = matA.getBlockColCount();
+
+  nodeVLayout.resize(
+      nRowC, std::vector<std::unordered_map<unsigned, std::size_t>>(nColC));
+
+  for (int i = 0; i < nRowC; i++) {
+    for (int j = 0; j < nColC; j++) {
+      if (blockIdMatrixC[i][j] == -1) {
+        continue;
+      }
+      std::vector<std::pair<unsigned int, unsigned int>> aList, bList;
+      for (int k = 0; k < nColA; k++) {
+        if (blockIdMatrixA[i][k] == -1 || blockIdMatrixB[k][j] == -1) {
+          continue;
+        }
+        aList.push_back(std::make_pair(i, k));
+        bList.push_back(std::make_pair(k, j));
+      }
+      if (!aList.empty()) {
+        populateNodeV(i, j, 0, aList, bList);
+      }
+    }
+  }
+}
+
+void HyperGraphBlockPinned::partitionGraph() {
+  const bool pinRows = pinnedDim == PinnedDim::ROW;
+  const std::size_t nPinned =
+      pinRows ? matC->getBlockRowCount() : matC->getBlockColCount();
+  if (pinnedTiles.size() != nPinned) {
+    throw poputil::poplibs_error(
+        "Number of pinned tiles " + std::to_string(pinnedTiles.size()) +
+        " does not match the number of result block " +
+        (pinRows ? "rows " : "columns ") + std::to_string(nPinned));
+  }
+
+  tileAssignment.assign(gNodeId, -1);
+  // Number of input blocks on each tile
+  std::vector<std::size_t> blocksOnTile(nTile, 0);
+
+  for (const auto &n : nodeV) {
+    tileAssignment[n.id] = pinnedTiles[pinRows ? n.blockRow : n.blockCol];
+  }
+  for (const auto &n : nodeC) {
+    tileAssignment[n.id] = pinnedTiles[pinRows ? n.blockRow : n.blockCol];
+  }
+
+  // A block row of A is a block row of C, a block column of B is a block
+  // column of C
+  const auto &pinnedNodes = pinRows ? nodeA : nodeB;
+  for (const auto &n : pinnedNodes) {
+    const unsigned tile = pinnedTiles[pinRows ? n.blockRow : n.blockCol];
+    tileAssignment[n.id] = tile;
+    ++blocksOnTile[tile];
+  }
+
+  // Put each block of the other input on the least loaded tile that uses it
+  const auto &otherNodes = pinRows ? nodeB : nodeA;
+  const auto &otherEdges = pinRows ? edgeB : edgeA;
+  assert(otherNodes.size() == otherEdges.size());
+  for (std::size_t i = 0; i < otherNodes.size(); ++i) {
+    int bestTile = -1;
+    std::size_t bestLoad = std::numeric_limits<std::size_t>::max();
+    for (auto idV : otherEdges[i].out) {
+      const int tile = tileAssignment[idV];
+      if (blocksOnTile[tile] < bestLoad ||
+          (blocksOnTile[tile] == bestLoad && tile < bestTile)) {
+        bestLoad = blocksOnTile[tile];
+        bestTile = tile;
+      }
+    }
+    if (bestTile < 0) {
+      // Not used by any node V
+      bestTile = static_cast<int>(
+          std::min_element(blocksOnTile.begin(), blocksOnTile.end()) -
+          blocksOnTile.begin());
+    }
+    tileAssignment[otherNodes[i].id] = bestTile;
+    ++blocksOnTile[bestTile];
+  }
+}
+
+void HyperGraphBlockPinned::mapCNodes(poplar::Graph &graph) {
+  nodeCTileId.resize(nodeC.size());
+  const std::vector<poplar::Tensor> &blockDataC = matC->getBlockTensor();
+  for (std::size_t i = 0; i < nodeC.size(); i++) {
+    // Blocks without any input are zeroed on their pinned tile too
+    const unsigned tileId = static_cast<unsigned>(getCNodeTile(i));
+    graph.setTileMapping(blockDataC[nodeC[i].blockId], tileId);
+    nodeCTileId[i] = tileId;
+  }
+}
+
+int HyperGraphBlockPinned::getCNodeTile(std::size_t idx) const {
+  return tileAssignment[nodeC[idx].id];
+}
+
+} // namespace experimental
+} // namespace popsparse
@@ -0,0 +1,58 @@
+// Copyright (c) 2020 Graphcore Ltd. All rights reserved.
+
+#ifndef popsparse_HyperGraphBlockPinned_hpp
+#define popsparse_HyperGraphBlockPinned_hpp
+
+#include "HyperGraphBlock.hpp"
+
+namespace popsparse {
+namespace experimental {
+
+/*
+This class maps a block matmul to tiles given in advance for the block rows
+or the block columns of the result, instead of partitioning the hypergraph.
+Each block of the result is computed by a single node V on the tile of its
+row (or column), together with the blocks of A in that row (or the blocks of
+B in that column). The blocks of the other input are put on the least loaded
+tile that uses them.
+
+It lets several block matmuls, and the element-wise ops and reductions
+between them, share one layout so that their intermediate results never
+leave the tile that produced them.
+*/
+class HyperGraphBlockPinned : public HyperGraphBlock {
+public:
+  enum class PinnedDim { ROW, COL };
+
+  HyperGraphBlockPinned(BlockMatrix &A, BlockMatrix &B,
+                        poplar::Type inDataTypeIn, poplar::Type outDataTypeIn,
+                        poplar::Type partialDataTypeIn, int nTileIn,
+                        PinnedDim pinnedDimIn,
+                        std::vector<unsigned> pinnedTilesIn);
+
+  virtual ~HyperGraphBlockPinned() = default;
+
+protected:
+  virtual void partitionGraph() override;
+
+  // Creates one node V for each non zero block of the result
+  virtual void
+  populateNodesV(int nRowC, int nColC,
+                 const std::vector<std::vector<int>> &blockIdMatrixC) override;
+
+  // Maps each block of the result to the tile of its row or column
+  virtual void mapCNodes(poplar::Graph &graph) override;
+
+  // Gets the pinned tile of the block of the result
+  virtual int getCNodeTile(std::size_t idx) const override;
+
+private:
+  PinnedDim pinnedDim;
+  // Tile of each block row or block column of the result
+  std::vector<unsigned> pinnedTiles;
+};
+
+} // namespace experimental
+} // namespace popsparse
+
+#endif
@@ -3,6 +3,7 @@
 #ifndef popsparse_HyperGraphPartitioner_hpp
 #define popsparse_HyperGraphPartitioner_hpp
 
+#include <string>
 #include <vector>
 
 namespace popsparse {
@@ -58,7 +59,8 @@ struct HyperGraphData {
 
 /*
 Abstract partitioner class.
-Currently implemented by Zoltan partitioner only.
+Implemented by the Zoltan, balanced and multilevel partitioners, and by the
+cached partitioner that reuses the partitions of another.
 */
 class HyperGraphPartitioner {
 public:
@@ -73,6 +75,12 @@ public:
   virtual float partitionGraph(const HyperGraphData &graphData, int nPartition,
                                std::vector<int> &partAssignment) = 0;
 
+  /*
+  Name of the partitioning algorithm and its settings. Partitioners with the
+  same name must give the same partition of the same hypergraph.
+  */
+  virtual std::string getName() const = 0;
+
   static void
   computeLoadBalance(const std::vector<float> &nodeWeight, int nPartition,
                      std::vector<int> &nodeAssignment, float &minWeight,
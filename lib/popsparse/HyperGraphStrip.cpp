@@ -10,6 +10,7 @@
 #include <popops/Zero.hpp>
 #include <poputil/exceptions.hpp>
 #include <unordered_set>
+#include <utility>
 #include <zoltan_cpp.h>
 
 #define DEBUG_INFO 0
@@ -19,6 +20,30 @@ namespace logging = poplibs_support::logging;
 namespace popsparse {
 namespace experimental {
 
+namespace {
+
+// Rows [begin, end) of slice s of nSlices of nRows rows, the first slices
+// getting one more row when the rows do not divide evenly
+std::pair<std::size_t, std::size_t> getSliceRows(int nRows, int nSlices,
+                                                 int s) {
+  const int sliceSize = nRows / nSlices;
+  const int leftOver = nRows % nSlices;
+  const std::size_t begin = s * sliceSize + std::min(s, leftOver);
+  return {begin, begin + sliceSize + (s < leftOver ? 1 : 0)};
+}
+
+// The rows of a block of a matrix in a slice
+poplar::Tensor getSliceTensor(const BlockMatrix &mat,
+                              const poplar::Tensor &block, std::size_t rowBegin,
+                              std::size_t rowEnd) {
+  const auto blockCol = static_cast<std::size_t>(mat.getBlockCol());
+  return block
+      .reshape({static_cast<std::size_t>(mat.getBlockRow()), blockCol})
+      .slice({rowBegin, 0}, {rowEnd, blockCol});
+}
+
+} // end anonymous namespace
+
 HyperGraphStrip::HyperGraphStrip(BlockMatrix &A, BlockMatrix &B,
                                  poplar::Type inDataTypeIn,
                                  poplar::Type outDataTypeIn,
@@ -81,8 +106,8 @@ void HyperGraphStrip::createGraphMatMul(poplar::Graph &graph,
   if (nSplitFactor > nTilePerGroup) {
     nSplitFactor = nTilePerGroup;
   }
-  float loadBalance = createPartitionPlan(
-      graph, matB, partitionPlan, nTilePerGroup, nSplitFactor, true, {dnai});
+  float loadBalance =
+      createPartitionPlan(matB, partitionPlan, nTilePerGroup, nSplitFactor);
 
   logging::popsparse::info("load balance: {}, nSplitFactor: {}", loadBalance,
                            nSplitFactor);
@@ -131,8 +156,8 @@ void HyperGraphStrip::createGraphMatMulSparsifyResult(
   if (nSplitFactor > matC->getBlockRowCount()) {
     nSplitFactor = matC->getBlockRowCount();
   }
-  float loadBalance = createPartitionPlan(
-      graph, *matC, partitionPlan, nTilePerGroup, nSplitFactor, false, {dnai});
+  float loadBalance =
+      createPartitionPlan(*matC, partitionPlan, nTilePerGroup, nSplitFactor);
 
   lhsPartitionDDS(partitionPlan, lhsPartitionPlan, nTilePerGroup);
 
@@ -140,6 +165,168 @@ void HyperGraphStrip::createGraphMatMulSparsifyResult(
                            nSplitFactor);
 }
 
+HyperGraph::PartitionCost HyperGraphStrip::getPartitionCost() const {
+  const unsigned inDataTypeSize = (inDataType == poplar::FLOAT) ? 4 : 2;
+  const unsigned outDataTypeSize = (outDataType == poplar::FLOAT) ? 4 : 2;
+  const unsigned partialDataTypeSize =
+      (partialDataType == poplar::FLOAT) ? 4 : 2;
+
+  const std::size_t memWeightA =
+      matA.getBlockRow() * matA.getBlockCol() * inDataTypeSize;
+  const std::size_t memWeightB =
+      matB.getBlockRow() * matB.getBlockCol() * inDataTypeSize;
+  const std::size_t memWeightC =
+      matC->getBlockRow() * matC->getBlockCol() * outDataTypeSize;
+  const std::size_t memWeightV =
+      matC->getBlockRow() * matC->getBlockCol() * partialDataTypeSize;
+
+  // Bytes are counted as in HyperGraphBlock::computeBytesByTile: the blocks
+  // and partials mapped to a tile, plus the blocks copied to the tile for the
+  // multiplications or the partials copied to it for the reduction. The
+  // blocks are placed by the same functions as in the program.
+  std::vector<std::size_t> mulsByTile(nTile, 0);
+  std::vector<std::size_t> bytesByTilesMatmul(nTile, 0);
+  std::vector<std::size_t> bytesByTilesReduce(nTile, 0);
+  const auto addBytes = [&](int idxTile, std::size_t bytes) {
+    assert(idxTile >= 0 && idxTile < nTile);
+    bytesByTilesMatmul[idxTile] += bytes;
+    bytesByTilesReduce[idxTile] += bytes;
+  };
+  const auto addSlices = [&](const std::vector<BlockSlice> &slices,
+                             std::size_t memWeight, int blockRows,
+                             std::vector<std::unordered_set<int>> *blockTiles) {
+    const std::size_t bytesPerRow = memWeight / blockRows;
+    for (const auto &slice : slices) {
+      addBytes(slice.tileId, (slice.rowEnd - slice.rowBegin) * bytesPerRow);
+      if (blockTiles) {
+        (*blockTiles)[slice.blockId].insert(slice.tileId);
+      }
+    }
+  };
+  // A block used on a tile which does not hold it is copied once to the tile
+  const auto addMul = [&](int idxTile, std::unordered_set<int> &tilesA,
+                          std::unordered_set<int> &tilesB) {
+    assert(idxTile >= 0 && idxTile < nTile);
+    mulsByTile[idxTile]++;
+    if (tilesA.insert(idxTile).second) {
+      bytesByTilesMatmul[idxTile] += memWeightA;
+    }
+    if (tilesB.insert(idxTile).second) {
+      bytesByTilesMatmul[idxTile] += memWeightB;
+    }
+  };
+
+  const std::vector<std::vector<int>> blockIdMatrixA = matA.getBlockIdMatrix();
+  const std::vector<std::vector<int>> blockIdMatrixB = matB.getBlockIdMatrix();
+  const std::vector<std::vector<int>> blockIdMatrixC = matC->getBlockIdMatrix();
+  std::vector<std::unordered_set<int>> tilesByBlockA(
+      matA.getNonZeroBlockCount());
+  std::vector<std::unordered_set<int>> tilesByBlockB(
+      matB.getNonZeroBlockCount());
+  addSlices(getLHSSlices(), memWeightA, matA.getBlockRow(), &tilesByBlockA);
+  addSlices(getRHSSlices(), memWeightB, matB.getBlockRow(), &tilesByBlockB);
+  const auto resultSlices = getResultSlices();
+  addSlices(resultSlices, memWeightC, matC->getBlockRow(), nullptr);
+  const int nColC = matC->getBlockColCount();
+
+  if (!isResultSparse) {
+    // The partials of all the groups are on the tile of the partition
+    for (int c = 0; c < nColC; c++) {
+      for (const auto &p : partitionPlan[c]) {
+        addBytes(p.tileId, nGroup * memWeightV);
+      }
+    }
+
+    const int nRowC = matC->getBlockRowCount();
+    for (int r = 0; r < nRowC; r++) {
+      const int tileOffset = getTileOffsetDSD(r);
+      for (int c = 0; c < nColC; c++) {
+        for (const auto &p : partitionPlan[c]) {
+          for (int k : p.rows) {
+            addMul(p.tileId + tileOffset, tilesByBlockA[blockIdMatrixA[r][k]],
+                   tilesByBlockB[blockIdMatrixB[k][c]]);
+          }
+        }
+        // Each partition reduces one slice of rows of the partials of all
+        // the partitions
+        const int nPartition = static_cast<int>(partitionPlan[c].size());
+        if (nPartition <= 1 && partialDataType == outDataType) {
+          continue;
+        }
+        const std::size_t bytesPerRow = memWeightV / matC->getBlockRow();
+        for (int s = 0; s < nPartition; s++) {
+          const int idxTile = partitionPlan[c][s].tileId + tileOffset;
+          const auto rows = getSliceRows(matC->getBlockRow(), nPartition, s);
+          for (const auto &q : partitionPlan[c]) {
+            if (q.tileId != idxTile) {
+              bytesByTilesReduce[idxTile] +=
+                  (rows.second - rows.first) * bytesPerRow;
+            }
+          }
+        }
+      }
+    }
+  } else {
+    // The partials of each group are on the tile of the partition in the
+    // group, and those of the other groups are reduced on the tile of the
+    // output block
+    const bool hasPartials = nGroup > 1 || partialDataType != outDataType;
+    for (int c = 0; c < nColC; c++) {
+      for (const auto &p : partitionPlan[c]) {
+        for (int g = 0; g < nGroup && hasPartials; g++) {
+          addBytes(p.tileId + g * nTilePerGroup, p.rows.size() * memWeightV);
+        }
+      }
+    }
+    if (nGroup > 1) {
+      for (const auto &slice : resultSlices) {
+        bytesByTilesReduce[slice.tileId] += (nGroup - 1) * memWeightV;
+      }
+    }
+
+    const int blocksPerPass = matA.getBlockColCount() / nPass;
+    const int blocksPerGroup = blocksPerPass / nGroup;
+    for (int pass = 0; pass < nPass; pass++) {
+      for (int g = 0; g < nGroup; g++) {
+        const int start = blocksPerPass * pass + g * blocksPerGroup;
+        for (int c = 0; c < nColC; c++) {
+          for (const auto &p : partitionPlan[c]) {
+            for (int k = start; k < start + blocksPerGroup; k++) {
+              for (int r : p.rows) {
+                addMul(p.tileId + g * nTilePerGroup,
+                       tilesByBlockA[blockIdMatrixA[r][k]],
+                       tilesByBlockB[blockIdMatrixB[k][c]]);
+              }
+            }
+          }
+        }
+      }
+    }
+  }
+
+  PartitionCost cost;
+  cost.maxMulsPerTile = *std::max_element(mulsByTile.begin(), mulsByTile.end());
+  cost.maxBytesPerTile =
+      std::max(*std::max_element(bytesByTilesMatmul.begin(),
+                                 bytesByTilesMatmul.end()),
+               *std::max_element(bytesByTilesReduce.begin(),
+                                 bytesByTilesReduce.end()));
+  return cost;
+}
+
+std::vector<HyperGraphStrip::BlockSlice> HyperGraphStrip::getLHSSlices() const {
+  return isResultSparse ? getLHSSlicesDDS() : getLHSSlicesDSD();
+}
+
+std::vector<HyperGraphStrip::BlockSlice> HyperGraphStrip::getRHSSlices() const {
+  return isResultSparse ? getRHSSlicesDDS() : getRHSSlicesDSD();
+}
+
+std::vector<HyperGraphStrip::BlockSlice>
+HyperGraphStrip::getResultSlices() const {
+  return isResultSparse ? getResultSlicesDDS() : getResultSlicesDSD();
+}
+
 void HyperGraphStrip::setTileMappingLHS(poplar::Graph &graph,
                                         poplar::Tensor &lhsTensor) {
   matA.setBlockTensor(lhsTensor);
@@ -252,10 +439,8 @@ float HyperGraphStrip::partitionGraph(std::vector<int> &tileAssignment,
 // Functions for dense x sparse = dense
 ////////////////////////////////////////////////////////////////////////////////
 float HyperGraphStrip::createPartitionPlan(
-    poplar::Graph &graph, const BlockMatrix &mat,
-    std::vector<std::vector<partition>> &partitionPlan, int nTilePerGroup,
-    int nSplitFactor, bool allocatePartials,
-    const poplar::DebugNameAndId &dnai) {
+    const BlockMatrix &mat, std::vector<std::vector<partition>> &partitionPlan,
+    int nTilePerGroup, int nSplitFactor) {
   assert(mat.isDense() == false);
 
   // Clean up hyper graph
@@ -412,17 +597,6 @@ float HyperGraphStrip::createPartitionPlan(
 
         struct partition p;
         p.tileId = columnTileId[j][k];
-        if (allocatePartials) {
-          p.partials.resize(nGroup);
-          for (int g = 0; g < nGroup; g++) {
-            p.partials[g] = graph.addVariable(
-                partialDataType,
-                {static_cast<unsigned long>(matC->getBlockRow() *
-                                            matC->getBlockCol())},
-                {dnai, "paritials"});
-            graph.setTileMapping(p.partials[g], p.tileId);
-          }
-        }
         for (int b = start; b < end; b++) {
           p.rows.push_back(nonZeroBlocks[b]);
         }
@@ -581,48 +755,107 @@ void HyperGraphStrip::lhsPartitionDSD(
   }
 }
 
-void HyperGraphStrip::setLHSTileMapDSD(poplar::Graph &graph,
-                                       std::vector<int> &lhsBlockTileId,
-                                       bool setTileMap) {
-  const std::vector<poplar::Tensor> &blockData = matA.getBlockTensor();
+int HyperGraphStrip::getTileOffsetDSD(int r) const {
+  // Each block row of a pass is computed by its own group of tiles
+  const int rowsPerPass = matA.getBlockRowCount() / nPass;
+  return (r % rowsPerPass) * nTilePerGroup;
+}
 
-  std::vector<std::vector<int>> blockIdMatrix = matA.getBlockIdMatrix();
+// A block of the LHS is split by rows over the tiles of its column of the LHS
+// partition plan, in the group of its block row
+std::vector<HyperGraphStrip::BlockSlice>
+HyperGraphStrip::getLHSSlicesDSD() const {
+  const std::vector<std::vector<int>> blockIdMatrix = matA.getBlockIdMatrix();
   const int nRow = matA.getBlockRowCount();
   const int nCol = matA.getBlockColCount();
 
-  lhsBlockTileId.resize(matA.getNonZeroBlockCount());
-  int startRow = 0;
-  for (int p = 0; p < nPass; p++) {
-    int endRow = startRow + nRow / nPass;
-    unsigned int tileOffset = 0;
-    for (int r = startRow; r < endRow; r++) {
-      for (int c = 0; c < nCol; c++) {
-        int blockId = blockIdMatrix[r][c];
-        // TODO: lhsBlockTileId is used in preprocessBlocks to copy the block
-        //       to make it contiguous. Not sure how to handle it since one
-        //       block may be on multiple tiles. set to the first tile for now.
-        lhsBlockTileId[blockId] = lhsPartitionPlan[c][0] + tileOffset;
-        poplar::Tensor block = blockData[blockId].reshape(
-            {static_cast<unsigned long>(matA.getBlockRow()),
-             static_cast<unsigned long>(matA.getBlockCol())});
-        int tileCount = static_cast<int>(lhsPartitionPlan[c].size());
-        int sliceSize = matA.getBlockRow() / tileCount;
-        int leftOver = matA.getBlockRow() % tileCount;
-        std::size_t start = 0;
-        for (int t = 0; t < tileCount; t++) {
-          unsigned int tileId = lhsPartitionPlan[c][t] + tileOffset;
-          std::size_t end = start + sliceSize + (t < leftOver ? 1 : 0);
-          poplar::Tensor oneSlice = block.slice(
-              {start, 0}, {end, static_cast<std::size_t>(matA.getBlockCol())});
-          if (setTileMap) {
-            graph.setTileMapping(oneSlice, tileId);
-          }
-          start = end;
+  std::vector<BlockSlice> slices;
+  for (int r = 0; r < nRow; r++) {
+    const int tileOffset = getTileOffsetDSD(r);
+    for (int c = 0; c < nCol; c++) {
+      const int tileCount = static_cast<int>(lhsPartitionPlan[c].size());
+      for (int t = 0; t < tileCount; t++) {
+        const auto rows = getSliceRows(matA.getBlockRow(), tileCount, t);
+        slices.push_back({blockIdMatrix[r][c], rows.first, rows.second,
+                          lhsPartitionPlan[c][t] + tileOffset, false});
+      }
+    }
+  }
+  return slices;
+}
+
+// The blocks of a partition of the RHS are evenly distributed over the groups
+// of tiles, on the tile of the partition in each group
+std::vector<HyperGraphStrip::BlockSlice>
+HyperGraphStrip::getRHSSlicesDSD() const {
+  const std::vector<std::vector<int>> blockIdMatrix = matB.getBlockIdMatrix();
+  const int nCol = matB.getBlockColCount();
+  const std::size_t blockRow = matB.getBlockRow();
+
+  std::vector<BlockSlice> slices;
+  for (int c = 0; c < nCol; c++) {
+    for (const auto &p : partitionPlan[c]) {
+      for (int g = 0; g < nGroup; g++) {
+        const auto rows =
+            getSliceRows(static_cast<int>(p.rows.size()), nGroup, g);
+        for (auto j = rows.first; j < rows.second; j++) {
+          slices.push_back({blockIdMatrix[p.rows[j]][c], 0, blockRow,
+                            p.tileId + g * nTilePerGroup, false});
         }
       }
-      tileOffset += nTilePerGroup;
     }
-    startRow = endRow;
+  }
+  return slices;
+}
+
+// A block of the result is split by rows over the tiles of the partitions of
+// its column, in the group of its block row. The blocks of a column with no
+// partition are zero and may go on any tile of the group.
+std::vector<HyperGraphStrip::BlockSlice>
+HyperGraphStrip::getResultSlicesDSD() const {
+  const std::vector<std::vector<int>> blockIdMatrix = matC->getBlockIdMatrix();
+  const int nRow = matC->getBlockRowCount();
+  const int nCol = matC->getBlockColCount();
+  const std::size_t blockRow = matC->getBlockRow();
+
+  std::vector<BlockSlice> slices;
+  for (int r = 0; r < nRow; r++) {
+    const int tileOffset = getTileOffsetDSD(r);
+    for (int c = 0; c < nCol; c++) {
+      const int blockId = blockIdMatrix[r][c];
+      const int tileCount = static_cast<int>(partitionPlan[c].size());
+      if (tileCount == 0) {
+        slices.push_back({blockId, 0, blockRow, tileOffset, true});
+        continue;
+      }
+      for (int t = 0; t < tileCount; t++) {
+        const auto rows = getSliceRows(matC->getBlockRow(), tileCount, t);
+        slices.push_back({blockId, rows.first, rows.second,
+                          partitionPlan[c][t].tileId + tileOffset, false});
+      }
+    }
+  }
+  return slices;
+}
+
+void HyperGraphStrip::setLHSTileMapDSD(poplar::Graph &graph,
+                                       std::vector<int> &lhsBlockTileId,
+                                       bool setTileMap) {
+  const std::vector<poplar::Tensor> &blockData = matA.getBlockTensor();
+
+  lhsBlockTileId.resize(matA.getNonZeroBlockCount());
+  for (const auto &slice : getLHSSlicesDSD()) {
+    // TODO: lhsBlockTileId is used in preprocessBlocks to copy the block
+    //       to make it contiguous. Not sure how to handle it since one
+    //       block may be on multiple tiles. set to the first tile for now.
+    if (slice.rowBegin == 0) {
+      lhsBlockTileId[slice.blockId] = slice.tileId;
+    }
+    if (setTileMap) {
+      graph.setTileMapping(getSliceTensor(matA, blockData[slice.blockId],
+                                          slice.rowBegin, slice.rowEnd),
+                           slice.tileId);
+    }
   }
 }
 
@@ -631,33 +864,12 @@ void HyperGraphStrip::setRHSTileMapDSD(poplar::Graph &graph,
                                        std::vector<int> &blockTileId,
                                        bool setTileMap) {
   const std::vector<poplar::Tensor> &blockData = matB.getBlockTensor();
-  std::vector<std::vector<int>> blockIdMatrix = matB.getBlockIdMatrix();
-  const int nCol = matB.getBlockColCount();
 
   blockTileId.resize(matB.getNonZeroBlockCount());
-
-  for (int c = 0; c < nCol; c++) {
-    for (auto &p : partitionPlan[c]) {
-      int tileId = p.tileId;
-
-      int nBlockSize = p.rows.size() / nGroup;
-      int leftOver = p.rows.size() % nGroup;
-
-      int currentTileOffset = 0;
-      int start = 0;
-      for (int i = 0; i < nGroup; i++) {
-        int end = start + (i < leftOver ? nBlockSize + 1 : nBlockSize);
-        for (int j = start; j < end; j++) {
-          int blockId = blockIdMatrix[p.rows[j]][c];
-          blockTileId[blockId] = tileId + currentTileOffset;
-          if (setTileMap) {
-            graph.setTileMapping(blockData[blockId], blockTileId[blockId]);
-          }
-        }
-        currentTileOffset += nTilePerGroup;
-        start = end;
-      }
-      assert(start == static_cast<int>(p.rows.size()));
+  for (const auto &slice : getRHSSlicesDSD()) {
+    blockTileId[slice.blockId] = slice.tileId;
+    if (setTileMap) {
+      graph.setTileMapping(blockData[slice.blockId], slice.tileId);
     }
   }
 }
@@ -665,49 +877,20 @@ void HyperGraphStrip::setRHSTileMapDSD(poplar::Graph &graph,
 void HyperGraphStrip::setResultTileMapDSD(poplar::Graph &graph,
                                           std::vector<int> &blockTileId) {
   const std::vector<poplar::Tensor> &blockData = matC->getBlockTensor();
-  std::vector<std::vector<int>> blockIdMatrix = matC->getBlockIdMatrix();
-  const int nRow = matC->getBlockRowCount();
-  const int nCol = matC->getBlockColCount();
 
   blockTileId.resize(matC->getNonZeroBlockCount());
-
-  int startRow = 0, endRow = 0;
-  for (int p = 0; p < nPass; p++) {
-    endRow += nRow / nPass;
-    unsigned int tileOffset = 0;
-    for (int r = startRow; r < endRow; r++) {
-      for (int c = 0; c < nCol; c++) {
-        int blockId = blockIdMatrix[r][c];
-        poplar::Tensor block = blockData[blockId].reshape(
-            {static_cast<unsigned long>(matC->getBlockRow()),
-             static_cast<unsigned long>(matC->getBlockCol())});
-        int tileCount = partitionPlan[c].size();
-        if (tileCount == 0) {
-          // this is the zero block
-          int tileId = getRandomTile(nTilePerGroup) + tileOffset;
-          blockTileId[blockId] = tileId;
-          graph.setTileMapping(block, tileId);
-          continue;
-        }
-        // TODO: This is for the tile to put zero vertex, for now, put on the
-        // first tile
-        blockTileId[blockId] = partitionPlan[c][0].tileId;
-        int sliceSize = matC->getBlockRow() / tileCount;
-        int leftOver = matC->getBlockRow() % tileCount;
-        std::size_t start = 0;
-        for (int t = 0; t < tileCount; t++) {
-          int tileId = partitionPlan[c][t].tileId + tileOffset;
-          std::size_t end = start + sliceSize + (t < leftOver ? 1 : 0);
-          graph.setTileMapping(
-              block.slice({start, 0},
-                          {end, static_cast<std::size_t>(matC->getBlockCol())}),
-              tileId);
-          start = end;
-        }
-      }
-      tileOffset += nTilePerGroup;
+  for (const auto &slice : getResultSlicesDSD()) {
+    const int tileId = slice.onAnyTile
+                           ? getRandomTile(nTilePerGroup) + slice.tileId
+                           : slice.tileId;
+    // TODO: This is for the tile to put zero vertex, for now, put on the
+    // first tile
+    if (slice.rowBegin == 0) {
+      blockTileId[slice.blockId] = tileId;
     }
-    startRow = endRow;
+    graph.setTileMapping(getSliceTensor(*matC, blockData[slice.blockId],
+                                        slice.rowBegin, slice.rowEnd),
+                         tileId);
   }
 }
 
@@ -735,6 +918,22 @@ void HyperGraphStrip::createComputeSetDSD(
   std::vector<int> outputBlockTileId;
   setResultTileMapDSD(graph, outputBlockTileId);
 
+  // The partials are created with the program rather than with the partition
+  // plan, so that the plan does not depend on the graph.
+  for (auto &column : partitionPlan) {
+    for (auto &p : column) {
+      p.partials.resize(nGroup);
+      for (auto &partials : p.partials) {
+        partials = graph.addVariable(
+            partialDataType,
+            {static_cast<unsigned long>(matC->getBlockRow() *
+                                        matC->getBlockCol())},
+            {dnai, "paritials"});
+        graph.setTileMapping(partials, p.tileId);
+      }
+    }
+  }
+
   std::vector<poplar::Tensor> blockDataA, blockDataB;
 
   poplar::ComputeSet *transposeCS = nullptr;
@@ -760,8 +959,8 @@ void HyperGraphStrip::createComputeSetDSD(
     poplar::ComputeSet &reduceCS = reduceCSVec[p];
 
     endRow += nRowC / nPass;
-    unsigned int tileOffset = 0;
     for (int r = startRow; r < endRow; r++) {
+      const int tileOffset = getTileOffsetDSD(r);
       for (int c = 0; c < nColC; c++) {
         if (partitionPlan[c].size() == 0) {
           int blockId = blockIdMatrixC[r][c];
@@ -798,34 +997,25 @@ void HyperGraphStrip::createComputeSetDSD(
         if (nPartition <= 1 && partialDataType == outDataType)
           continue;
 
-        int sliceSize = matC->getBlockRow() / nPartition;
-        int leftOver = matC->getBlockRow() % nPartition;
-
-        std::size_t start = 0;
-        std::size_t blockColC = static_cast<std::size_t>(matC->getBlockCol());
         for (int p = 0; p < nPartition; p++) {
           unsigned int tileId = partitionPlan[c][p].tileId + tileOffset;
-          std::size_t end = start + sliceSize + (p < leftOver ? 1 : 0);
+          const auto rows = getSliceRows(matC->getBlockRow(), nPartition, p);
 
           std::vector<poplar::Tensor> input;
           for (int s = 0; s < nPartition; s++) {
-            poplar::Tensor t = partitionPlan[c][s].partials[r - startRow];
-            t = t.reshape({static_cast<unsigned long>(matC->getBlockRow()),
-                           static_cast<unsigned long>(matC->getBlockCol())});
-            input.push_back(t.slice({start, 0}, {end, blockColC}).flatten());
+            const auto &partials = partitionPlan[c][s].partials[r - startRow];
+            input.push_back(
+                getSliceTensor(*matC, partials, rows.first, rows.second)
+                    .flatten());
           }
-          poplar::Tensor outputTensor = blockDataC[blockIdMatrixC[r][c]];
-          outputTensor = outputTensor.reshape(
-              {static_cast<unsigned long>(matC->getBlockRow()),
-               static_cast<unsigned long>(matC->getBlockCol())});
-          outputTensor =
-              outputTensor.slice({start, 0}, {end, blockColC}).flatten();
+          poplar::Tensor outputTensor =
+              getSliceTensor(*matC, blockDataC[blockIdMatrixC[r][c]],
+                             rows.first, rows.second)
+                  .flatten();
           addReduceVertex(graph, input, outputTensor, tileId, reduceCS);
           nReduceVertex++;
-          start = end;
         }
       }
-      tileOffset += nTilePerGroup;
     }
     startRow = endRow;
   }
@@ -950,160 +1140,148 @@ void HyperGraphStrip::lhsPartitionDDS(
   }
 }
 
-void HyperGraphStrip::setLHSTileMapDDS(poplar::Graph &graph,
-                                       std::vector<int> &lhsBlockTileId,
-                                       bool setTileMap) {
-
-  const std::vector<poplar::Tensor> &blockData = matA.getBlockTensor();
-  std::vector<std::vector<int>> blockIdMatrix = matA.getBlockIdMatrix();
+// The blocks of a row of the LHS in a group are distributed over the tiles
+// of the row in the LHS partition plan: one block per tile on the first tiles
+// if there are more tiles than blocks, and evenly otherwise
+std::vector<HyperGraphStrip::BlockSlice>
+HyperGraphStrip::getLHSSlicesDDS() const {
+  const std::vector<std::vector<int>> blockIdMatrix = matA.getBlockIdMatrix();
   const int nRow = matA.getBlockRowCount();
-  const int nCol = matA.getBlockColCount();
+  const int nBlock = matA.getBlockColCount() / nPass;
+  const std::size_t blockRow = matA.getBlockRow();
 
-  lhsBlockTileId.resize(matA.getNonZeroBlockCount());
-  int startCol = 0;
-  for (int p = 0; p < nPass; p++) {
-    int endCol = startCol + nCol / nPass;
+  std::vector<BlockSlice> slices;
+  for (int pass = 0; pass < nPass; pass++) {
     for (int r = 0; r < nRow; r++) {
-      int tileOffset = 0;
-      int nBlock = nCol / nPass;
-      int tileCount = lhsPartitionPlan[r].size();
-      if (tileCount > nBlock) {
-        // distribut the blocks to the first few tiles
-        int start = startCol;
-        for (int g = 0; g < nGroup; g++) {
-          int end = start + nBlock / nGroup;
-          for (int c = start; c < end; c++) {
-            int blockId = blockIdMatrix[r][c];
-            unsigned int tileId = lhsPartitionPlan[r][c - start] + tileOffset;
-            if (setTileMap)
-              graph.setTileMapping(blockData[blockId], tileId);
-            lhsBlockTileId[blockId] = tileId;
-          }
-          start = end;
-          tileOffset += nTilePerGroup;
-        }
-      } else {
-        // evenly distribute blocks to all available tiles
-        int blocksPerTile = (nBlock + tileCount) / tileCount;
-        int start = startCol;
-        for (int g = 0; g < nGroup; g++) {
-          int end = start + nBlock / nGroup;
-          for (int c = start; c < end; c++) {
-            int blockId = blockIdMatrix[r][c];
-            int partitionIndex = (c - start) / blocksPerTile;
-            assert(partitionIndex <
-                   static_cast<int>(lhsPartitionPlan[r].size()));
-            unsigned int tileId =
-                lhsPartitionPlan[r][partitionIndex] + tileOffset;
-            if (setTileMap) {
-              graph.setTileMapping(blockData[blockId], tileId);
-            }
-            lhsBlockTileId[blockId] = tileId;
-          }
-          start = end;
-          tileOffset += nTilePerGroup;
+      const int tileCount = static_cast<int>(lhsPartitionPlan[r].size());
+      const int blocksPerTile = (nBlock + tileCount) / tileCount;
+      int start = nBlock * pass;
+      for (int g = 0; g < nGroup; g++) {
+        const int end = start + nBlock / nGroup;
+        for (int c = start; c < end; c++) {
+          const int partitionIndex =
+              tileCount > nBlock ? c - start : (c - start) / blocksPerTile;
+          assert(partitionIndex < tileCount);
+          slices.push_back({blockIdMatrix[r][c], 0, blockRow,
+                            lhsPartitionPlan[r][partitionIndex] +
+                                g * nTilePerGroup,
+                            false});
         }
+        start = end;
       }
     }
-
-    startCol = endCol;
   }
+  return slices;
 }
 
-void HyperGraphStrip::setRHSTileMapDDS(poplar::Graph &graph,
-                                       std::vector<int> &blockTileId,
-                                       bool setTileMap) {
-  const std::vector<poplar::Tensor> &blockData = matB.getBlockTensor();
-  std::vector<std::vector<int>> blockIdMatrix = matB.getBlockIdMatrix();
+// A block of the RHS is split by rows over the tiles of the partitions of its
+// column, in the group of its block row. The blocks of a column with no
+// partition may go on any tile of the group.
+std::vector<HyperGraphStrip::BlockSlice>
+HyperGraphStrip::getRHSSlicesDDS() const {
+  const std::vector<std::vector<int>> blockIdMatrix = matB.getBlockIdMatrix();
   const int nRow = matB.getBlockRowCount();
   const int nCol = matB.getBlockColCount();
+  const std::size_t blockRow = matB.getBlockRow();
 
-  blockTileId.resize(matB.getNonZeroBlockCount());
-  int startRow = 0;
-  for (int p = 0; p < nPass; p++) {
-    int endRow = startRow + nRow / nPass;
-
+  std::vector<BlockSlice> slices;
+  for (int pass = 0; pass < nPass; pass++) {
     for (int c = 0; c < nCol; c++) {
-      int tileCount = partitionPlan[c].size();
-      int sliceSize = 0;
-      int leftOver = 0;
-      if (tileCount != 0) {
-        sliceSize = matB.getBlockRow() / tileCount;
-        leftOver = matB.getBlockRow() % tileCount;
-      }
-      unsigned int tileOffset = 0;
-      int start = startRow;
+      const int tileCount = static_cast<int>(partitionPlan[c].size());
+      int start = nRow / nPass * pass;
       for (int g = 0; g < nGroup; g++) {
-        int end = start + nRow / nPass / nGroup;
+        const int tileOffset = g * nTilePerGroup;
+        const int end = start + nRow / nPass / nGroup;
         for (int r = start; r < end; r++) {
-          int blockId = blockIdMatrix[r][c];
+          const int blockId = blockIdMatrix[r][c];
           if (tileCount == 0) {
-            blockTileId[blockId] = getRandomTile(nTilePerGroup) + tileOffset;
-            if (setTileMap) {
-              graph.setTileMapping(blockData[blockId], blockTileId[blockId]);
-            }
+            slices.push_back({blockId, 0, blockRow, tileOffset, true});
             continue;
           }
-          // TODO: blockTileId is used for transpose the block, use the first
-          // tile for now. May need to improve it if transpose becomes the
-          // bottle neck
-          blockTileId[blockId] = partitionPlan[c][0].tileId + tileOffset;
-          poplar::Tensor block = blockData[blockId].reshape(
-              {static_cast<unsigned long>(matB.getBlockRow()),
-               static_cast<unsigned long>(matB.getBlockCol())});
-
-          std::size_t startSlice = 0;
           for (int t = 0; t < tileCount; t++) {
-            int tileId = partitionPlan[c][t].tileId + tileOffset;
-            std::size_t endSlice =
-                startSlice + sliceSize + (t < leftOver ? 1 : 0);
-            if (setTileMap) {
-              graph.setTileMapping(
-                  block.slice(
-                      {startSlice, 0},
-                      {endSlice, static_cast<std::size_t>(matB.getBlockCol())}),
-                  tileId);
-            }
-            startSlice = endSlice;
+            const auto rows = getSliceRows(matB.getBlockRow(), tileCount, t);
+            slices.push_back({blockId, rows.first, rows.second,
+                              partitionPlan[c][t].tileId + tileOffset, false});
           }
         }
         start = end;
-        tileOffset += nTilePerGroup;
       }
     }
-    startRow = endRow;
   }
+  return slices;
 }
 
-void HyperGraphStrip::setOutputTileMapDDS(poplar::Graph &graph,
-                                          std::vector<int> &blockTileId) {
-  const std::vector<poplar::Tensor> &blockData = matC->getBlockTensor();
-  std::vector<std::vector<int>> blockIdMatrix = matC->getBlockIdMatrix();
+// The blocks of a partition of the result are evenly distributed over the
+// groups of tiles, on the tile of the partition in each group
+std::vector<HyperGraphStrip::BlockSlice>
+HyperGraphStrip::getResultSlicesDDS() const {
+  const std::vector<std::vector<int>> blockIdMatrix = matC->getBlockIdMatrix();
   const int nCol = matC->getBlockColCount();
+  const std::size_t blockRow = matC->getBlockRow();
 
-  blockTileId.resize(matC->getNonZeroBlockCount());
-
+  std::vector<BlockSlice> slices;
   for (int c = 0; c < nCol; c++) {
-    for (auto &p : partitionPlan[c]) {
-      int tileId = p.tileId;
-
-      int nBlockSize = p.rows.size() / nGroup;
-      int leftOver = p.rows.size() % nGroup;
-      int currentTileOffset = 0;
-      int start = 0;
-      for (int i = 0; i < nGroup; i++) {
-        int end = start + (i < leftOver ? nBlockSize + 1 : nBlockSize);
-        for (int j = start; j < end; j++) {
-          int blockId = blockIdMatrix[p.rows[j]][c];
-          blockTileId[blockId] = tileId + currentTileOffset;
-          graph.setTileMapping(blockData[blockId], blockTileId[blockId]);
+    for (const auto &p : partitionPlan[c]) {
+      for (int g = 0; g < nGroup; g++) {
+        const auto rows =
+            getSliceRows(static_cast<int>(p.rows.size()), nGroup, g);
+        for (auto j = rows.first; j < rows.second; j++) {
+          slices.push_back({blockIdMatrix[p.rows[j]][c], 0, blockRow,
+                            p.tileId + g * nTilePerGroup, false});
         }
-        currentTileOffset += nTilePerGroup;
-        start = end;
       }
-      assert(start == static_cast<int>(p.rows.size()));
     }
   }
+  return slices;
+}
+
+void HyperGraphStrip::setLHSTileMapDDS(poplar::Graph &graph,
+                                       std::vector<int> &lhsBlockTileId,
+                                       bool setTileMap) {
+  const std::vector<poplar::Tensor> &blockData = matA.getBlockTensor();
+
+  lhsBlockTileId.resize(matA.getNonZeroBlockCount());
+  for (const auto &slice : getLHSSlicesDDS()) {
+    lhsBlockTileId[slice.blockId] = slice.tileId;
+    if (setTileMap) {
+      graph.setTileMapping(blockData[slice.blockId], slice.tileId);
+    }
+  }
+}
+
+void HyperGraphStrip::setRHSTileMapDDS(poplar::Graph &graph,
+                                       std::vector<int> &blockTileId,
+                                       bool setTileMap) {
+  const std::vector<poplar::Tensor> &blockData = matB.getBlockTensor();
+
+  blockTileId.resize(matB.getNonZeroBlockCount());
+  for (const auto &slice : getRHSSlicesDDS()) {
+    const int tileId = slice.onAnyTile
+                           ? getRandomTile(nTilePerGroup) + slice.tileId
+                           : slice.tileId;
+    // TODO: blockTileId is used for transpose the block, use the first
+    // tile for now. May need to improve it if transpose becomes the
+    // bottle neck
+    if (slice.rowBegin == 0) {
+      blockTileId[slice.blockId] = tileId;
+    }
+    if (setTileMap) {
+      graph.setTileMapping(getSliceTensor(matB, blockData[slice.blockId],
+                                          slice.rowBegin, slice.rowEnd),
+                           tileId);
+    }
+  }
+}
+
+void HyperGraphStrip::setOutputTileMapDDS(poplar::Graph &graph,
+                                          std::vector<int> &blockTileId) {
+  const std::vector<poplar::Tensor> &blockData = matC->getBlockTensor();
+
+  blockTileId.resize(matC->getNonZeroBlockCount());
+  for (const auto &slice : getResultSlicesDDS()) {
+    blockTileId[slice.blockId] = slice.tileId;
+    graph.setTileMapping(blockData[slice.blockId], slice.tileId);
+  }
 
   // Check if all blocks are mapped to tiles
   for (int i = 0; i < matC->getNonZeroBlockCount(); i++) {
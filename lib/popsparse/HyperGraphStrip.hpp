@@ -68,6 +68,17 @@ private:
 
   bool isResultSparse;
 
+  // Rows [rowBegin, rowEnd) of a block, placed on a tile. When the tile is
+  // left to the program, as for a zero block, onAnyTile is set and tileId is
+  // the first tile of the group of tiles the block goes to.
+  struct BlockSlice {
+    int blockId;
+    std::size_t rowBegin;
+    std::size_t rowEnd;
+    int tileId;
+    bool onAnyTile;
+  };
+
 public:
   // Creates a graph for (sparse) matrix multiplication
   virtual void createGraphMatMul(poplar::Graph &graph,
@@ -79,6 +90,9 @@ public:
                                   const unsigned char *sparsity,
                                   const poplar::DebugNameAndId &dnai) override;
 
+  // Gets the estimated cost of the partition from the partition plan
+  PartitionCost getPartitionCost() const override;
+
   // Set the tile mapping for left hand matrix
   void setTileMappingLHS(poplar::Graph &graph,
                          poplar::Tensor &lhsTensor) override;
@@ -106,6 +120,14 @@ private:
 
   float partitionGraph(std::vector<int> &tileAssignment, int nPartition);
 
+  // The placement of the blocks, the multiplications and the reductions
+  // comes from these functions only. They are used both by the tile maps
+  // and compute sets of the program and by getPartitionCost(), so that the
+  // cost follows the program.
+  std::vector<BlockSlice> getLHSSlices() const;
+  std::vector<BlockSlice> getRHSSlices() const;
+  std::vector<BlockSlice> getResultSlices() const;
+
   /* name convention:  DSD --> dense x sparse = dense
                        DDS --> dense x dense  = sparse
    */
@@ -133,11 +155,19 @@ private:
 
   void setResultTileMapDSD(poplar::Graph &graph, std::vector<int> &blockTileId);
 
-  float createPartitionPlan(poplar::Graph &graph, const BlockMatrix &mat,
+  std::vector<BlockSlice> getLHSSlicesDSD() const;
+
+  std::vector<BlockSlice> getRHSSlicesDSD() const;
+
+  std::vector<BlockSlice> getResultSlicesDSD() const;
+
+  // The first tile of the group of tiles which computes block row r of the
+  // result
+  int getTileOffsetDSD(int r) const;
+
+  float createPartitionPlan(const BlockMatrix &mat,
                             std::vector<std::vector<partition>> &partitionPlan,
-                            int nTilePerGroup, int nSplitFactor,
-                            bool allocatePartials,
-                            const poplar::DebugNameAndId &dnai);
+                            int nTilePerGroup, int nSplitFactor);
 
   void lhsPartitionDSD(std::vector<std::vector<partition>> &partitionPlan,
                        std::vector<std::vector<int>> &lhsPartitionPlan,
@@ -178,6 +208,12 @@ private:
 
   void setOutputTileMapDDS(poplar::Graph &graph, std::vector<int> &blockTileId);
 
+  std::vector<BlockSlice> getLHSSlicesDDS() const;
+
+  std::vector<BlockSlice> getRHSSlicesDDS() const;
+
+  std::vector<BlockSlice> getResultSlicesDDS() const;
+
   void lhsPartitionDDS(std::vector<std::vector<partition>> &partitionPlan,
                        std::vector<std::vector<int>> &lhsPartitionPlan,
                        int nTilePerGroup);
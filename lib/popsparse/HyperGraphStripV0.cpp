@@ -1,6 +1,7 @@
 // Copyright (c) 2020 Graphcore Ltd. All rights reserved.
 
 #include "HyperGraphStripV0.hpp"
+#include <algorithm>
 #include <cfloat>
 #include <poplibs_support/logging.hpp>
 #include <popops/Zero.hpp>
@@ -180,6 +181,92 @@ void HyperGraphStripV0::createGraphMatMulSparsifyResult(
   }
 }
 
+HyperGraph::PartitionCost HyperGraphStripV0::getPartitionCost() const {
+  const unsigned inDataTypeSize = (inDataType == poplar::FLOAT) ? 4 : 2;
+  const unsigned partialDataTypeSize =
+      (partialDataType == poplar::FLOAT) ? 4 : 2;
+
+  const std::size_t memWeightA =
+      matA.getBlockRow() * matA.getBlockCol() * inDataTypeSize;
+  const std::size_t memWeightB =
+      matB.getBlockRow() * matB.getBlockCol() * inDataTypeSize;
+  const std::size_t memWeightV =
+      matC->getBlockRow() * matC->getBlockCol() * partialDataTypeSize;
+
+  const std::vector<std::vector<int>> blockIdMatrixA = matA.getBlockIdMatrix();
+  const std::vector<std::vector<int>> blockIdMatrixB = matB.getBlockIdMatrix();
+  const std::vector<std::vector<int>> blockIdMatrixC = matC->getBlockIdMatrix();
+  const int nRowC = matC->getBlockRowCount();
+  const int nColC = matC->getBlockColCount();
+  const int nColA = matA.getBlockColCount();
+
+  // A tile holds every block of A and B it multiplies, either mapped to it
+  // or copied to it, and the block of the result or of partials of each of
+  // its multiplications
+  std::vector<std::size_t> mulsByTile(nTile, 0);
+  std::vector<std::unordered_set<int>> blocksAByTile(nTile);
+  std::vector<std::unordered_set<int>> blocksBByTile(nTile);
+  std::vector<std::unordered_set<std::size_t>> blocksVByTile(nTile);
+  const auto addMul = [&](int idxTile, int r, int k, int c, int group) {
+    assert(idxTile >= 0 && idxTile < nTile);
+    mulsByTile[idxTile]++;
+    blocksAByTile[idxTile].insert(blockIdMatrixA[r][k]);
+    blocksBByTile[idxTile].insert(blockIdMatrixB[k][c]);
+    blocksVByTile[idxTile].insert(
+        static_cast<std::size_t>(blockIdMatrixC[r][c]) * nGroup + group);
+  };
+
+  if (!isResultSparse) {
+    for (int r = 0; r < nRowC; r++) {
+      for (int c = 0; c < nColC; c++) {
+        for (int k = 0; k < nColA; k++) {
+          if (blockIdMatrixA[r][k] == -1 || blockIdMatrixB[k][c] == -1) {
+            continue;
+          }
+          addMul(getMulTile(r, k, c), r, k, c, 0);
+        }
+      }
+    }
+  } else {
+    for (int k = 0; k < nColA; k++) {
+      for (int r = 0; r < nRowC; r++) {
+        for (int c = 0; c < nColC; c++) {
+          if (blockIdMatrixC[r][c] == -1) {
+            continue;
+          }
+          addMul(getMulTile(r, k, c), r, k, c, k % nGroup);
+        }
+      }
+    }
+  }
+
+  std::size_t maxBytes = 0;
+  for (int i = 0; i < nTile; i++) {
+    maxBytes = std::max(maxBytes, blocksAByTile[i].size() * memWeightA +
+                                      blocksBByTile[i].size() * memWeightB +
+                                      blocksVByTile[i].size() * memWeightV);
+  }
+
+  PartitionCost cost;
+  cost.maxMulsPerTile = *std::max_element(mulsByTile.begin(), mulsByTile.end());
+  cost.maxBytesPerTile = maxBytes;
+  return cost;
+}
+
+int HyperGraphStripV0::getMulTile(int r, int k, int c) const {
+  if (!isResultSparse) {
+    // Each row of a pass runs on its own group of tiles
+    const int rowsPerPass = matC->getBlockRowCount() / nPass;
+    const int tileOffset = (r % rowsPerPass) * nTilePerGroup;
+    return (doRowSplit ? rhsTileAssignment[k] : rhsTileAssignment[c]) +
+           tileOffset;
+  }
+  // Each column of A of a pass runs on its own group of tiles
+  const int tileOffset = (k % nGroup) * nTilePerGroup;
+  return (doRowSplit ? resultTileAssignment[r] : resultTileAssignment[c]) +
+         tileOffset;
+}
+
 void HyperGraphStripV0::setTileMappingLHS(poplar::Graph &graph,
                                           poplar::Tensor &lhsTensor) {
   matA.setBlockTensor(lhsTensor);
@@ -699,10 +786,9 @@ void HyperGraphStripV0::createComputeSetColSplitDSD(
     poplar::ComputeSet &mulCS = mulCSVec[p];
 
     endR += nRowC / nPass;
-    unsigned int tileOffset = 0;
     for (int r = startR; r < endR; r++) {
       for (int c = 0; c < nColC; c++) {
-        unsigned int tileId = rhsTileAssignment[c] + tileOffset;
+        unsigned int tileId = getMulTile(r, 0, c);
 
         std::vector<poplar::Tensor> inputA, inputB;
         bool isNonZero = false;
@@ -722,8 +808,6 @@ void HyperGraphStripV0::createComputeSetColSplitDSD(
                            {dnai});
         }
       }
-
-      tileOffset += nTilePerGroup;
     }
     startR = endR;
   }
@@ -867,10 +951,12 @@ void HyperGraphStripV0::createComputeSetRowSplitDSD(
     poplar::ComputeSet &mulCS = mulCSVec[p];
     poplar::ComputeSet &reduceCS = reduceCSVec[p];
 
-    unsigned int tileOffset = 0;
     for (int g = startR; g < endR; g++) {
       for (int i = 0; i < nTilePerGroup; i++) {
-        unsigned int tileId = i + tileOffset;
+        if (tileStrips[i].rows.empty()) {
+          continue;
+        }
+        unsigned int tileId = getMulTile(g, tileStrips[i].rows.front(), 0);
         for (unsigned c = 0; c < nColB; c++) {
           bool isNonZero = false;
           std::vector<poplar::Tensor> inputA, inputB;
@@ -889,11 +975,10 @@ void HyperGraphStripV0::createComputeSetRowSplitDSD(
           }
         }
       }
-      tileOffset += nTilePerGroup;
     }
 
     // partial reduction
-    tileOffset = 0;
+    unsigned int tileOffset = 0;
     for (int g = startR; g < endR; g++) {
       for (unsigned c = 0; c < nColB; c++) {
         unsigned int tileId = resultTileAssignment[c] + tileOffset;
@@ -1313,16 +1398,15 @@ void HyperGraphStripV0::createComputeSetColSplitDDS(
 
   std::vector<std::vector<poplar::Tensor>> partialSum;
   partialSum.resize(nGroup);
-  int tileOffset = 0;
   for (int i = 0; i < nGroup; i++) {
     partialSum[i].resize(blockDataC.size());
     for (unsigned c = 0; c < nColC; c++) {
-      unsigned int tileId = resultTileAssignment[c] + tileOffset;
       for (unsigned r = 0; r < nRowC; r++) {
         int blockId = blockIdMatrixC[r][c];
         if (blockId == -1) {
           continue;
         }
+        unsigned int tileId = getMulTile(r, i, c);
         partialSum[i][blockId] = graph.addVariable(
             partialDataType,
             {static_cast<unsigned long>(matC->getBlockRow() *
@@ -1331,8 +1415,6 @@ void HyperGraphStripV0::createComputeSetColSplitDDS(
         graph.setTileMapping(partialSum[i][blockId], tileId);
       }
     }
-
-    tileOffset += nTilePerGroup;
   }
 
   int gStart = 0;
@@ -1341,7 +1423,6 @@ void HyperGraphStripV0::createComputeSetColSplitDDS(
   assert(static_cast<int>(mulCSVec.size()) == nPass);
   assert(static_cast<int>(reduceCSVec.size()) == nPass);
   for (int p = 0; p < nPass; p++) {
-    tileOffset = 0;
     gEnd += nGroup;
 
     poplar::ComputeSet &mulCS = mulCSVec[p];
@@ -1349,11 +1430,11 @@ void HyperGraphStripV0::createComputeSetColSplitDDS(
 
     for (int g = gStart; g < gEnd; g++) {
       for (unsigned c = 0; c < nColC; c++) {
-        unsigned int tileId = resultTileAssignment[c] + tileOffset;
         for (unsigned r = 0; r < nRowC; r++) {
           if (blockIdMatrixC[r][c] == -1) {
             continue;
           }
+          unsigned int tileId = getMulTile(r, g, c);
           std::vector<poplar::Tensor> inputA, inputB;
           inputA.push_back(blockDataA[blockIdMatrixA[r][g]]);
           inputB.push_back(blockDataB[blockIdMatrixB[g][c]]);
@@ -1363,7 +1444,6 @@ void HyperGraphStripV0::createComputeSetColSplitDDS(
                            mulCS, {dnai});
         }
       }
-      tileOffset += nTilePerGroup;
     }
 
     for (unsigned c = 0; c < nColC; c++) {
@@ -1430,16 +1510,15 @@ void HyperGraphStripV0::createComputeSetRowSplitDDS(
 
   std::vector<std::vector<poplar::Tensor>> partialSum;
   partialSum.resize(nGroup);
-  int tileOffset = 0;
   for (int i = 0; i < nGroup; i++) {
     partialSum[i].resize(blockDataC.size());
     for (unsigned r = 0; r < nRowC; r++) {
-      unsigned int tileId = resultTileAssignment[r] + tileOffset;
       for (unsigned c = 0; c < nColC; c++) {
         int blockId = blockIdMatrixC[r][c];
         if (blockId == -1) {
           continue;
         }
+        unsigned int tileId = getMulTile(r, i, c);
         partialSum[i][blockId] = graph.addVariable(
             partialDataType,
             {static_cast<unsigned long>(matC->getBlockRow() *
@@ -1448,8 +1527,6 @@ void HyperGraphStripV0::createComputeSetRowSplitDDS(
         graph.setTileMapping(partialSum[i][blockId], tileId);
       }
     }
-
-    tileOffset += nTilePerGroup;
   }
 
   int gStart = 0;
@@ -1458,7 +1535,6 @@ void HyperGraphStripV0::createComputeSetRowSplitDDS(
   assert(static_cast<int>(mulCSVec.size()) == nPass);
   assert(static_cast<int>(reduceCSVec.size()) == nPass);
   for (int p = 0; p < nPass; p++) {
-    tileOffset = 0;
     gEnd += nGroup;
 
     poplar::ComputeSet &mulCS = mulCSVec[p];
@@ -1466,11 +1542,11 @@ void HyperGraphStripV0::createComputeSetRowSplitDDS(
 
     for (int g = gStart; g < gEnd; g++) {
       for (unsigned r = 0; r < nRowC; r++) {
-        unsigned int tileId = resultTileAssignment[r] + tileOffset;
         for (unsigned c = 0; c < nColC; c++) {
           if (blockIdMatrixC[r][c] == -1) {
             continue;
           }
+          unsigned int tileId = getMulTile(r, g, c);
 
           std::vector<poplar::Tensor> inputA, inputB;
           inputA.push_back(blockDataA[blockIdMatrixA[r][g]]);
@@ -1481,7 +1557,6 @@ void HyperGraphStripV0::createComputeSetRowSplitDDS(
                            mulCS, {dnai});
         }
       }
-      tileOffset += nTilePerGroup;
     }
 
     for (unsigned r = 0; r < nRowC; r++) {
@@ -78,6 +78,10 @@ public:
                                   const unsigned char *sparsity,
                                   const poplar::DebugNameAndId &dnai) override;
 
+  // Gets the estimated cost of the partition from the tiles of the
+  // multiplications of the compute sets
+  PartitionCost getPartitionCost() const override;
+
   // Set the tile mapping for left hand matrix
   void setTileMappingLHS(poplar::Graph &graph,
                          poplar::Tensor &lhsTensor) override;
@@ -105,6 +109,10 @@ private:
 
   float partitionGraph(std::vector<int> &tileAssignment, int nPartition);
 
+  // The tile of the multiplication of block (r, k) of A by block (k, c) of B,
+  // used by both the compute sets and getPartitionCost
+  int getMulTile(int r, int k, int c) const;
+
   /* name convention:  DSD --> dense x sparse = dense
                        DDS --> dense x dense  = sparse
    */
@@ -16,7 +16,7 @@ static constexpr auto comparisonHelper = poplibs_support::makeStructHelper(
     &MatMulOptions::availableMemoryProportion,
     &MatMulOptions::metaInfoBucketOversizeProportion,
     &MatMulOptions::partialsType, &MatMulOptions::sharedBuckets,
-    &MatMulOptions::partitioner);
+    &MatMulOptions::allowDenseFallback, &MatMulOptions::partitioner);
 
 bool operator<(const MatMulOptions &a, const MatMulOptions &b) {
   return comparisonHelper.lt(a, b);
@@ -36,6 +36,7 @@ std::ostream &operator<<(std::ostream &os, const MatMulOptions &o) {
      << o.metaInfoBucketOversizeProportion
      << ",\n partialsType: " << o.partialsType
      << ",\n sharedBuckets: " << o.sharedBuckets
+     << ",\n allowDenseFallback: " << o.allowDenseFallback
      << ",\n partitioner.optimiseForSpeed: " << o.partitioner.optimiseForSpeed
      << ",\n partitioner.forceBucketSpills: " << o.partitioner.forceBucketSpills
      << ",\n partitioner.useActualWorkerSplitCosts: "
@@ -57,6 +58,8 @@ MatMulOptions parseMatMulOptionFlags(const OptionFlags &flags) {
       {"partialsType",
        OptionHandler::createWithEnum(options.partialsType, partialsTypeMap)},
       {"sharedBuckets", OptionHandler::createWithBool(options.sharedBuckets)},
+      {"allowDenseFallback",
+       OptionHandler::createWithBool(options.allowDenseFallback)},
       {"partitioner.optimiseForSpeed",
        OptionHandler::createWithBool(options.partitioner.optimiseForSpeed)},
       {"partitioner.forceBucketSpills",
@@ -18,6 +18,7 @@ struct MatMulOptions {
   double metaInfoBucketOversizeProportion = 0.3;
   poplar::Type partialsType = poplar::FLOAT;
   bool sharedBuckets = true;
+  bool allowDenseFallback = false;
   PartitionerOptions partitioner;
 
   friend bool operator<(const MatMulOptions &a, const MatMulOptions &b);
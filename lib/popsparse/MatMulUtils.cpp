@@ -26,6 +26,7 @@ poplar::OptionFlags getFullyConnectedOptions(const MatMulOptions &options) {
       {"doGradWPass", "false"},
       {"partialsType", options.partialsType.toString()},
       {"sharedBuckets", (options.sharedBuckets ? "true" : "false")},
+      {"allowDenseFallback", (options.allowDenseFallback ? "true" : "false")},
       {"partitioner.optimiseForSpeed",
        (options.partitioner.optimiseForSpeed ? "true" : "false")},
       {"partitioner.forceBucketSpills",
@@ -0,0 +1,608 @@
+// Copyright (c) 2020 Graphcore Ltd. All rights reserved.
+
+#include "MultilevelPartitioner.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <numeric>
+#include <poplibs_support/logging.hpp>
+#include <poputil/exceptions.hpp>
+#include <queue>
+#include <random>
+#include <tbb/parallel_for.h>
+#include <tbb/parallel_invoke.h>
+
+namespace logging = poplibs_support::logging;
+
+namespace popsparse {
+namespace experimental {
+
+namespace {
+
+// Coarsening stops at this many nodes, or when a level merges too few nodes
+// to be worth refining
+constexpr unsigned coarsestNodes = 100;
+constexpr float minCoarseningRatio = 0.9f;
+// Hyperedges with more pins than this are ignored when matching nodes, as
+// they say little about which pairs of nodes belong together
+constexpr unsigned maxMatchingEdgeSize = 256;
+// Number of seeds grown to bisect the coarsest hypergraph
+constexpr unsigned numInitialBisections = 8;
+// Refinement passes at each level, and the number of moves without
+// improvement after which a pass gives up
+constexpr unsigned maxRefinementPasses = 4;
+constexpr unsigned minFruitlessMoves = 64;
+
+constexpr unsigned noNode = std::numeric_limits<unsigned>::max();
+
+// Hypergraph with unit hyperedge weights, holding the pins of each hyperedge
+// and the hyperedges of each node
+struct Hypergraph {
+  std::vector<float> nodeWeights;
+  // Pins of hyperedge e are pins[edgeStart[e]] to pins[edgeStart[e + 1] - 1]
+  std::vector<unsigned> edgeStart = {0};
+  std::vector<unsigned> pins;
+  // Hyperedges of node n are nodeEdges[nodeStart[n]] to
+  // nodeEdges[nodeStart[n + 1] - 1]
+  std::vector<unsigned> nodeStart;
+  std::vector<unsigned> nodeEdges;
+
+  unsigned numNodes() const { return nodeWeights.size(); }
+  unsigned numEdges() const { return edgeStart.size() - 1; }
+  unsigned edgeSize(unsigned e) const {
+    return edgeStart[e + 1] - edgeStart[e];
+  }
+
+  // Appends a hyperedge with the pins in [begin, end) mapped by nodeMap,
+  // skipping pins mapped to noNode and repeated pins. Hyperedges with fewer
+  // than two pins can never be cut so are dropped. mark must not hold stamp
+  // for any node before the call.
+  template <typename PinIt, typename NodeMap>
+  void addEdge(PinIt begin, PinIt end, NodeMap nodeMap, unsigned stamp,
+               std::vector<unsigned> &mark) {
+    const auto start = pins.size();
+    for (auto it = begin; it != end; ++it) {
+      const unsigned p = nodeMap(*it);
+      if (p != noNode && mark[p] != stamp) {
+        mark[p] = stamp;
+        pins.push_back(p);
+      }
+    }
+    if (pins.size() - start < 2) {
+      pins.resize(start);
+    } else {
+      edgeStart.push_back(pins.size());
+    }
+  }
+
+  void buildNodeEdges() {
+    nodeStart.assign(numNodes() + 1, 0);
+    for (auto p : pins) {
+      ++nodeStart[p + 1];
+    }
+    std::partial_sum(nodeStart.begin(), nodeStart.end(), nodeStart.begin());
+    nodeEdges.resize(pins.size());
+    std::vector<unsigned> next(nodeStart.begin(), nodeStart.end() - 1);
+    for (unsigned e = 0; e < numEdges(); ++e) {
+      for (unsigned i = edgeStart[e]; i < edgeStart[e + 1]; ++i) {
+        nodeEdges[next[pins[i]]++] = e;
+      }
+    }
+  }
+};
+
+// Side 0 or 1 of each node of a bisection
+using Sides = std::vector<std::uint8_t>;
+using SideWeights = std::array<float, 2>;
+
+Hypergraph subHypergraph(const Hypergraph &hg,
+                         const std::vector<unsigned> &nodes) {
+  Hypergraph sub;
+  std::vector<unsigned> localId(hg.numNodes(), noNode);
+  sub.nodeWeights.reserve(nodes.size());
+  for (unsigned i = 0; i < nodes.size(); ++i) {
+    localId[nodes[i]] = i;
+    sub.nodeWeights.push_back(hg.nodeWeights[nodes[i]]);
+  }
+  std::vector<unsigned> mark(nodes.size(), noNode);
+  for (unsigned e = 0; e < hg.numEdges(); ++e) {
+    sub.addEdge(hg.pins.begin() + hg.edgeStart[e],
+                hg.pins.begin() + hg.edgeStart[e + 1],
+                [&](unsigned p) { return localId[p]; }, e, mark);
+  }
+  sub.buildNodeEdges();
+  return sub;
+}
+
+// Matches each node with the unmatched neighbour it shares the most
+// hyperedges with, counting each hyperedge as 1 / (size - 1) so that small
+// hyperedges count for more. Matched pairs may not weigh more than
+// maxNodeWeight. Returns the number of coarse nodes.
+unsigned matchNodes(const Hypergraph &hg, float maxNodeWeight,
+                    std::mt19937 &rng, std::vector<unsigned> &coarseNode) {
+  const auto n = hg.numNodes();
+  std::vector<unsigned> order(n);
+  std::iota(order.begin(), order.end(), 0);
+  std::shuffle(order.begin(), order.end(), rng);
+
+  coarseNode.assign(n, noNode);
+  std::vector<float> score(n, 0.0f);
+  std::vector<unsigned> neighbours;
+  unsigned numCoarse = 0;
+  for (const auto u : order) {
+    if (coarseNode[u] != noNode) {
+      continue;
+    }
+    neighbours.clear();
+    for (unsigned i = hg.nodeStart[u]; i < hg.nodeStart[u + 1]; ++i) {
+      const auto e = hg.nodeEdges[i];
+      const auto size = hg.edgeSize(e);
+      if (size > maxMatchingEdgeSize) {
+        continue;
+      }
+      const float w = 1.0f / (size - 1);
+      for (unsigned j = hg.edgeStart[e]; j < hg.edgeStart[e + 1]; ++j) {
+        const auto v = hg.pins[j];
+        if (v == u || coarseNode[v] != noNode ||
+            hg.nodeWeights[u] + hg.nodeWeights[v] > maxNodeWeight) {
+          continue;
+        }
+        if (score[v] == 0.0f) {
+          neighbours.push_back(v);
+        }
+        score[v] += w;
+      }
+    }
+    auto best = noNode;
+    float bestScore = 0.0f;
+    for (const auto v : neighbours) {
+      if (score[v] > bestScore) {
+        best = v;
+        bestScore = score[v];
+      }
+      score[v] = 0.0f;
+    }
+    coarseNode[u] = numCoarse;
+    if (best != noNode) {
+      coarseNode[best] = numCoarse;
+    }
+    ++numCoarse;
+  }
+  return numCoarse;
+}
+
+Hypergraph contract(const Hypergraph &hg,
+                    const std::vector<unsigned> &coarseNode,
+                    unsigned numCoarse) {
+  Hypergraph coarse;
+  coarse.nodeWeights.assign(numCoarse, 0.0f);
+  for (unsigned n = 0; n < hg.numNodes(); ++n) {
+    coarse.nodeWeights[coarseNode[n]] += hg.nodeWeights[n];
+  }
+  std::vector<unsigned> mark(numCoarse, noNode);
+  for (unsigned e = 0; e < hg.numEdges(); ++e) {
+    coarse.addEdge(hg.pins.begin() + hg.edgeStart[e],
+                   hg.pins.begin() + hg.edgeStart[e + 1],
+                   [&](unsigned p) { return coarseNode[p]; }, e, mark);
+  }
+  coarse.buildNodeEdges();
+  return coarse;
+}
+
+SideWeights getSideWeights(const Hypergraph &hg, const Sides &side) {
+  SideWeights weight = {0.0f, 0.0f};
+  for (unsigned n = 0; n < hg.numNodes(); ++n) {
+    weight[side[n]] += hg.nodeWeights[n];
+  }
+  return weight;
+}
+
+// Weight by which the sides exceed their limits
+float getExcess(const SideWeights &weight, const SideWeights &maxWeight) {
+  return std::max(0.0f, weight[0] - maxWeight[0]) +
+         std::max(0.0f, weight[1] - maxWeight[1]);
+}
+
+unsigned getCut(const Hypergraph &hg, const Sides &side) {
+  unsigned cut = 0;
+  for (unsigned e = 0; e < hg.numEdges(); ++e) {
+    const auto first = side[hg.pins[hg.edgeStart[e]]];
+    for (unsigned i = hg.edgeStart[e] + 1; i < hg.edgeStart[e + 1]; ++i) {
+      if (side[hg.pins[i]] != first) {
+        ++cut;
+        break;
+      }
+    }
+  }
+  return cut;
+}
+
+// Fiduccia-Mattheyses refinement. Each pass moves every node at most once,
+// taking the move with the highest gain in cut that keeps the sides within
+// maxWeight or reduces their excess weight, and keeps the best prefix of the
+// moves: the one with the least excess weight, then the lowest cut.
+void refine(const Hypergraph &hg, Sides &side, const SideWeights &maxWeight) {
+  const auto n = hg.numNodes();
+  if (n < 2) {
+    return;
+  }
+  std::vector<std::array<unsigned, 2>> pinsOnSide(hg.numEdges());
+  std::vector<int> gain(n);
+  std::vector<bool> locked(n);
+  std::vector<unsigned> moves;
+  const std::size_t maxFruitlessMoves = std::max(minFruitlessMoves, n / 8);
+
+  for (unsigned pass = 0; pass < maxRefinementPasses; ++pass) {
+    auto weight = getSideWeights(hg, side);
+    for (unsigned e = 0; e < hg.numEdges(); ++e) {
+      pinsOnSide[e] = {0, 0};
+      for (unsigned i = hg.edgeStart[e]; i < hg.edgeStart[e + 1]; ++i) {
+        ++pinsOnSide[e][side[hg.pins[i]]];
+      }
+    }
+    // Gains change as nodes move, so the queue may hold stale entries which
+    // are skipped when they do not match the current gain.
+    std::priority_queue<std::pair<int, unsigned>> queue;
+    for (unsigned v = 0; v < n; ++v) {
+      gain[v] = 0;
+      for (unsigned i = hg.nodeStart[v]; i < hg.nodeStart[v + 1]; ++i) {
+        const auto &count = pinsOnSide[hg.nodeEdges[i]];
+        gain[v] += (count[side[v]] == 1) - (count[1 - side[v]] == 0);
+      }
+      queue.emplace(gain[v], v);
+    }
+    std::fill(locked.begin(), locked.end(), false);
+    const auto updateGain = [&](unsigned u, int delta) {
+      if (!locked[u]) {
+        gain[u] += delta;
+        queue.emplace(gain[u], u);
+      }
+    };
+
+    moves.clear();
+    auto excess = getExcess(weight, maxWeight);
+    const auto initialExcess = excess;
+    auto bestExcess = excess;
+    int totalGain = 0, bestGain = 0;
+    std::size_t bestMoves = 0;
+    while (!queue.empty() && moves.size() - bestMoves < maxFruitlessMoves) {
+      const auto entry = queue.top();
+      queue.pop();
+      const auto v = entry.second;
+      if (locked[v] || entry.first != gain[v]) {
+        continue;
+      }
+      const unsigned from = side[v], to = 1 - from;
+      const auto w = hg.nodeWeights[v];
+      auto newWeight = weight;
+      newWeight[from] -= w;
+      newWeight[to] += w;
+      const auto newExcess = getExcess(newWeight, maxWeight);
+      if (newExcess > excess) {
+        continue;
+      }
+
+      locked[v] = true;
+      side[v] = to;
+      for (unsigned i = hg.nodeStart[v]; i < hg.nodeStart[v + 1]; ++i) {
+        const auto e = hg.nodeEdges[i];
+        auto &count = pinsOnSide[e];
+        const auto begin = hg.edgeStart[e], end = hg.edgeStart[e + 1];
+        // Moving the last pin off a side removes the hyperedge from the cut,
+        // and moving the first pin onto a side adds it.
+        if (count[to] == 0) {
+          for (unsigned j = begin; j < end; ++j) {
+            updateGain(hg.pins[j], 1);
+          }
+        } else if (count[to] == 1) {
+          for (unsigned j = begin; j < end; ++j) {
+            if (side[hg.pins[j]] == to) {
+              updateGain(hg.pins[j], -1);
+            }
+          }
+        }
+        --count[from];
+        ++count[to];
+        if (count[from] == 0) {
+          for (unsigned j = begin; j < end; ++j) {
+            updateGain(hg.pins[j], -1);
+          }
+        } else if (count[from] == 1) {
+          for (unsigned j = begin; j < end; ++j) {
+            if (side[hg.pins[j]] == from) {
+              updateGain(hg.pins[j], 1);
+            }
+          }
+        }
+      }
+      weight = newWeight;
+      excess = newExcess;
+      totalGain += entry.first;
+      moves.push_back(v);
+      if (excess < bestExcess ||
+          (excess == bestExcess && totalGain > bestGain)) {
+        bestExcess = excess;
+        bestGain = totalGain;
+        bestMoves = moves.size();
+      }
+    }
+
+    for (auto i = moves.size(); i > bestMoves; --i) {
+      side[moves[i - 1]] ^= 1;
+    }
+    if (bestGain <= 0 && bestExcess >= initialExcess) {
+      break;
+    }
+  }
+}
+
+// The last node reached by a breadth first search from start, which is at
+// the edge of its connected component
+unsigned getFarthestNode(const Hypergraph &hg, unsigned start) {
+  std::vector<bool> visited(hg.numNodes());
+  std::vector<unsigned> frontier = {start};
+  visited[start] = true;
+  for (std::size_t next = 0; next < frontier.size(); ++next) {
+    const auto v = frontier[next];
+    for (unsigned i = hg.nodeStart[v]; i < hg.nodeStart[v + 1]; ++i) {
+      const auto e = hg.nodeEdges[i];
+      for (unsigned j = hg.edgeStart[e]; j < hg.edgeStart[e + 1]; ++j) {
+        if (!visited[hg.pins[j]]) {
+          visited[hg.pins[j]] = true;
+          frontier.push_back(hg.pins[j]);
+        }
+      }
+    }
+  }
+  return frontier.back();
+}
+
+// Grows side 0 from a random node, or from the node farthest from it, adding
+// the node most connected to side 0 until it reaches target0
+Sides growBisection(const Hypergraph &hg, float target0, bool fromFarthest,
+                    std::mt19937 &rng) {
+  const auto n = hg.numNodes();
+  Sides side(n, 1);
+  std::vector<float> connection(n, 0.0f);
+  std::priority_queue<std::pair<float, unsigned>> queue;
+  std::uniform_int_distribution<unsigned> pickNode(0, n - 1);
+  float weight0 = 0.0f;
+  for (unsigned grown = 0; grown < n && weight0 < target0; ++grown) {
+    auto v = noNode;
+    while (!queue.empty() && v == noNode) {
+      const auto entry = queue.top();
+      queue.pop();
+      if (side[entry.second] == 1 && entry.first == connection[entry.second]) {
+        v = entry.second;
+      }
+    }
+    if (v == noNode) {
+      // Start, or continue in another connected component
+      v = pickNode(rng);
+      while (side[v] == 0) {
+        v = (v + 1) % n;
+      }
+      if (grown == 0 && fromFarthest) {
+        v = getFarthestNode(hg, v);
+      }
+    }
+    side[v] = 0;
+    weight0 += hg.nodeWeights[v];
+    for (unsigned i = hg.nodeStart[v]; i < hg.nodeStart[v + 1]; ++i) {
+      const auto e = hg.nodeEdges[i];
+      const float w = 1.0f / (hg.edgeSize(e) - 1);
+      for (unsigned j = hg.edgeStart[e]; j < hg.edgeStart[e + 1]; ++j) {
+        const auto u = hg.pins[j];
+        if (side[u] == 1) {
+          connection[u] += w;
+          queue.emplace(connection[u], u);
+        }
+      }
+    }
+  }
+  return side;
+}
+
+Sides initialBisection(const Hypergraph &hg, float target0,
+                       const SideWeights &maxWeight, unsigned seed) {
+  std::vector<Sides> bisections(numInitialBisections);
+  tbb::parallel_for(0u, numInitialBisections, [&](unsigned i) {
+    std::seed_seq seq{seed, i};
+    std::mt19937 rng(seq);
+    bisections[i] = growBisection(hg, target0, i % 2 == 1, rng);
+    refine(hg, bisections[i], maxWeight);
+  });
+
+  std::size_t best = 0;
+  float bestExcess = std::numeric_limits<float>::max();
+  unsigned bestCut = std::numeric_limits<unsigned>::max();
+  for (std::size_t i = 0; i < bisections.size(); ++i) {
+    const auto excess =
+        getExcess(getSideWeights(hg, bisections[i]), maxWeight);
+    const auto cut = getCut(hg, bisections[i]);
+    if (excess < bestExcess || (excess == bestExcess && cut < bestCut)) {
+      best = i;
+      bestExcess = excess;
+      bestCut = cut;
+    }
+  }
+  return std::move(bisections[best]);
+}
+
+// Bisects hg so that side 0 has fraction0 of the weight
+Sides bisect(const Hypergraph &hg, float fraction0, float imbalance,
+             unsigned seed) {
+  const auto &weights = hg.nodeWeights;
+  const auto total = std::accumulate(weights.begin(), weights.end(), 0.0f);
+  const auto maxNodeWeight = *std::max_element(weights.begin(), weights.end());
+  const SideWeights target = {total * fraction0, total * (1.0f - fraction0)};
+  const SideWeights maxWeight = {target[0] * (1.0f + imbalance),
+                                 target[1] * (1.0f + imbalance)};
+  const auto maxClusterWeight =
+      std::max(maxNodeWeight, total / static_cast<float>(coarsestNodes));
+
+  std::seed_seq seq{seed};
+  std::mt19937 rng(seq);
+  // Coarse hypergraphs, and the node each node of the finer level is merged
+  // into
+  std::vector<std::unique_ptr<Hypergraph>> levels;
+  std::vector<std::vector<unsigned>> coarseNodes;
+  const Hypergraph *current = &hg;
+  while (current->numNodes() > coarsestNodes) {
+    std::vector<unsigned> coarseNode;
+    const auto numCoarse =
+        matchNodes(*current, maxClusterWeight, rng, coarseNode);
+    if (numCoarse > minCoarseningRatio * current->numNodes()) {
+      break;
+    }
+    levels.push_back(std::make_unique<Hypergraph>(
+        contract(*current, coarseNode, numCoarse)));
+    coarseNodes.push_back(std::move(coarseNode));
+    current = levels.back().get();
+  }
+
+  auto side = initialBisection(*current, target[0], maxWeight, seed);
+  for (auto level = coarseNodes.size(); level-- > 0;) {
+    const auto &fine = level == 0 ? hg : *levels[level - 1];
+    Sides fineSide(fine.numNodes());
+    for (unsigned n = 0; n < fine.numNodes(); ++n) {
+      fineSide[n] = side[coarseNodes[level][n]];
+    }
+    side = std::move(fineSide);
+    refine(fine, side, maxWeight);
+  }
+  return side;
+}
+
+// Assigns the nodes of hg, which are nodes ids of the input hypergraph, to
+// parts firstPart to firstPart + numParts - 1
+void partitionRecursive(const Hypergraph &hg, const std::vector<unsigned> &ids,
+                        unsigned firstPart, unsigned numParts, float imbalance,
+                        unsigned seed, std::vector<int> &nodeAssignment) {
+  if (numParts == 1 || hg.numNodes() <= 1) {
+    for (const auto id : ids) {
+      nodeAssignment[id] = firstPart;
+    }
+    return;
+  }
+  // Each bisection has its own seed so that the partition does not depend on
+  // the order in which they run. The range of parts identifies the bisection.
+  std::seed_seq seq{seed, firstPart, numParts};
+  unsigned bisectionSeed;
+  seq.generate(&bisectionSeed, &bisectionSeed + 1);
+  const auto parts0 = numParts / 2;
+  const auto side = bisect(hg, static_cast<float>(parts0) / numParts,
+                           imbalance, bisectionSeed);
+  std::array<std::vector<unsigned>, 2> nodes, subIds;
+  for (unsigned n = 0; n < hg.numNodes(); ++n) {
+    nodes[side[n]].push_back(n);
+    subIds[side[n]].push_back(ids[n]);
+  }
+  tbb::parallel_invoke(
+      [&] {
+        partitionRecursive(subHypergraph(hg, nodes[0]), subIds[0], firstPart,
+                           parts0, imbalance, seed, nodeAssignment);
+      },
+      [&] {
+        partitionRecursive(subHypergraph(hg, nodes[1]), subIds[1],
+                           firstPart + parts0, numParts - parts0, imbalance,
+                           seed, nodeAssignment);
+      });
+}
+
+} // end anonymous namespace
+
+float MultilevelPartitioner::partitionGraph(const HyperGraphData &graphData,
+                                            int nPartition,
+                                            std::vector<int> &nodeAssignment) {
+  if (nPartition <= 0) {
+    throw poputil::poplibs_error("Number of partitions must be positive");
+  }
+  if (graphData.weights.size() != graphData.nodes) {
+    throw poputil::poplibs_error("Hypergraph must have a weight for each node");
+  }
+
+  Hypergraph hg;
+  hg.nodeWeights = graphData.weights;
+  std::vector<unsigned> mark(graphData.nodes, noNode);
+  for (unsigned e = 0; e < graphData.hyperEdges.size(); ++e) {
+    const auto begin = graphData.hyperEdges[e];
+    const auto end = e + 1 < graphData.hyperEdges.size()
+                         ? graphData.hyperEdges[e + 1]
+                         : graphData.pins.size();
+    if (begin > end || end > graphData.pins.size()) {
+      throw poputil::poplibs_error("Hypergraph has invalid hyperedge offsets");
+    }
+    for (unsigned i = begin; i < end; ++i) {
+      if (graphData.pins[i] >= graphData.nodes) {
+        throw poputil::poplibs_error("Hypergraph pin is not a node");
+      }
+    }
+    hg.addEdge(graphData.pins.begin() + begin, graphData.pins.begin() + end,
+               [](unsigned p) { return p; }, e, mark);
+  }
+  hg.buildNodeEdges();
+
+  // The imbalance of nested bisections compounds, so each level is allowed
+  // its share of it
+  const auto depth = std::ceil(std::log2(static_cast<float>(nPartition)));
+  const auto levelImbalance =
+      depth > 0 ? std::pow(1.0f + imbalance, 1.0f / depth) - 1.0f : imbalance;
+
+  std::vector<unsigned> ids(graphData.nodes);
+  std::iota(ids.begin(), ids.end(), 0);
+  nodeAssignment.assign(graphData.nodes, 0);
+  partitionRecursive(hg, ids, 0, nPartition, levelImbalance, seed,
+                     nodeAssignment);
+
+  float minWeight, maxWeight, avgWeight, balance;
+  int minTileId, maxTileId, zeroTiles;
+  computeLoadBalance(graphData.weights, nPartition, nodeAssignment, minWeight,
+                     minTileId, maxWeight, maxTileId, avgWeight, balance,
+                     zeroTiles);
+
+  logging::popsparse::info("Min weight {} on tile {}", minWeight, minTileId);
+  logging::popsparse::info("Max weight {} on tile {}", maxWeight, maxTileId);
+  logging::popsparse::info("Average weight {}", avgWeight);
+  logging::popsparse::info("Connectivity cut {}",
+                           computeConnectivityCut(graphData, nodeAssignment));
+  logging::popsparse::info(
+      "partition load balance {}, number of tile that has no "
+      "assignment {}",
+      balance, zeroTiles);
+
+  return balance + zeroTiles;
+}
+
+std::string MultilevelPartitioner::getName() const {
+  return "multilevel-" + std::to_string(imbalance) + "-" +
+         std::to_string(seed);
+}
+
+std::size_t MultilevelPartitioner::computeConnectivityCut(
+    const HyperGraphData &graphData, const std::vector<int> &nodeAssignment) {
+  std::size_t cut = 0;
+  std::vector<int> parts;
+  for (std::size_t e = 0; e < graphData.hyperEdges.size(); ++e) {
+    const auto end = e + 1 < graphData.hyperEdges.size()
+                         ? graphData.hyperEdges[e + 1]
+                         : graphData.pins.size();
+    parts.clear();
+    for (auto i = graphData.hyperEdges[e]; i < end; ++i) {
+      parts.push_back(nodeAssignment[graphData.pins[i]]);
+    }
+    std::sort(parts.begin(), parts.end());
+    const auto numParts =
+        std::unique(parts.begin(), parts.end()) - parts.begin();
+    if (numParts > 1) {
+      cut += numParts - 1;
+    }
+  }
+  return cut;
+}
+
+} // namespace experimental
+} // namespace popsparse
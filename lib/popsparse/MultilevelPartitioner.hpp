@@ -0,0 +1,52 @@
+// Copyright (c) 2020 Graphcore Ltd. All rights reserved.
+
+#ifndef popsparse_MultilevelPartitioner_hpp
+#define popsparse_MultilevelPartitioner_hpp
+
+#include "HyperGraphPartitioner.hpp"
+#include <cstddef>
+
+namespace popsparse {
+namespace experimental {
+
+/*
+A multilevel hypergraph partitioner.
+
+The hypergraph is split into nPartition parts by recursive bisection, and the
+two halves of each bisection are partitioned in parallel. Each bisection
+coarsens the hypergraph by merging pairs of nodes that share heavy
+hyperedges, bisects the coarsest hypergraph by growing one side from several
+seeds, and projects the bisection back through the levels, refining it with
+Fiduccia-Mattheyses passes at each one.
+
+The objective is the connectivity cut, the sum over hyperedges of the number
+of parts they span minus one, with the weight of each part at most
+(1 + imbalance) times its share of the total weight. The partition depends
+only on the hypergraph, the number of parts and the seed.
+*/
+class MultilevelPartitioner : public HyperGraphPartitioner {
+public:
+  MultilevelPartitioner(float imbalanceIn = 0.1f, unsigned seedIn = 1)
+      : imbalance(imbalanceIn), seed(seedIn) {}
+
+  virtual ~MultilevelPartitioner() = default;
+
+  virtual float partitionGraph(const HyperGraphData &graphData, int nPartition,
+                               std::vector<int> &nodeAssignment) override;
+
+  virtual std::string getName() const override;
+
+  // The sum over hyperedges of the number of parts they span minus one
+  static std::size_t
+  computeConnectivityCut(const HyperGraphData &graphData,
+                         const std::vector<int> &nodeAssignment);
+
+private:
+  float imbalance;
+  unsigned seed;
+};
+
+} // namespace experimental
+} // namespace popsparse
+
+#endif
@@ -0,0 +1,677 @@
+// Copyright (c) 2020 Graphcore Ltd. All rights reserved.
+
+#include "popsparse/experimental/NMSparseMatMul.hpp"
+#include "PerformanceEstimation.hpp"
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <numeric>
+#include <poplibs_support/Algorithm.hpp>
+#include <poplibs_support/logging.hpp>
+#include <popops/Reduce.hpp>
+#include <poputil/DebugInfo.hpp>
+#include <poputil/OptionParsing.hpp>
+#include <poputil/VertexTemplates.hpp>
+#include <poputil/exceptions.hpp>
+#include <sstream>
+#include <string>
+
+namespace logging = poplibs_support::logging;
+
+namespace poputil {
+template <>
+poplar::ProfileValue
+toProfileValue(const popsparse::experimental::NMMatMulParams &t) {
+  poplar::ProfileValue::Map v;
+  v.insert({"n", toProfileValue(t.n)});
+  v.insert({"m", toProfileValue(t.m)});
+  v.insert({"numRows", toProfileValue(t.numRows)});
+  v.insert({"numColumns", toProfileValue(t.numColumns)});
+  v.insert({"batchSize", toProfileValue(t.batchSize)});
+  return v;
+}
+
+template <>
+poplar::ProfileValue
+toProfileValue(const popsparse::experimental::NMSparseTensor &t) {
+  poplar::ProfileValue::Map v;
+  v.insert({"nzValues", toProfileValue(t.nzValues)});
+  v.insert({"metaInfo", toProfileValue(t.metaInfo)});
+  return v;
+}
+} // namespace poputil
+
+using namespace poplar;
+using namespace poplar::program;
+using namespace poputil;
+
+namespace popsparse {
+namespace experimental {
+
+namespace {
+
+// Number of bits of the meta-information used for the column of a value in
+// its group
+unsigned getIndexBits(unsigned m) {
+  return std::max(1u, poplibs_support::ceilLog2(m));
+}
+
+void validateNMShape(std::size_t numColumns, unsigned n, unsigned m) {
+  if (n == 0 || m < n) {
+    throw poplibs_error("N:M sparsity needs 0 < n <= m, got " +
+                        std::to_string(n) + ":" + std::to_string(m));
+  }
+  if (numColumns % m) {
+    throw poplibs_error("Number of columns " + std::to_string(numColumns) +
+                        " is not a multiple of m = " + std::to_string(m));
+  }
+  if (n * getIndexBits(m) > 16) {
+    throw poplibs_error("The columns of the " + std::to_string(n) +
+                        " values of a group of " + std::to_string(m) +
+                        " do not fit in 16 bits of meta-information");
+  }
+}
+
+void validateParams(const NMMatMulParams &params) {
+  validateNMShape(params.numColumns, params.n, params.m);
+  if (params.numRows == 0 || params.numColumns == 0 || params.batchSize == 0) {
+    throw poplibs_error("N:M sparse matmul with an empty dimension");
+  }
+}
+
+void validateShape(const Tensor &t, const std::vector<std::size_t> &shape,
+                   const std::string &name) {
+  if (t.shape() != shape) {
+    std::stringstream ss;
+    ss << "Shape of " << name << " " << t.shapeToString()
+       << " does not match the parameters, expected {";
+    for (std::size_t i = 0; i < shape.size(); ++i) {
+      ss << (i ? "," : "") << shape[i];
+    }
+    ss << "}";
+    throw poplibs_error(ss.str());
+  }
+}
+
+std::size_t getNzPerRow(const NMMatMulParams &params) {
+  return params.numColumns / params.m * params.n;
+}
+
+std::size_t getGroupsPerRow(const NMMatMulParams &params) {
+  return params.numColumns / params.m;
+}
+
+void validateMetaInfo(const Tensor &metaInfo, const NMMatMulParams &params) {
+  validateShape(metaInfo, {params.numRows, getGroupsPerRow(params)},
+                "meta-information");
+  if (metaInfo.elementType() != UNSIGNED_SHORT) {
+    throw poplibs_error("Meta-information must be of type UNSIGNED_SHORT");
+  }
+}
+
+Type parsePartialsType(const OptionFlags &options, const Type &inputType) {
+  if (inputType != FLOAT && inputType != HALF) {
+    throw poplibs_error("Only FLOAT and HALF types are supported");
+  }
+  Type partialsType = FLOAT;
+  using poplibs::OptionHandler;
+  using poplibs::OptionSpec;
+  const OptionSpec nmSpec{
+      {"partialsType",
+       OptionHandler::createWithEnum(partialsType,
+                                     {{"half", HALF}, {"float", FLOAT}})},
+  };
+  for (const auto &entry : options) {
+    nmSpec.parse(entry.first, entry.second);
+  }
+  if (partialsType == HALF && inputType != HALF) {
+    throw poplibs_error("HALF partials are only supported for HALF inputs");
+  }
+  return partialsType;
+}
+
+// Tiles form a grid of rowSplit ranges of rows of the weights by batchSplit
+// ranges of the batch. Every row has the same number of non-zero values, so
+// equal ranges give each tile the same work.
+struct NMPartition {
+  unsigned rowSplit;
+  unsigned batchSplit;
+};
+
+// The weights and activations are created for the forward pass, the
+// gradient passes are partitioned for their own work
+enum class NMPass { FWD, GRAD_A, GRAD_W };
+
+const char *asString(NMPass pass) {
+  switch (pass) {
+  case NMPass::FWD:
+    return "forward";
+  case NMPass::GRAD_A:
+    return "gradA";
+  case NMPass::GRAD_W:
+    return "gradW";
+  }
+  throw poplibs_error("Unknown N:M sparse matmul pass");
+}
+
+Interval getPartRange(std::size_t size, unsigned numParts, unsigned part) {
+  return {part * size / numParts, (part + 1) * size / numParts};
+}
+
+// Cycles to sum the partials of numParts parts into an output of outputSize
+// elements spread over all tiles. A single part is only cast, if needed.
+std::uint64_t getReduceCycles(const Target &target, std::size_t outputSize,
+                              unsigned numParts, const Type &partialsType,
+                              const Type &outputType) {
+  if (numParts == 1 && partialsType == outputType) {
+    return 0;
+  }
+  const unsigned numWorkers = target.getNumWorkerContexts();
+  const auto outputPerTile =
+      poplibs_support::ceildiv(outputSize, target.getNumTiles());
+  if (numParts == 1) {
+    return getCastCycleEstimate(outputPerTile,
+                                target.getVectorWidth(partialsType),
+                                target.getVectorWidth(outputType), numWorkers);
+  }
+  // Each tile receives the partials of its outputs from the other parts
+  const auto bytes =
+      outputPerTile * (numParts - 1) * target.getTypeSize(partialsType);
+  return bytes / target.getExchangeBytesPerCycle() +
+         getReduceCycleEstimate(outputPerTile, numParts,
+                                target.getDataPathWidth(),
+                                outputType == FLOAT, partialsType == FLOAT,
+                                numWorkers);
+}
+
+NMPartition getPartition(const Target &target, const Type &inputType,
+                         const Type &partialsType,
+                         const NMMatMulParams &params, NMPass pass) {
+  const unsigned numTiles = target.getNumTiles();
+  const unsigned numWorkers = target.getNumWorkerContexts();
+  const auto typeSize = target.getTypeSize(inputType);
+  const auto metaInfoTypeSize = target.getTypeSize(UNSIGNED_SHORT);
+  const auto exchangeBytesPerCycle = target.getExchangeBytesPerCycle();
+  const auto nzPerRow = getNzPerRow(params);
+  const auto groupsPerRow = getGroupsPerRow(params);
+
+  NMPartition best{1, 1};
+  std::uint64_t bestCost = std::numeric_limits<std::uint64_t>::max();
+  const auto maxRowSplit =
+      static_cast<unsigned>(std::min<std::size_t>(numTiles, params.numRows));
+  for (unsigned rowSplit = 1; rowSplit <= maxRowSplit; ++rowSplit) {
+    const auto batchSplit = static_cast<unsigned>(
+        std::min<std::size_t>(numTiles / rowSplit, params.batchSize));
+    const auto rows = poplibs_support::ceildiv(params.numRows, rowSplit);
+    const auto batch = poplibs_support::ceildiv(params.batchSize, batchSplit);
+    const auto metaInfoBytes = rows * groupsPerRow * metaInfoTypeSize;
+    const auto nzBytes = rows * nzPerRow * typeSize;
+    const auto actsBytes = batch * params.numColumns * typeSize;
+    const auto gradientsBytes = batch * rows * typeSize;
+    // Each tile receives the inputs of its vertices, which split the rows
+    // over the workers, or the groups for the gradient of the activations.
+    // The gradient passes then sum the partials of the parts of the
+    // dimension they do not split.
+    std::uint64_t cost = 0;
+    switch (pass) {
+    case NMPass::FWD:
+      cost = getNMSparseMatMulCycles(
+                 batch, poplibs_support::ceildiv(rows, numWorkers), nzPerRow) +
+             (metaInfoBytes + nzBytes + actsBytes) / exchangeBytesPerCycle;
+      break;
+    case NMPass::GRAD_A:
+      cost = getNMSparseMatMulCycles(
+                 batch, rows,
+                 poplibs_support::ceildiv(groupsPerRow, numWorkers) *
+                     params.n) +
+             (metaInfoBytes + nzBytes + gradientsBytes) /
+                 exchangeBytesPerCycle +
+             getReduceCycles(target, params.batchSize * params.numColumns,
+                             rowSplit, partialsType, inputType);
+      break;
+    case NMPass::GRAD_W:
+      cost = getNMSparseMatMulCycles(
+                 batch, poplibs_support::ceildiv(rows, numWorkers), nzPerRow) +
+             (metaInfoBytes + actsBytes + gradientsBytes) /
+                 exchangeBytesPerCycle +
+             getReduceCycles(target, params.numRows * nzPerRow, batchSplit,
+                             partialsType, inputType);
+      break;
+    }
+    if (cost < bestCost) {
+      bestCost = cost;
+      best = {rowSplit, batchSplit};
+    }
+  }
+  logging::popsparse::debug(
+      "N:M sparse matmul {} partition: {} rows x {} batch", asString(pass),
+      best.rowSplit, best.batchSplit);
+  return best;
+}
+
+unsigned getTile(const NMPartition &partition, unsigned rowPart,
+                 unsigned batchPart) {
+  return rowPart * partition.batchSplit + batchPart;
+}
+
+// Calls f for each tile of the partition with its ranges of rows of the
+// weights and of the batch
+void forEachTile(const NMPartition &partition, const NMMatMulParams &params,
+                 const std::function<void(unsigned, unsigned, unsigned,
+                                          const Interval &, const Interval &)>
+                     &f) {
+  for (unsigned rowPart = 0; rowPart < partition.rowSplit; ++rowPart) {
+    const auto rows = getPartRange(params.numRows, partition.rowSplit, rowPart);
+    for (unsigned batchPart = 0; batchPart < partition.batchSplit;
+         ++batchPart) {
+      const auto batch =
+          getPartRange(params.batchSize, partition.batchSplit, batchPart);
+      f(getTile(partition, rowPart, batchPart), rowPart, batchPart, rows,
+        batch);
+    }
+  }
+}
+
+// Spreads the rows of t over the given tiles
+void mapRowsOverTiles(Graph &graph, const Tensor &t,
+                      const std::vector<unsigned> &tiles) {
+  for (unsigned i = 0; i < tiles.size(); ++i) {
+    const auto rows = getPartRange(t.dim(0), tiles.size(), i);
+    if (rows.size()) {
+      graph.setTileMapping(t.slice(rows), tiles[i]);
+    }
+  }
+}
+
+void setNMFields(Graph &graph, VertexRef v, const NMMatMulParams &params) {
+  graph.setInitialValue(v["nzPerGroup"], params.n);
+  graph.setInitialValue(v["groupSize"], params.m);
+  graph.setInitialValue(v["indexBits"], getIndexBits(params.m));
+}
+
+// Sums the partials of each part into the result, or reuses them if there is
+// a single part of the right type
+Tensor reduceParts(Graph &graph, const Tensor &partials, const Type &outType,
+                   Sequence &prog, const DebugNameAndId &dnai) {
+  if (partials.dim(0) == 1 && partials.elementType() == outType) {
+    return partials[0];
+  }
+  return popops::reduce(graph, partials, outType, {0}, popops::Operation::ADD,
+                        prog, {dnai, "reduce"});
+}
+
+} // end anonymous namespace
+
+template <typename T>
+NMMatrix<T> denseToNM(const std::vector<T> &dense, std::size_t numRows,
+                      std::size_t numColumns, unsigned n, unsigned m) {
+  validateNMShape(numColumns, n, m);
+  if (dense.size() != numRows * numColumns) {
+    throw poplibs_error("Dense matrix of " + std::to_string(dense.size()) +
+                        " values does not have " + std::to_string(numRows) +
+                        " rows of " + std::to_string(numColumns) + " columns");
+  }
+  NMMatrix<T> nm(numRows, numColumns, n, m);
+  const auto indexBits = getIndexBits(m);
+  std::vector<unsigned> columns(m);
+  for (std::size_t group = 0; group < nm.metaInfo.size(); ++group) {
+    // The groups of a row-major matrix are contiguous
+    const T *values = dense.data() + group * m;
+    std::iota(columns.begin(), columns.end(), 0);
+    std::stable_sort(columns.begin(), columns.end(),
+                     [&](unsigned a, unsigned b) {
+                       return std::abs(values[a]) > std::abs(values[b]);
+                     });
+    std::sort(columns.begin(), columns.begin() + n);
+    unsigned short meta = 0;
+    for (unsigned j = 0; j < n; ++j) {
+      nm.nzValues[group * n + j] = values[columns[j]];
+      meta |= columns[j] << (j * indexBits);
+    }
+    nm.metaInfo[group] = meta;
+  }
+  return nm;
+}
+
+template <typename T>
+NMMatrix<T> csrToNM(const CSRMatrix<T> &csr, std::size_t numRows,
+                    std::size_t numColumns, unsigned n, unsigned m) {
+  validateNMShape(numColumns, n, m);
+  if (csr.getBlockSize() != 1) {
+    throw poplibs_error("Only element-wise sparse CSR matrices can be "
+                        "converted to N:M");
+  }
+  if (csr.rowIndices.size() != numRows + 1 ||
+      csr.rowIndices.back() != csr.nzValues.size() ||
+      csr.columnIndices.size() != csr.nzValues.size()) {
+    throw poplibs_error("Invalid CSR matrix for " + std::to_string(numRows) +
+                        " rows");
+  }
+  NMMatrix<T> nm(numRows, numColumns, n, m);
+  const auto indexBits = getIndexBits(m);
+  const auto groupsPerRow = numColumns / m;
+  // Value of each column of a group, if it is a non-zero value of the CSR
+  std::vector<bool> used(m);
+  std::vector<T> values(m);
+  std::vector<std::vector<std::size_t>> groupEntries(groupsPerRow);
+  for (std::size_t row = 0; row < numRows; ++row) {
+    for (auto &entries : groupEntries) {
+      entries.clear();
+    }
+    for (auto i = csr.rowIndices[row]; i < csr.rowIndices[row + 1]; ++i) {
+      if (csr.columnIndices[i] >= numColumns) {
+        throw poplibs_error("CSR column index " +
+                            std::to_string(csr.columnIndices[i]) +
+                            " out of range");
+      }
+      groupEntries[csr.columnIndices[i] / m].push_back(i);
+    }
+    for (std::size_t g = 0; g < groupsPerRow; ++g) {
+      const auto &entries = groupEntries[g];
+      if (entries.size() > n) {
+        throw poplibs_error("Row " + std::to_string(row) + " has " +
+                            std::to_string(entries.size()) +
+                            " non-zero values in columns [" +
+                            std::to_string(g * m) + ", " +
+                            std::to_string((g + 1) * m) + "), more than " +
+                            std::to_string(n));
+      }
+      std::fill(used.begin(), used.end(), false);
+      for (auto i : entries) {
+        const auto column = csr.columnIndices[i] % m;
+        if (used[column]) {
+          throw poplibs_error("Duplicate CSR column index " +
+                              std::to_string(csr.columnIndices[i]) +
+                              " in row " + std::to_string(row));
+        }
+        used[column] = true;
+        values[column] = csr.nzValues[i];
+      }
+      // Pad with zeros in the first unused columns
+      for (unsigned column = 0, padding = n - entries.size(); padding;
+           ++column) {
+        if (!used[column]) {
+          used[column] = true;
+          values[column] = 0;
+          --padding;
+        }
+      }
+      const auto group = row * groupsPerRow + g;
+      unsigned short meta = 0;
+      for (unsigned column = 0, j = 0; column < m; ++column) {
+        if (used[column]) {
+          nm.nzValues[group * n + j] = values[column];
+          meta |= column << (j * indexBits);
+          ++j;
+        }
+      }
+      nm.metaInfo[group] = meta;
+    }
+  }
+  return nm;
+}
+
+template <typename T> std::vector<T> nmToDense(const NMMatrix<T> &nm) {
+  validateNMShape(nm.numColumns, nm.n, nm.m);
+  const auto indexBits = getIndexBits(nm.m);
+  const unsigned mask = (1u << indexBits) - 1;
+  std::vector<T> dense(nm.numRows * nm.numColumns, 0);
+  for (std::size_t group = 0; group < nm.metaInfo.size(); ++group) {
+    for (unsigned j = 0; j < nm.n; ++j) {
+      const auto column = (nm.metaInfo[group] >> (j * indexBits)) & mask;
+      dense[group * nm.m + column] = nm.nzValues[group * nm.n + j];
+    }
+  }
+  return dense;
+}
+
+template NMMatrix<float> denseToNM(const std::vector<float> &, std::size_t,
+                                   std::size_t, unsigned, unsigned);
+template NMMatrix<double> denseToNM(const std::vector<double> &, std::size_t,
+                                    std::size_t, unsigned, unsigned);
+template NMMatrix<float> csrToNM(const CSRMatrix<float> &, std::size_t,
+                                 std::size_t, unsigned, unsigned);
+template NMMatrix<double> csrToNM(const CSRMatrix<double> &, std::size_t,
+                                  std::size_t, unsigned, unsigned);
+template std::vector<float> nmToDense(const NMMatrix<float> &);
+template std::vector<double> nmToDense(const NMMatrix<double> &);
+
+NMSparseTensor createNMSparseWeights(Graph &graph, const Type &inputType,
+                                     const NMMatMulParams &params,
+                                     const DebugContext &debugContext,
+                                     const OptionFlags &options) {
+  PoplibsOpDebugInfo di(debugContext, DI_ARGS(inputType, params, options));
+  validateParams(params);
+  const auto partialsType = parsePartialsType(options, inputType);
+  const auto partition = getPartition(graph.getTarget(), inputType,
+                                      partialsType, params, NMPass::FWD);
+
+  NMSparseTensor weights;
+  weights.nzValues = graph.addVariable(
+      inputType, {params.numRows, getNzPerRow(params)}, {di, "nzValues"});
+  weights.metaInfo = graph.addVariable(
+      UNSIGNED_SHORT, {params.numRows, getGroupsPerRow(params)},
+      {di, "metaInfo"});
+  // The rows used by a range of tiles are spread over them
+  for (unsigned rowPart = 0; rowPart < partition.rowSplit; ++rowPart) {
+    const auto rows = getPartRange(params.numRows, partition.rowSplit, rowPart);
+    std::vector<unsigned> tiles;
+    for (unsigned batchPart = 0; batchPart < partition.batchSplit;
+         ++batchPart) {
+      tiles.push_back(getTile(partition, rowPart, batchPart));
+    }
+    mapRowsOverTiles(graph, weights.nzValues.slice(rows), tiles);
+    mapRowsOverTiles(graph, weights.metaInfo.slice(rows), tiles);
+  }
+  di.addOutput(weights.nzValues);
+  di.addOutput(weights.metaInfo);
+  return weights;
+}
+
+Tensor createNMSparseInput(Graph &graph, const Type &inputType,
+                           const NMMatMulParams &params,
+                           const DebugContext &debugContext,
+                           const OptionFlags &options) {
+  PoplibsOpDebugInfo di(debugContext, DI_ARGS(inputType, params, options));
+  validateParams(params);
+  const auto partialsType = parsePartialsType(options, inputType);
+  const auto partition = getPartition(graph.getTarget(), inputType,
+                                      partialsType, params, NMPass::FWD);
+
+  const auto input = graph.addVariable(
+      inputType, {params.batchSize, params.numColumns}, {di, "input"});
+  for (unsigned batchPart = 0; batchPart < partition.batchSplit; ++batchPart) {
+    const auto batch =
+        getPartRange(params.batchSize, partition.batchSplit, batchPart);
+    std::vector<unsigned> tiles;
+    for (unsigned rowPart = 0; rowPart < partition.rowSplit; ++rowPart) {
+      tiles.push_back(getTile(partition, rowPart, batchPart));
+    }
+    mapRowsOverTiles(graph, input.slice(batch), tiles);
+  }
+  di.addOutput(input);
+  return input;
+}
+
+Tensor nmSparseMatMul(Graph &graph, const NMSparseTensor &weights,
+                      const Tensor &activations, const NMMatMulParams &params,
+                      Sequence &prog, const DebugContext &debugContext,
+                      const OptionFlags &options) {
+  PoplibsOpDebugInfo di(debugContext,
+                        DI_ARGS(weights, activations, params, options));
+  const auto &target = graph.getTarget();
+  const auto inputType = activations.elementType();
+  validateParams(params);
+  const auto partialsType = parsePartialsType(options, inputType);
+  validateShape(weights.nzValues, {params.numRows, getNzPerRow(params)},
+                "non-zero values");
+  validateMetaInfo(weights.metaInfo, params);
+  validateShape(activations, {params.batchSize, params.numColumns},
+                "activations");
+  logging::popsparse::debug("popsparse::nmSparseMatMul: '{}' {}:{} {}x{} "
+                            "weights, batch {}",
+                            debugContext.getPathName(), params.n, params.m,
+                            params.numRows, params.numColumns,
+                            params.batchSize);
+  const auto partition =
+      getPartition(target, inputType, partialsType, params, NMPass::FWD);
+  const auto numWorkers = target.getNumWorkerContexts();
+
+  const auto output = graph.addVariable(
+      inputType, {params.batchSize, params.numRows}, {di, "output"});
+  const auto cs = graph.addComputeSet({di, "NMSparseMatMul"});
+  const auto vertexClass = templateVertex("popsparse::NMSparseDenseMatMul",
+                                          inputType, partialsType);
+  forEachTile(partition, params,
+              [&](unsigned tile, unsigned, unsigned, const Interval &rows,
+                  const Interval &batch) {
+                graph.setTileMapping(
+                    output.slice({batch.begin(), rows.begin()},
+                                 {batch.end(), rows.end()}),
+                    tile);
+                // Each worker computes the output of some of the rows
+                for (unsigned w = 0; w < numWorkers; ++w) {
+                  const auto part = getPartRange(rows.size(), numWorkers, w);
+                  if (!part.size()) {
+                    continue;
+                  }
+                  const auto begin = rows.begin() + part.begin();
+                  const auto end = rows.begin() + part.end();
+                  const auto v = graph.addVertex(
+                      cs, vertexClass,
+                      {{"nzValues", weights.nzValues.slice(begin, end)},
+                       {"metaInfo", weights.metaInfo.slice(begin, end)},
+                       {"acts", activations.slice(batch)},
+                       {"out", output.slice({batch.begin(), begin},
+                                            {batch.end(), end})}});
+                  setNMFields(graph, v, params);
+                  graph.setTileMapping(v, tile);
+                }
+              });
+  prog.add(Execute(cs, {di}));
+  di.addOutput(output);
+  return output;
+}
+
+Tensor nmSparseMatMulGradA(Graph &graph, const NMSparseTensor &weights,
+                           const Tensor &gradients,
+                           const NMMatMulParams &params, Sequence &prog,
+                           const DebugContext &debugContext,
+                           const OptionFlags &options) {
+  PoplibsOpDebugInfo di(debugContext,
+                        DI_ARGS(weights, gradients, params, options));
+  const auto &target = graph.getTarget();
+  const auto inputType = gradients.elementType();
+  validateParams(params);
+  const auto partialsType = parsePartialsType(options, inputType);
+  validateShape(weights.nzValues, {params.numRows, getNzPerRow(params)},
+                "non-zero values");
+  validateMetaInfo(weights.metaInfo, params);
+  validateShape(gradients, {params.batchSize, params.numRows}, "gradients");
+  const auto partition =
+      getPartition(target, inputType, partialsType, params, NMPass::GRAD_A);
+  const auto numWorkers = target.getNumWorkerContexts();
+  const auto groupsPerRow = getGroupsPerRow(params);
+
+  // Each range of rows of the weights gives a partial gradient
+  const auto partials = graph.addVariable(
+      partialsType, {partition.rowSplit, params.batchSize, params.numColumns},
+      {di, "partials"});
+  const auto cs = graph.addComputeSet({di, "NMSparseMatMulGradA"});
+  const auto vertexClass = templateVertex("popsparse::NMSparseDenseMatMulGradA",
+                                          inputType, partialsType);
+  forEachTile(
+      partition, params,
+      [&](unsigned tile, unsigned rowPart, unsigned, const Interval &rows,
+          const Interval &batch) {
+        const auto tilePartials = partials[rowPart].slice(batch);
+        graph.setTileMapping(tilePartials, tile);
+        // Each worker computes the columns of some of the groups
+        for (unsigned w = 0; w < numWorkers; ++w) {
+          const auto groups = getPartRange(groupsPerRow, numWorkers, w);
+          if (!groups.size()) {
+            continue;
+          }
+          const auto v = graph.addVertex(
+              cs, vertexClass,
+              {{"nzValues", weights.nzValues.slice(
+                                {rows.begin(), groups.begin() * params.n},
+                                {rows.end(), groups.end() * params.n})},
+               {"metaInfo",
+                weights.metaInfo.slice({rows.begin(), groups.begin()},
+                                       {rows.end(), groups.end()})},
+               {"gradients", gradients.slice({batch.begin(), rows.begin()},
+                                             {batch.end(), rows.end()})},
+               {"out", tilePartials.slice(groups.begin() * params.m,
+                                          groups.end() * params.m, 1)}});
+          setNMFields(graph, v, params);
+          graph.setTileMapping(v, tile);
+        }
+      });
+  prog.add(Execute(cs, {di}));
+  const auto output = reduceParts(graph, partials, inputType, prog, {di});
+  di.addOutput(output);
+  return output;
+}
+
+Tensor nmSparseMatMulGradW(Graph &graph, const Tensor &metaInfo,
+                           const Tensor &gradients, const Tensor &activations,
+                           const NMMatMulParams &params, Sequence &prog,
+                           const DebugContext &debugContext,
+                           const OptionFlags &options) {
+  PoplibsOpDebugInfo di(debugContext, DI_ARGS(metaInfo, gradients,
+                                              activations, params, options));
+  const auto &target = graph.getTarget();
+  const auto inputType = activations.elementType();
+  validateParams(params);
+  const auto partialsType = parsePartialsType(options, inputType);
+  validateMetaInfo(metaInfo, params);
+  validateShape(gradients, {params.batchSize, params.numRows}, "gradients");
+  validateShape(activations, {params.batchSize, params.numColumns},
+                "activations");
+  if (gradients.elementType() != inputType) {
+    throw poplibs_error("Gradients and activations must have the same type");
+  }
+  const auto partition =
+      getPartition(target, inputType, partialsType, params, NMPass::GRAD_W);
+  const auto numWorkers = target.getNumWorkerContexts();
+
+  // Each range of the batch gives a partial gradient
+  const auto partials = graph.addVariable(
+      partialsType, {partition.batchSplit, params.numRows, getNzPerRow(params)},
+      {di, "partials"});
+  const auto cs = graph.addComputeSet({di, "NMSparseMatMulGradW"});
+  const auto vertexClass = templateVertex("popsparse::NMSparseDenseMatMulGradW",
+                                          inputType, partialsType);
+  forEachTile(partition, params,
+              [&](unsigned tile, unsigned, unsigned batchPart,
+                  const Interval &rows, const Interval &batch) {
+                graph.setTileMapping(partials[batchPart].slice(rows), tile);
+                // Each worker computes the gradient of some of the rows
+                for (unsigned w = 0; w < numWorkers; ++w) {
+                  const auto part = getPartRange(rows.size(), numWorkers, w);
+                  if (!part.size()) {
+                    continue;
+                  }
+                  const auto begin = rows.begin() + part.begin();
+                  const auto end = rows.begin() + part.end();
+                  const auto v = graph.addVertex(
+                      cs, vertexClass,
+                      {{"metaInfo", metaInfo.slice(begin, end)},
+                       {"acts", activations.slice(batch)},
+                       {"gradients", gradients.slice({batch.begin(), begin},
+                                                     {batch.end(), end})},
+                       {"out", partials[batchPart].slice(begin, end)}});
+                  setNMFields(graph, v, params);
+                  graph.setTileMapping(v, tile);
+                }
+              });
+  prog.add(Execute(cs, {di}));
+  const auto output = reduceParts(graph, partials, inputType, prog, {di});
+  di.addOutput(output);
+  return output;
+}
+
+} // namespace experimental
+} // namespace popsparse
@@ -914,4 +914,16 @@ getTransposeCycleEstimate(unsigned numTransposes, unsigned numSrcRows,
   return supervisorCycles + numWorkers * maxWorkerCycles;
 }
 
+// Worker vertex estimate for the N:M sparse matmul codelets, which visit
+// every non-zero value of every row of the weights once for each row of
+// activations, decoding its column from the meta-information.
+static inline std::uint64_t getNMSparseMatMulCycles(unsigned numBatchRows,
+                                                    unsigned numWeightRows,
+                                                    unsigned nzPerRow) {
+  // ld meta-info, shift, and, add group offset, ld act, ld nz, f32mac
+  const std::uint64_t cyclesPerNz = 7;
+  return 20 + std::uint64_t(numBatchRows) * numWeightRows *
+                  (8 + cyclesPerNz * nzPerRow);
+}
+
 #endif // _performance_estimation_h_
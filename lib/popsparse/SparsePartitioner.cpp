@@ -43,7 +43,7 @@ Partitioner<T>::Partitioner(const FullyConnectedParams &params,
       plan.fwdMetaInfoElemsPerBucket, plan.gradAMetaInfoElemsPerBucket,
       plan.nzElemsPerBucket, target.getNumWorkerContexts(), 1,
       useBlockMetaInfoFormat, options.doGradAPass, options.doGradWPass,
-      options.sharedBuckets, dataType, options.partialsType,
+      options.sharedBuckets, plan.useDense, dataType, options.partialsType,
       options.partitioner));
 }
 
@@ -64,6 +64,10 @@ SparsityDataImpl<T>
 Partitioner<T>::createSparsityDataImpl(const CSCMatrix<T> &matrix_) const {
   logging::popsparse::info("Creating sparsity implementation for CSC matrix:{}",
                            name);
+  if (impl->useDenseLayout()) {
+    auto info = impl->denseImpl(matrix_);
+    return {std::get<0>(info), std::get<1>(info)};
+  }
   auto info = impl->bucketImplAllPasses(impl->createBuckets(matrix_), name);
   return {std::get<0>(info), std::get<1>(info)};
 }
@@ -73,6 +77,10 @@ SparsityDataImpl<T>
 Partitioner<T>::createSparsityDataImpl(const CSRMatrix<T> &matrix_) const {
   logging::popsparse::info("Creating sparsity implementation for CSR matrix:{}",
                            name);
+  if (impl->useDenseLayout()) {
+    auto info = impl->denseImpl(matrix_);
+    return {std::get<0>(info), std::get<1>(info)};
+  }
   auto info = impl->bucketImplAllPasses(impl->createBuckets(matrix_), name);
   return {std::get<0>(info), std::get<1>(info)};
 }
@@ -82,6 +90,10 @@ SparsityDataImpl<T>
 Partitioner<T>::createSparsityDataImpl(const COOMatrix<T> &matrix_) const {
   logging::popsparse::info("Creating sparsity implementation for COO matrix:{}",
                            name);
+  if (impl->useDenseLayout()) {
+    auto info = impl->denseImpl(matrix_);
+    return {std::get<0>(info), std::get<1>(info)};
+  }
   auto info = impl->bucketImplAllPasses(impl->createBuckets(matrix_), name);
   return {std::get<0>(info), std::get<1>(info)};
 }
@@ -89,18 +101,27 @@ Partitioner<T>::createSparsityDataImpl(const COOMatrix<T> &matrix_) const {
 template <typename T>
 COOMatrix<T> Partitioner<T>::sparsityDataImplToCOOMatrix(
     const SparsityDataImpl<T> &buckets) const {
+  if (impl->useDenseLayout()) {
+    return impl->denseImplToCOOMatrix(buckets.metaInfo, buckets.nzValues);
+  }
   return impl->bucketsToCOOMatrix(buckets.metaInfo, buckets.nzValues);
 }
 
 template <typename T>
 CSRMatrix<T> Partitioner<T>::sparsityDataImplToCSRMatrix(
     const SparsityDataImpl<T> &buckets) const {
+  if (impl->useDenseLayout()) {
+    return impl->denseImplToCSRMatrix(buckets.metaInfo, buckets.nzValues);
+  }
   return impl->bucketsToCSRMatrix(buckets.metaInfo, buckets.nzValues);
 }
 
 template <typename T>
 CSCMatrix<T> Partitioner<T>::sparsityDataImplToCSCMatrix(
     const SparsityDataImpl<T> &buckets) const {
+  if (impl->useDenseLayout()) {
+    return impl->denseImplToCSCMatrix(buckets.metaInfo, buckets.nzValues);
+  }
   return impl->bucketsToCSCMatrix(buckets.metaInfo, buckets.nzValues);
 }
 
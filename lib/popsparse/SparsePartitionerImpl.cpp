@@ -109,8 +109,9 @@ PartitionerImpl::PartitionerImpl(
     std::size_t metaInfoBucketElementsGradA_,
     std::size_t nzElementsBucketElements_, std::size_t numWorkerContexts_,
     std::size_t bucketsPerZ_, bool useBlockMetaInfoFormat_, bool includeGradA_,
-    bool includeGradW_, bool sharedBuckets_, const poplar::Type &dataType_,
-    const poplar::Type &accumType_, const PartitionerOptions &options) {
+    bool includeGradW_, bool sharedBuckets_, bool denseLayout_,
+    const poplar::Type &dataType_, const poplar::Type &accumType_,
+    const PartitionerOptions &options) {
 
   auto verifySplit = [](std::size_t dimension, const std::vector<size_t> &split,
                         const std::string &str) {
@@ -165,6 +166,7 @@ PartitionerImpl::PartitionerImpl(
   gradWEnabled = includeGradW_;
   gradAEnabled = includeGradA_;
   sharedBuckets = sharedBuckets_;
+  denseLayout = denseLayout_;
   dataType = dataType_;
   accumType = accumType_;
   optimiseForSpeed = options.optimiseForSpeed;
@@ -1863,6 +1865,120 @@ PartitionerImpl::bucketsToCSCMatrix(const std::vector<std::size_t> &metaInfo,
   return csrToCSC(numX, numY, csrMatrix);
 }
 
+template <typename T>
+std::pair<std::vector<std::size_t>, std::vector<T>>
+PartitionerImpl::denseImpl(const CSRMatrix<T> &matrix_) const {
+  if (matrix_.getBlockDimensions() != blockDimensions) {
+    return denseImpl(changeCSRBlockSize(matrix_, blockDimensions));
+  }
+  const auto blockRows = blockDimensions[0];
+  const auto blockColumns = blockDimensions[1];
+  const auto blockSize = blockRows * blockColumns;
+  const auto numRowBlocks = numX / blockRows;
+  const auto numColumnBlocks = numY / blockColumns;
+  if (matrix_.rowIndices.size() != numRowBlocks + 1) {
+    throw poputil::poplibs_error("Number of row indices in the CSR matrix "
+                                 "does not match the number of rows");
+  }
+  if (matrix_.rowIndices.back() != matrix_.nzValues.size() ||
+      matrix_.columnIndices.size() * blockSize != matrix_.nzValues.size()) {
+    throw poputil::poplibs_error("Number of non-zero values do not match the "
+                                 "indices in the CSR matrix");
+  }
+
+  constexpr std::size_t bitsPerElem = std::numeric_limits<MetaInfoType>::digits;
+  std::vector<std::size_t> metaInfo(
+      getNumDenseMaskElems(bitsPerElem, numRowBlocks * numColumnBlocks));
+  std::vector<T> nzValues(numX * numY);
+  for (std::size_t row = 0; row != numRowBlocks; ++row) {
+    for (auto block = matrix_.rowIndices[row] / blockSize;
+         block != matrix_.rowIndices[row + 1] / blockSize; ++block) {
+      const auto column = matrix_.columnIndices[block] / blockColumns;
+      if (column >= numColumnBlocks) {
+        throw poputil::poplibs_error("Column index in the CSR matrix exceeds "
+                                     "the number of columns");
+      }
+      const auto index = row * numColumnBlocks + column;
+      metaInfo[index / bitsPerElem] |= std::size_t(1) << (index % bitsPerElem);
+      for (std::size_t r = 0; r != blockRows; ++r) {
+        std::copy_n(matrix_.nzValues.begin() + block * blockSize +
+                        r * blockColumns,
+                    blockColumns,
+                    nzValues.begin() + (row * blockRows + r) * numY +
+                        column * blockColumns);
+      }
+    }
+  }
+  return std::make_pair(std::move(metaInfo), std::move(nzValues));
+}
+
+template <typename T>
+std::pair<std::vector<std::size_t>, std::vector<T>>
+PartitionerImpl::denseImpl(const CSCMatrix<T> &matrix_) const {
+  return denseImpl(cscToCSR(numX, numY, matrix_));
+}
+
+template <typename T>
+std::pair<std::vector<std::size_t>, std::vector<T>>
+PartitionerImpl::denseImpl(const COOMatrix<T> &matrix_) const {
+  return denseImpl(cooToCSR(numX, numY, matrix_));
+}
+
+template <typename T>
+COOMatrix<T>
+PartitionerImpl::denseImplToCOOMatrix(const std::vector<std::size_t> &metaInfo,
+                                      const std::vector<T> &nzValues) const {
+  const auto blockRows = blockDimensions[0];
+  const auto blockColumns = blockDimensions[1];
+  const auto numRowBlocks = numX / blockRows;
+  const auto numColumnBlocks = numY / blockColumns;
+  constexpr std::size_t bitsPerElem = std::numeric_limits<MetaInfoType>::digits;
+  if (metaInfo.size() !=
+      getNumDenseMaskElems(bitsPerElem, numRowBlocks * numColumnBlocks)) {
+    throw poputil::poplibs_error("Size of meta-information does not match the "
+                                 "number of blocks in the matrix");
+  }
+  if (nzValues.size() != numX * numY) {
+    throw poputil::poplibs_error("Number of non-zero values does not match "
+                                 "the size of the matrix");
+  }
+
+  std::vector<T> cooNzValues;
+  std::vector<std::size_t> cooColumnIndices;
+  std::vector<std::size_t> cooRowIndices;
+  for (std::size_t row = 0; row != numRowBlocks; ++row) {
+    for (std::size_t column = 0; column != numColumnBlocks; ++column) {
+      const auto index = row * numColumnBlocks + column;
+      if (!((metaInfo[index / bitsPerElem] >> (index % bitsPerElem)) & 1)) {
+        continue;
+      }
+      cooRowIndices.push_back(row * blockRows);
+      cooColumnIndices.push_back(column * blockColumns);
+      for (std::size_t r = 0; r != blockRows; ++r) {
+        const auto begin = nzValues.begin() + (row * blockRows + r) * numY +
+                           column * blockColumns;
+        cooNzValues.insert(cooNzValues.end(), begin, begin + blockColumns);
+      }
+    }
+  }
+  return COOMatrix<T>(std::move(cooNzValues), std::move(cooColumnIndices),
+                      std::move(cooRowIndices), blockDimensions);
+}
+
+template <typename T>
+CSRMatrix<T>
+PartitionerImpl::denseImplToCSRMatrix(const std::vector<std::size_t> &metaInfo,
+                                      const std::vector<T> &nzValues) const {
+  return cooToCSR(numX, numY, denseImplToCOOMatrix(metaInfo, nzValues));
+}
+
+template <typename T>
+CSCMatrix<T>
+PartitionerImpl::denseImplToCSCMatrix(const std::vector<std::size_t> &metaInfo,
+                                      const std::vector<T> &nzValues) const {
+  return csrToCSC(numX, numY, denseImplToCSRMatrix(metaInfo, nzValues));
+}
+
 // Instantiations of templated member methods
 template PNBucketsImpl<double>
 PartitionerImpl::createBuckets<double>(const CSCMatrix<double> &) const;
@@ -1914,4 +2030,34 @@ template std::pair<std::vector<std::size_t>, std::vector<float>>
 PartitionerImpl::bucketImplAllPasses<float>(
     const PNBucketsImpl<float> &, const poplar::DebugNameAndId &) const;
 
+template std::pair<std::vector<std::size_t>, std::vector<double>>
+PartitionerImpl::denseImpl<double>(const CSRMatrix<double> &) const;
+template std::pair<std::vector<std::size_t>, std::vector<float>>
+PartitionerImpl::denseImpl<float>(const CSRMatrix<float> &) const;
+
+template std::pair<std::vector<std::size_t>, std::vector<double>>
+PartitionerImpl::denseImpl<double>(const CSCMatrix<double> &) const;
+template std::pair<std::vector<std::size_t>, std::vector<float>>
+PartitionerImpl::denseImpl<float>(const CSCMatrix<float> &) const;
+
+template std::pair<std::vector<std::size_t>, std::vector<double>>
+PartitionerImpl::denseImpl<double>(const COOMatrix<double> &) const;
+template std::pair<std::vector<std::size_t>, std::vector<float>>
+PartitionerImpl::denseImpl<float>(const COOMatrix<float> &) const;
+
+template COOMatrix<double> PartitionerImpl::denseImplToCOOMatrix<double>(
+    const std::vector<std::size_t> &, const std::vector<double> &) const;
+template COOMatrix<float> PartitionerImpl::denseImplToCOOMatrix<float>(
+    const std::vector<std::size_t> &, const std::vector<float> &) const;
+
+template CSRMatrix<double> PartitionerImpl::denseImplToCSRMatrix<double>(
+    const std::vector<std::size_t> &, const std::vector<double> &) const;
+template CSRMatrix<float> PartitionerImpl::denseImplToCSRMatrix<float>(
+    const std::vector<std::size_t> &, const std::vector<float> &) const;
+
+template CSCMatrix<double> PartitionerImpl::denseImplToCSCMatrix<double>(
+    const std::vector<std::size_t> &, const std::vector<double> &) const;
+template CSCMatrix<float> PartitionerImpl::denseImplToCSCMatrix<float>(
+    const std::vector<std::size_t> &, const std::vector<float> &) const;
+
 } // namespace popsparse
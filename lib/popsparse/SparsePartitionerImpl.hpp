@@ -107,6 +107,10 @@ class PartitionerImpl {
   bool gradWEnabled{false};
   bool sharedBuckets{false};
 
+  // If set, the weights are held densely with a mask of the sparsity pattern
+  // as meta-information and no buckets are created.
+  bool denseLayout{false};
+
   poplar::Type dataType{poplar::HALF};
   poplar::Type accumType{poplar::FLOAT};
 
@@ -127,7 +131,7 @@ public:
                   std::size_t nzElementsBucketElements_,
                   std::size_t numWorkerContexts_, std::size_t bucketsPerZ_,
                   bool useBlockMetaInfoFormat, bool includeGradA_,
-                  bool includeGradW_, bool sharedBuckets_,
+                  bool includeGradW_, bool sharedBuckets_, bool denseLayout_,
                   const poplar::Type &dataType_, const poplar::Type &accumType_,
                   const PartitionerOptions &options);
 
@@ -235,6 +239,40 @@ public:
   template <typename T>
   CSCMatrix<T> bucketsToCSCMatrix(const std::vector<std::size_t> &metaInfo,
                                   const std::vector<T> &nzValues) const;
+
+  // returns true if the weights are held densely
+  bool useDenseLayout() const { return denseLayout; }
+
+  // Creates the dense layout of a matrix. The first in the output pair is the
+  // meta-information, a mask with one bit per block of the matrix in
+  // row-major order, and the second the values of the matrix in row-major
+  // order with zeros outside the sparsity pattern.
+  template <typename T>
+  std::pair<std::vector<std::size_t>, std::vector<T>>
+  denseImpl(const CSRMatrix<T> &matrix_) const;
+
+  template <typename T>
+  std::pair<std::vector<std::size_t>, std::vector<T>>
+  denseImpl(const CSCMatrix<T> &matrix_) const;
+
+  template <typename T>
+  std::pair<std::vector<std::size_t>, std::vector<T>>
+  denseImpl(const COOMatrix<T> &matrix_) const;
+
+  // create COO matrix from the dense layout
+  template <typename T>
+  COOMatrix<T> denseImplToCOOMatrix(const std::vector<std::size_t> &metaInfo,
+                                    const std::vector<T> &nzValues) const;
+
+  // create CSR matrix from the dense layout
+  template <typename T>
+  CSRMatrix<T> denseImplToCSRMatrix(const std::vector<std::size_t> &metaInfo,
+                                    const std::vector<T> &nzValues) const;
+
+  // create CSC matrix from the dense layout
+  template <typename T>
+  CSCMatrix<T> denseImplToCSCMatrix(const std::vector<std::size_t> &metaInfo,
+                                    const std::vector<T> &nzValues) const;
 };
 
 // Fixed metainfo overhead in number of elements
@@ -10,7 +10,11 @@
 #include "popsparse/SparseStorageFormats.hpp"
 #include "poputil/exceptions.hpp"
 #include <algorithm>
+#include <functional>
 #include <numeric>
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#include <tbb/task_arena.h>
 #include <unordered_map>
 
 namespace popsparse {
@@ -146,6 +150,113 @@ static inline void validateBlockSizes(std::size_t numRows,
   }
 }
 
+// The host conversions below are parallelised with TBB. The result of each
+// does not depend on the number of threads used, and is identical to that of
+// a serial conversion. Conversions of fewer than this number of blocks per
+// thread run serially.
+static constexpr std::size_t minBlocksPerConversionChunk = 1u << 14;
+
+// Number of chunks to split a conversion of the given number of blocks into.
+static inline std::size_t getNumConversionChunks(std::size_t numBlocks) {
+  const std::size_t maxChunks = tbb::this_task_arena::max_concurrency();
+  return std::max<std::size_t>(
+      1, std::min(maxChunks, numBlocks / minBlocksPerConversionChunk));
+}
+
+// Call body(begin, end) on ranges covering [0, n), in parallel when there is
+// more than one range. Ranges have about grainSize elements: they may be
+// larger, and the last one may be smaller.
+template <class Body>
+void parallelForRanges(std::size_t n, std::size_t grainSize, const Body &body) {
+  if (n <= grainSize) {
+    body(std::size_t(0), n);
+    return;
+  }
+  tbb::parallel_for(tbb::blocked_range<std::size_t>(0, n, grainSize),
+                    [&](const tbb::blocked_range<std::size_t> &range) {
+                      body(range.begin(), range.end());
+                    });
+}
+
+// Stable counting sort of numItems items into numBuckets buckets.
+//
+// \param  bucketOf  bucketOf(i) gives the bucket of item i.
+// \param  scatter   scatter(begin, end, nextPositions) places the items in
+//                   [begin, end), in order, where item i is placed at
+//                   position nextPositions[bucketOf(i)]++ of the sorted
+//                   order.
+//
+// \return The start of each bucket in the sorted order followed by the number
+//         of items.
+//
+// The items are split into contiguous chunks which are counted and placed in
+// parallel. The position of each chunk within each bucket is given by a
+// prefix sum over buckets and chunks, so items of a bucket stay in their
+// original order. Each chunk keeps a count per bucket, so the number of
+// chunks is limited for the counts of all the chunks not to outgrow the
+// items. With about as many buckets as items the sort runs in one chunk.
+template <class BucketFn, class ScatterFn>
+std::vector<std::size_t>
+parallelCountingSort(std::size_t numItems, std::size_t numBuckets,
+                     const BucketFn &bucketOf, const ScatterFn &scatter) {
+  const auto numChunks = std::max<std::size_t>(
+      1, std::min(getNumConversionChunks(numItems),
+                  numItems / std::max<std::size_t>(numBuckets, 1)));
+  const auto chunkBegin = [&](std::size_t chunk) {
+    return numItems * chunk / numChunks;
+  };
+
+  // Number of items of each bucket in each chunk, chunk-major.
+  std::vector<std::size_t> counts(numChunks * numBuckets);
+  parallelForRanges(numChunks, 1, [&](std::size_t begin, std::size_t end) {
+    for (auto chunk = begin; chunk != end; ++chunk) {
+      auto *chunkCounts = counts.data() + chunk * numBuckets;
+      for (auto i = chunkBegin(chunk); i != chunkBegin(chunk + 1); ++i) {
+        ++chunkCounts[bucketOf(i)];
+      }
+    }
+  });
+
+  std::vector<std::size_t> bucketStarts(numBuckets + 1);
+  const auto bucketGrainSize =
+      std::max<std::size_t>(1, minBlocksPerConversionChunk / numChunks);
+  parallelForRanges(
+      numBuckets, bucketGrainSize, [&](std::size_t begin, std::size_t end) {
+        for (auto bucket = begin; bucket != end; ++bucket) {
+          std::size_t total = 0;
+          for (std::size_t chunk = 0; chunk != numChunks; ++chunk) {
+            total += counts[chunk * numBuckets + bucket];
+          }
+          bucketStarts[bucket + 1] = total;
+        }
+      });
+  std::partial_sum(bucketStarts.begin(), bucketStarts.end(),
+                   bucketStarts.begin());
+
+  // Turn the counts into the position of the first item of each chunk in
+  // each bucket.
+  parallelForRanges(
+      numBuckets, bucketGrainSize, [&](std::size_t begin, std::size_t end) {
+        for (auto bucket = begin; bucket != end; ++bucket) {
+          auto position = bucketStarts[bucket];
+          for (std::size_t chunk = 0; chunk != numChunks; ++chunk) {
+            auto &count = counts[chunk * numBuckets + bucket];
+            const auto chunkCount = count;
+            count = position;
+            position += chunkCount;
+          }
+        }
+      });
+
+  parallelForRanges(numChunks, 1, [&](std::size_t begin, std::size_t end) {
+    for (auto chunk = begin; chunk != end; ++chunk) {
+      scatter(chunkBegin(chunk), chunkBegin(chunk + 1),
+              counts.data() + chunk * numBuckets);
+    }
+  });
+  return bucketStarts;
+}
+
 // Convert from a CSR representation of a matrix of dimension
 // [numRows x numColumns] to a CSC representation.
 //
@@ -170,50 +281,42 @@ CSCMatrix<T> csrToCSC(std::size_t numRows, std::size_t numColumns,
     throw poputil::poplibs_error("Number of non-zero values do not match last "
                                  "entry on rowIndices");
   }
-  const auto numColumnBlocks = numColumns / csr.getNumColumnsInBlock();
-  std::vector<std::size_t> columnIndices(numColumnBlocks + 1);
-  for (std::size_t nz = 0; nz != numNZBlocks; ++nz) {
-    columnIndices[csr.columnIndices[nz] / csr.getNumColumnsInBlock() + 1]++;
-  }
-  std::partial_sum(columnIndices.begin(), columnIndices.end(),
-                   columnIndices.begin());
-  // The last entry in the CSC columns is always the number of non zero entries
-  columnIndices[numColumnBlocks] = numNZBlocks;
+  const auto rowsInBlock = csr.getNumRowsInBlock();
+  const auto columnsInBlock = csr.getNumColumnsInBlock();
+  const auto numColumnBlocks = numColumns / columnsInBlock;
 
-  std::vector<std::size_t> rowIndices;
-  rowIndices.resize(numNZBlocks);
-  std::vector<T> nzValues;
-  nzValues.resize(numNZValues);
-
-  // Fill in the non zero entries and the row indices
-  for (std::size_t row = 0; row != numRows / csr.getNumRowsInBlock(); ++row) {
-    for (std::size_t csrRow = csr.rowIndices[row] / blockSize;
-         csrRow != csr.rowIndices[row + 1] / blockSize; ++csrRow) {
-      auto column = csr.columnIndices[csrRow] / csr.getNumColumnsInBlock();
-      auto dstRow = columnIndices[column];
-      rowIndices[dstRow] = row;
-      // transpose block and store
-      for (std::size_t r = 0; r != csr.getNumRowsInBlock(); ++r) {
-        for (std::size_t c = 0; c != csr.getNumColumnsInBlock(); ++c) {
-          const auto srcIndex =
-              dstRow * blockSize + c * csr.getNumRowsInBlock() + r;
-          const auto dstIndex =
-              csrRow * blockSize + r * csr.getNumColumnsInBlock() + c;
-          nzValues[srcIndex] = csr.nzValues[dstIndex];
-        }
-      }
-      ++columnIndices[column];
-    }
-  }
+  std::vector<std::size_t> rowIndices(numNZBlocks);
+  std::vector<T> nzValues(numNZValues);
 
-  std::size_t startIndex = 0;
-  for (std::size_t column = 0; column != numColumnBlocks; ++column) {
-    std::swap(columnIndices[column], startIndex);
-  }
+  // Sort the blocks by column keeping them in row order within a column
+  auto columnIndices = parallelCountingSort(
+      numNZBlocks, numColumnBlocks,
+      [&](std::size_t nz) { return csr.columnIndices[nz] / columnsInBlock; },
+      [&](std::size_t begin, std::size_t end, std::size_t *nextPositions) {
+        // The row of the first block of the chunk
+        std::size_t row = std::distance(csr.rowIndices.begin(),
+                                        std::upper_bound(csr.rowIndices.begin(),
+                                                         csr.rowIndices.end(),
+                                                         begin * blockSize)) -
+                          1;
+        for (auto nz = begin; nz != end; ++nz) {
+          while (csr.rowIndices[row + 1] <= nz * blockSize) {
+            ++row;
+          }
+          const auto dst = nextPositions[csr.columnIndices[nz] /
+                                         columnsInBlock]++;
+          rowIndices[dst] = row * rowsInBlock;
+          // transpose block and store
+          for (std::size_t r = 0; r != rowsInBlock; ++r) {
+            for (std::size_t c = 0; c != columnsInBlock; ++c) {
+              nzValues[dst * blockSize + c * rowsInBlock + r] =
+                  csr.nzValues[nz * blockSize + r * columnsInBlock + c];
+            }
+          }
+        }
+      });
 
   // scale to block dimensions
-  std::for_each(rowIndices.begin(), rowIndices.end(),
-                [=](std::size_t &x) { x *= csr.getNumRowsInBlock(); });
   std::for_each(columnIndices.begin(), columnIndices.end(),
                 [=](std::size_t &x) { x *= blockSize; });
 
@@ -229,43 +332,51 @@ CSCMatrix<T> csrToCSC(std::size_t numRows, std::size_t numColumns,
 template <class T> void canonicalizeCSR(CSRMatrix<T> &matrix) {
   const auto numRowBlocks = matrix.rowIndices.size() - 1;
   const auto blockSize = matrix.getBlockSize();
-
-  for (std::size_t row = 0; row != numRowBlocks; ++row) {
-    const auto startIndex = matrix.rowIndices[row] / blockSize;
-    const auto endIndex = matrix.rowIndices[row + 1] / blockSize;
-    const auto numElems = endIndex - startIndex;
-
-    std::vector<std::vector<T>> columnNzValues;
+  const auto numBlocks = matrix.columnIndices.size();
+  const auto rowGrainSize = std::max<std::size_t>(
+      1, numRowBlocks * minBlocksPerConversionChunk / std::max<std::size_t>(
+                                                         numBlocks, 1));
+
+  parallelForRanges(numRowBlocks, rowGrainSize, [&](std::size_t beginRow,
+                                                   std::size_t endRow) {
+    std::vector<T> columnNzValues;
     std::vector<std::size_t> columnIndices;
-    columnNzValues.resize(numElems);
-    columnIndices.resize(numElems);
-
-    for (std::size_t index = startIndex; index != endIndex; ++index) {
-      std::vector<T> nzBlock;
-      columnNzValues[index - startIndex].resize(blockSize);
-      std::copy(matrix.nzValues.begin() + index * blockSize,
-                matrix.nzValues.begin() + (index + 1) * blockSize,
-                columnNzValues[index - startIndex].begin());
-      columnIndices[index - startIndex] = matrix.columnIndices[index];
-    }
-
     std::vector<std::size_t> columnOrder;
-    columnOrder.resize(numElems);
-    std::iota(columnOrder.begin(), columnOrder.end(), 0);
+    for (auto row = beginRow; row != endRow; ++row) {
+      const auto startIndex = matrix.rowIndices[row] / blockSize;
+      const auto endIndex = matrix.rowIndices[row + 1] / blockSize;
+      const auto numElems = endIndex - startIndex;
+      const auto rowColumnsBegin = matrix.columnIndices.begin() + startIndex;
+      const auto rowColumnsEnd = matrix.columnIndices.begin() + endIndex;
+
+      // Strictly increasing columns are left in place by the sort
+      if (std::adjacent_find(rowColumnsBegin, rowColumnsEnd,
+                             std::greater_equal<std::size_t>()) ==
+          rowColumnsEnd) {
+        continue;
+      }
 
-    std::sort(columnOrder.begin(), columnOrder.end(),
-              [&](std::size_t a, std::size_t b) {
-                return columnIndices[a] < columnIndices[b];
-              });
+      columnIndices.assign(rowColumnsBegin, rowColumnsEnd);
+      columnNzValues.assign(matrix.nzValues.begin() + startIndex * blockSize,
+                            matrix.nzValues.begin() + endIndex * blockSize);
+
+      columnOrder.resize(numElems);
+      std::iota(columnOrder.begin(), columnOrder.end(), 0);
+
+      std::sort(columnOrder.begin(), columnOrder.end(),
+                [&](std::size_t a, std::size_t b) {
+                  return columnIndices[a] < columnIndices[b];
+                });
 
-    for (std::size_t index = startIndex; index != endIndex; ++index) {
-      auto thisIndex = columnOrder[index - startIndex];
-      matrix.columnIndices[index] = columnIndices[thisIndex];
-      std::move(columnNzValues[thisIndex].begin(),
-                columnNzValues[thisIndex].end(),
-                matrix.nzValues.begin() + index * blockSize);
+      for (std::size_t index = startIndex; index != endIndex; ++index) {
+        auto thisIndex = columnOrder[index - startIndex];
+        matrix.columnIndices[index] = columnIndices[thisIndex];
+        std::move(columnNzValues.begin() + thisIndex * blockSize,
+                  columnNzValues.begin() + (thisIndex + 1) * blockSize,
+                  matrix.nzValues.begin() + index * blockSize);
+      }
     }
-  }
+  });
 }
 
 // Convert a CSC representation of a matrix of dimension [numRows x numColumns]
@@ -277,10 +388,10 @@ CSRMatrix<T> cscToCSR(std::size_t numRows, std::size_t numColumns,
       CSRMatrix<T>(input.nzValues, input.rowIndices, input.columnIndices,
                    {input.getNumColumnsInBlock(), input.getNumRowsInBlock()});
   auto cscMatrix = csrToCSC<T>(numColumns, numRows, csrMatrix);
-  return CSRMatrix<T>(
-      std::move(cscMatrix.nzValues), std::move(cscMatrix.rowIndices),
-      std::move(cscMatrix.columnIndices),
-      {cscMatrix.getNumRowsInBlock(), cscMatrix.getNumColumnsInBlock()});
+  return CSRMatrix<T>(std::move(cscMatrix.nzValues),
+                      std::move(cscMatrix.rowIndices),
+                      std::move(cscMatrix.columnIndices),
+                      {input.getNumRowsInBlock(), input.getNumColumnsInBlock()});
 }
 
 // Transpose a CSR representation of a matrix of dimension
@@ -351,32 +462,38 @@ CSRMatrix<T> cooToCSR(std::size_t numRows, std::size_t numColumns,
                                  "number of column elements in the COO");
   }
 
-  std::vector<std::size_t> rowIndices(numRowBlocks + 1);
-  for (const auto &row : coo.rowIndices) {
-    const auto rowBlock = row / rowBlockSize;
-    rowIndices.at(rowBlock + 1) += blockSize;
+  const auto rowOutOfRange = [&](std::size_t row) {
+    return row / rowBlockSize >= numRowBlocks;
+  };
+  if (std::any_of(coo.rowIndices.begin(), coo.rowIndices.end(),
+                  rowOutOfRange)) {
+    throw poputil::poplibs_error("Row index in the COO exceeds the number of "
+                                 "rows");
   }
-  std::partial_sum(std::next(rowIndices.begin()), rowIndices.end(),
-                   std::next(rowIndices.begin()));
 
-  std::vector<std::size_t> perRowBlockIndex(numRowBlocks);
   std::vector<std::size_t> columnIndices(numNZBlocks);
   std::vector<T> nzValues(numNZValues);
 
-  for (std::size_t block = 0; block < numNZBlocks; ++block) {
-    const auto rowBlock = coo.rowIndices[block] / rowBlockSize;
-    const auto dstIndex =
-        rowIndices[rowBlock] / blockSize + perRowBlockIndex[rowBlock];
-    columnIndices[dstIndex] = coo.columnIndices[block];
-    std::copy(coo.nzValues.begin() + block * blockSize,
-              coo.nzValues.begin() + (block + 1) * blockSize,
-              nzValues.begin() + dstIndex * blockSize);
-    ++perRowBlockIndex[rowBlock];
-  }
+  // Sort the blocks by row keeping them in their original order within a row
+  auto rowIndices = parallelCountingSort(
+      numNZBlocks, numRowBlocks,
+      [&](std::size_t block) { return coo.rowIndices[block] / rowBlockSize; },
+      [&](std::size_t begin, std::size_t end, std::size_t *nextPositions) {
+        for (auto block = begin; block != end; ++block) {
+          const auto dstIndex =
+              nextPositions[coo.rowIndices[block] / rowBlockSize]++;
+          columnIndices[dstIndex] = coo.columnIndices[block];
+          std::copy(coo.nzValues.begin() + block * blockSize,
+                    coo.nzValues.begin() + (block + 1) * blockSize,
+                    nzValues.begin() + dstIndex * blockSize);
+        }
+      });
+  std::for_each(rowIndices.begin(), rowIndices.end(),
+                [=](std::size_t &x) { x *= blockSize; });
 
-  auto csrMatrix =
-      CSRMatrix<T>(nzValues, columnIndices, rowIndices,
-                   {coo.getNumRowsInBlock(), coo.getNumColumnsInBlock()});
+  auto csrMatrix = CSRMatrix<T>(
+      std::move(nzValues), std::move(columnIndices), std::move(rowIndices),
+      {coo.getNumRowsInBlock(), coo.getNumColumnsInBlock()});
   canonicalizeCSR(csrMatrix);
   return csrMatrix;
 }
@@ -427,44 +544,55 @@ changeCSRBlockSize(const CSRMatrix<T> &csr,
   colIndices.resize(csr.columnIndices.size() * subRowsPerRow * subColsPerCol);
   nzValues.resize(csr.nzValues.size());
 
-  auto newRowIndicesIt = rowIndices.begin();
-  auto newColIndicesIt = colIndices.begin();
-  auto oldColIndicesIt = csr.columnIndices.begin();
-  auto newNzValuesIt = nzValues.begin();
-  for (auto oldRowIt = csr.rowIndices.begin();
-       oldRowIt != csr.rowIndices.end() - 1; ++oldRowIt) {
-    const auto numOldCols = (*std::next(oldRowIt) - *oldRowIt) / oldBlockSize;
-    auto thisRowColBegin = oldColIndicesIt;
-    auto thisRowColEnd = oldColIndicesIt + numOldCols;
-
-    for (std::size_t subR = 0; subR != csr.getNumRowsInBlock();
-         subR += newBlockDimensions[0]) {
-      *newRowIndicesIt++ =
-          *oldRowIt + subR * csr.getNumColumnsInBlock() * numOldCols;
-      for (auto colIt = thisRowColBegin; colIt != thisRowColEnd; ++colIt) {
-        const auto blockStartIndex =
-            *oldRowIt + std::distance(thisRowColBegin, colIt) * oldBlockSize;
-        for (std::size_t subC = 0; subC != csr.getNumColumnsInBlock();
-             subC += newBlockDimensions[1]) {
-          *newColIndicesIt++ = *colIt + subC;
-
-          for (std::size_t r = 0; r != newBlockDimensions[0]; ++r) {
-            auto src = csr.nzValues.begin() + blockStartIndex +
-                       (subR + r) * csr.getNumColumnsInBlock() + subC;
-            std::copy(src, src + newBlockDimensions[1], newNzValuesIt);
-            newNzValuesIt += newBlockDimensions[1];
+  // Each row of blocks is split independently. Its new blocks start at the
+  // same position in the non-zero values, and its new column indices at the
+  // position of its old column indices scaled by the number of new blocks in
+  // each old block.
+  const auto numOldRows = csr.rowIndices.size() - 1;
+  const auto rowGrainSize = std::max<std::size_t>(
+      1, numOldRows * minBlocksPerConversionChunk /
+             std::max<std::size_t>(csr.columnIndices.size(), 1));
+  parallelForRanges(numOldRows, rowGrainSize, [&](std::size_t beginRow,
+                                                 std::size_t endRow) {
+    for (auto oldRow = beginRow; oldRow != endRow; ++oldRow) {
+      const auto oldRowIt = csr.rowIndices.begin() + oldRow;
+      const auto nzOffset = *oldRowIt - csr.rowIndices.front();
+      const auto numOldCols =
+          (*std::next(oldRowIt) - *oldRowIt) / oldBlockSize;
+      auto thisRowColBegin =
+          csr.columnIndices.begin() + nzOffset / oldBlockSize;
+      auto thisRowColEnd = thisRowColBegin + numOldCols;
+      auto newRowIndicesIt = rowIndices.begin() + oldRow * subRowsPerRow;
+      auto newColIndicesIt = colIndices.begin() + nzOffset / oldBlockSize *
+                                                      subRowsPerRow *
+                                                      subColsPerCol;
+      auto newNzValuesIt = nzValues.begin() + nzOffset;
+
+      for (std::size_t subR = 0; subR != csr.getNumRowsInBlock();
+           subR += newBlockDimensions[0]) {
+        *newRowIndicesIt++ =
+            *oldRowIt + subR * csr.getNumColumnsInBlock() * numOldCols;
+        for (auto colIt = thisRowColBegin; colIt != thisRowColEnd; ++colIt) {
+          const auto blockStartIndex =
+              *oldRowIt + std::distance(thisRowColBegin, colIt) * oldBlockSize;
+          for (std::size_t subC = 0; subC != csr.getNumColumnsInBlock();
+               subC += newBlockDimensions[1]) {
+            *newColIndicesIt++ = *colIt + subC;
+
+            for (std::size_t r = 0; r != newBlockDimensions[0]; ++r) {
+              auto src = csr.nzValues.begin() + blockStartIndex +
+                         (subR + r) * csr.getNumColumnsInBlock() + subC;
+              std::copy(src, src + newBlockDimensions[1], newNzValuesIt);
+              newNzValuesIt += newBlockDimensions[1];
+            }
           }
         }
       }
     }
-    oldColIndicesIt = thisRowColEnd;
-  }
-  assert(static_cast<std::size_t>(std::distance(
-             colIndices.begin(), newColIndicesIt)) == colIndices.size());
-  assert(static_cast<std::size_t>(std::distance(
-             nzValues.begin(), newNzValuesIt)) == nzValues.size());
+  });
   rowIndices.back() = csr.rowIndices.back();
-  return CSRMatrix<T>(nzValues, colIndices, rowIndices, newBlockDimensions);
+  return CSRMatrix<T>(std::move(nzValues), std::move(colIndices),
+                      std::move(rowIndices), newBlockDimensions);
 }
 
 // Form a new CSC matrix with smaller block sizes given by newBlockDimensions
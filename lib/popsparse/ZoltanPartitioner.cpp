@@ -2,6 +2,7 @@
 
 #include "ZoltanPartitioner.hpp"
 #include <memory>
+#include <mutex>
 #include <poplibs_support/logging.hpp>
 #include <poputil/exceptions.hpp>
 #include <zoltan_cpp.h>
@@ -74,6 +75,11 @@ static void hypergraphList(void *data, int globalIDEntries, int hyperGraphSize,
 float ZoltanPartitioner::partitionGraph(const HyperGraphData &graphData,
                                         int nPartition,
                                         std::vector<int> &nodeAssignment) {
+  // Zoltan keeps global state, so partitions made by several threads, as when
+  // partition methods are compared, must not run at the same time.
+  static std::mutex zoltanMutex;
+  std::lock_guard<std::mutex> lock(zoltanMutex);
+
   float zoltanVersion;
 
   if (Zoltan_Initialize(0, nullptr, &zoltanVersion) != ZOLTAN_OK) {
@@ -23,6 +23,11 @@ public:
   virtual float partitionGraph(const HyperGraphData &graphData, int nPartition,
                                std::vector<int> &nodeAssignment) override;
 
+  virtual std::string getName() const override {
+    return partitionType == PartitionType::BLOCK ? "zoltan-block"
+                                                 : "zoltan-hypergraph";
+  }
+
   PartitionType partitionType;
 };
 
@@ -0,0 +1,144 @@
+// Copyright (c) 2020 Graphcore Ltd. All rights reserved.
+#include <poplar/HalfFloat.hpp>
+#include <poplar/Vertex.hpp>
+
+using namespace poplar;
+
+namespace popsparse {
+
+// N:M structured sparse weights are held as one row of non-zero values and
+// one row of meta-information per row of the weights. Each group of
+// `groupSize` columns of the weights has `nzPerGroup` non-zero values, and one
+// unsigned short of meta-information packing the column of each of them in
+// the group using `indexBits` bits, the first value in the lowest bits.
+static inline unsigned nmColumnInGroup(unsigned short metaInfo, unsigned j,
+                                       unsigned indexBits) {
+  return (metaInfo >> (j * indexBits)) & ((1u << indexBits) - 1);
+}
+
+// Computes out = acts * transpose(weights) for the rows of the weights given.
+template <typename FPType, typename AccumType>
+class NMSparseDenseMatMul : public Vertex {
+public:
+  NMSparseDenseMatMul();
+
+  // Non-zero values of each row of the weights
+  Vector<Input<Vector<FPType>>> nzValues;
+  // Meta-information of each row of the weights, one entry per group
+  Vector<Input<Vector<unsigned short>>> metaInfo;
+  // Each row of activations has as many columns as the weights
+  Vector<Input<Vector<FPType>>> acts;
+  // One row per row of activations, one column per row of the weights
+  Vector<Output<Vector<FPType>>> out;
+  const unsigned short nzPerGroup;
+  const unsigned short groupSize;
+  const unsigned short indexBits;
+
+  bool compute() {
+    for (unsigned b = 0; b != acts.size(); ++b) {
+      for (unsigned r = 0; r != nzValues.size(); ++r) {
+        AccumType sum = 0;
+        for (unsigned g = 0; g != metaInfo[r].size(); ++g) {
+          const auto meta = metaInfo[r][g];
+          for (unsigned j = 0; j != nzPerGroup; ++j) {
+            const auto c = g * groupSize + nmColumnInGroup(meta, j, indexBits);
+            sum += AccumType(nzValues[r][g * nzPerGroup + j]) *
+                   AccumType(acts[b][c]);
+          }
+        }
+        out[b][r] = FPType(sum);
+      }
+    }
+    return true;
+  }
+};
+
+template class NMSparseDenseMatMul<half, half>;
+template class NMSparseDenseMatMul<half, float>;
+template class NMSparseDenseMatMul<float, float>;
+
+// Computes the partial out = gradients * weights for the groups of the weights
+// given. Only the columns of these groups are written.
+template <typename FPType, typename AccumType>
+class NMSparseDenseMatMulGradA : public Vertex {
+public:
+  NMSparseDenseMatMulGradA();
+
+  // Non-zero values of the groups of each row of the weights
+  Vector<Input<Vector<FPType>>> nzValues;
+  // Meta-information of the groups of each row of the weights
+  Vector<Input<Vector<unsigned short>>> metaInfo;
+  // One row per row of activations, one column per row of the weights
+  Vector<Input<Vector<FPType>>> gradients;
+  // One row per row of activations, with the columns of the groups
+  Vector<Output<Vector<AccumType>>> out;
+  const unsigned short nzPerGroup;
+  const unsigned short groupSize;
+  const unsigned short indexBits;
+
+  bool compute() {
+    for (unsigned b = 0; b != gradients.size(); ++b) {
+      for (unsigned c = 0; c != out[b].size(); ++c) {
+        out[b][c] = 0;
+      }
+      for (unsigned r = 0; r != nzValues.size(); ++r) {
+        const auto grad = AccumType(gradients[b][r]);
+        for (unsigned g = 0; g != metaInfo[r].size(); ++g) {
+          const auto meta = metaInfo[r][g];
+          for (unsigned j = 0; j != nzPerGroup; ++j) {
+            const auto c = g * groupSize + nmColumnInGroup(meta, j, indexBits);
+            out[b][c] += grad * AccumType(nzValues[r][g * nzPerGroup + j]);
+          }
+        }
+      }
+    }
+    return true;
+  }
+};
+
+template class NMSparseDenseMatMulGradA<half, half>;
+template class NMSparseDenseMatMulGradA<half, float>;
+template class NMSparseDenseMatMulGradA<float, float>;
+
+// Computes the partial gradient of the non-zero values of the rows of the
+// weights given, for the rows of activations given.
+template <typename FPType, typename AccumType>
+class NMSparseDenseMatMulGradW : public Vertex {
+public:
+  NMSparseDenseMatMulGradW();
+
+  // Meta-information of each row of the weights
+  Vector<Input<Vector<unsigned short>>> metaInfo;
+  // Each row of activations has as many columns as the weights
+  Vector<Input<Vector<FPType>>> acts;
+  // One row per row of activations, one column per row of the weights
+  Vector<Input<Vector<FPType>>> gradients;
+  // Gradient of the non-zero values of each row of the weights
+  Vector<Output<Vector<AccumType>>> out;
+  const unsigned short nzPerGroup;
+  const unsigned short groupSize;
+  const unsigned short indexBits;
+
+  bool compute() {
+    for (unsigned r = 0; r != out.size(); ++r) {
+      for (unsigned g = 0; g != metaInfo[r].size(); ++g) {
+        const auto meta = metaInfo[r][g];
+        for (unsigned j = 0; j != nzPerGroup; ++j) {
+          const auto c = g * groupSize + nmColumnInGroup(meta, j, indexBits);
+          AccumType sum = 0;
+          for (unsigned b = 0; b != acts.size(); ++b) {
+            sum += AccumType(gradients[b][r]) * AccumType(acts[b][c]);
+          }
+          out[r][g * nzPerGroup + j] = sum;
+        }
+      }
+    }
+    return true;
+  }
+};
+
+template class NMSparseDenseMatMulGradW<half, half>;
+template class NMSparseDenseMatMulGradW<half, float>;
+template class NMSparseDenseMatMulGradW<float, float>;
+
+} // end namespace popsparse
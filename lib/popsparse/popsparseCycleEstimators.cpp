@@ -130,6 +130,33 @@ std::uint64_t MAKE_CYCLE_ESTIMATOR_NAME(BitIsSet)(
   return 8 * target.getNumWorkerContexts();
 }
 
+std::uint64_t MAKE_CYCLE_ESTIMATOR_NAME(NMSparseDenseMatMul)(
+    const VertexIntrospector &vertex, const Target &target, const Type &fpType,
+    const Type &accumType) {
+  CODELET_FIELD(nzValues);
+  CODELET_FIELD(acts);
+  const auto nzPerRow = nzValues.size() ? nzValues[0].size() : 0;
+  return getNMSparseMatMulCycles(acts.size(), nzValues.size(), nzPerRow);
+}
+
+std::uint64_t MAKE_CYCLE_ESTIMATOR_NAME(NMSparseDenseMatMulGradA)(
+    const VertexIntrospector &vertex, const Target &target, const Type &fpType,
+    const Type &accumType) {
+  CODELET_FIELD(nzValues);
+  CODELET_FIELD(gradients);
+  const auto nzPerRow = nzValues.size() ? nzValues[0].size() : 0;
+  return getNMSparseMatMulCycles(gradients.size(), nzValues.size(), nzPerRow);
+}
+
+std::uint64_t MAKE_CYCLE_ESTIMATOR_NAME(NMSparseDenseMatMulGradW)(
+    const VertexIntrospector &vertex, const Target &target, const Type &fpType,
+    const Type &accumType) {
+  CODELET_FIELD(out);
+  CODELET_FIELD(acts);
+  const auto nzPerRow = out.size() ? out[0].size() : 0;
+  return getNMSparseMatMulCycles(acts.size(), out.size(), nzPerRow);
+}
+
 poplibs::CycleEstimatorTable makeCyclesFunctionTable() {
   return {
       CYCLE_ESTIMATOR_ENTRY(popsparse, SparseDenseMatMulElementWise, HALF,
@@ -251,6 +278,16 @@ poplibs::CycleEstimatorTable makeCyclesFunctionTable() {
       CYCLE_ESTIMATOR_ENTRY(popsparse, SparseDenseMultiUpdateAddBlock, FLOAT,
                             false),
 
+      CYCLE_ESTIMATOR_ENTRY(popsparse, NMSparseDenseMatMul, HALF, HALF),
+      CYCLE_ESTIMATOR_ENTRY(popsparse, NMSparseDenseMatMul, HALF, FLOAT),
+      CYCLE_ESTIMATOR_ENTRY(popsparse, NMSparseDenseMatMul, FLOAT, FLOAT),
+      CYCLE_ESTIMATOR_ENTRY(popsparse, NMSparseDenseMatMulGradA, HALF, HALF),
+      CYCLE_ESTIMATOR_ENTRY(popsparse, NMSparseDenseMatMulGradA, HALF, FLOAT),
+      CYCLE_ESTIMATOR_ENTRY(popsparse, NMSparseDenseMatMulGradA, FLOAT, FLOAT),
+      CYCLE_ESTIMATOR_ENTRY(popsparse, NMSparseDenseMatMulGradW, HALF, HALF),
+      CYCLE_ESTIMATOR_ENTRY(popsparse, NMSparseDenseMatMulGradW, HALF, FLOAT),
+      CYCLE_ESTIMATOR_ENTRY(popsparse, NMSparseDenseMatMulGradW, FLOAT, FLOAT),
+
   };
 }
 
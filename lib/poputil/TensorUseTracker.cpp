@@ -2,6 +2,7 @@
 #include "poputil/TileMapping.hpp"
 
 #include "poputil/Util.hpp"
+#include "poputil/VarStructure.hpp"
 #include "poputil/exceptions.hpp"
 
 #include <boost/icl/interval_map.hpp>
@@ -288,6 +289,7 @@ void TensorUseTracker::mapTensorsByUse(
       }
     }
     graph.setTileMapping(t, mapping);
+    invalidateIntrospectionCache(graph, t);
   }
 }
 
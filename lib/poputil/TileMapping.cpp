@@ -3,6 +3,7 @@
 #include "poplar/Program.hpp"
 #include "poputil/DebugInfo.hpp"
 #include "poputil/Util.hpp"
+#include "poputil/VarStructure.hpp"
 #include "poputil/exceptions.hpp"
 #include <boost/functional/hash.hpp>
 #include <boost/icl/interval_map.hpp>
@@ -37,10 +38,12 @@ void mapTensorLinearly(poplar::Graph &graph, const poplar::Tensor &t,
                        unsigned minElementsPerTile, unsigned grainSize) {
   graph.setTileMapping(t, calcLinearTileMapping(graph, t.shape(),
                                                 minElementsPerTile, grainSize));
+  invalidateIntrospectionCache(graph, t);
 }
 
 void mapTensorLinearly(poplar::Graph &graph, const poplar::Tensor &t) {
   graph.setTileMapping(t, calcLinearTileMapping(graph, t));
+  invalidateIntrospectionCache(graph, t);
 }
 
 unsigned getTileImbalance(const poplar::Graph::TileToTensorMapping &mapping,
@@ -104,6 +107,7 @@ poplar::Tensor cloneToIpu(poplar::Graph &masterGraph, const poplar::Tensor &t,
     }
   }
   masterGraph.setTileMapping(tLocalSimple, mapping);
+  invalidateIntrospectionCache(masterGraph, tLocalSimple);
   di.addOutput(tLocal);
   return tLocal;
 }
@@ -270,6 +274,7 @@ createBroadcastOperand(poplar::Graph &graph, const poplar::Tensor &fullTensor,
       }
     }
     graph.setTileMapping(out, newMapping);
+    invalidateIntrospectionCache(graph, out);
   }
   di.addOutput(out);
   return out;
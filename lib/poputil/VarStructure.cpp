@@ -8,7 +8,13 @@
 #include "poputil/DebugInfo.hpp"
 #include "poputil/exceptions.hpp"
 
+#include <boost/functional/hash.hpp>
+#include <boost/optional.hpp>
+
 #include <algorithm>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
 
 using namespace poplar;
 using namespace poplibs_support;
@@ -56,6 +62,90 @@ enum class PermutationOrder {
   Forward
 };
 
+namespace {
+
+// The layout of a tensor is fully described by the ordered variable regions
+// its elements are drawn from, together with its shape.
+struct LayoutKey {
+  std::vector<std::size_t> shape;
+  std::vector<VariableInterval> regions;
+
+  bool operator==(const LayoutKey &other) const {
+    return shape == other.shape &&
+           std::equal(regions.begin(), regions.end(), other.regions.begin(),
+                      other.regions.end(),
+                      [](const VariableInterval &a, const VariableInterval &b) {
+                        return a.var == b.var && a.interval == b.interval;
+                      });
+  }
+};
+
+struct LayoutKeyHash {
+  std::size_t operator()(const LayoutKey &key) const {
+    std::size_t seed = boost::hash_range(key.shape.begin(), key.shape.end());
+    for (const auto &region : key.regions) {
+      boost::hash_combine(seed, std::hash<VariableRef>()(region.var));
+      boost::hash_combine(seed, region.interval.begin());
+      boost::hash_combine(seed, region.interval.end());
+    }
+    return seed;
+  }
+};
+
+struct LayoutInfo {
+  boost::optional<unsigned> innermostGrouping;
+  boost::optional<std::vector<GroupingInfo>> dimGroupings;
+};
+
+struct IntrospectionCache {
+  unsigned numScopes = 0;
+  std::unordered_map<LayoutKey, LayoutInfo, LayoutKeyHash> entries;
+  // Every variable referenced by a cached layout, so that invalidation for
+  // a tensor that has never been inspected, the common case when a new
+  // variable is mapped, does not need to search the entries.
+  std::unordered_set<VariableRef> cachedVars;
+  IntrospectionCacheStats stats;
+};
+
+std::mutex cachesMutex;
+std::unordered_map<const Graph *, IntrospectionCache> caches;
+
+// Return the field of the cached layout of t, computing it with f and
+// caching it on a miss. The cache is not locked while f runs so that f may
+// itself query the cache.
+template <typename T, typename F>
+T withIntrospectionCache(const Graph &graph, const Tensor &t,
+                         boost::optional<T> LayoutInfo::*field, const F &f) {
+  std::unique_lock<std::mutex> lock(cachesMutex);
+  if (!caches.count(&graph)) {
+    lock.unlock();
+    return f();
+  }
+  LayoutKey key{t.shape(), t.getVarRegions()};
+  auto &cache = caches.at(&graph);
+  const auto it = cache.entries.find(key);
+  if (it != cache.entries.end() && it->second.*field) {
+    ++cache.stats.hits;
+    return *(it->second.*field);
+  }
+  ++cache.stats.misses;
+  lock.unlock();
+
+  auto result = f();
+
+  lock.lock();
+  const auto cacheIt = caches.find(&graph);
+  if (cacheIt != caches.end()) {
+    for (const auto &region : key.regions) {
+      cacheIt->second.cachedVars.insert(region.var);
+    }
+    cacheIt->second.entries[std::move(key)].*field = result;
+  }
+  return result;
+}
+
+} // end anonymous namespace
+
 // For a list of parameters, each with their own possible values,
 // iterate the possible permutations of the values of all parameters
 // and pass them to a user-provided functor.
@@ -288,18 +378,8 @@ void iterateTensorPartitions(
   } while (!genI.complete());
 }
 
-unsigned detectInnermostGrouping(const Graph &graph, const Tensor &t0) {
-  if (t0.rank() == 0)
-    throw poplibs_error("Cannot detect channel grouping of 0-rank tensor");
-
-  if (t0.numElements() == 0)
-    return 1;
-
-  // Sample the first point in the inner dimension
-  auto t = t0;
-  while (t.rank() != 1)
-    t = t[0];
-
+static unsigned detectInnermostGroupingOfRow(const Graph &graph,
+                                             const Tensor &t) {
   // Perform a binary search to find the largest contiguous slice in
   // the inner dimension.
   auto lower = 1U;
@@ -339,8 +419,26 @@ unsigned detectInnermostGrouping(const Graph &graph, const Tensor &t0) {
   return grouping;
 }
 
-std::vector<GroupingInfo> detectDimGroupings(const Graph &graph,
-                                             const Tensor &t) {
+unsigned detectInnermostGrouping(const Graph &graph, const Tensor &t0) {
+  if (t0.rank() == 0)
+    throw poplibs_error("Cannot detect channel grouping of 0-rank tensor");
+
+  if (t0.numElements() == 0)
+    return 1;
+
+  // Sample the first point in the inner dimension
+  auto t = t0;
+  while (t.rank() != 1)
+    t = t[0];
+
+  // The grouping only depends on the sampled row so that is the cache key.
+  return withIntrospectionCache(
+      graph, t, &LayoutInfo::innermostGrouping,
+      [&] { return detectInnermostGroupingOfRow(graph, t); });
+}
+
+static std::vector<GroupingInfo> detectDimGroupingsImpl(const Graph &graph,
+                                                        const Tensor &t) {
   std::vector<GroupingInfo> info;
 
   auto dims = t.rank();
@@ -388,4 +486,81 @@ std::vector<GroupingInfo> detectDimGroupings(const Graph &graph,
   return info;
 }
 
+std::vector<GroupingInfo> detectDimGroupings(const Graph &graph,
+                                             const Tensor &t) {
+  return withIntrospectionCache(
+      graph, t, &LayoutInfo::dimGroupings,
+      [&] { return detectDimGroupingsImpl(graph, t); });
+}
+
+IntrospectionCacheScope::IntrospectionCacheScope(const Graph &graph)
+    : graph(graph) {
+  std::lock_guard<std::mutex> lock(cachesMutex);
+  ++caches[&graph].numScopes;
+}
+
+IntrospectionCacheScope::~IntrospectionCacheScope() {
+  std::lock_guard<std::mutex> lock(cachesMutex);
+  auto it = caches.find(&graph);
+  assert(it != caches.end());
+  if (--it->second.numScopes == 0) {
+    const auto &stats = it->second.stats;
+    logging::poputil::debug("Introspection cache: {} hits, {} misses, {} "
+                            "invalidations, {} layouts",
+                            stats.hits, stats.misses, stats.invalidations,
+                            it->second.entries.size());
+    caches.erase(it);
+  }
+}
+
+void invalidateIntrospectionCache(const Graph &graph, const Tensor &t) {
+  std::lock_guard<std::mutex> lock(cachesMutex);
+  auto it = caches.find(&graph);
+  if (it == caches.end()) {
+    return;
+  }
+  auto &cache = it->second;
+  std::unordered_set<VariableRef> vars;
+  for (const auto &region : t.getVarRegions()) {
+    if (cache.cachedVars.count(region.var)) {
+      vars.insert(region.var);
+    }
+  }
+  if (vars.empty()) {
+    return;
+  }
+  for (auto entry = cache.entries.begin(); entry != cache.entries.end();) {
+    const auto &regions = entry->first.regions;
+    if (std::any_of(regions.begin(), regions.end(),
+                    [&](const VariableInterval &region) {
+                      return vars.count(region.var) != 0;
+                    })) {
+      entry = cache.entries.erase(entry);
+      ++cache.stats.invalidations;
+    } else {
+      ++entry;
+    }
+  }
+  for (const auto &var : vars) {
+    cache.cachedVars.erase(var);
+  }
+}
+
+void invalidateIntrospectionCache(const Graph &graph) {
+  std::lock_guard<std::mutex> lock(cachesMutex);
+  auto it = caches.find(&graph);
+  if (it == caches.end()) {
+    return;
+  }
+  it->second.stats.invalidations += it->second.entries.size();
+  it->second.entries.clear();
+  it->second.cachedVars.clear();
+}
+
+IntrospectionCacheStats getIntrospectionCacheStats(const Graph &graph) {
+  std::lock_guard<std::mutex> lock(cachesMutex);
+  auto it = caches.find(&graph);
+  return it == caches.end() ? IntrospectionCacheStats() : it->second.stats;
+}
+
 } // end namespace poputil
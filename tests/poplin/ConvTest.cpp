@@ -7,9 +7,14 @@
 #include <poplibs_support/TestDevice.hpp>
 #include <poplibs_support/VectorUtils.hpp>
 #include <poplibs_test/Convolution.hpp>
+#include <poplibs_test/GeneralMatrixMultiply.hpp>
 #include <poplibs_test/Util.hpp>
 #include <poplin/Convolution.hpp>
+#include <poplin/MatMul.hpp>
 #include <poplin/codelets.hpp>
+#include <popops/codelets.hpp>
+#include <algorithm>
+#include <cmath>
 #include <random>
 
 using namespace poplar;
@@ -307,6 +312,221 @@ BOOST_AUTO_TEST_CASE(MultiConvCombination) {
   runAndCheckConvolution(device, graph, {cp1, cp2, cp3});
 }
 
+// Bias, RELU and a cast to half applied by the epilogue of a convolution
+// with float output.
+BOOST_AUTO_TEST_CASE(ConvolutionEpilogue) {
+  auto device = createTestDevice(TEST_TARGET, 1, 16);
+  const auto &target = device.getTarget();
+  Graph graph(target);
+  poplin::addCodelets(graph);
+  popops::addCodelets(graph);
+
+  const auto params = createParams();
+  const auto numOutChans = params.outputChannelsPerConvGroup;
+  poplin::PlanningCache cache;
+  auto in = createInput(graph, params, "in", {}, &cache);
+  auto weights = createWeights(graph, params, "weights", {}, &cache);
+  Epilogue epilogue;
+  epilogue.biases = graph.addVariable(FLOAT, {numOutChans}, "biases");
+  poputil::mapTensorLinearly(graph, epilogue.biases);
+  epilogue.nonLinearity = popops::expr::UnaryOpType::RELU;
+  epilogue.outputType = HALF;
+
+  poplar::program::Sequence prog, uploadProg, downloadProg;
+  auto out = poplin::convolution(graph, in, weights, params, false, epilogue,
+                                 prog, "conv", {}, &cache);
+  BOOST_CHECK(out.elementType() == HALF);
+
+  std::vector<std::pair<std::string, char *>> tmap;
+  auto rawIn = allocateHostMemoryForTensor(in, "in", graph, uploadProg,
+                                           downloadProg, tmap);
+  auto rawWeights = allocateHostMemoryForTensor(weights, "weights", graph,
+                                                uploadProg, downloadProg, tmap);
+  auto rawBiases = allocateHostMemoryForTensor(
+      epilogue.biases, "biases", graph, uploadProg, downloadProg, tmap);
+  auto rawOut = allocateHostMemoryForTensor(out, "out", graph, uploadProg,
+                                            downloadProg, tmap);
+
+  boost::multi_array<double, 3> hostIn(
+      boost::extents[params.batchSize][params.inputChannelsPerConvGroup]
+                    [product(params.inputFieldShape)]);
+  boost::multi_array<double, 4> hostWeights(
+      boost::extents[1][numOutChans][params.inputChannelsPerConvGroup]
+                    [product(params.kernelShape)]);
+  boost::multi_array<double, 1> hostBiases(boost::extents[numOutChans]);
+  std::mt19937 randomEngine;
+  writeRandomValues(target, HALF, hostIn, -2.0, 2.0, randomEngine);
+  writeRandomValues(target, HALF, hostWeights, -2.0, 2.0, randomEngine);
+  writeRandomValues(target, FLOAT, hostBiases, -2.0, 2.0, randomEngine);
+  copy(target, hostIn, HALF, rawIn.get());
+  copy(target, hostWeights, HALF, rawWeights.get());
+  copy(target, hostBiases, FLOAT, rawBiases.get());
+
+  Engine e(graph, poplar::program::Sequence{uploadProg, prog, downloadProg});
+  attachStreams(e, tmap);
+  device.bind([&](const Device &d) { e.loadAndRun(d); });
+
+  auto modelOut = createOut(params);
+  convolve(hostIn, hostWeights, hostBiases, modelOut, params);
+  std::transform(modelOut.data(), modelOut.data() + modelOut.num_elements(),
+                 modelOut.data(), [](double x) { return std::max(x, 0.0); });
+  auto hostOut = createOut(params);
+  copy(target, HALF, rawOut.get(), hostOut);
+  BOOST_CHECK(checkIsClose("epilogue", hostOut, modelOut, 0.01, 1e-3));
+}
+
+// Bias and TANH applied in float by the epilogue of a matrix multiplication
+// with half output.
+BOOST_AUTO_TEST_CASE(MatMulEpilogue) {
+  constexpr std::size_t m = 8, k = 16, n = 12;
+  auto device = createTestDevice(TEST_TARGET, 1, 16);
+  const auto &target = device.getTarget();
+  Graph graph(target);
+  poplin::addCodelets(graph);
+  popops::addCodelets(graph);
+
+  matmul::PlanningCache cache;
+  auto a = createMatMulInputLHS(graph, HALF, {m, k}, {k, n}, "a", {}, &cache);
+  auto b = createMatMulInputRHS(graph, HALF, {m, k}, {k, n}, "b", {}, &cache);
+  Epilogue epilogue;
+  epilogue.biases = graph.addVariable(HALF, {n}, "biases");
+  poputil::mapTensorLinearly(graph, epilogue.biases);
+  epilogue.nonLinearity = popops::expr::UnaryOpType::TANH;
+  epilogue.outputType = FLOAT;
+
+  poplar::program::Sequence prog, uploadProg, downloadProg;
+  auto out = poplin::matMul(graph, a, b, prog, HALF, epilogue, "matMul", {},
+                            &cache);
+  BOOST_CHECK(out.elementType() == FLOAT);
+  BOOST_CHECK(out.shape() == std::vector<std::size_t>({m, n}));
+
+  std::vector<std::pair<std::string, char *>> tmap;
+  auto rawA = allocateHostMemoryForTensor(a, "a", graph, uploadProg,
+                                          downloadProg, tmap);
+  auto rawB = allocateHostMemoryForTensor(b, "b", graph, uploadProg,
+                                          downloadProg, tmap);
+  auto rawBiases = allocateHostMemoryForTensor(
+      epilogue.biases, "biases", graph, uploadProg, downloadProg, tmap);
+  auto rawOut = allocateHostMemoryForTensor(out, "out", graph, uploadProg,
+                                            downloadProg, tmap);
+
+  boost::multi_array<double, 2> hostA(boost::extents[m][k]);
+  boost::multi_array<double, 2> hostB(boost::extents[k][n]);
+  boost::multi_array<double, 1> hostBiases(boost::extents[n]);
+  std::mt19937 randomEngine;
+  writeRandomValues(target, HALF, hostA, -1.0, 1.0, randomEngine);
+  writeRandomValues(target, HALF, hostB, -1.0, 1.0, randomEngine);
+  writeRandomValues(target, HALF, hostBiases, -1.0, 1.0, randomEngine);
+  copy(target, hostA, HALF, rawA.get());
+  copy(target, hostB, HALF, rawB.get());
+  copy(target, hostBiases, HALF, rawBiases.get());
+
+  Engine e(graph, poplar::program::Sequence{uploadProg, prog, downloadProg});
+  attachStreams(e, tmap);
+  device.bind([&](const Device &d) { e.loadAndRun(d); });
+
+  boost::multi_array<double, 2> modelOut(boost::extents[m][n]);
+  poplibs_test::gemm::generalMatrixMultiply(hostA, hostB, modelOut);
+  for (std::size_t i = 0; i != m; ++i) {
+    for (std::size_t j = 0; j != n; ++j) {
+      modelOut[i][j] = std::tanh(modelOut[i][j] + hostBiases[j]);
+    }
+  }
+  boost::multi_array<double, 2> hostOut(boost::extents[m][n]);
+  copy(target, FLOAT, rawOut.get(), hostOut);
+  BOOST_CHECK(checkIsClose("epilogue", hostOut, modelOut, 0.01, 1e-3));
+}
+
+// Bias and SIGMOID applied in place by the epilogue of a matrix
+// multiplication whose rows do not divide evenly between tiles, so that the
+// regions of the epilogue wrap past the last column.
+BOOST_AUTO_TEST_CASE(MatMulEpilogueInPlace) {
+  constexpr std::size_t m = 9, k = 8, n = 37;
+  auto device = createTestDevice(TEST_TARGET, 1, 16);
+  const auto &target = device.getTarget();
+  Graph graph(target);
+  poplin::addCodelets(graph);
+  popops::addCodelets(graph);
+
+  matmul::PlanningCache cache;
+  auto a = createMatMulInputLHS(graph, FLOAT, {m, k}, {k, n}, "a", {}, &cache);
+  auto b = createMatMulInputRHS(graph, FLOAT, {m, k}, {k, n}, "b", {}, &cache);
+  Epilogue epilogue;
+  epilogue.biases = graph.addVariable(FLOAT, {n}, "biases");
+  poputil::mapTensorLinearly(graph, epilogue.biases);
+  epilogue.nonLinearity = popops::expr::UnaryOpType::SIGMOID;
+
+  poplar::program::Sequence prog, uploadProg, downloadProg;
+  auto out = poplin::matMul(graph, a, b, prog, FLOAT, epilogue, "matMul", {},
+                            &cache);
+  BOOST_CHECK(out.elementType() == FLOAT);
+
+  std::vector<std::pair<std::string, char *>> tmap;
+  auto rawA = allocateHostMemoryForTensor(a, "a", graph, uploadProg,
+                                          downloadProg, tmap);
+  auto rawB = allocateHostMemoryForTensor(b, "b", graph, uploadProg,
+                                          downloadProg, tmap);
+  auto rawBiases = allocateHostMemoryForTensor(
+      epilogue.biases, "biases", graph, uploadProg, downloadProg, tmap);
+  auto rawOut = allocateHostMemoryForTensor(out, "out", graph, uploadProg,
+                                            downloadProg, tmap);
+
+  boost::multi_array<double, 2> hostA(boost::extents[m][k]);
+  boost::multi_array<double, 2> hostB(boost::extents[k][n]);
+  boost::multi_array<double, 1> hostBiases(boost::extents[n]);
+  std::mt19937 randomEngine;
+  writeRandomValues(target, FLOAT, hostA, -1.0, 1.0, randomEngine);
+  writeRandomValues(target, FLOAT, hostB, -1.0, 1.0, randomEngine);
+  writeRandomValues(target, FLOAT, hostBiases, -4.0, 4.0, randomEngine);
+  copy(target, hostA, FLOAT, rawA.get());
+  copy(target, hostB, FLOAT, rawB.get());
+  copy(target, hostBiases, FLOAT, rawBiases.get());
+
+  Engine e(graph, poplar::program::Sequence{uploadProg, prog, downloadProg});
+  attachStreams(e, tmap);
+  device.bind([&](const Device &d) { e.loadAndRun(d); });
+
+  boost::multi_array<double, 2> modelOut(boost::extents[m][n]);
+  poplibs_test::gemm::generalMatrixMultiply(hostA, hostB, modelOut);
+  for (std::size_t i = 0; i != m; ++i) {
+    for (std::size_t j = 0; j != n; ++j) {
+      modelOut[i][j] = 1.0 / (1.0 + std::exp(-(modelOut[i][j] +
+                                               hostBiases[j])));
+    }
+  }
+  boost::multi_array<double, 2> hostOut(boost::extents[m][n]);
+  copy(target, FLOAT, rawOut.get(), hostOut);
+  BOOST_CHECK(checkIsClose("epilogue", hostOut, modelOut, 1e-4, 1e-6));
+}
+
+// Biases with a RELU, SIGMOID or TANH take a single pass over the output
+// whatever the types. Other non-linearities add the biases separately.
+BOOST_AUTO_TEST_CASE(EpiloguePasses) {
+  auto device = createTestDevice(TEST_TARGET, 1, 1);
+  Graph graph(device.getTarget());
+
+  Epilogue epilogue;
+  epilogue.biases = graph.addVariable(HALF, {4}, "biases");
+  epilogue.nonLinearity = popops::expr::UnaryOpType::RELU;
+  BOOST_CHECK_EQUAL(getNumEpiloguePasses(epilogue, HALF), 1);
+  BOOST_CHECK_EQUAL(getNumEpiloguePasses(epilogue, FLOAT), 1);
+  epilogue.outputType = FLOAT;
+  BOOST_CHECK_EQUAL(getNumEpiloguePasses(epilogue, HALF), 1);
+  epilogue.nonLinearity = popops::expr::UnaryOpType::TANH;
+  epilogue.outputType = HALF;
+  BOOST_CHECK_EQUAL(getNumEpiloguePasses(epilogue, FLOAT), 1);
+
+  epilogue.nonLinearity = popops::expr::UnaryOpType::ABSOLUTE;
+  BOOST_CHECK_EQUAL(getNumEpiloguePasses(epilogue, HALF), 2);
+  epilogue.outputType = FLOAT;
+  BOOST_CHECK_EQUAL(getNumEpiloguePasses(epilogue, HALF), 3);
+  epilogue.nonLinearity = boost::none;
+  epilogue.outputType = boost::none;
+  BOOST_CHECK_EQUAL(getNumEpiloguePasses(epilogue, HALF), 1);
+  epilogue.biases = Tensor();
+  BOOST_CHECK_EQUAL(getNumEpiloguePasses(epilogue, HALF), 0);
+}
+
 const auto printMapping = [](const auto &mapping) {
   for (unsigned tile = 0; tile < mapping.size(); ++tile) {
     std::stringstream ss;
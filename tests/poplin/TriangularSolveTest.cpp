@@ -173,3 +173,29 @@ BOOST_DATA_TEST_CASE(TriangularSolveCase,
                                    bShape, left_side, lower, unit_diagonal,
                                    block_size);
 }
+
+BOOST_AUTO_TEST_CASE(TriangularSolvePrePlanParameters) {
+  using Shape = std::vector<std::size_t>;
+  // A padded to 16 and solved down to blocks of 4: two recursive levels of
+  // [8x8]*[8x8] and [4x4]*[4x4] then three rows of the direct solver.
+  auto matmuls = getTriangularSolveMatMulPrePlanParameters(
+      FLOAT, FLOAT, {2, 3, 13, 13}, {2, 3, 13, 5}, true, true, 4);
+  BOOST_REQUIRE_EQUAL(matmuls.size(), 5);
+  BOOST_TEST(matmuls[0].first.aShape == Shape({6, 8, 8}),
+             boost::test_tools::per_element());
+  BOOST_TEST(matmuls[1].first.bShape == Shape({6, 4, 4}),
+             boost::test_tools::per_element());
+  for (std::size_t idx = 1; idx < 4; ++idx) {
+    BOOST_TEST(matmuls[idx + 1].first.aShape == Shape({6, 1, idx}),
+               boost::test_tools::per_element());
+    BOOST_TEST(matmuls[idx + 1].first.bShape == Shape({6, idx, 4}),
+               boost::test_tools::per_element());
+  }
+
+  // Small enough to be solved directly, right side solve uses the rows of B.
+  matmuls = getTriangularSolveMatMulPrePlanParameters(FLOAT, FLOAT, {3, 3},
+                                                      {7, 3}, false, true, 4);
+  BOOST_REQUIRE_EQUAL(matmuls.size(), 2);
+  BOOST_TEST(matmuls[1].first.bShape == Shape({1, 2, 7}),
+             boost::test_tools::per_element());
+}
@@ -2,9 +2,11 @@
 // Simple test case for test log of softmax
 //
 #define BOOST_TEST_MODULE NonLinearityTest
+#include <algorithm>
 #include <boost/test/unit_test.hpp>
 #include <iostream>
 #include <limits>
+#include <random>
 #include <poplar/Engine.hpp>
 #include <poplibs_support/TestDevice.hpp>
 #include <poplibs_test/Util.hpp>
@@ -122,3 +124,122 @@ void validateLogSoftmax(unsigned batchSize, unsigned numChannels) {
 BOOST_AUTO_TEST_CASE(logSoftmax_1D) { validateLogSoftmax(1, 100); }
 
 BOOST_AUTO_TEST_CASE(logSoftmax_2D) { validateLogSoftmax(4, 100); }
+
+// HALF inputs far from zero, where the offset max + log(sumExp) rounded to
+// HALF would be off by up to 0.5.
+BOOST_AUTO_TEST_CASE(logSoftmax_halfLargeInputs) {
+  constexpr unsigned numChannels = 8;
+  auto device = createTestDevice(TEST_TARGET);
+  auto &target = device.getTarget();
+  Graph graph(target);
+  popnn::addCodelets(graph);
+  popops::addCodelets(graph);
+
+  auto act = graph.addVariable(HALF, {2, numChannels}, "act");
+  mapTensorLinearly(graph, act);
+
+  Sequence prog, uploadProg, downloadProg;
+  auto out = popnn::logSoftmax(graph, act, prog);
+  popnn::logSoftmaxInPlace(graph, act, prog);
+
+  std::vector<std::pair<std::string, char *>> tmap;
+  auto rawAct = allocateHostMemoryForTensor(act, "act", graph, uploadProg,
+                                            downloadProg, tmap);
+  auto rawOut = allocateHostMemoryForTensor(out, "out", graph, uploadProg,
+                                            downloadProg, tmap);
+
+  // Values a multiple of 0.5 apart, which HALF holds exactly around 1000.
+  boost::multi_array<double, 2> hAct(boost::extents[2][numChannels]),
+      hOutRef(boost::extents[2][numChannels]);
+  for (unsigned b = 0; b < 2; ++b) {
+    const double base = b == 0 ? 1000.0 : -1500.0;
+    for (unsigned c = 0; c < numChannels; ++c) {
+      hAct[b][c] = base + 0.5 * c;
+    }
+    const double max = hAct[b][numChannels - 1];
+    double sum = 0.0;
+    for (unsigned c = 0; c < numChannels; ++c) {
+      sum += std::exp(hAct[b][c] - max);
+    }
+    for (unsigned c = 0; c < numChannels; ++c) {
+      hOutRef[b][c] = hAct[b][c] - max - std::log(sum);
+    }
+  }
+  copy(target, hAct, HALF, rawAct.get());
+
+  Engine engine(graph, Sequence(uploadProg, prog, downloadProg));
+  attachStreams(engine, tmap);
+  device.bind([&](const Device &d) { engine.loadAndRun(d); });
+
+  boost::multi_array<double, 2> hOut(boost::extents[2][numChannels]);
+  copy(target, HALF, rawOut.get(), hOut);
+  BOOST_TEST(checkIsClose("out", hOut, hOutRef, 0.01, HALF_ATOL));
+  copy(target, HALF, rawAct.get(), hOut);
+  BOOST_TEST(checkIsClose("act", hOut, hOutRef, 0.01, HALF_ATOL));
+}
+
+// The rows are mapped across tiles with a grain size of one so that most
+// rows are split between tiles and workers, giving several partial
+// normalisers per row to combine.
+void validateSoftmaxNormaliser(const Type &type) {
+  const std::vector<std::size_t> shape = {2, 3, 500};
+  const auto numRows = shape[0] * shape[1];
+  const auto rowSize = shape[2];
+  auto device = createTestDevice(TEST_TARGET, 1, 4);
+  auto &target = device.getTarget();
+  Graph graph(target);
+  popnn::addCodelets(graph);
+  popops::addCodelets(graph);
+
+  auto act = graph.addVariable(type, shape, "act");
+  mapTensorLinearly(graph, act, 1, 1);
+
+  Sequence prog, uploadProg, downloadProg;
+  const auto normaliser = popnn::softmaxNormaliser(graph, act, prog);
+  const std::vector<std::size_t> rowShape = {shape[0], shape[1]};
+  BOOST_CHECK(normaliser.max.shape() == rowShape);
+  BOOST_CHECK(normaliser.sumExp.shape() == rowShape);
+
+  std::vector<std::pair<std::string, char *>> tmap;
+  auto rawAct = allocateHostMemoryForTensor(act, "act", graph, uploadProg,
+                                            downloadProg, tmap);
+  auto rawMax = allocateHostMemoryForTensor(normaliser.max, "max", graph,
+                                            uploadProg, downloadProg, tmap);
+  auto rawSumExp = allocateHostMemoryForTensor(
+      normaliser.sumExp, "sumExp", graph, uploadProg, downloadProg, tmap);
+
+  boost::multi_array<double, 2> hAct(boost::extents[numRows][rowSize]);
+  std::mt19937 randomEngine;
+  writeRandomValues(target, type, hAct, -10.0, 10.0, randomEngine);
+  copy(target, hAct, type, rawAct.get());
+  copy(target, type, rawAct.get(), hAct);
+
+  boost::multi_array<double, 1> hMaxRef(boost::extents[numRows]),
+      hSumExpRef(boost::extents[numRows]);
+  for (unsigned r = 0; r < numRows; ++r) {
+    hMaxRef[r] = *std::max_element(hAct[r].begin(), hAct[r].end());
+    hSumExpRef[r] = 0;
+    for (unsigned c = 0; c < rowSize; ++c) {
+      hSumExpRef[r] += std::exp(hAct[r][c] - hMaxRef[r]);
+    }
+  }
+
+  Engine engine(graph, Sequence(uploadProg, prog, downloadProg));
+  attachStreams(engine, tmap);
+  device.bind([&](const Device &d) { engine.loadAndRun(d); });
+
+  boost::multi_array<double, 1> hMax(boost::extents[numRows]),
+      hSumExp(boost::extents[numRows]);
+  copy(target, FLOAT, rawMax.get(), hMax);
+  copy(target, FLOAT, rawSumExp.get(), hSumExp);
+  BOOST_TEST(checkIsClose("max", hMax, hMaxRef, 0.0));
+  BOOST_TEST(checkIsClose("sumExp", hSumExp, hSumExpRef, 0.01, FLOAT_ATOL));
+}
+
+BOOST_AUTO_TEST_CASE(softmaxNormaliser_float) {
+  validateSoftmaxNormaliser(FLOAT);
+}
+
+BOOST_AUTO_TEST_CASE(softmaxNormaliser_half) {
+  validateSoftmaxNormaliser(HALF);
+}
@@ -19,6 +19,7 @@
 #include <boost/multi_array.hpp>
 #include <boost/random.hpp>
 #include <cassert>
+#include <cmath>
 #include <iostream>
 #include <limits>
 #include <random>
@@ -275,6 +276,109 @@ static bool lossTest(const LossType lossType, std::size_t batchSize,
   return matchesModel;
 }
 
+static bool sparseSoftmaxCrossEntropyTest(const Type &fpType,
+                                          const Type &labelType,
+                                          std::size_t batchSize,
+                                          std::size_t numClasses,
+                                          bool maskLabels, bool scaling) {
+  auto device = createTestDevice(TEST_TARGET, 1, 4);
+  auto target = device.getTarget();
+  poplar::Graph graph(target);
+  popops::addCodelets(graph);
+  popnn::addCodelets(graph);
+
+  auto logits = graph.addVariable(fpType, {batchSize, numClasses},
+                                  VariableMappingMethod::LINEAR, "logits");
+  auto labels = graph.addVariable(labelType, {batchSize},
+                                  VariableMappingMethod::LINEAR, "labels");
+  auto loss = graph.addVariable(fpType, {batchSize},
+                                VariableMappingMethod::LINEAR, "loss");
+
+  Sequence uploadProg, downloadProg;
+  std::vector<std::pair<std::string, char *>> tmap;
+  auto rawHostLogits = allocateHostMemoryForTensor(
+      logits, "logits", graph, uploadProg, downloadProg, tmap);
+  auto rawHostLabels = allocateHostMemoryForTensor(
+      labels, "labels", graph, uploadProg, downloadProg, tmap);
+  auto rawHostLoss = allocateHostMemoryForTensor(
+      loss, "loss", graph, uploadProg, downloadProg, tmap);
+
+  std::mt19937 randomEngine;
+  boost::multi_array<double, 2> hostLogits(
+      boost::extents[batchSize][numClasses]);
+  writeRandomValues(target, fpType, hostLogits, -5.0, 5.0, randomEngine);
+  copy(target, hostLogits, fpType, rawHostLogits.get());
+  copy(target, fpType, rawHostLogits.get(), hostLogits);
+  std::vector<std::uint64_t> hostLabels(batchSize);
+  boost::random::uniform_int_distribution<std::uint64_t> labelDist(
+      0, numClasses - 1);
+  for (std::size_t b = 0; b < batchSize; ++b) {
+    hostLabels[b] = labelDist(randomEngine);
+    if (maskLabels && b % 3 == 1) {
+      hostLabels[b] = MASKED_LABEL_CODE;
+    }
+  }
+  copyLabels(labelType, hostLabels, rawHostLabels.get());
+
+  const float scaleForDeltas = scaling ? 1000.0f : 1.0f;
+  Program prog;
+  if (scaling) {
+    auto deltasScale = graph.addConstant(fpType, {}, scaleForDeltas);
+    graph.setTileMapping(deltasScale, 0);
+    prog = calcSparseSoftmaxCrossEntropyLoss(graph, logits, labels, loss,
+                                             deltasScale);
+  } else {
+    prog = calcSparseSoftmaxCrossEntropyLoss(graph, logits, labels, loss);
+  }
+
+  Engine engine(graph, Sequence(uploadProg, prog, downloadProg));
+  device.bind([&](const Device &d) {
+    engine.load(d);
+    attachStreams(engine, tmap);
+
+    engine.run(0);
+  });
+
+  boost::multi_array<double, 2> hostDeltas(
+      boost::extents[batchSize][numClasses]);
+  boost::multi_array<double, 1> hostLoss(boost::extents[batchSize]);
+  copy(target, fpType, rawHostLogits.get(), hostDeltas);
+  copy(target, fpType, rawHostLoss.get(), hostLoss);
+
+  boost::multi_array<double, 2> modelDeltas(
+      boost::extents[batchSize][numClasses]);
+  boost::multi_array<double, 1> modelLoss(boost::extents[batchSize]);
+  for (std::size_t b = 0; b < batchSize; ++b) {
+    const bool masked = hostLabels[b] == MASKED_LABEL_CODE;
+    const auto max =
+        *std::max_element(hostLogits[b].begin(), hostLogits[b].end());
+    double sum = 0;
+    for (std::size_t c = 0; c < numClasses; ++c) {
+      sum += std::exp(hostLogits[b][c] - max);
+    }
+    modelLoss[b] =
+        masked ? 0 : std::log(sum) + max - hostLogits[b][hostLabels[b]];
+    for (std::size_t c = 0; c < numClasses; ++c) {
+      const double expect = c == hostLabels[b] ? 1 : 0;
+      modelDeltas[b][c] =
+          masked ? 0
+                 : scaleForDeltas *
+                       (std::exp(hostLogits[b][c] - max) / sum - expect);
+    }
+  }
+
+  const double relativeTolerance = fpType == FLOAT ? 0.01 : 0.1;
+  const double absoluteTolerance = (fpType == FLOAT ? 1e-6 : 1e-3) *
+                                   scaleForDeltas;
+
+  bool matchesModel = true;
+  matchesModel &= checkIsClose("deltas", hostDeltas, modelDeltas,
+                               relativeTolerance, absoluteTolerance);
+  matchesModel &= checkIsClose("loss", hostLoss, modelLoss, relativeTolerance,
+                               fpType == FLOAT ? 1e-6 : 1e-3);
+  return matchesModel;
+}
+
 static bool accuracyTest(const Type &fpType, const Type &labelType,
                          std::size_t batchSize, std::size_t numClasses,
                          bool maskLabels) {
@@ -326,8 +430,13 @@ static bool accuracyTest(const Type &fpType, const Type &labelType,
   return modelNumCorrect == actualNumCorrect;
 }
 
+// With \p withTies the activations take a few distinct values, so the
+// maximum appears many times, and the classes are mapped to the tiles in
+// decreasing order.
 static bool argMaxTest(const Type &inType, std::size_t batchSize,
-                       std::size_t numClasses) {
+                       std::size_t numClasses,
+                       const std::string &method = "auto",
+                       bool withTies = false) {
   auto device = createTestDevice(TEST_TARGET, 1, 4);
   auto target = device.getTarget();
   poplar::Graph graph(target);
@@ -337,6 +446,16 @@ static bool argMaxTest(const Type &inType, std::size_t batchSize,
   auto activations =
       graph.addVariable(inType, {batchSize, numClasses},
                         VariableMappingMethod::LINEAR, "activations");
+  if (withTies) {
+    const auto numTiles = target.getNumTiles();
+    const auto classesPerTile = (numClasses + numTiles - 1) / numTiles;
+    for (unsigned tile = 0; tile != numTiles; ++tile) {
+      const auto begin = std::min(numClasses, tile * classesPerTile);
+      const auto end = std::min(numClasses, begin + classesPerTile);
+      graph.setTileMapping(activations.slice(begin, end, 1),
+                           numTiles - 1 - tile);
+    }
+  }
 
   Sequence uploadProg, downloadProg;
   std::vector<std::pair<std::string, char *>> tmap;
@@ -352,10 +471,17 @@ static bool argMaxTest(const Type &inType, std::size_t batchSize,
                     isInt ? std::numeric_limits<int>::min() : 0.0,
                     isFpType ? 1.0 : std::numeric_limits<int>::max(),
                     randomEngine);
+  if (withTies) {
+    for (unsigned b = 0; b != batchSize; ++b) {
+      for (unsigned c = 0; c != numClasses; ++c) {
+        hostActivations[b][c] = (7 * c + b) % 5;
+      }
+    }
+  }
   copy(target, hostActivations, inType, rawHostActivations.get());
 
   Sequence prog;
-  auto indices = argMax(graph, activations, prog);
+  auto indices = argMax(graph, activations, prog, {}, {{"method", method}});
 
   boost::multi_array<unsigned, 1> hostIndices(boost::extents[batchSize]);
 
@@ -453,7 +579,7 @@ static std::vector<double> model_topK(std::vector<double> &acts, int numK) {
 
 static bool topKTest(const Type &fpType, std::size_t batchSize,
                      std::size_t numClasses, std::size_t numK,
-                     bool sort = false) {
+                     bool sort = false, const std::string &method = "auto") {
   auto device = createTestDevice(TEST_TARGET, 1, 4);
   auto target = device.getTarget();
   poplar::Graph graph(target);
@@ -483,7 +609,8 @@ static bool topKTest(const Type &fpType, std::size_t batchSize,
   copy(target, hostActivations, fpType, rawHostActivations.get());
 
   Sequence prog;
-  auto values = topK(graph, activations, outputIndices, numK, sort, prog);
+  auto values = topK(graph, activations, outputIndices, numK, sort, prog, {},
+                     {{"method", method}});
 
   auto rawHostOut = allocateHostMemoryForTensor(values, "output", graph,
                                                 uploadProg, downloadProg, tmap);
@@ -549,6 +676,18 @@ BOOST_AUTO_TEST_CASE(argMaxUnsignedInt) {
   BOOST_CHECK(matchesModel);
 }
 
+BOOST_AUTO_TEST_CASE(argMaxStreaming) {
+  BOOST_CHECK(argMaxTest(FLOAT, 2, 10, "streaming"));
+  BOOST_CHECK(argMaxTest(FLOAT, 3, 5000, "streaming"));
+  BOOST_CHECK(argMaxTest(INT, 2, 2000, "streaming"));
+}
+
+BOOST_AUTO_TEST_CASE(argMaxTies) {
+  BOOST_CHECK(argMaxTest(FLOAT, 2, 5000, "heap", true));
+  BOOST_CHECK(argMaxTest(FLOAT, 2, 5000, "streaming", true));
+  BOOST_CHECK(argMaxTest(INT, 3, 2000, "streaming", true));
+}
+
 BOOST_AUTO_TEST_CASE(argMinFloat) {
   auto matchesModel = argMinTest(FLOAT, 2, 10);
   BOOST_CHECK(matchesModel);
@@ -627,6 +766,23 @@ BOOST_AUTO_TEST_CASE(topKHalf) {
   BOOST_CHECK(topKTest(HALF, 1, 20, 20, true));
 }
 
+BOOST_AUTO_TEST_CASE(topKStreaming) {
+  BOOST_CHECK(topKTest(FLOAT, 2, 10, 3, false, "streaming"));
+  BOOST_CHECK(topKTest(FLOAT, 1, 20, 20, true, "streaming"));
+  BOOST_CHECK(topKTest(FLOAT, 2, 1200, 24, true, "streaming"));
+
+  // Enough classes for several partial results per tile and merge stages.
+  BOOST_CHECK(topKTest(FLOAT, 3, 20000, 5, false, "streaming"));
+  BOOST_CHECK(topKTest(FLOAT, 2, 20000, 5, true, "streaming"));
+  BOOST_CHECK(topKTest(HALF, 1, 6000, 150, true, "streaming"));
+
+  // K larger than the classes held by each tile.
+  BOOST_CHECK(topKTest(FLOAT, 1, 1000, 400, true, "streaming"));
+
+  // Large enough to be streamed by default.
+  BOOST_CHECK(topKTest(FLOAT, 1, 8192, 16, true));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 #define LOSS_TEST_NAME(lossType, b, n, tr, ml, fpType, lType, scaling)         \
@@ -681,3 +837,21 @@ ENUMERATE_VALID_ACCURACY_TYPE_TESTS(1, 1, false)
 ENUMERATE_VALID_ACCURACY_TYPE_TESTS(100, 20, true)
 
 BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(SparseSoftmaxCrossEntropy)
+
+BOOST_AUTO_TEST_CASE(SparseSoftmaxCrossEntropyFloat) {
+  BOOST_CHECK(sparseSoftmaxCrossEntropyTest(FLOAT, UNSIGNED_INT, 1, 1, false,
+                                            false));
+  BOOST_CHECK(sparseSoftmaxCrossEntropyTest(FLOAT, UNSIGNED_INT, 4, 1000,
+                                            false, true));
+  BOOST_CHECK(sparseSoftmaxCrossEntropyTest(FLOAT, INT, 10, 37, true, false));
+}
+
+BOOST_AUTO_TEST_CASE(SparseSoftmaxCrossEntropyHalf) {
+  BOOST_CHECK(sparseSoftmaxCrossEntropyTest(HALF, UNSIGNED_INT, 3, 500, true,
+                                            true));
+  BOOST_CHECK(sparseSoftmaxCrossEntropyTest(HALF, INT, 8, 20, false, false));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -3,6 +3,7 @@
 #include <boost/multi_array.hpp>
 #include <boost/test/framework.hpp>
 #include <boost/test/unit_test.hpp>
+#include <algorithm>
 #include <cassert>
 #include <iostream>
 #include <numeric>
@@ -16,6 +17,7 @@
 #include <poputil/TileMapping.hpp>
 #include <poputil/exceptions.hpp>
 #include <sstream>
+#include <type_traits>
 #include <vector>
 
 using namespace poplar;
@@ -921,8 +923,8 @@ void multiupdate(const std::vector<uint32_t> &indicies,
                  const std::vector<std::size_t> &indiciesShape,
                  bool planAsEmbedding, bool accumulate = false,
                  float updateScaling = 1.0,
-                 const unsigned E = 8) // embedding size
-{
+                 const unsigned E = 8, // embedding size
+                 const OptionFlags &options = {}) {
   // This test should pass with large T - but graph construction becomes
   // slow (a couple of minutes for T=1024)
   assert(indiciesShape.size() == 2); // max 2 dims supported by this test
@@ -936,7 +938,6 @@ void multiupdate(const std::vector<uint32_t> &indicies,
   std::vector<std::size_t> sliceSizes{1};
   Tensor scale;
 
-  const auto options = OptionFlags();
   auto plan = SlicePlan();
   if (planAsEmbedding) {
     plan = embedding::plan(graph, HALF, D, E, {indicies.size()}, options);
@@ -996,7 +997,7 @@ void multiupdate(const std::vector<uint32_t> &indicies,
   // Engine creation will fail for non-cpu targets if many edge pointers or
   // significant exchange is required; this should not happen if
   // createSliceableTensor() has given a good layout
-  Engine eng(graph, prog, options);
+  Engine eng(graph, prog);
   device.bind([&](const Device &d) {
     eng.load(d);
     if (accumulate) {
@@ -1122,6 +1123,66 @@ BOOST_AUTO_TEST_CASE(MultiUpdateAdd10Multiples_AsEmbedding) {
               64);
 }
 
+// sum the updates to duplicate indices before the update
+BOOST_AUTO_TEST_CASE(MultiUpdateAdd12Coalesced) {
+  multiupdate({2, 1, 2, 1, 80, 2, 70, 60, 2, 50, 40, 1}, {12, 1}, false, true,
+              0.5, 8, {{"coalesceDuplicates", "always"}});
+}
+
+BOOST_AUTO_TEST_CASE(MultiUpdateAdd12Coalesced_AsEmbedding) {
+  multiupdate({2, 1, 2, 1, 80, 2, 70, 60, 2, 50, 40, 1}, {12, 1}, true, true,
+              0.5, 8, {{"coalesceDuplicates", "always"}});
+}
+
+// Coalesce duplicate updates of the columns of a base tensor with fewer rows
+// than columns: the updates dropped from a run must not land on a column
+// whose index is the number of rows.
+BOOST_AUTO_TEST_CASE(MultiUpdateAddCoalescedColumns) {
+  const std::size_t numRows = 4, numColumns = 16;
+  const std::vector<unsigned> indices = {4, 1, 4, 9, 4, 1, 0, 4};
+  const auto numIndices = indices.size();
+  auto device = createTestDevice(TEST_TARGET, 1, 4);
+  const auto &target = device.getTarget();
+  Graph graph(target);
+  popops::addCodelets(graph);
+
+  auto t = graph.addVariable(FLOAT, {numRows, numColumns}, "t");
+  auto s = graph.addVariable(FLOAT, {numIndices, numRows, 1}, "s");
+  mapTensorLinearly(graph, t);
+  mapTensorLinearly(graph, s);
+  auto offset = graph.addConstant(UNSIGNED_INT, {numIndices, 1}, indices.data(),
+                                  "offset");
+  graph.setTileMapping(offset, 0);
+  auto scale = graph.addConstant(FLOAT, {}, 1.0f, "scale");
+  graph.setTileMapping(scale, 0);
+  Sequence prog;
+  multiUpdateAdd(graph, t, s, offset, scale, {1}, {1}, prog, SlicePlan(),
+                 {{"coalesceDuplicates", "always"}}, "coalescedColumns");
+  graph.createHostWrite("inS", s, true);
+  graph.createHostWrite("inT", t, true);
+  graph.createHostRead("outT", t, true);
+
+  std::vector<float> hS(s.numElements());
+  std::iota(hS.begin(), hS.end(), 1.0f);
+  std::vector<float> hT(t.numElements(), 0.0f);
+  std::vector<float> expected = hT;
+  for (std::size_t i = 0; i != numIndices; ++i) {
+    for (std::size_t row = 0; row != numRows; ++row) {
+      expected[row * numColumns + indices[i]] += hS[i * numRows + row];
+    }
+  }
+
+  Engine eng(graph, prog);
+  device.bind([&](const Device &d) {
+    eng.load(d);
+    eng.writeTensor("inS", hS.data(), hS.data() + hS.size());
+    eng.writeTensor("inT", hT.data(), hT.data() + hT.size());
+    eng.run();
+    eng.readTensor("outT", hT.data(), hT.data() + hT.size());
+  });
+  BOOST_TEST(hT == expected, boost::test_tools::per_element());
+}
+
 // test heuristic which checks for mapping of a slice.
 // if this doesn't kick in we will run out of memory on some
 // tiles hence we check for an error constructing the engine.
@@ -1392,6 +1453,159 @@ BOOST_AUTO_TEST_CASE(MultiUpdateAddPoorlyMappedSlices) {
 
 BOOST_AUTO_TEST_SUITE_END()
 
+// Combine slices with duplicate indices using each of the operations, with
+// and without a plan. A plan constrained to split the lookups checks the
+// reduction of partials. Integer data uses values whose products do not fit
+// in a float mantissa, so they must be combined exactly.
+template <typename T = float>
+static void multiUpdateOpTest(Operation op, bool planAsEmbedding,
+                              unsigned lookupSplit = 1) {
+  const auto type = equivalent_device_type<T>().value;
+  const std::vector<unsigned> indices = {3, 1, 3, 7, 0, 3, 1, 9, 4, 7, 3, 2};
+  const unsigned T = 16;  // tiles
+  const unsigned D = 100; // dictionary size
+  const unsigned E = 8;   // embedding size
+  const unsigned N = indices.size();
+  auto device = createTestDevice(TEST_TARGET, 1, T);
+  const auto &target = device.getTarget();
+  Graph graph(target);
+  popops::addCodelets(graph);
+
+  OptionFlags sliceOptions;
+  auto plan = SlicePlan();
+  if (planAsEmbedding) {
+    sliceOptions.set("planConstraints", "{\"lookupSplit\": " +
+                                            std::to_string(lookupSplit) + "}");
+    plan = embedding::plan(graph, type, D, E, {N}, sliceOptions);
+  }
+  auto t = createSliceableTensor(graph, type, {D, E}, {0}, {1}, plan,
+                                 sliceOptions, "t");
+  auto s = createSliceTensor(graph, type, {D, E}, {0}, {1}, N, plan,
+                             sliceOptions, "s");
+  auto offsetInit =
+      graph.addConstant(UNSIGNED_INT, {N, 1}, indices.data(), "offsetInit");
+  graph.setTileMapping(offsetInit, 0);
+  auto offset =
+      createIndicesTensor(graph, {0}, N, plan, sliceOptions, "offset");
+
+  Sequence prog;
+  prog.add(Copy(offsetInit, offset));
+  multiUpdateOp(graph, t, s, offset, {0}, {1}, prog, plan, op, sliceOptions,
+                "multiUpdateOpTest");
+
+  graph.createHostWrite("inS", s, true);
+  graph.createHostWrite("inT", t, true);
+  graph.createHostRead("outT", t, true);
+
+  std::vector<T> hS(s.numElements()), hT(t.numElements());
+  for (unsigned i = 0; i != hS.size(); ++i) {
+    if (std::is_integral<T>::value) {
+      hS[i] = 3 + i * 7 % 13;
+    } else {
+      hS[i] = 0.5f + (i * 7 % 13) * 0.25f;
+    }
+  }
+  for (unsigned i = 0; i != hT.size(); ++i) {
+    if (std::is_integral<T>::value) {
+      hT[i] = 100001 + i % 5;
+    } else {
+      hT[i] = 1.0f + (i % 5) * 0.5f;
+    }
+  }
+  std::vector<T> expected = hT;
+  for (unsigned i = 0; i != N; ++i) {
+    for (unsigned e = 0; e != E; ++e) {
+      auto &dst = expected[indices[i] * E + e];
+      const auto src = hS[i * E + e];
+      switch (op) {
+      case Operation::ADD:
+        dst += src;
+        break;
+      case Operation::MUL:
+        dst *= src;
+        break;
+      case Operation::MIN:
+        dst = std::min(dst, src);
+        break;
+      case Operation::MAX:
+        dst = std::max(dst, src);
+        break;
+      default:
+        BOOST_FAIL("Unexpected operation");
+      }
+    }
+  }
+
+  Engine eng(graph, prog);
+  device.bind([&](const Device &d) {
+    eng.load(d);
+    eng.writeTensor("inT", hT.data(), hT.data() + hT.size());
+    eng.writeTensor("inS", hS.data(), hS.data() + hS.size());
+    eng.run();
+    eng.readTensor("outT", hT.data(), hT.data() + hT.size());
+  });
+  for (unsigned i = 0; i != hT.size(); ++i) {
+    if (std::is_integral<T>::value) {
+      BOOST_CHECK_EQUAL(hT[i], expected[i]);
+    } else {
+      BOOST_CHECK_CLOSE(hT[i], expected[i], 1e-4);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_SUITE(MultiUpdateOps)
+
+BOOST_AUTO_TEST_CASE(MultiUpdateOpMax) {
+  multiUpdateOpTest(Operation::MAX, false);
+}
+
+BOOST_AUTO_TEST_CASE(MultiUpdateOpMin) {
+  multiUpdateOpTest(Operation::MIN, false);
+}
+
+BOOST_AUTO_TEST_CASE(MultiUpdateOpMul) {
+  multiUpdateOpTest(Operation::MUL, false);
+}
+
+BOOST_AUTO_TEST_CASE(MultiUpdateOpAdd) {
+  multiUpdateOpTest(Operation::ADD, false);
+}
+
+BOOST_AUTO_TEST_CASE(MultiUpdateOpMax_AsEmbedding) {
+  multiUpdateOpTest(Operation::MAX, true);
+}
+
+BOOST_AUTO_TEST_CASE(MultiUpdateOpMax_LookupSplit) {
+  multiUpdateOpTest(Operation::MAX, true, 2);
+}
+
+BOOST_AUTO_TEST_CASE(MultiUpdateOpMin_LookupSplit) {
+  multiUpdateOpTest(Operation::MIN, true, 2);
+}
+
+BOOST_AUTO_TEST_CASE(MultiUpdateOpMul_LookupSplit) {
+  multiUpdateOpTest(Operation::MUL, true, 2);
+}
+
+BOOST_AUTO_TEST_CASE(MultiUpdateOpMulInt_LookupSplit) {
+  multiUpdateOpTest<int>(Operation::MUL, true, 2);
+}
+
+BOOST_AUTO_TEST_CASE(MultiUpdateOpUnsupported) {
+  auto device = createTestDevice(TEST_TARGET, 1, 4);
+  Graph graph(device.getTarget());
+  popops::addCodelets(graph);
+  auto t = graph.addVariable(FLOAT, {10, 4}, "t");
+  auto s = graph.addVariable(FLOAT, {2, 1, 4}, "s");
+  auto offset = graph.addVariable(UNSIGNED_INT, {2, 1}, "offset");
+  Sequence prog;
+  BOOST_CHECK_THROW(multiUpdateOp(graph, t, s, offset, {0}, {1}, prog,
+                                  SlicePlan(), Operation::LOGICAL_OR, {}),
+                    poputil::poplibs_error);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
 // Build and run a small model to check for cpu-specific target problems
 void smallAndSimple() {
   const int num_ipus = 1;
@@ -0,0 +1,156 @@
+// Copyright (c) 2020 Graphcore Ltd. All rights reserved.
+#define BOOST_TEST_MODULE ElementWiseBuilderTest
+
+#include "popops/ElementWiseBuilder.hpp"
+#include "poplibs_test/Util.hpp"
+#include "popops/codelets.hpp"
+#include "poputil/TileMapping.hpp"
+#include <boost/multi_array.hpp>
+#include <boost/random.hpp>
+#include <boost/test/unit_test.hpp>
+#include <cmath>
+#include <poplibs_support/TestDevice.hpp>
+#include <random>
+
+using namespace poplar;
+using namespace poplar::program;
+using namespace poplibs_test::util;
+using namespace poplibs_support;
+namespace pe = popops::expr;
+
+static constexpr std::size_t N = 100;
+
+// Runs a momentum update as one deferred chain:
+//   m = 0.9 * m + g
+//   w = w - 0.1 * m
+// optionally followed by a swap of w and m, which needs a temporary.
+void momentumTest(bool swap) {
+  std::mt19937 randomEngine;
+  boost::random::uniform_real_distribution<double> dist(-1., 1.);
+  boost::multi_array<double, 1> w(boost::extents[N]), m(boost::extents[N]),
+      g(boost::extents[N]);
+  for (std::size_t i = 0; i != N; ++i) {
+    w[i] = dist(randomEngine);
+    m[i] = dist(randomEngine);
+    g[i] = dist(randomEngine);
+  }
+
+  auto device = createTestDevice(TEST_TARGET, 1, 4);
+  const auto &target = device.getTarget();
+  Graph graph(target);
+  popops::addCodelets(graph);
+
+  auto wT = graph.addVariable(FLOAT, {N}, "w");
+  auto mT = graph.addVariable(FLOAT, {N}, "m");
+  auto gT = graph.addVariable(FLOAT, {N}, "g");
+  poputil::mapTensorLinearly(graph, wT);
+  poputil::mapTensorLinearly(graph, mT);
+  poputil::mapTensorLinearly(graph, gT);
+
+  Sequence uploadProg, downloadProg;
+  std::vector<std::pair<std::string, char *>> tmap;
+  auto rawW = allocateHostMemoryForTensor(wT, "w", graph, uploadProg,
+                                          downloadProg, tmap);
+  auto rawM = allocateHostMemoryForTensor(mT, "m", graph, uploadProg,
+                                          downloadProg, tmap);
+  auto rawG = allocateHostMemoryForTensor(gT, "g", graph, uploadProg,
+                                          downloadProg, tmap);
+  copy(target, w, FLOAT, rawW.get());
+  copy(target, m, FLOAT, rawM.get());
+  copy(target, g, FLOAT, rawG.get());
+
+  Sequence prog;
+  popops::ElementWiseBuilder builder(graph, "momentum");
+  auto wId = builder.addTensor(wT);
+  auto mId = builder.addTensor(mT);
+  auto gId = builder.addTensor(gT);
+  builder.set(mId, pe::Add(pe::Mul(pe::Const(0.9f), builder.get(mId)),
+                           builder.get(gId)));
+  builder.set(wId, pe::Sub(builder.get(wId),
+                           pe::Mul(pe::Const(0.1f), builder.get(mId))));
+  if (swap) {
+    auto newW = builder.get(wId);
+    builder.set(wId, builder.get(mId));
+    builder.set(mId, newW);
+  }
+  BOOST_CHECK_EQUAL(builder.numPending(), 2);
+  builder.flush(prog);
+  BOOST_CHECK_EQUAL(builder.numPending(), 0);
+
+  Engine engine(graph, Sequence(uploadProg, prog, downloadProg));
+  device.bind([&](const Device &d) {
+    engine.load(d);
+    attachStreams(engine, tmap);
+    engine.run(0);
+  });
+
+  boost::multi_array<double, 1> wOut(boost::extents[N]);
+  boost::multi_array<double, 1> mOut(boost::extents[N]);
+  copy(target, FLOAT, rawW.get(), wOut);
+  copy(target, FLOAT, rawM.get(), mOut);
+
+  for (std::size_t i = 0; i != N; ++i) {
+    m[i] = 0.9 * m[i] + g[i];
+    w[i] = w[i] - 0.1 * m[i];
+    if (swap) {
+      std::swap(w[i], m[i]);
+    }
+  }
+  BOOST_CHECK(checkIsClose("w", wOut, w, 1e-5));
+  BOOST_CHECK(checkIsClose("m", mOut, m, 1e-5));
+}
+
+BOOST_AUTO_TEST_CASE(ElementWiseBuilderMomentum) { momentumTest(false); }
+
+BOOST_AUTO_TEST_CASE(ElementWiseBuilderCycle) { momentumTest(true); }
+
+// Doubles a tensor by adding it to itself many times. Each value is read
+// twice by the next one, so it must be shared rather than inlined for the
+// fused expression not to double in size at every step.
+BOOST_AUTO_TEST_CASE(ElementWiseBuilderSelfReference) {
+  constexpr unsigned numSteps = 40;
+  std::mt19937 randomEngine;
+  boost::random::uniform_real_distribution<double> dist(-1., 1.);
+  boost::multi_array<double, 1> x(boost::extents[N]);
+  for (std::size_t i = 0; i != N; ++i) {
+    x[i] = dist(randomEngine);
+  }
+
+  auto device = createTestDevice(TEST_TARGET, 1, 4);
+  const auto &target = device.getTarget();
+  Graph graph(target);
+  popops::addCodelets(graph);
+
+  auto xT = graph.addVariable(FLOAT, {N}, "x");
+  poputil::mapTensorLinearly(graph, xT);
+
+  Sequence uploadProg, downloadProg;
+  std::vector<std::pair<std::string, char *>> tmap;
+  auto rawX = allocateHostMemoryForTensor(xT, "x", graph, uploadProg,
+                                          downloadProg, tmap);
+  copy(target, x, FLOAT, rawX.get());
+
+  Sequence prog;
+  popops::ElementWiseBuilder builder(graph, "selfReference");
+  auto xId = builder.addTensor(xT);
+  for (unsigned step = 0; step != numSteps; ++step) {
+    builder.set(xId, pe::Add(builder.get(xId), builder.get(xId)));
+  }
+  BOOST_CHECK_EQUAL(builder.numPending(), 1);
+  builder.flush(prog);
+  BOOST_CHECK_EQUAL(builder.numPending(), 0);
+
+  Engine engine(graph, Sequence(uploadProg, prog, downloadProg));
+  device.bind([&](const Device &d) {
+    engine.load(d);
+    attachStreams(engine, tmap);
+    engine.run(0);
+  });
+
+  boost::multi_array<double, 1> xOut(boost::extents[N]);
+  copy(target, FLOAT, rawX.get(), xOut);
+  for (std::size_t i = 0; i != N; ++i) {
+    x[i] = std::ldexp(x[i], numSteps);
+  }
+  BOOST_CHECK(checkIsClose("x", xOut, x, 1e-5));
+}
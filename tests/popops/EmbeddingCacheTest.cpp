@@ -0,0 +1,123 @@
+// Copyright (c) 2020 Graphcore Ltd. All rights reserved.
+#define BOOST_TEST_MODULE EmbeddingCacheTest
+
+#include "popops/EmbeddingCache.hpp"
+#include "poplibs_test/Util.hpp"
+#include "popops/codelets.hpp"
+#include "poputil/TileMapping.hpp"
+#include "poputil/exceptions.hpp"
+#include <boost/multi_array.hpp>
+#include <boost/test/unit_test.hpp>
+#include <poplibs_support/TestDevice.hpp>
+
+using namespace poplar;
+using namespace poplar::program;
+using namespace poplibs_test::util;
+using namespace poplibs_support;
+
+namespace {
+
+constexpr std::size_t numEntries = 16;
+constexpr std::size_t embeddingSize = 4;
+
+float tableValue(std::size_t row, std::size_t col) {
+  return static_cast<float>(row * embeddingSize + col);
+}
+
+} // end anonymous namespace
+
+// Two sets of two lines. The first lookup misses four times, including both
+// lookups of row 3, and installs rows 3, 5 and 8 in different lines. The
+// second lookup hits on rows 5, 3 and 8 and misses on row 9.
+static void embeddingCacheTest(unsigned maxMissesPerFetch) {
+  auto device = createTestDevice(TEST_TARGET, 1, 4);
+  const auto &target = device.getTarget();
+  Graph graph(target);
+  popops::addCodelets(graph);
+
+  const std::vector<std::vector<unsigned>> lookups = {{3, 5, 3, 8},
+                                                      {5, 3, 9, 8}};
+  const std::size_t numLookups = lookups[0].size();
+  popops::EmbeddingCache cache(
+      graph, FLOAT, numEntries, embeddingSize, 4, numLookups,
+      {{"associativity", "2"},
+       {"maxMissesPerFetch", std::to_string(maxMissesPerFetch)}},
+      "cache");
+
+  Sequence prog, uploadProg, downloadProg;
+  std::vector<std::pair<std::string, char *>> tmap;
+  std::vector<std::unique_ptr<char[]>> rawIndices, rawResults;
+  std::vector<Tensor> results;
+  cache.initialise(prog);
+  for (std::size_t l = 0; l < lookups.size(); ++l) {
+    const auto name = "lookup" + std::to_string(l);
+    auto indices = graph.addVariable(UNSIGNED_INT, {numLookups}, name);
+    poputil::mapTensorLinearly(graph, indices);
+    rawIndices.push_back(allocateHostMemoryForTensor(
+        indices, name, graph, uploadProg, downloadProg, tmap));
+    auto result = cache.lookup(indices, prog, name);
+    rawResults.push_back(allocateHostMemoryForTensor(
+        result, name + "Result", graph, uploadProg, downloadProg, tmap));
+    copy(target, lookups[l], UNSIGNED_INT, rawIndices.back().get());
+  }
+  auto rawHits = allocateHostMemoryForTensor(cache.getHitCount(), "hits", graph,
+                                             uploadProg, downloadProg, tmap);
+  auto rawMisses = allocateHostMemoryForTensor(
+      cache.getMissCount(), "misses", graph, uploadProg, downloadProg, tmap);
+
+  std::vector<float> table(numEntries * embeddingSize);
+  for (std::size_t r = 0; r < numEntries; ++r) {
+    for (std::size_t c = 0; c < embeddingSize; ++c) {
+      table[r * embeddingSize + c] = tableValue(r, c);
+    }
+  }
+
+  Engine engine(graph, Sequence(uploadProg, prog, downloadProg));
+  device.bind([&](const Device &d) {
+    engine.load(d);
+    attachStreams(engine, tmap);
+    for (std::size_t r = 0; r < numEntries; ++r) {
+      engine.copyToRemoteBuffer(&table[r * embeddingSize],
+                                "embeddingCacheTable", r);
+    }
+    engine.run(0);
+  });
+
+  for (std::size_t l = 0; l < lookups.size(); ++l) {
+    boost::multi_array<double, 2> expected(
+        boost::extents[numLookups][embeddingSize]);
+    boost::multi_array<double, 2> actual(
+        boost::extents[numLookups][embeddingSize]);
+    for (std::size_t i = 0; i < numLookups; ++i) {
+      for (std::size_t c = 0; c < embeddingSize; ++c) {
+        expected[i][c] = tableValue(lookups[l][i], c);
+      }
+    }
+    copy(target, FLOAT, rawResults[l].get(), actual);
+    BOOST_CHECK(checkIsClose("lookup" + std::to_string(l), actual, expected,
+                             0.0));
+  }
+  int hits, misses;
+  copy(target, INT, rawHits.get(), &hits, 1);
+  copy(target, INT, rawMisses.get(), &misses, 1);
+  BOOST_CHECK_EQUAL(hits, 3);
+  BOOST_CHECK_EQUAL(misses, 5);
+}
+
+BOOST_AUTO_TEST_CASE(EmbeddingCacheSingleFetch) { embeddingCacheTest(4); }
+
+BOOST_AUTO_TEST_CASE(EmbeddingCacheChunkedFetch) { embeddingCacheTest(3); }
+
+BOOST_AUTO_TEST_CASE(EmbeddingCacheBadOptions) {
+  auto device = createTestDevice(TEST_TARGET, 1, 4);
+  Graph graph(device.getTarget());
+  popops::addCodelets(graph);
+  BOOST_CHECK_THROW(popops::EmbeddingCache(graph, FLOAT, numEntries,
+                                           embeddingSize, 6, 4,
+                                           {{"associativity", "4"}}),
+                    poputil::poplibs_error);
+  BOOST_CHECK_THROW(popops::EmbeddingCache(graph, FLOAT, numEntries,
+                                           embeddingSize, 4, 4,
+                                           {{"maxMissesPerFetch", "5"}}),
+                    poputil::poplibs_error);
+}
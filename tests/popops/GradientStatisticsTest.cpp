@@ -0,0 +1,136 @@
+// Copyright (c) 2020 Graphcore Ltd. All rights reserved.
+#define BOOST_TEST_MODULE GradientStatisticsTest
+
+#include "popops/GradientStatistics.hpp"
+#include "poplibs_test/Util.hpp"
+#include "popops/codelets.hpp"
+#include "poputil/TileMapping.hpp"
+#include "poputil/exceptions.hpp"
+#include <boost/multi_array.hpp>
+#include <boost/random.hpp>
+#include <boost/test/unit_test.hpp>
+#include <poplibs_support/TestDevice.hpp>
+#include <cmath>
+#include <limits>
+#include <random>
+
+using namespace poplar;
+using namespace poplar::program;
+using namespace poplibs_test::util;
+using namespace poplibs_support;
+
+namespace {
+
+struct TestTensor {
+  Type type;
+  std::size_t size;
+  // The value written to the first element, if any.
+  double special;
+};
+
+} // end anonymous namespace
+
+// The second tensor holds a NaN and the third an infinity, which must be
+// flagged and excluded from the maximum and the sum of squares. The last
+// tensor is empty.
+BOOST_AUTO_TEST_CASE(GradientStatisticsMixedTypes) {
+  const auto inf = std::numeric_limits<double>::infinity();
+  const std::vector<TestTensor> specs = {{FLOAT, 100, 0.5},
+                                         {HALF, 37, std::nan("")},
+                                         {FLOAT, 1, -inf},
+                                         {HALF, 260, -3.0},
+                                         {FLOAT, 0, 0}};
+  auto device = createTestDevice(TEST_TARGET, 1, 4);
+  const auto &target = device.getTarget();
+  Graph graph(target);
+  popops::addCodelets(graph);
+
+  std::mt19937 randomEngine;
+  boost::random::uniform_real_distribution<double> dist(-2., 2.);
+  Sequence uploadProg, downloadProg;
+  std::vector<std::pair<std::string, char *>> tmap;
+  std::vector<Tensor> ts;
+  std::vector<std::unique_ptr<char[]>> rawInputs;
+  std::vector<boost::multi_array<double, 1>> hostInputs;
+  for (std::size_t i = 0; i < specs.size(); ++i) {
+    const auto &spec = specs[i];
+    const auto name = "in" + std::to_string(i);
+    auto t = graph.addVariable(spec.type, {spec.size}, name);
+    poputil::mapTensorLinearly(graph, t);
+    ts.push_back(t);
+    boost::multi_array<double, 1> values(boost::extents[spec.size]);
+    if (spec.size == 0) {
+      hostInputs.push_back(values);
+      continue;
+    }
+    for (auto &v : values) {
+      v = dist(randomEngine);
+    }
+    values[0] = spec.special;
+    rawInputs.push_back(allocateHostMemoryForTensor(t, name, graph, uploadProg,
+                                                    downloadProg, tmap));
+    copy(target, values, spec.type, rawInputs.back().get());
+    // Read back to model the rounding of half inputs.
+    copy(target, spec.type, rawInputs.back().get(), values);
+    hostInputs.push_back(values);
+  }
+
+  Sequence prog;
+  const auto stats = popops::gradientStatistics(graph, ts, prog, "stats");
+  auto rawFlags = allocateHostMemoryForTensor(
+      stats.hasNonFinite, "flags", graph, uploadProg, downloadProg, tmap);
+  auto rawMaxAbs = allocateHostMemoryForTensor(
+      stats.maxAbs, "maxAbs", graph, uploadProg, downloadProg, tmap);
+  auto rawSumSquares = allocateHostMemoryForTensor(
+      stats.sumSquares, "sumSquares", graph, uploadProg, downloadProg, tmap);
+
+  const OptionFlags engineOptions{{"debug.floatPointOpException", "false"}};
+  Engine engine(graph, Sequence(uploadProg, prog, downloadProg),
+                engineOptions);
+  device.bind([&](const Device &d) {
+    engine.load(d);
+    attachStreams(engine, tmap);
+    engine.run(0);
+  });
+
+  const auto n = specs.size();
+  boost::multi_array<bool, 1> flags(boost::extents[n]);
+  boost::multi_array<double, 1> maxAbs(boost::extents[n]);
+  boost::multi_array<double, 1> sumSquares(boost::extents[n]);
+  copy(target, BOOL, rawFlags.get(), flags);
+  copy(target, FLOAT, rawMaxAbs.get(), maxAbs);
+  copy(target, FLOAT, rawSumSquares.get(), sumSquares);
+
+  boost::multi_array<double, 1> expectedMaxAbs(boost::extents[n]);
+  boost::multi_array<double, 1> expectedSumSquares(boost::extents[n]);
+  for (std::size_t i = 0; i < n; ++i) {
+    bool nonFinite = false;
+    expectedMaxAbs[i] = 0;
+    expectedSumSquares[i] = 0;
+    for (const auto v : hostInputs[i]) {
+      if (!std::isfinite(v)) {
+        nonFinite = true;
+        continue;
+      }
+      expectedMaxAbs[i] = std::max(expectedMaxAbs[i], std::fabs(v));
+      expectedSumSquares[i] += v * v;
+    }
+    BOOST_CHECK_EQUAL(flags[i], nonFinite);
+  }
+  BOOST_CHECK(checkIsClose("maxAbs", maxAbs, expectedMaxAbs, 0.0));
+  BOOST_CHECK(
+      checkIsClose("sumSquares", sumSquares, expectedSumSquares, 1e-5));
+}
+
+BOOST_AUTO_TEST_CASE(GradientStatisticsBadType) {
+  auto device = createTestDevice(TEST_TARGET, 1, 4);
+  Graph graph(device.getTarget());
+  popops::addCodelets(graph);
+  auto t = graph.addVariable(INT, {4}, "in");
+  poputil::mapTensorLinearly(graph, t);
+  Sequence prog;
+  BOOST_CHECK_THROW(popops::gradientStatistics(graph, {t}, prog),
+                    poputil::poplibs_error);
+  BOOST_CHECK_THROW(popops::gradientStatistics(graph, {}, prog),
+                    poputil::poplibs_error);
+}
@@ -4,10 +4,13 @@
 #include "poplibs_test/Util.hpp"
 #include "popops/GatherStatistics.hpp"
 #include "popops/codelets.hpp"
+#include <boost/optional.hpp>
 #include <boost/program_options.hpp>
 #include <poplar/Engine.hpp>
 #include <poplibs_support/TestDevice.hpp>
 #include <poputil/TileMapping.hpp>
+#include <algorithm>
+#include <cmath>
 #include <stdexcept>
 #include <string.h>
 #include <utility>
@@ -56,23 +59,60 @@ bool doTest(TestDevice &device, DeviceType deviceType, bool profile,
             const std::vector<double> &data, const std::vector<float> &limits,
             const std::vector<HistType> &initialHistogram,
             bool useFloatArithmetic, bool withOutput, bool update,
-            const poplar::Type &dataType, bool isAbsolute) {
+            const poplar::Type &dataType, bool isAbsolute, unsigned numTensors,
+            bool mixedTypes, boost::optional<int> minExponent) {
   auto &target = device.getTarget();
   Graph graph(target);
   popops::addCodelets(graph);
 
   const auto rawSize = target.getTypeSize(dataType);
+  // With mixed types every other input tensor has the other floating point
+  // type. Both types hold the data and limits exactly once they are rounded
+  // to half precision.
+  const auto otherType = dataType == FLOAT ? HALF : FLOAT;
 
   std::vector<char> rawData(data.size() * rawSize);
   std::vector<char> rawLimits(limits.size() * rawSize);
+  std::vector<char> rawOtherData(data.size() * target.getTypeSize(otherType));
 
   copy(target, data.data(), data.size(), dataType, rawData.data());
   copy(target, limits.data(), limits.size(), dataType, rawLimits.data());
+  if (mixedTypes) {
+    std::vector<float> halfData(data.size());
+    std::vector<float> halfLimits(limits.size());
+    std::vector<char> rawHalf(std::max(data.size(), limits.size()) *
+                              target.getTypeSize(HALF));
+    copy(target, data.data(), data.size(), HALF, rawHalf.data());
+    copy(target, HALF, rawHalf.data(), halfData.data(), halfData.size());
+    copy(target, limits.data(), limits.size(), HALF, rawHalf.data());
+    copy(target, HALF, rawHalf.data(), halfLimits.data(), halfLimits.size());
+    copy(target, halfData.data(), halfData.size(), dataType, rawData.data());
+    copy(target, halfData.data(), halfData.size(), otherType,
+         rawOtherData.data());
+    copy(target, halfLimits.data(), halfLimits.size(), dataType,
+         rawLimits.data());
+  }
 
   auto ipuData = graph.addVariable(dataType, {data.size()});
   auto ipuLimits = graph.addVariable(dataType, {limits.size()});
-  mapTensorLinearly(graph, ipuData);
   graph.setTileMapping(ipuLimits, 0);
+  Tensor ipuOtherData;
+  if (mixedTypes) {
+    // Only every other slice of each of the variables is an input
+    ipuOtherData = graph.addVariable(otherType, {data.size()});
+    mapTensorLinearly(graph, ipuData);
+    mapTensorLinearly(graph, ipuOtherData);
+  }
+  // Split the data into tensors which are each mapped linearly, so that
+  // tiles hold regions of several tensors.
+  std::vector<Tensor> ipuInputs;
+  for (unsigned i = 0; i < numTensors; ++i) {
+    const auto begin = data.size() * i / numTensors;
+    const auto end = data.size() * (i + 1) / numTensors;
+    const auto &source = mixedTypes && i % 2 ? ipuOtherData : ipuData;
+    ipuInputs.push_back(source.slice(begin, end));
+    mapTensorLinearly(graph, ipuInputs.back());
+  }
 
   auto prog = Sequence();
   poplar::OptionFlags options = {
@@ -84,14 +124,35 @@ bool doTest(TestDevice &device, DeviceType deviceType, bool profile,
     mapTensorLinearly(graph, ipuHistogram);
     graph.createHostWrite("histogram", ipuHistogram);
 
-    popops::histogram(graph, ipuData, ipuHistogram, update, ipuLimits,
-                      isAbsolute, prog, "Test Histogram");
+    if (minExponent) {
+      popops::exponentHistogram(graph, ipuInputs, ipuHistogram, update,
+                                *minExponent, prog, "Test Histogram");
+    } else if (numTensors > 1) {
+      popops::histogram(graph, ipuInputs, ipuHistogram, update, ipuLimits,
+                        isAbsolute, prog, "Test Histogram");
+    } else {
+      popops::histogram(graph, ipuData, ipuHistogram, update, ipuLimits,
+                        isAbsolute, prog, "Test Histogram");
+    }
   } else {
-    ipuHistogram = popops::histogram(graph, ipuData, ipuLimits, isAbsolute,
-                                     prog, "Test Histogram", options);
+    if (minExponent) {
+      ipuHistogram =
+          popops::exponentHistogram(graph, ipuInputs, *minExponent,
+                                    limits.size() + 1, prog, "Test Histogram",
+                                    options);
+    } else if (numTensors > 1) {
+      ipuHistogram = popops::histogram(graph, ipuInputs, ipuLimits, isAbsolute,
+                                       prog, "Test Histogram", options);
+    } else {
+      ipuHistogram = popops::histogram(graph, ipuData, ipuLimits, isAbsolute,
+                                       prog, "Test Histogram", options);
+    }
   }
   graph.createHostRead("histogram", ipuHistogram);
   graph.createHostWrite("data", ipuData);
+  if (mixedTypes) {
+    graph.createHostWrite("otherData", ipuOtherData);
+  }
   graph.createHostWrite("limits", ipuLimits);
 
   OptionFlags engineOptions;
@@ -105,6 +166,10 @@ bool doTest(TestDevice &device, DeviceType deviceType, bool profile,
     e.load(d);
 
     e.writeTensor("data", rawData.data(), rawData.data() + rawData.size());
+    if (mixedTypes) {
+      e.writeTensor("otherData", rawOtherData.data(),
+                    rawOtherData.data() + rawOtherData.size());
+    }
     e.writeTensor("limits", rawLimits.data(),
                   rawLimits.data() + rawLimits.size());
     if (withOutput) {
@@ -161,6 +226,9 @@ int main(int argc, char **argv) {
   unsigned dataSize;
   unsigned limitSize;
   unsigned tiles = 4;
+  unsigned numTensors = 1;
+  bool mixedTypes = false;
+  boost::optional<int> minExponent;
   double dataMin = -65504;
   double dataRange = 65504 * 2;
   float limitsMin = -60000;
@@ -201,6 +269,14 @@ int main(int argc, char **argv) {
       "Provide an output external to the histogram function")
     ("update", po::value(&update)->default_value(update),
       "Update (continue to gather) histogram results, implies with-output=true")
+    ("num-tensors", po::value(&numTensors)->default_value(numTensors),
+      "Split the data into this many tensors and gather one histogram of all "
+      "of them")
+    ("mixed-types", po::value(&mixedTypes)->default_value(mixedTypes),
+      "Give every other tensor the other floating point type (float or half)")
+    ("min-exponent", po::value(&minExponent),
+      "Bin the data by exponent, with this exponent for the upper bound of the "
+      "first bin. The limits are powers of two and absolute=true is implied")
     ;
   // clang-format on
   po::variables_map vm;
@@ -232,15 +308,23 @@ int main(int argc, char **argv) {
                     data.data() + data.size(), dataMin, dataMin + dataRange,
                     randomEngine);
 
-  // Evenly spaced limits
   std::vector<float> limits(limitSize);
-  if (limitsStep == 0.0) {
-    limitsStep = limits.size() == 1
-                     ? 1
-                     : limitsRange / static_cast<float>(limits.size() - 1);
-  }
-  for (unsigned i = 0; i < limits.size(); i++) {
-    limits[i] = limitsMin + static_cast<float>(i) * limitsStep;
+  if (minExponent) {
+    // The limits that are equivalent to binning by exponent
+    isAbsolute = true;
+    for (unsigned i = 0; i < limits.size(); i++) {
+      limits[i] = std::ldexp(1.0f, *minExponent + static_cast<int>(i));
+    }
+  } else {
+    // Evenly spaced limits
+    if (limitsStep == 0.0) {
+      limitsStep = limits.size() == 1
+                       ? 1
+                       : limitsRange / static_cast<float>(limits.size() - 1);
+    }
+    for (unsigned i = 0; i < limits.size(); i++) {
+      limits[i] = limitsMin + static_cast<float>(i) * limitsStep;
+    }
   }
   bool success;
   if (useFloatArithmetic) {
@@ -250,7 +334,8 @@ int main(int argc, char **argv) {
     }
     success = doTest<float>(device, deviceType, profile, data, limits,
                             initialHistogram, useFloatArithmetic, withOutput,
-                            update, dataType, isAbsolute);
+                            update, dataType, isAbsolute, numTensors,
+                            mixedTypes, minExponent);
   } else {
     std::vector<unsigned> initialHistogram(limitSize + 1);
     for (unsigned i = 0; i < limitSize + 1; i++) {
@@ -258,7 +343,8 @@ int main(int argc, char **argv) {
     }
     success = doTest<unsigned>(device, deviceType, profile, data, limits,
                                initialHistogram, useFloatArithmetic, withOutput,
-                               update, dataType, isAbsolute);
+                               update, dataType, isAbsolute, numTensors,
+                               mixedTypes, minExponent);
   }
   if (!success) {
     std::cerr << "Failure\n";
@@ -0,0 +1,129 @@
+// Copyright (c) 2020 Graphcore Ltd. All rights reserved.
+#define BOOST_TEST_MODULE MultiTensorTest
+
+#include "popops/MultiTensor.hpp"
+#include "poplibs_test/Util.hpp"
+#include "popops/codelets.hpp"
+#include "poputil/TileMapping.hpp"
+#include "poputil/exceptions.hpp"
+#include <boost/multi_array.hpp>
+#include <boost/random.hpp>
+#include <boost/test/unit_test.hpp>
+#include <poplibs_support/TestDevice.hpp>
+#include <random>
+
+using namespace poplar;
+using namespace poplar::program;
+using namespace poplibs_test::util;
+using namespace poplibs_support;
+namespace pe = popops::expr;
+
+using Array = boost::multi_array<double, 1>;
+
+// Sizes of the small tensors, mapped to different tiles.
+static const std::vector<std::size_t> sizes = {1, 7, 16, 3, 32, 5, 64, 9};
+
+struct HostTensor {
+  Tensor t;
+  std::unique_ptr<char[]> raw;
+  Array values;
+};
+
+static std::vector<HostTensor>
+addTensors(Graph &graph, const Type &type, const std::string &name,
+           std::mt19937 &randomEngine, Sequence &uploadProg,
+           Sequence &downloadProg,
+           std::vector<std::pair<std::string, char *>> &tmap) {
+  const auto &target = graph.getTarget();
+  boost::random::uniform_real_distribution<double> dist(-1., 1.);
+  std::vector<HostTensor> result;
+  for (std::size_t i = 0; i < sizes.size(); ++i) {
+    HostTensor h;
+    const auto tName = name + std::to_string(i);
+    h.t = graph.addVariable(type, {sizes[i]}, tName);
+    graph.setTileMapping(h.t, i % target.getNumTiles());
+    h.raw = allocateHostMemoryForTensor(h.t, tName, graph, uploadProg,
+                                        downloadProg, tmap);
+    h.values.resize(boost::extents[sizes[i]]);
+    for (auto &v : h.values) {
+      v = dist(randomEngine);
+    }
+    copy(target, h.values, type, h.raw.get());
+    copy(target, type, h.raw.get(), h.values);
+    result.push_back(std::move(h));
+  }
+  return result;
+}
+
+static std::vector<Tensor> getTensors(const std::vector<HostTensor> &hs) {
+  std::vector<Tensor> ts;
+  for (const auto &h : hs) {
+    ts.push_back(h.t);
+  }
+  return ts;
+}
+
+// A[i] = A[i] * B[i] + scale for every i, then A[i] += 0.5 * B[i].
+static void multiTensorTest(const Type &type) {
+  auto device = createTestDevice(TEST_TARGET, 1, 4);
+  const auto &target = device.getTarget();
+  Graph graph(target);
+  popops::addCodelets(graph);
+
+  std::mt19937 randomEngine;
+  Sequence uploadProg, downloadProg;
+  std::vector<std::pair<std::string, char *>> tmap;
+  auto as = addTensors(graph, type, "a", randomEngine, uploadProg,
+                       downloadProg, tmap);
+  auto bs = addTensors(graph, type, "b", randomEngine, uploadProg,
+                       downloadProg, tmap);
+  auto scale = graph.addConstant(type, {}, 0.25f, "scale");
+  graph.setTileMapping(scale, 0);
+
+  Sequence prog;
+  popops::multiTensorMapInPlace(
+      graph, pe::Add(pe::Mul(pe::_1, pe::_2), pe::_3),
+      {getTensors(as), getTensors(bs), {scale}}, prog, "mulAdd");
+  popops::multiTensorScaledAddTo(graph, getTensors(as), getTensors(bs), 0.5f,
+                                 prog, "scaledAdd");
+
+  Engine engine(graph, Sequence(uploadProg, prog, downloadProg));
+  device.bind([&](const Device &d) {
+    engine.load(d);
+    attachStreams(engine, tmap);
+    engine.run(0);
+  });
+
+  const double tolerance = type == HALF ? 1e-2 : 1e-5;
+  for (std::size_t i = 0; i < sizes.size(); ++i) {
+    Array expected(boost::extents[sizes[i]]), actual(boost::extents[sizes[i]]);
+    for (std::size_t j = 0; j < sizes[i]; ++j) {
+      const auto a = as[i].values[j] * bs[i].values[j] + 0.25;
+      expected[j] = a + 0.5 * bs[i].values[j];
+    }
+    copy(target, type, as[i].raw.get(), actual);
+    BOOST_CHECK(checkIsClose("a" + std::to_string(i), actual, expected,
+                             tolerance, tolerance));
+  }
+}
+
+BOOST_AUTO_TEST_CASE(MultiTensorFloat) { multiTensorTest(FLOAT); }
+
+BOOST_AUTO_TEST_CASE(MultiTensorHalf) { multiTensorTest(HALF); }
+
+BOOST_AUTO_TEST_CASE(MultiTensorMismatchedOperands) {
+  auto device = createTestDevice(TEST_TARGET, 1, 4);
+  Graph graph(device.getTarget());
+  popops::addCodelets(graph);
+  auto a0 = graph.addVariable(FLOAT, {4}, "a0");
+  auto a1 = graph.addVariable(FLOAT, {8}, "a1");
+  auto b0 = graph.addVariable(FLOAT, {4}, "b0");
+  Sequence prog;
+  BOOST_CHECK_THROW(popops::multiTensorMapInPlace(
+                        graph, pe::Add(pe::_1, pe::_2), {{a0, a1}, {b0, b0}},
+                        prog),
+                    poputil::poplibs_error);
+  BOOST_CHECK_THROW(
+      popops::multiTensorScaledAddTo(graph, {a0, a1}, {b0}, 1.0f, prog),
+      poputil::poplibs_error);
+}
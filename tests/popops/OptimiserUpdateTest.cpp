@@ -0,0 +1,195 @@
+// Copyright (c) 2020 Graphcore Ltd. All rights reserved.
+#define BOOST_TEST_MODULE OptimiserUpdateTest
+
+#include "popops/OptimiserUpdate.hpp"
+#include "poplibs_test/Util.hpp"
+#include "popops/codelets.hpp"
+#include "poputil/TileMapping.hpp"
+#include "poputil/exceptions.hpp"
+#include <boost/multi_array.hpp>
+#include <boost/random.hpp>
+#include <boost/test/unit_test.hpp>
+#include <cmath>
+#include <poplibs_support/TestDevice.hpp>
+#include <random>
+
+using namespace poplar;
+using namespace poplar::program;
+using namespace poplibs_test::util;
+using namespace poplibs_support;
+
+static constexpr std::size_t N = 200;
+static constexpr float learningRate = 0.01f;
+static constexpr float lossScale = 128.0f;
+
+enum class Optimiser { MOMENTUM, ADAM, LAMB };
+
+using Array = boost::multi_array<double, 1>;
+
+// Host model of the updates, with the gradients already unscaled.
+static void referenceUpdate(Optimiser optimiser, Array &w, const Array &g,
+                            Array &s0, Array &s1,
+                            const popops::MomentumParams &momentumParams,
+                            const popops::AdamParams &adamParams) {
+  if (optimiser == Optimiser::MOMENTUM) {
+    for (std::size_t i = 0; i != N; ++i) {
+      s0[i] = momentumParams.momentum * s0[i] + g[i] +
+              momentumParams.weightDecay * w[i];
+      w[i] -= learningRate * s0[i];
+    }
+    return;
+  }
+  Array u(boost::extents[N]);
+  double wNorm = 0, uNorm = 0;
+  for (std::size_t i = 0; i != N; ++i) {
+    s0[i] = adamParams.beta1 * s0[i] + (1 - adamParams.beta1) * g[i];
+    s1[i] = adamParams.beta2 * s1[i] + (1 - adamParams.beta2) * g[i] * g[i];
+    u[i] = s0[i] / (std::sqrt(s1[i]) + adamParams.epsilon) +
+           adamParams.weightDecay * w[i];
+    wNorm += w[i] * w[i];
+    uNorm += u[i] * u[i];
+  }
+  double ratio = 1;
+  if (optimiser == Optimiser::LAMB && wNorm > 0 && uNorm > 0) {
+    ratio = std::sqrt(wNorm / uNorm);
+  }
+  for (std::size_t i = 0; i != N; ++i) {
+    w[i] -= learningRate * ratio * u[i];
+  }
+}
+
+static void optimiserTest(Optimiser optimiser, const Type &weightType,
+                          const Type &stateType) {
+  auto device = createTestDevice(TEST_TARGET, 1, 4);
+  const auto &target = device.getTarget();
+  Graph graph(target);
+  popops::addCodelets(graph);
+
+  std::mt19937 randomEngine;
+  boost::random::uniform_real_distribution<double> dist(-1., 1.);
+  Array w(boost::extents[N]), g(boost::extents[N]), s0(boost::extents[N]),
+      s1(boost::extents[N]);
+  for (std::size_t i = 0; i != N; ++i) {
+    w[i] = dist(randomEngine);
+    g[i] = dist(randomEngine) * lossScale;
+    s0[i] = dist(randomEngine) * 0.1;
+    s1[i] = std::abs(dist(randomEngine)) * 0.1;
+  }
+
+  auto wT = graph.addVariable(weightType, {N}, "weights");
+  auto gT = graph.addVariable(weightType, {N}, "grads");
+  auto s0T = graph.addVariable(stateType, {N}, "state0");
+  auto s1T = graph.addVariable(stateType, {N}, "state1");
+  for (const auto &t : {wT, gT, s0T, s1T}) {
+    poputil::mapTensorLinearly(graph, t);
+  }
+  auto lrT = graph.addConstant(FLOAT, {}, learningRate, "learningRate");
+  auto lossScaleT = graph.addConstant(FLOAT, {}, lossScale, "lossScale");
+  graph.setTileMapping(lrT, 0);
+  graph.setTileMapping(lossScaleT, 0);
+
+  Sequence uploadProg, downloadProg;
+  std::vector<std::pair<std::string, char *>> tmap;
+  auto rawW = allocateHostMemoryForTensor(wT, "w", graph, uploadProg,
+                                          downloadProg, tmap);
+  auto rawG = allocateHostMemoryForTensor(gT, "g", graph, uploadProg,
+                                          downloadProg, tmap);
+  auto rawS0 = allocateHostMemoryForTensor(s0T, "s0", graph, uploadProg,
+                                           downloadProg, tmap);
+  auto rawS1 = allocateHostMemoryForTensor(s1T, "s1", graph, uploadProg,
+                                           downloadProg, tmap);
+  // the model uses the values as represented on the device
+  copy(target, w, weightType, rawW.get());
+  copy(target, g, weightType, rawG.get());
+  copy(target, s0, stateType, rawS0.get());
+  copy(target, s1, stateType, rawS1.get());
+  copy(target, weightType, rawW.get(), w);
+  copy(target, weightType, rawG.get(), g);
+  copy(target, stateType, rawS0.get(), s0);
+  copy(target, stateType, rawS1.get(), s1);
+
+  popops::MomentumParams momentumParams;
+  momentumParams.weightDecay = 0.01f;
+  popops::AdamParams adamParams;
+  adamParams.weightDecay = 0.01f;
+  adamParams.epsilon = 1e-4f;
+
+  Sequence prog;
+  switch (optimiser) {
+  case Optimiser::MOMENTUM:
+    popops::momentumUpdate(graph, wT, gT, s0T, lrT, lossScaleT, momentumParams,
+                           prog, "momentum");
+    break;
+  case Optimiser::ADAM:
+    popops::adamUpdate(graph, wT, gT, s0T, s1T, lrT, lossScaleT, adamParams,
+                       prog, "adam");
+    break;
+  case Optimiser::LAMB:
+    popops::lambUpdate(graph, wT, gT, s0T, s1T, lrT, lossScaleT, adamParams,
+                       prog, "lamb");
+    break;
+  }
+
+  Engine engine(graph, Sequence(uploadProg, prog, downloadProg));
+  device.bind([&](const Device &d) {
+    engine.load(d);
+    attachStreams(engine, tmap);
+    engine.run(0);
+  });
+
+  Array wOut(boost::extents[N]), s0Out(boost::extents[N]),
+      s1Out(boost::extents[N]);
+  copy(target, weightType, rawW.get(), wOut);
+  copy(target, stateType, rawS0.get(), s0Out);
+  copy(target, stateType, rawS1.get(), s1Out);
+
+  for (std::size_t i = 0; i != N; ++i) {
+    g[i] /= lossScale;
+  }
+  referenceUpdate(optimiser, w, g, s0, s1, momentumParams, adamParams);
+
+  const double wTol = weightType == HALF ? 1e-2 : 1e-5;
+  const double sTol = stateType == HALF ? 1e-2 : 1e-5;
+  BOOST_CHECK(checkIsClose("weights", wOut, w, wTol, wTol));
+  BOOST_CHECK(checkIsClose("state0", s0Out, s0, sTol, sTol));
+  if (optimiser != Optimiser::MOMENTUM) {
+    BOOST_CHECK(checkIsClose("state1", s1Out, s1, sTol, sTol));
+  }
+}
+
+BOOST_AUTO_TEST_CASE(MomentumUpdateFloatFloat) {
+  optimiserTest(Optimiser::MOMENTUM, FLOAT, FLOAT);
+}
+
+BOOST_AUTO_TEST_CASE(MomentumUpdateHalfHalf) {
+  optimiserTest(Optimiser::MOMENTUM, HALF, HALF);
+}
+
+BOOST_AUTO_TEST_CASE(AdamUpdateFloatFloat) {
+  optimiserTest(Optimiser::ADAM, FLOAT, FLOAT);
+}
+
+BOOST_AUTO_TEST_CASE(AdamUpdateHalfFloat) {
+  optimiserTest(Optimiser::ADAM, HALF, FLOAT);
+}
+
+BOOST_AUTO_TEST_CASE(LambUpdateFloatFloat) {
+  optimiserTest(Optimiser::LAMB, FLOAT, FLOAT);
+}
+
+BOOST_AUTO_TEST_CASE(LambUpdateHalfFloat) {
+  optimiserTest(Optimiser::LAMB, HALF, FLOAT);
+}
+
+BOOST_AUTO_TEST_CASE(OptimiserUpdateInvalidStateType) {
+  auto device = createTestDevice(TEST_TARGET, 1, 4);
+  Graph graph(device.getTarget());
+  popops::addCodelets(graph);
+  auto w = graph.addVariable(FLOAT, {N}, "weights");
+  auto g = graph.addVariable(FLOAT, {N}, "grads");
+  auto v = graph.addVariable(HALF, {N}, "velocity");
+  auto lr = graph.addConstant(FLOAT, {}, learningRate, "learningRate");
+  Sequence prog;
+  BOOST_CHECK_THROW(popops::momentumUpdate(graph, w, g, v, lr, lr, {}, prog),
+                    poputil::poplibs_error);
+}
@@ -3,6 +3,7 @@
 #include <poplibs_support/TestDevice.hpp>
 
 #include <iostream>
+#include <numeric>
 
 #include <boost/test/unit_test.hpp>
 
@@ -25,7 +26,8 @@ std::array<T, N1> deviceScatter(
     std::array<T, N3> updates, std::vector<std::size_t> updates_shape,
     std::size_t index_vector_dim, std::vector<unsigned> update_window_dims,
     std::vector<std::size_t> insert_window_dims,
-    std::vector<unsigned> scatter_dims_to_operand_dims) {
+    std::vector<unsigned> scatter_dims_to_operand_dims,
+    const OptionFlags &options = {}) {
   auto device = createTestDevice(TEST_TARGET, 1, 4);
   Graph graph(device.getTarget());
   auto seq = Sequence();
@@ -46,7 +48,8 @@ std::array<T, N1> deviceScatter(
   BOOST_REQUIRE_EQUAL(tUpdates.numElements(), N3);
 
   scatter(graph, tIn, tIndices, tUpdates, index_vector_dim, update_window_dims,
-          insert_window_dims, scatter_dims_to_operand_dims, seq);
+          insert_window_dims, scatter_dims_to_operand_dims, seq, {},
+          options);
 
   graph.createHostWrite("in", tIn);
   graph.createHostWrite("indices", tIndices);
@@ -213,3 +216,75 @@ BOOST_AUTO_TEST_CASE(ScatterTestCase12) {
                            {0}) == result,
              boost::test_tools::per_element());
 }
+
+// Enough row updates to use the multiUpdate vertices rather than individual
+// dynamic updates.
+BOOST_AUTO_TEST_CASE(ScatterTestManyRows) {
+  constexpr std::size_t numRows = 16, rowSize = 4, numIndices = 10;
+  std::array<float, numRows * rowSize> operand;
+  std::iota(operand.begin(), operand.end(), 0);
+  std::array<int, numIndices> indices = {3, 15, 0, 7, 8, 1, 12, 5, 10, 2};
+  std::array<float, numIndices * rowSize> updates;
+  std::iota(updates.begin(), updates.end(), 100);
+  auto result = operand;
+  for (std::size_t i = 0; i != numIndices; ++i) {
+    for (std::size_t j = 0; j != rowSize; ++j) {
+      result[indices[i] * rowSize + j] = updates[i * rowSize + j];
+    }
+  }
+
+  BOOST_TEST(deviceScatter(operand, {numRows, rowSize}, indices, {numIndices},
+                           updates, {numIndices, rowSize}, 1, {1}, {0},
+                           {0}) == result,
+             boost::test_tools::per_element());
+}
+
+// Out of range and negative row indices are ignored by the multiUpdate
+// vertices; no row, in particular row 0, is written for them.
+BOOST_AUTO_TEST_CASE(ScatterTestManyRowsOutOfRange) {
+  constexpr std::size_t numRows = 16, rowSize = 4, numIndices = 10;
+  std::array<float, numRows * rowSize> operand;
+  std::iota(operand.begin(), operand.end(), 0);
+  std::array<int, numIndices> indices = {3, 16, -1, 7, 8, 100, 12, 5, -7, 2};
+  std::array<float, numIndices * rowSize> updates;
+  std::iota(updates.begin(), updates.end(), 100);
+  auto result = operand;
+  for (std::size_t i = 0; i != numIndices; ++i) {
+    if (indices[i] < 0 || indices[i] >= int(numRows)) {
+      continue;
+    }
+    for (std::size_t j = 0; j != rowSize; ++j) {
+      result[indices[i] * rowSize + j] = updates[i * rowSize + j];
+    }
+  }
+
+  BOOST_TEST(deviceScatter(operand, {numRows, rowSize}, indices, {numIndices},
+                           updates, {numIndices, rowSize}, 1, {1}, {0},
+                           {0}) == result,
+             boost::test_tools::per_element());
+}
+
+// Too few row updates for the multiUpdate vertices: out of range and negative
+// row indices are still ignored, as with many row updates.
+BOOST_AUTO_TEST_CASE(ScatterTestFewRowsOutOfRange) {
+  constexpr std::size_t numRows = 8, rowSize = 2, numIndices = 4;
+  std::array<float, numRows * rowSize> operand;
+  std::iota(operand.begin(), operand.end(), 0);
+  std::array<int, numIndices> indices = {3, 8, -1, 5};
+  std::array<float, numIndices * rowSize> updates;
+  std::iota(updates.begin(), updates.end(), 100);
+  auto result = operand;
+  for (std::size_t i = 0; i != numIndices; ++i) {
+    if (indices[i] < 0 || indices[i] >= int(numRows)) {
+      continue;
+    }
+    for (std::size_t j = 0; j != rowSize; ++j) {
+      result[indices[i] * rowSize + j] = updates[i * rowSize + j];
+    }
+  }
+
+  BOOST_TEST(deviceScatter(operand, {numRows, rowSize}, indices, {numIndices},
+                           updates, {numIndices, rowSize}, 1, {1}, {0},
+                           {0}) == result,
+             boost::test_tools::per_element());
+}
@@ -2,7 +2,11 @@
 
 #define BOOST_TEST_MODULE BlockSparseTest
 #include <boost/test/unit_test.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
 #include <cstdlib>
+#include <iomanip>
 #include <poplar/IPUModel.hpp>
 #include <poplibs_support/TestDevice.hpp>
 #include <poplibs_test/Util.hpp>
@@ -10,10 +14,15 @@
 #include <popops/codelets.hpp>
 #include <poputil/TileMapping.hpp>
 #include <random>
+#include <sstream>
+#include <unistd.h>
 #include <vector>
 
 #include "popsparse/BSMatrix.hpp"
+#include "popsparse/BalancedPartitioner.hpp"
+#include "popsparse/CachedPartitioner.hpp"
 #include "popsparse/HyperGraphBlock.hpp"
+#include "popsparse/MultilevelPartitioner.hpp"
 #include "popsparse/experimental/BlockSparseMatMul.hpp"
 
 using namespace poplar;
@@ -339,6 +348,177 @@ BOOST_AUTO_TEST_CASE(BlockSparseMatrix_test) {
   BOOST_TEST(blockIdMatrix == blockIdMatrix_expected);
 }
 
+namespace {
+
+// Assigns node i to partition i % nPartition and counts the calls
+class CountingPartitioner : public HyperGraphPartitioner {
+public:
+  CountingPartitioner(int &callsIn) : calls(callsIn) {}
+
+  float partitionGraph(const HyperGraphData &graphData, int nPartition,
+                       std::vector<int> &nodeAssignment) override {
+    ++calls;
+    nodeAssignment.resize(graphData.nodes);
+    for (unsigned i = 0; i < graphData.nodes; ++i) {
+      nodeAssignment[i] = i % nPartition;
+    }
+    return 1.0f;
+  }
+
+  std::string getName() const override { return "counting"; }
+
+private:
+  int &calls;
+};
+
+HyperGraphData createPartitionerTestData() {
+  // The hypergraph from the example in HyperGraphPartitioner.hpp
+  HyperGraphData data;
+  data.nodes = 5;
+  data.weights = {2.0f, 1.0f, 1.0f, 1.0f, 1.0f};
+  data.pins = {0, 3, 4, 1, 3, 2, 3, 4};
+  data.hyperEdges = {0, 3, 5};
+  return data;
+}
+
+} // end anonymous namespace
+
+/*
+Testing that identical hypergraphs are partitioned once, in memory and on disk
+*/
+BOOST_AUTO_TEST_CASE(CachedPartitioner_test) {
+  CachedPartitioner::clearMemoryCache();
+  const auto data = createPartitionerTestData();
+  int calls = 0;
+  std::vector<int> first, second, third;
+
+  CachedPartitioner p1(std::make_unique<CountingPartitioner>(calls));
+  p1.partitionGraph(data, 2, first);
+  CachedPartitioner p2(std::make_unique<CountingPartitioner>(calls));
+  p2.partitionGraph(data, 2, second);
+  BOOST_TEST(calls == 1);
+  BOOST_TEST(first == second);
+
+  // A different number of partitions is a different problem
+  p2.partitionGraph(data, 3, third);
+  BOOST_TEST(calls == 2);
+
+  char cacheDir[] = "/tmp/partitionCacheXXXXXX";
+  BOOST_REQUIRE(mkdtemp(cacheDir) != nullptr);
+  CachedPartitioner p3(std::make_unique<CountingPartitioner>(calls), cacheDir);
+  auto changed = data;
+  changed.weights[0] = 3.0f;
+  p3.partitionGraph(changed, 2, third);
+  BOOST_TEST(calls == 3);
+  CachedPartitioner::clearMemoryCache();
+  const auto hits = CachedPartitioner::getHitCount();
+  std::vector<int> fromDisk;
+  p3.partitionGraph(changed, 2, fromDisk);
+  BOOST_TEST(calls == 3);
+  BOOST_TEST(CachedPartitioner::getHitCount() == hits + 1);
+  BOOST_TEST(fromDisk == third);
+
+  // A file left under the key of another problem, as on a collision of the
+  // keys, is not used for it
+  const auto getCacheFile = [&](const HyperGraphData &graphData) {
+    std::stringstream cacheFile;
+    cacheFile << cacheDir << "/" << std::hex << std::setw(16)
+              << std::setfill('0')
+              << CachedPartitioner::hash("counting", graphData, 2)
+              << ".partition";
+    return cacheFile.str();
+  };
+  auto collided = data;
+  collided.weights[1] = 3.0f;
+  BOOST_REQUIRE(std::rename(getCacheFile(changed).c_str(),
+                            getCacheFile(collided).c_str()) == 0);
+  CachedPartitioner::clearMemoryCache();
+  std::vector<int> fromCollision;
+  p3.partitionGraph(collided, 2, fromCollision);
+  BOOST_TEST(calls == 4);
+  BOOST_TEST(CachedPartitioner::getHitCount() == hits + 1);
+
+  BOOST_TEST(std::remove(getCacheFile(collided).c_str()) == 0);
+  rmdir(cacheDir);
+}
+
+/*
+Testing that the least recently used partitions are dropped from memory when
+the cache is full
+*/
+BOOST_AUTO_TEST_CASE(CachedPartitioner_testEviction) {
+  CachedPartitioner::clearMemoryCache();
+  const auto data = createPartitionerTestData();
+  const int numProblems = CachedPartitioner::maxMemoryCacheEntries;
+  int calls = 0;
+  std::vector<int> assignment;
+
+  CachedPartitioner p(std::make_unique<CountingPartitioner>(calls));
+  for (int nPartition = 1; nPartition <= numProblems; ++nPartition) {
+    p.partitionGraph(data, nPartition, assignment);
+  }
+  BOOST_TEST(calls == numProblems);
+
+  // Use the oldest problem again, so that the second oldest is dropped when
+  // one more problem is added
+  p.partitionGraph(data, 1, assignment);
+  BOOST_TEST(calls == numProblems);
+  p.partitionGraph(data, numProblems + 1, assignment);
+  BOOST_TEST(calls == numProblems + 1);
+  p.partitionGraph(data, 1, assignment);
+  BOOST_TEST(calls == numProblems + 1);
+  p.partitionGraph(data, 2, assignment);
+  BOOST_TEST(calls == numProblems + 2);
+  CachedPartitioner::clearMemoryCache();
+}
+
+/*
+Testing that the multilevel partitioner separates two clusters of nodes joined
+by one hyperedge, and gives balanced, repeatable partitions
+*/
+BOOST_AUTO_TEST_CASE(MultilevelPartitioner_test) {
+  // Nodes 0 to 15 and 16 to 31 are each joined by hyperedges of neighbouring
+  // nodes, and nodes 15 and 16 by one more
+  HyperGraphData data;
+  data.nodes = 32;
+  data.weights.assign(data.nodes, 1.0f);
+  for (unsigned cluster = 0; cluster < 2; ++cluster) {
+    for (unsigned i = 0; i + 2 < 16; ++i) {
+      data.hyperEdges.push_back(data.pins.size());
+      for (unsigned j = 0; j < 3; ++j) {
+        data.pins.push_back(cluster * 16 + i + j);
+      }
+    }
+  }
+  data.hyperEdges.push_back(data.pins.size());
+  data.pins.insert(data.pins.end(), {15, 16});
+
+  MultilevelPartitioner partitioner;
+  std::vector<int> halves;
+  const auto balance = partitioner.partitionGraph(data, 2, halves);
+  BOOST_TEST(balance <= 1.1f);
+  BOOST_TEST(MultilevelPartitioner::computeConnectivityCut(data, halves) == 1);
+  for (unsigned n = 0; n < data.nodes; ++n) {
+    BOOST_TEST(halves[n] == halves[n / 16 * 16]);
+  }
+
+  std::vector<int> quarters, again, balanced;
+  partitioner.partitionGraph(data, 4, quarters);
+  partitioner.partitionGraph(data, 4, again);
+  BOOST_TEST(quarters == again);
+  std::vector<int> partWeights(4, 0);
+  for (auto part : quarters) {
+    BOOST_REQUIRE(part >= 0 && part < 4);
+    ++partWeights[part];
+  }
+  for (auto weight : partWeights) {
+    BOOST_TEST(weight == 8);
+  }
+  BalancedPartitioner().partitionGraph(data, 4, balanced);
+  BOOST_TEST(MultilevelPartitioner::computeConnectivityCut(data, quarters) <=
+             MultilevelPartitioner::computeConnectivityCut(data, balanced));
+}
+
 namespace popsparse {
 namespace experimental {
 
@@ -1747,7 +1927,8 @@ Testing block-sparse API
 dense x sparse = dense case
 */
 void TestDSDAPI(const poplar::Type &dataType, int blockSize, int batchSize,
-                const std::string &partitionMethod = "block-naive") {
+                const std::string &partitionMethod = "block-naive",
+                const std::string &hypergraphPartitioner = "zoltan") {
   auto device = createTestDevice(TEST_TARGET, 1, 16);
   const auto &target = device.getTarget();
   Graph graph(target);
@@ -1813,6 +1994,7 @@ void TestDSDAPI(const poplar::Type &dataType, int blockSize, int batchSize,
 
   poplar::OptionFlags options = {
       {"partitionMethod", partitionMethod},
+      {"hypergraphPartitioner", hypergraphPartitioner},
   };
   poplar::Tensor tensorC =
       bsMatMul(graph, bsParams, matMulProg, tensorA, tensorB, options);
@@ -1948,5 +2130,202 @@ BOOST_AUTO_TEST_CASE(DenseSparseDenseAPI_testF32_block) {
 BOOST_AUTO_TEST_CASE(DenseSparseDenseAPI_testF32_block_naive) {
   TestDSDAPI(FLOAT, 8, 8, "block-naive");
 }
+BOOST_AUTO_TEST_CASE(DenseSparseDenseAPI_testF32_auto) {
+  TestDSDAPI(FLOAT, 8, 8, "auto");
+}
+BOOST_AUTO_TEST_CASE(DenseSparseDenseAPI_testF32_block_multilevel) {
+  TestDSDAPI(FLOAT, 8, 8, "block", "multilevel");
+}
+BOOST_AUTO_TEST_CASE(DenseSparseDenseAPI_testF32_strip_multilevel) {
+  TestDSDAPI(FLOAT, 8, 8, "strip", "multilevel");
+}
 
 BOOST_AUTO_TEST_CASE(DenseDenseSparseAPI_testF32) { TestDDSAPI(FLOAT, 8, 8); }
+BOOST_AUTO_TEST_CASE(DenseDenseSparseAPI_testF32_auto) {
+  TestDDSAPI(FLOAT, 8, 8, "auto");
+}
+
+/*
+Testing block-sparse attention API
+softmax(query * key^T) * value against a dense reference, with the masked
+out blocks and sub-block elements left out of the softmax.
+With emptyRows, the query blocks are twice as tall as the key blocks and the
+first block row only has its second block, so that the sub-block mask leaves
+its first rows without any element, and the second block row has no blocks.
+*/
+void TestAttentionAPI(const poplar::Type &dataType, SubBlockMask subBlockMask,
+                      unsigned numGroups,
+                      const std::string &hypergraphPartitioner = "zoltan",
+                      bool emptyRows = false) {
+  auto device = createTestDevice(TEST_TARGET, 1, 16);
+  const auto &target = device.getTarget();
+  Graph graph(target);
+  popops::addCodelets(graph);
+  poplin::addCodelets(graph);
+
+  const int blockSizeK = dataType == FLOAT ? 8 : 16;
+  const int blockSizeQ = emptyRows ? 2 * blockSizeK : blockSizeK;
+  const int seqLen = 4 * blockSizeK;
+  const int blockRows = seqLen / blockSizeQ;
+  const int blockCols = seqLen / blockSizeK;
+  const std::size_t depth = blockSizeK;
+  const std::size_t depthV = 2 * blockSizeK;
+  const int rows = seqLen * numGroups;
+
+  // Block diagonal band with a global first block column, mirrored to stay
+  // above the diagonal for ZeroLowerTriangle
+  std::vector<unsigned char> sparsity;
+  for (unsigned g = 0; g < numGroups; ++g) {
+    for (int r = 0; r < blockRows; ++r) {
+      for (int c = 0; c < blockCols; ++c) {
+        bool nz;
+        if (emptyRows) {
+          nz = r == 0 && c == 1;
+        } else if (subBlockMask == SubBlockMask::ZeroLowerTriangle) {
+          nz = c == blockCols - 1 || c == r || (g == 0 && c == r + 1);
+        } else {
+          nz = c == 0 || c == r || (g == 0 && c == r - 1);
+        }
+        sparsity.push_back(nz ? 1 : 0);
+      }
+    }
+  }
+
+  std::mt19937 randomEngine;
+  std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+  const auto populate = [&](boost::multi_array<float, 2> &host, int nRows,
+                            int nCols) {
+    host.resize(boost::extents[nRows][nCols]);
+    for (int i = 0; i < nRows; ++i) {
+      for (int j = 0; j < nCols; ++j) {
+        host[i][j] = dist(randomEngine);
+      }
+    }
+  };
+  boost::multi_array<float, 2> hostQ, hostK, hostV;
+  populate(hostQ, rows, depth);
+  populate(hostK, rows, depth);
+  populate(hostV, rows, depthV);
+
+  Sequence uploadProg, downloadProg;
+  std::vector<std::pair<std::string, char *>> streamMaps;
+
+  Tensor query = graph.addVariable(dataType, {std::size_t(rows), depth}, "Q");
+  Tensor key = graph.addVariable(dataType, {std::size_t(rows), depth}, "K");
+  Tensor value = graph.addVariable(dataType, {std::size_t(rows), depthV}, "V");
+  poputil::mapTensorLinearly(graph, query);
+  poputil::mapTensorLinearly(graph, key);
+  poputil::mapTensorLinearly(graph, value);
+
+  std::unique_ptr<char[]> rawHostQ =
+      poplibs_test::util::allocateHostMemoryForTensor(
+          query, "Q", graph, uploadProg, downloadProg, streamMaps);
+  poplibs_test::util::copy(target, hostQ, dataType, rawHostQ.get());
+  std::unique_ptr<char[]> rawHostK =
+      poplibs_test::util::allocateHostMemoryForTensor(
+          key, "K", graph, uploadProg, downloadProg, streamMaps);
+  poplibs_test::util::copy(target, hostK, dataType, rawHostK.get());
+  std::unique_ptr<char[]> rawHostV =
+      poplibs_test::util::allocateHostMemoryForTensor(
+          value, "V", graph, uploadProg, downloadProg, streamMaps);
+  poplibs_test::util::copy(target, hostV, dataType, rawHostV.get());
+
+  Sequence attentionProg;
+  poplar::OptionFlags options = {
+      {"hypergraphPartitioner", hypergraphPartitioner},
+  };
+  Tensor output = bsAttention(graph, query, key, value,
+                              {blockSizeQ, blockSizeK, blockSizeK}, sparsity,
+                              subBlockMask, numGroups, attentionProg, options);
+  BOOST_TEST(output.shape() ==
+             std::vector<std::size_t>({std::size_t(rows), depthV}));
+
+  std::unique_ptr<char[]> rawHostOut =
+      poplibs_test::util::allocateHostMemoryForTensor(
+          output, "out", graph, uploadProg, downloadProg, streamMaps);
+
+  Sequence allSequence;
+  allSequence.add(uploadProg);
+  allSequence.add(attentionProg);
+  allSequence.add(downloadProg);
+
+  const OptionFlags engineOptions{{"debug.allowOutOfMemory", "true"}};
+
+  Engine engine(graph, allSequence, engineOptions);
+  poplibs_test::util::attachStreams(engine, streamMaps);
+  device.bind([&](const Device &d) {
+    engine.load(d);
+    engine.run(0);
+  });
+
+  boost::multi_array<float, 2> hostOut(boost::extents[rows][depthV]);
+  poplibs_test::util::copy(target, dataType, rawHostOut.get(), hostOut);
+
+  std::vector<std::vector<float>> expected(rows,
+                                           std::vector<float>(depthV, 0.0f));
+  for (unsigned g = 0; g < numGroups; ++g) {
+    for (int i = 0; i < seqLen; ++i) {
+      const int row = g * seqLen + i;
+      std::vector<int> cols;
+      std::vector<float> scores;
+      for (int j = 0; j < seqLen; ++j) {
+        const int idxBlock =
+            (g * blockRows + i / blockSizeQ) * blockCols + j / blockSizeK;
+        if (!sparsity[idxBlock] ||
+            (subBlockMask == SubBlockMask::ZeroUpperTriangle && j > i) ||
+            (subBlockMask == SubBlockMask::ZeroLowerTriangle && j < i)) {
+          continue;
+        }
+        float s = 0.0f;
+        for (std::size_t d = 0; d < depth; ++d) {
+          s += hostQ[row][d] * hostK[g * seqLen + j][d];
+        }
+        cols.push_back(j);
+        scores.push_back(s);
+      }
+      if (cols.empty()) {
+        continue;
+      }
+      const float maxScore = *std::max_element(scores.begin(), scores.end());
+      float sum = 0.0f;
+      for (auto &s : scores) {
+        s = std::exp(s - maxScore);
+        sum += s;
+      }
+      for (std::size_t c = 0; c < cols.size(); ++c) {
+        for (std::size_t e = 0; e < depthV; ++e) {
+          expected[row][e] +=
+              scores[c] / sum * hostV[g * seqLen + cols[c]][e];
+        }
+      }
+    }
+  }
+
+  checkDenseResult(dataType, rows, depthV, expected, hostOut);
+}
+
+BOOST_AUTO_TEST_CASE(AttentionAPI_testF32) {
+  TestAttentionAPI(FLOAT, SubBlockMask::None, 1);
+}
+BOOST_AUTO_TEST_CASE(AttentionAPI_testF32_subBlockMask_groups) {
+  TestAttentionAPI(FLOAT, SubBlockMask::ZeroUpperTriangle, 2);
+}
+BOOST_AUTO_TEST_CASE(AttentionAPI_testF32_multilevel) {
+  TestAttentionAPI(FLOAT, SubBlockMask::ZeroUpperTriangle, 2, "multilevel");
+}
+BOOST_AUTO_TEST_CASE(AttentionAPI_testF32_lowerTriangle_multilevel) {
+  TestAttentionAPI(FLOAT, SubBlockMask::ZeroLowerTriangle, 2, "multilevel");
+}
+BOOST_AUTO_TEST_CASE(AttentionAPI_testF32_emptyRows) {
+  TestAttentionAPI(FLOAT, SubBlockMask::ZeroUpperTriangle, 2, "zoltan", true);
+}
+BOOST_AUTO_TEST_CASE(AttentionAPI_testF16) {
+  TestAttentionAPI(HALF, SubBlockMask::None, 1);
+}
+BOOST_AUTO_TEST_CASE(AttentionAPI_testF16_lowerTriangle_groups) {
+  TestAttentionAPI(HALF, SubBlockMask::ZeroLowerTriangle, 2);
+}
+BOOST_AUTO_TEST_CASE(AttentionAPI_testF16_emptyRows_multilevel) {
+  TestAttentionAPI(HALF, SubBlockMask::ZeroUpperTriangle, 1, "multilevel",
+                   true);
+}
@@ -0,0 +1,219 @@
+// Copyright (c) 2020 Graphcore Ltd. All rights reserved.
+
+// Compares the partitions of the hypergraphs of a static block-sparse matmul
+// made by Zoltan, the balanced partitioner and the multilevel partitioner:
+// the connectivity cut, the load balance and the time taken.
+
+#include "popsparse/BSMatrix.hpp"
+#include "popsparse/BalancedPartitioner.hpp"
+#include "popsparse/HyperGraphBlockZoltan.hpp"
+#include "popsparse/HyperGraphStrip.hpp"
+#include "popsparse/MultilevelPartitioner.hpp"
+#include "popsparse/ZoltanPartitioner.hpp"
+#include <boost/program_options.hpp>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <poplar/Graph.hpp>
+#include <poplibs_support/TestDevice.hpp>
+#include <string>
+#include <vector>
+
+using namespace poplar;
+using namespace poplibs_support;
+using namespace popsparse::experimental;
+
+namespace {
+
+struct Problem {
+  std::string method;
+  HyperGraphData graphData;
+  int nPartition;
+};
+
+// Records the hypergraphs a partition method asks to partition, and
+// partitions them cheaply so that the method can carry on
+class RecordingPartitioner : public HyperGraphPartitioner {
+public:
+  RecordingPartitioner(std::string methodIn, std::vector<Problem> &problemsIn)
+      : method(std::move(methodIn)), problems(problemsIn) {}
+
+  float partitionGraph(const HyperGraphData &graphData, int nPartition,
+                       std::vector<int> &nodeAssignment) override {
+    problems.push_back({method, graphData, nPartition});
+    return BalancedPartitioner().partitionGraph(graphData, nPartition,
+                                                nodeAssignment);
+  }
+
+  std::string getName() const override { return "recording"; }
+
+private:
+  std::string method;
+  std::vector<Problem> &problems;
+};
+
+bool readSparsity(const std::string &fileName, int &rows, int &cols,
+                  std::vector<unsigned char> &sparsity) {
+  std::ifstream is(fileName);
+  if (!is || !(is >> rows >> cols) || rows <= 0 || cols <= 0) {
+    return false;
+  }
+  sparsity.resize(rows * cols);
+  for (auto &s : sparsity) {
+    int value;
+    if (!(is >> value)) {
+      return false;
+    }
+    s = value ? 1 : 0;
+  }
+  return true;
+}
+
+} // end anonymous namespace
+
+int main(int argc, char **argv) {
+  DeviceType deviceType = DeviceType::IpuModel2;
+  unsigned tilesPerIPU = 1472;
+  std::string sparsityFileName;
+  std::string scenario = "dsd";
+  int denseRows = 64;
+  int blockSize = 8;
+  unsigned repeats = 1;
+
+  namespace po = boost::program_options;
+  po::options_description desc("Options");
+  // clang-format off
+  desc.add_options()
+    ("help", "Produce help message")
+    ("device-type",
+     po::value<DeviceType>(&deviceType)->default_value(deviceType),
+     "Device type: Cpu | Sim | Sim2 | Hw | IpuModel | IpuModel2")
+    ("tiles-per-ipu",
+     po::value<unsigned>(&tilesPerIPU)->default_value(tilesPerIPU),
+     "Number of tiles, which is the number of partitions")
+    ("sparsity-matrix", po::value<std::string>(&sparsityFileName)->required(),
+     "The file holding the block sparsity mask")
+    ("scenario", po::value<std::string>(&scenario)->default_value(scenario),
+     "dsd = dense x sparse = dense, dds = dense x dense = sparse")
+    ("dense-rows", po::value<int>(&denseRows)->default_value(denseRows),
+     "The number of rows of the dense left hand matrix")
+    ("block-size", po::value<int>(&blockSize)->default_value(blockSize),
+     "The size of the square blocks")
+    ("repeats", po::value<unsigned>(&repeats)->default_value(repeats),
+     "The number of times each hypergraph is partitioned, to time it");
+  // clang-format on
+
+  po::variables_map vm;
+  try {
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    if (vm.count("help")) {
+      std::cout << desc << "\n";
+      return 1;
+    }
+    po::notify(vm);
+  } catch (std::exception &e) {
+    std::cerr << "error: " << e.what() << "\n";
+    return 1;
+  }
+  if (scenario != "dsd" && scenario != "dds") {
+    std::cerr << "error: unknown scenario " << scenario << "\n";
+    return 1;
+  }
+
+  int blockRows, blockCols;
+  std::vector<unsigned char> sparsity;
+  if (!readSparsity(sparsityFileName, blockRows, blockCols, sparsity)) {
+    std::cerr << "error: can not read sparsity mask " << sparsityFileName
+              << "\n";
+    return 1;
+  }
+
+  auto device = createTestDevice(deviceType, 1, tilesPerIPU);
+  const auto &target = device.getTarget();
+  const int nTile = target.getNumTiles();
+
+  // Collect the hypergraphs of the strip and block partition methods
+  std::vector<Problem> problems;
+  for (const std::string method : {"strip", "block"}) {
+    // For dsd the sparse matrix is the right hand side; for dds the mask is
+    // that of the result, and the left hand matrix has its rows
+    const int rows = blockRows * blockSize, cols = blockCols * blockSize;
+    std::unique_ptr<BlockMatrix> lhs, rhs;
+    if (scenario == "dsd") {
+      lhs = std::make_unique<BlockDenseMatrix>(denseRows, rows, blockSize,
+                                               blockSize, false);
+      rhs = std::make_unique<BlockSparseMatrix>(rows, cols, blockSize,
+                                                blockSize, false,
+                                                sparsity.data());
+    } else {
+      lhs = std::make_unique<BlockDenseMatrix>(rows, denseRows, blockSize,
+                                               blockSize, false);
+      rhs = std::make_unique<BlockDenseMatrix>(denseRows, cols, blockSize,
+                                               blockSize, false);
+    }
+    std::unique_ptr<HyperGraph> hg;
+    if (method == "strip") {
+      hg = std::make_unique<HyperGraphStrip>(*lhs, *rhs, FLOAT, FLOAT, FLOAT,
+                                             nTile, 1);
+    } else {
+      hg = std::make_unique<HyperGraphBlockZoltan>(*lhs, *rhs, FLOAT, FLOAT,
+                                                   FLOAT, nTile, 0.5f);
+    }
+    hg->partitioner = std::make_unique<RecordingPartitioner>(method, problems);
+    Graph graph(target);
+    if (scenario == "dsd") {
+      hg->createGraphMatMul(graph, method);
+    } else {
+      hg->createGraphMatMulSparsifyResult(graph, sparsity.data(), method);
+    }
+  }
+
+  std::vector<std::pair<std::string, std::function<HyperGraphPartitioner *()>>>
+      partitioners = {
+          {"zoltan-block",
+           [] {
+             return new ZoltanPartitioner(
+                 ZoltanPartitioner::PartitionType::BLOCK);
+           }},
+          {"zoltan-hypergraph",
+           [] {
+             return new ZoltanPartitioner(
+                 ZoltanPartitioner::PartitionType::HYPERGRAPH);
+           }},
+          {"balanced", [] { return new BalancedPartitioner(); }},
+          {"multilevel", [] { return new MultilevelPartitioner(); }},
+      };
+
+  std::cout << std::left << std::setw(8) << "method" << std::setw(10)
+            << "nodes" << std::setw(10) << "edges" << std::setw(8) << "parts"
+            << std::setw(20) << "partitioner" << std::setw(10) << "cut"
+            << std::setw(12) << "balance"
+            << "time (ms)\n";
+  for (const auto &problem : problems) {
+    const auto &data = problem.graphData;
+    for (const auto &p : partitioners) {
+      std::unique_ptr<HyperGraphPartitioner> partitioner(p.second());
+      std::vector<int> assignment;
+      float balance = 0;
+      const auto start = std::chrono::steady_clock::now();
+      for (unsigned r = 0; r < repeats; ++r) {
+        balance =
+            partitioner->partitionGraph(data, problem.nPartition, assignment);
+      }
+      const std::chrono::duration<double, std::milli> elapsed =
+          std::chrono::steady_clock::now() - start;
+      std::cout << std::setw(8) << problem.method << std::setw(10)
+                << data.nodes << std::setw(10) << data.hyperEdges.size()
+                << std::setw(8) << problem.nPartition << std::setw(20)
+                << p.first << std::setw(10)
+                << MultilevelPartitioner::computeConnectivityCut(data,
+                                                                 assignment)
+                << std::setw(12) << balance << elapsed.count() / repeats
+                << "\n";
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,191 @@
+// Copyright (c) 2020 Graphcore Ltd. All rights reserved.
+
+#define BOOST_TEST_MODULE NMSparseMatMulTest
+#include <algorithm>
+#include <boost/multi_array.hpp>
+#include <boost/test/unit_test.hpp>
+#include <poplar/Engine.hpp>
+#include <poplibs_support/TestDevice.hpp>
+#include <poplibs_test/Util.hpp>
+#include <popops/codelets.hpp>
+#include <popsparse/codelets.hpp>
+#include <popsparse/experimental/NMSparseMatMul.hpp>
+#include <poputil/TileMapping.hpp>
+#include <poputil/exceptions.hpp>
+#include <random>
+#include <vector>
+
+using namespace poplar;
+using namespace poplar::program;
+using namespace poplibs_support;
+using namespace poplibs_test::util;
+using namespace popsparse;
+using namespace popsparse::experimental;
+
+// 2:4 sparsity of a 2 x 8 matrix
+//    0  3 -4  1    1  1  1  1
+//    0  0  0  0    5  0  0  0
+static const std::vector<float> denseRef = {0, 3, -4, 1, 1, 1, 1, 1,
+                                            0, 0, 0, 0, 5, 0, 0, 0};
+// Columns {1, 2}, {0, 1}, {0, 1}, {0, 1} of the groups with 2 bits per column
+static const std::vector<unsigned short> metaInfoRef = {1 | 2 << 2, 1 << 2,
+                                                        1 << 2, 1 << 2};
+
+BOOST_AUTO_TEST_CASE(DenseToNM) {
+  const auto nm = denseToNM(denseRef, 2, 8, 2, 4);
+  // The two values of largest magnitude, taking the lowest columns on a tie,
+  // in increasing column order
+  BOOST_TEST(nm.nzValues == std::vector<float>({3, -4, 1, 1, 0, 0, 5, 0}),
+             boost::test_tools::per_element());
+  BOOST_TEST(nm.metaInfo == metaInfoRef, boost::test_tools::per_element());
+
+  auto expected = denseRef;
+  expected[3] = 0;
+  expected[6] = expected[7] = 0;
+  BOOST_TEST(nmToDense(nm) == expected, boost::test_tools::per_element());
+}
+
+BOOST_AUTO_TEST_CASE(CSRToNM) {
+  const CSRMatrix<float> csr({3, -4, 1, 5}, {1, 2, 5, 4}, {0, 3, 4});
+  const auto nm = csrToNM(csr, 2, 8, 2, 4);
+  BOOST_TEST(nm.nzValues == std::vector<float>({3, -4, 0, 1, 0, 0, 5, 0}),
+             boost::test_tools::per_element());
+  BOOST_TEST(nm.metaInfo == metaInfoRef, boost::test_tools::per_element());
+
+  // Three non-zero values in the first group of the first row
+  const CSRMatrix<float> tooDense({1, 2, 3}, {0, 1, 2}, {0, 3, 3});
+  BOOST_CHECK_THROW(csrToNM(tooDense, 2, 8, 2, 4), poputil::poplibs_error);
+  // Five columns of 4 bits do not fit in the meta-information
+  BOOST_CHECK_THROW(csrToNM(csr, 2, 16, 5, 16), poputil::poplibs_error);
+}
+
+static void testNMSparseMatMul(const Type &dataType, const Type &partialsType,
+                               unsigned n, unsigned m, std::size_t numRows,
+                               std::size_t numColumns, std::size_t batchSize,
+                               unsigned numTiles) {
+  auto device = createTestDevice(TEST_TARGET, 1, numTiles);
+  const auto &target = device.getTarget();
+  Graph graph(target);
+  popops::addCodelets(graph);
+  popsparse::addCodelets(graph);
+
+  const NMMatMulParams params{n, m, numRows, numColumns, batchSize};
+  const OptionFlags options{{"partialsType", partialsType.toString()}};
+
+  std::mt19937 randomEngine;
+  std::uniform_real_distribution<double> dist(-1.0, 1.0);
+  std::vector<double> hostWeights(numRows * numColumns);
+  const auto random = [&] { return dist(randomEngine); };
+  std::generate(hostWeights.begin(), hostWeights.end(), random);
+  const auto nm = denseToNM(hostWeights, numRows, numColumns, n, m);
+  hostWeights = nmToDense(nm);
+  boost::multi_array<double, 2> hostActs(boost::extents[batchSize][numColumns]);
+  boost::multi_array<double, 2> hostGrads(boost::extents[batchSize][numRows]);
+  std::generate_n(hostActs.data(), hostActs.num_elements(), random);
+  std::generate_n(hostGrads.data(), hostGrads.num_elements(), random);
+
+  Sequence prog, uploadProg, downloadProg;
+  const auto weights =
+      createNMSparseWeights(graph, dataType, params, "weights", options);
+  const auto acts =
+      createNMSparseInput(graph, dataType, params, "acts", options);
+  const auto grads = graph.addVariable(dataType, {batchSize, numRows}, "grads");
+  poputil::mapTensorLinearly(graph, grads);
+  const auto out =
+      nmSparseMatMul(graph, weights, acts, params, prog, "fwd", options);
+  const auto gradA = nmSparseMatMulGradA(graph, weights, grads, params, prog,
+                                         "gradA", options);
+  const auto gradW = nmSparseMatMulGradW(graph, weights.metaInfo, grads, acts,
+                                         params, prog, "gradW", options);
+  BOOST_TEST(out.shape() == std::vector<std::size_t>({batchSize, numRows}));
+  BOOST_TEST(gradA.shape() == acts.shape());
+  BOOST_TEST(gradW.shape() == weights.nzValues.shape());
+
+  std::vector<std::pair<std::string, char *>> tmap;
+  auto rawNzValues = allocateHostMemoryForTensor(
+      weights.nzValues, "nzValues", graph, uploadProg, downloadProg, tmap);
+  auto rawMetaInfo = allocateHostMemoryForTensor(
+      weights.metaInfo, "metaInfo", graph, uploadProg, downloadProg, tmap);
+  auto rawActs = allocateHostMemoryForTensor(acts, "acts", graph, uploadProg,
+                                             downloadProg, tmap);
+  auto rawGrads = allocateHostMemoryForTensor(grads, "grads", graph, uploadProg,
+                                              downloadProg, tmap);
+  auto rawOut = allocateHostMemoryForTensor(out, "out", graph, uploadProg,
+                                            downloadProg, tmap);
+  auto rawGradA = allocateHostMemoryForTensor(gradA, "gradA", graph, uploadProg,
+                                              downloadProg, tmap);
+  auto rawGradW = allocateHostMemoryForTensor(gradW, "gradW", graph, uploadProg,
+                                              downloadProg, tmap);
+  copy(target, nm.nzValues, dataType, rawNzValues.get());
+  copy(target, nm.metaInfo, UNSIGNED_SHORT, rawMetaInfo.get());
+  copy(target, hostActs, dataType, rawActs.get());
+  copy(target, hostGrads, dataType, rawGrads.get());
+
+  Engine engine(graph, Sequence(uploadProg, prog, downloadProg));
+  attachStreams(engine, tmap);
+  device.bind([&](const Device &d) { engine.loadAndRun(d); });
+
+  boost::multi_array<double, 2> hostOut(boost::extents[batchSize][numRows]);
+  boost::multi_array<double, 2> hostGradA(
+      boost::extents[batchSize][numColumns]);
+  std::vector<double> hostGradW(nm.nzValues.size());
+  copy(target, dataType, rawOut.get(), hostOut);
+  copy(target, dataType, rawGradA.get(), hostGradA);
+  copy(target, dataType, rawGradW.get(), hostGradW.data(), hostGradW.size());
+
+  boost::multi_array<double, 2> modelOut(boost::extents[batchSize][numRows]);
+  boost::multi_array<double, 2> modelGradA(
+      boost::extents[batchSize][numColumns]);
+  for (std::size_t b = 0; b < batchSize; ++b) {
+    for (std::size_t r = 0; r < numRows; ++r) {
+      for (std::size_t c = 0; c < numColumns; ++c) {
+        const auto w = hostWeights[r * numColumns + c];
+        modelOut[b][r] += hostActs[b][c] * w;
+        modelGradA[b][c] += hostGrads[b][r] * w;
+      }
+    }
+  }
+  // The gradient of each non-zero value at the column of its meta-information
+  unsigned indexBits = 1;
+  while ((1u << indexBits) < m) {
+    ++indexBits;
+  }
+  std::vector<double> modelGradW(nm.nzValues.size());
+  for (std::size_t group = 0; group < nm.metaInfo.size(); ++group) {
+    const auto r = group / (numColumns / m);
+    for (unsigned j = 0; j < n; ++j) {
+      const auto c = (group % (numColumns / m)) * m +
+                     ((nm.metaInfo[group] >> (j * indexBits)) &
+                      ((1u << indexBits) - 1));
+      for (std::size_t b = 0; b < batchSize; ++b) {
+        modelGradW[group * n + j] += hostGrads[b][r] * hostActs[b][c];
+      }
+    }
+  }
+
+  const double relTolerance = dataType == HALF ? 0.1 : 0.01;
+  const double absTolerance = dataType == HALF ? 0.05 : 1e-5;
+  BOOST_CHECK(
+      checkIsClose("out", hostOut, modelOut, relTolerance, absTolerance));
+  BOOST_CHECK(checkIsClose("gradA", hostGradA, modelGradA, relTolerance,
+                           absTolerance));
+  BOOST_CHECK(checkIsClose("gradW", hostGradW.data(), {hostGradW.size()},
+                           modelGradW.data(), modelGradW.size(), relTolerance,
+                           absTolerance));
+}
+
+BOOST_AUTO_TEST_CASE(NMSparseMatMul_2_4_float) {
+  testNMSparseMatMul(FLOAT, FLOAT, 2, 4, 32, 64, 8, 16);
+}
+
+BOOST_AUTO_TEST_CASE(NMSparseMatMul_2_4_half) {
+  testNMSparseMatMul(HALF, FLOAT, 2, 4, 32, 64, 8, 16);
+}
+
+BOOST_AUTO_TEST_CASE(NMSparseMatMul_1_4_half_partials_uneven) {
+  testNMSparseMatMul(HALF, HALF, 1, 4, 20, 48, 3, 8);
+}
+
+BOOST_AUTO_TEST_CASE(NMSparseMatMul_4_16_float) {
+  testNMSparseMatMul(FLOAT, FLOAT, 4, 16, 16, 64, 4, 4);
+}
@@ -1,7 +1,11 @@
 // Copyright (c) 2019 Graphcore Ltd. All rights reserved.
 #define BOOST_TEST_MODULE SparseFormatsTest
 #include "../lib/popsparse/SparseStorageInternal.hpp"
+#include <algorithm>
 #include <boost/test/unit_test.hpp>
+#include <random>
+#include <tbb/task_arena.h>
+#include <tuple>
 
 // CSR/CSC representation of matrix for element sparsity
 //    10   20    0    0    0    0
@@ -443,4 +447,113 @@ BOOST_AUTO_TEST_CASE(ChangeCooBlockSize4x4DoubleChange) {
   BOOST_CHECK_EQUAL_COLLECTIONS(
       cooRef4x4.columnIndices.begin(), cooRef4x4.columnIndices.end(),
       cooOrig.columnIndices.begin(), cooOrig.columnIndices.end());
-}
\ No newline at end of file
+}
+
+// Conversions of a matrix large enough to be split over several threads give
+// the same result on one and on several threads, which is also that of a
+// plain conversion scanning the blocks of the matrix in order. Some rows and
+// columns of blocks are empty, and the chunks of blocks converted by each
+// thread start inside rows.
+BOOST_AUTO_TEST_CASE(ParallelConversionsMatchSerial) {
+  const std::size_t rows = 1024, cols = 768;
+  const unsigned numThreads = 4;
+  std::mt19937 randomEngine;
+  std::bernoulli_distribution isNonZero(0.5);
+  popsparse::COOMatrix<float> coo({2, 2});
+  for (std::size_t c = 0; c < cols; c += 2) {
+    for (std::size_t r = rows; r != 0; r -= 2) {
+      const bool emptyRow = (r / 2) % 8 == 5 || (r >= 400 && r < 432);
+      const bool emptyColumn = (c / 2) % 16 == 3;
+      if (!emptyRow && !emptyColumn && isNonZero(randomEngine)) {
+        coo.rowIndices.push_back(r - 2);
+        coo.columnIndices.push_back(c);
+        for (unsigned i = 0; i != 4; ++i) {
+          coo.nzValues.push_back(coo.nzValues.size());
+        }
+      }
+    }
+  }
+
+  const auto numBlocks = coo.rowIndices.size();
+  tbb::task_arena(numThreads).execute([&] {
+    BOOST_REQUIRE_EQUAL(popsparse::getNumConversionChunks(numBlocks),
+                        numThreads);
+  });
+  const auto rowStarts = popsparse::cooToCSR(rows, cols, coo).rowIndices;
+  for (unsigned chunk = 1; chunk != numThreads; ++chunk) {
+    const auto chunkStart = numBlocks * chunk / numThreads * 4;
+    BOOST_REQUIRE(!std::binary_search(rowStarts.begin(), rowStarts.end(),
+                                      chunkStart));
+  }
+
+  const auto convert = [&](unsigned threads) {
+    tbb::task_arena arena(threads);
+    return arena.execute([&] {
+      const auto csr = popsparse::cooToCSR(rows, cols, coo);
+      const auto csc = popsparse::csrToCSC(rows, cols, csr);
+      const auto csrElems = popsparse::changeCSRBlockSize(csr, {1, 1});
+      const auto roundTrip = popsparse::cscToCSR(rows, cols, csc);
+      BOOST_TEST(roundTrip.nzValues == csr.nzValues);
+      BOOST_TEST(roundTrip.columnIndices == csr.columnIndices);
+      BOOST_TEST(roundTrip.rowIndices == csr.rowIndices);
+      return std::make_tuple(csr.nzValues, csr.columnIndices, csr.rowIndices,
+                             csc.nzValues, csc.rowIndices, csc.columnIndices,
+                             csrElems.nzValues, csrElems.columnIndices,
+                             csrElems.rowIndices);
+    });
+  };
+  // The blocks of the matrix in row-major order of blocks, with the index of
+  // each in the COO matrix.
+  const std::size_t rowBlocks = rows / 2, columnBlocks = cols / 2;
+  std::vector<long> blockAt(rowBlocks * columnBlocks, -1);
+  for (std::size_t i = 0; i != numBlocks; ++i) {
+    blockAt[coo.rowIndices[i] / 2 * columnBlocks + coo.columnIndices[i] / 2] =
+        i;
+  }
+  const auto valueAt = [&](std::size_t row, std::size_t column) {
+    const auto block = blockAt[row / 2 * columnBlocks + column / 2];
+    return coo.nzValues[block * 4 + row % 2 * 2 + column % 2];
+  };
+
+  std::vector<float> csrValues, cscValues, elemValues;
+  std::vector<std::size_t> csrColumns, cscRows, elemColumns;
+  std::vector<std::size_t> csrRowStarts = {0}, cscColumnStarts = {0},
+                           elemRowStarts = {0};
+  for (std::size_t r = 0; r != rowBlocks; ++r) {
+    for (std::size_t c = 0; c != columnBlocks; ++c) {
+      if (blockAt[r * columnBlocks + c] != -1) {
+        csrColumns.push_back(c * 2);
+        for (std::size_t i = 0; i != 4; ++i) {
+          csrValues.push_back(valueAt(r * 2 + i / 2, c * 2 + i % 2));
+        }
+      }
+    }
+    csrRowStarts.push_back(csrValues.size());
+  }
+  for (std::size_t c = 0; c != columnBlocks; ++c) {
+    for (std::size_t r = 0; r != rowBlocks; ++r) {
+      if (blockAt[r * columnBlocks + c] != -1) {
+        cscRows.push_back(r * 2);
+        for (std::size_t i = 0; i != 4; ++i) {
+          cscValues.push_back(valueAt(r * 2 + i % 2, c * 2 + i / 2));
+        }
+      }
+    }
+    cscColumnStarts.push_back(cscValues.size());
+  }
+  for (std::size_t r = 0; r != rows; ++r) {
+    for (std::size_t c = 0; c != cols; ++c) {
+      if (blockAt[r / 2 * columnBlocks + c / 2] != -1) {
+        elemColumns.push_back(c);
+        elemValues.push_back(valueAt(r, c));
+      }
+    }
+    elemRowStarts.push_back(elemValues.size());
+  }
+  const auto reference = std::make_tuple(
+      csrValues, csrColumns, csrRowStarts, cscValues, cscRows, cscColumnStarts,
+      elemValues, elemColumns, elemRowStarts);
+
+  BOOST_CHECK(convert(1) == reference);
+  BOOST_CHECK(convert(numThreads) == reference);
+}
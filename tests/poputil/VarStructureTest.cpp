@@ -156,3 +156,30 @@ BOOST_AUTO_TEST_CASE(IterateTensorPartitionsZeroElements) {
         BOOST_CHECK_EQUAL(s.getContiguousRegions().size(), 0);
       });
 }
+
+BOOST_AUTO_TEST_CASE(IntrospectionCache) {
+  auto device = createTestDevice(TEST_TARGET, 1, 4);
+  Graph graph(device.getTarget());
+
+  // Grouped by 8 in the innermost dimension, one group per tile.
+  auto t = graph.addVariable(FLOAT, {4, 8}, "t");
+  for (unsigned tile = 0; tile < 4; ++tile) {
+    graph.setTileMapping(t[tile], tile);
+  }
+
+  {
+    IntrospectionCacheScope scope(graph);
+    const auto groupings = detectDimGroupings(graph, t);
+    const auto stats = getIntrospectionCacheStats(graph);
+    BOOST_CHECK_GT(stats.misses, 0);
+    BOOST_CHECK(detectDimGroupings(graph, t) == groupings);
+    BOOST_CHECK_EQUAL(getIntrospectionCacheStats(graph).hits, stats.hits + 1);
+
+    // Remapping and invalidating drops the stale layout.
+    graph.setTileMapping(t, 0);
+    invalidateIntrospectionCache(graph, t);
+    BOOST_CHECK_GT(getIntrospectionCacheStats(graph).invalidations, 0);
+    BOOST_CHECK_EQUAL(detectInnermostGrouping(graph, t.flatten()), 32);
+  }
+  BOOST_CHECK_EQUAL(getIntrospectionCacheStats(graph).hits, 0);
+}
@@ -0,0 +1,256 @@
+// Copyright (c) 2020 Graphcore Ltd. All rights reserved.
+#include <boost/multi_array.hpp>
+#include <boost/optional.hpp>
+#include <boost/program_options.hpp>
+#include <fstream>
+#include <iostream>
+#include <poplar/Engine.hpp>
+#include <poplar/Graph.hpp>
+#include <poplibs_support/TestDevice.hpp>
+#include <poplibs_test/Cholesky.hpp>
+#include <poplibs_test/Util.hpp>
+#include <poplin/Cholesky.hpp>
+#include <poplin/MatMul.hpp>
+#include <poplin/codelets.hpp>
+#include <popops/codelets.hpp>
+#include <poputil/TileMapping.hpp>
+#include <poputil/exceptions.hpp>
+#include <random>
+
+using namespace poplar;
+using namespace poplar::program;
+using namespace poplibs_test::util;
+using namespace poplibs_support;
+
+// Default tolerances used in tests
+#define FLOAT_REL_TOL 0.01
+#define HALF_REL_TOL 0.1
+#define FLOAT_ABS_TOL 1e-5
+#define HALF_ABS_TOL 1e-2
+
+const OptionFlags defaultEngineOptions;
+
+int main(int argc, char **argv) {
+  namespace po = boost::program_options;
+
+  unsigned n, k, g;
+  unsigned blockSize;
+  bool lower;
+  bool solve;
+  Type dataType;
+  Type partialsType;
+  double relativeTolerance, absoluteTolerance;
+  DeviceType deviceType = DeviceType::IpuModel2;
+  boost::optional<unsigned> tilesPerIPU;
+
+  boost::optional<std::string> jsonProfileOut;
+  boost::optional<std::string> profileFormat;
+
+  po::options_description desc("Options");
+  // clang-format off
+  desc.add_options()
+    ("help", "Produce help message")
+    ("compile-only", "Stop after compilation; don't run the program")
+    ("device-type",
+      po::value<DeviceType>(&deviceType)->default_value(deviceType),
+      deviceTypeHelp)
+    ("profile", "Output profiling report to standard output")
+    ("profile-json",
+     po::value<decltype(jsonProfileOut)>(&jsonProfileOut)
+      ->default_value(boost::none),
+     "Write the profile report as JSON to the specified file.")
+    ("profile-format",
+     po::value<decltype(profileFormat)>(&profileFormat)
+      ->default_value(boost::none),
+     "Profile formats: v1 | experimental | unstable")
+    ("ignore-data", "Don't upload and download the results from the device. "
+     "Note that this means the result is not validated against the model.")
+    ("n", po::value<unsigned>(&n)->required(),
+     "Number of rows and columns of the symmetric positive definite matrix A")
+    ("k", po::value<unsigned>(&k)->default_value(1),
+     "Number of columns of the right hand side B when solving")
+    ("g",  po::value<unsigned>(&g)->default_value(1),
+      "Number of batches")
+    ("block-size", po::value<unsigned>(&blockSize)->default_value(64),
+     "Block size of the blocked factorisation")
+    ("lower", po::value<bool>(&lower)->default_value(true),
+     "Use the lower (true) or upper (false) triangle of A")
+    ("solve", po::value<bool>(&solve)->default_value(false),
+     "Solve A * X = B using the factorisation instead of only factorising A")
+    ("data-type",
+     po::value<Type>(&dataType)->default_value(FLOAT),
+     "Type of the input and output data")
+    ("partials-type",
+     po::value<Type>(&partialsType),
+     "Type of the matmul partials")
+    ("tolerance", po::value<double>(&relativeTolerance),
+     "Relative tolerance to use when validating results against the reference "
+     "model")
+    ("tiles-per-ipu",
+     po::value(&tilesPerIPU),
+     "Number of tiles per IPU")
+    ("show-execution-steps", "Show execution steps (requires profiling)")
+    ("show-var-storage", "Show variable liveness (requires profiling)")
+  ;
+  // clang-format on
+  po::variables_map vm;
+  try {
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    if (vm.count("help")) {
+      std::cout << desc << "\n";
+      return 1;
+    }
+    po::notify(vm);
+  } catch (std::exception &e) {
+    std::cerr << "error: " << e.what() << "\n";
+    return 1;
+  }
+
+  if (dataType == FLOAT) {
+    absoluteTolerance = FLOAT_ABS_TOL;
+    if (vm["tolerance"].empty()) {
+      relativeTolerance = FLOAT_REL_TOL;
+    }
+  } else {
+    absoluteTolerance = HALF_ABS_TOL;
+    if (vm["tolerance"].empty()) {
+      relativeTolerance = HALF_REL_TOL;
+    }
+  }
+
+  const bool profile = deviceType != DeviceType::Cpu && vm.count("profile");
+  const bool showExecutionSteps = vm.count("show-execution-steps");
+  const bool showVarStorage = vm.count("show-var-storage");
+  const bool ignoreData = vm.count("ignore-data");
+
+  const bool compileIPUCode = true;
+  auto device =
+      tilesPerIPU
+          ? createTestDevice(deviceType, 1, *tilesPerIPU, compileIPUCode)
+          : createTestDeviceFullSize(deviceType, 1, compileIPUCode);
+
+  const auto &target = device.getTarget();
+  Graph graph(target);
+  poplin::addCodelets(graph);
+  popops::addCodelets(graph);
+
+  poplar::OptionFlags mmOpt;
+  if (!vm["partials-type"].empty()) {
+    mmOpt.set("partialsType", partialsType.toString());
+  }
+  poplin::matmul::PlanningCache cache;
+
+  auto matA = graph.addVariable(dataType, {g, n, n}, "matA");
+  poputil::mapTensorLinearly(graph, matA);
+  auto matB = graph.addVariable(dataType, {g, n, k}, "matB");
+  poputil::mapTensorLinearly(graph, matB);
+
+  Sequence prog;
+  auto out = solve ? poplin::choleskySolve(graph, matA, matB, lower, blockSize,
+                                           prog, "choleskySolve", mmOpt,
+                                           &cache)
+                   : poplin::cholesky(graph, matA, lower, blockSize, prog,
+                                      "cholesky", mmOpt, &cache);
+
+  Sequence uploadProg, downloadProg;
+  std::vector<std::pair<std::string, char *>> tmap;
+  auto rawHostMatA = allocateHostMemoryForTensor(
+      matA, "matA", graph, uploadProg, downloadProg, tmap);
+  auto rawHostMatB = allocateHostMemoryForTensor(
+      matB, "matB", graph, uploadProg, downloadProg, tmap);
+  auto rawHostOut = allocateHostMemoryForTensor(out, "out", graph, uploadProg,
+                                                downloadProg, tmap);
+
+  auto engineOptions = defaultEngineOptions;
+  if (profile || jsonProfileOut) {
+    engineOptions.set("debug.instrumentCompute", "true");
+    if (profileFormat) {
+      engineOptions.set("profiler.format", *profileFormat);
+    }
+  }
+
+  Sequence ctrlProg;
+  if (!ignoreData) {
+    ctrlProg.add(uploadProg);
+  }
+  ctrlProg.add(prog);
+  if (!ignoreData) {
+    ctrlProg.add(downloadProg);
+  }
+
+  Engine engine(graph, ctrlProg, engineOptions);
+
+  if (vm.count("compile-only"))
+    return 0;
+
+  const auto outCols = solve ? k : n;
+  boost::multi_array<double, 3> hostOut(boost::extents[g][n][outCols]);
+  boost::multi_array<double, 3> refOut(boost::extents[g][n][outCols]);
+  if (!ignoreData) {
+    attachStreams(engine, tmap);
+
+    // A = M * M' + n * I is symmetric positive definite
+    boost::multi_array<double, 3> hostM(boost::extents[g][n][n]);
+    boost::multi_array<double, 3> hostMatA(boost::extents[g][n][n]);
+    boost::multi_array<double, 3> hostMatB(boost::extents[g][n][k]);
+    std::mt19937 randomEngine;
+    writeRandomValues(target, dataType, hostM, -1.0, 1.0, randomEngine);
+    writeRandomValues(target, dataType, hostMatB, -2.0, 2.0, randomEngine);
+    for (unsigned b = 0; b != g; ++b) {
+      for (unsigned i = 0; i != n; ++i) {
+        for (unsigned j = 0; j != n; ++j) {
+          double sum = i == j ? n : 0;
+          for (unsigned l = 0; l != n; ++l) {
+            sum += hostM[b][i][l] * hostM[b][j][l];
+          }
+          hostMatA[b][i][j] = sum;
+        }
+      }
+    }
+
+    copy(target, hostMatA, dataType, rawHostMatA.get());
+    copy(target, hostMatB, dataType, rawHostMatB.get());
+
+    // the device result is computed from the device representation of A
+    copy(target, dataType, rawHostMatA.get(), hostMatA);
+    if (solve) {
+      poplibs_test::cholesky::choleskySolve(hostMatA, hostMatB, refOut, lower);
+    } else {
+      poplibs_test::cholesky::cholesky(hostMatA, refOut, lower);
+    }
+  }
+
+  device.bind([&](const Device &d) {
+    engine.load(d);
+    engine.run(0);
+  });
+
+  bool matchesModel = true;
+  if (!ignoreData) {
+    copy(target, dataType, rawHostOut.get(), hostOut);
+
+    matchesModel = checkIsClose(solve ? "choleskySolve" : "cholesky", hostOut,
+                                refOut, relativeTolerance, absoluteTolerance);
+  }
+
+  if (jsonProfileOut) {
+    const auto pr = engine.getProfile();
+
+    std::ofstream os(*jsonProfileOut);
+    poplar::serializeToJSON(os, pr);
+  }
+
+  if (profile) {
+    engine.printProfileSummary(
+        std::cout,
+        {{"showExecutionSteps", showExecutionSteps ? "true" : "false"},
+         {"showVarStorage", showVarStorage ? "true" : "false"}});
+  }
+
+  if (!matchesModel) {
+    std::cerr << "Validation failed\n";
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,485 @@
+// Copyright (c) 2020 Graphcore Ltd. All rights reserved.
+//
+// Compares an N:M structured sparse fully connected layer with the same layer
+// implemented with dynamic (unstructured) sparsity and with a dense matmul.
+#include "poputil/exceptions.hpp"
+#include <algorithm>
+#include <boost/multi_array.hpp>
+#include <boost/optional.hpp>
+#include <boost/optional/optional_io.hpp>
+#include <boost/program_options.hpp>
+#include <fstream>
+#include <iomanip>
+#include <poplar/CycleCount.hpp>
+#include <poplar/Engine.hpp>
+#include <poplar/Graph.hpp>
+#include <poplibs_support/TestDevice.hpp>
+#include <poplibs_test/GeneralMatrixMultiply.hpp>
+#include <poplibs_test/Pass.hpp>
+#include <poplibs_test/Util.hpp>
+#include <poplin/MatMul.hpp>
+#include <poplin/codelets.hpp>
+#include <popops/codelets.hpp>
+#include <popsparse/FullyConnected.hpp>
+#include <popsparse/FullyConnectedParams.hpp>
+#include <popsparse/SparsePartitioner.hpp>
+#include <popsparse/codelets.hpp>
+#include <popsparse/experimental/NMSparseMatMul.hpp>
+#include <poputil/TileMapping.hpp>
+#include <random>
+
+using namespace poplar;
+using namespace poplar::program;
+using namespace poplibs_test::util;
+using namespace poplibs_support;
+using poplibs_test::Pass;
+
+using namespace popsparse;
+using namespace popsparse::experimental;
+
+// Tolerances used when data is not ignored
+#define FLOAT_REL_TOL 0.01
+#define HALF_REL_TOL 0.1
+
+// Element-wise CSR matrix with the same non-zero values as an N:M matrix,
+// including any zero padding so that both hold the same number of values.
+static CSRMatrix<float> nmToCSR(const NMMatrix<float> &nm) {
+  unsigned indexBits = 1;
+  while ((1u << indexBits) < nm.m) {
+    ++indexBits;
+  }
+  const auto groupsPerRow = nm.numColumns / nm.m;
+  CSRMatrix<float> csr(nm.nzValues.size(), nm.numRows);
+  csr.nzValues = nm.nzValues;
+  for (std::size_t group = 0; group != nm.metaInfo.size(); ++group) {
+    for (unsigned j = 0; j != nm.n; ++j) {
+      const auto columnInGroup =
+          (nm.metaInfo[group] >> (j * indexBits)) & ((1u << indexBits) - 1);
+      csr.columnIndices[group * nm.n + j] =
+          (group % groupsPerRow) * nm.m + columnInGroup;
+    }
+  }
+  for (std::size_t row = 0; row <= nm.numRows; ++row) {
+    csr.rowIndices[row] = row * groupsPerRow * nm.n;
+  }
+  return csr;
+}
+
+// The programs and memory use of one implementation of the layer.
+struct Implementation {
+  std::string name;
+  Sequence fwdProg, bwdProg, wuProg;
+  std::size_t weightBytes = 0;
+  std::size_t metaInfoBytes = 0;
+};
+
+int main(int argc, char **argv) try {
+  namespace po = boost::program_options;
+
+  DeviceType deviceType = DeviceType::IpuModel2;
+  unsigned numIPUs = 1;
+  boost::optional<unsigned> tilesPerIPU;
+  unsigned n = 2;
+  unsigned m = 4;
+  unsigned inputSize;
+  unsigned outputSize;
+  unsigned batchSize;
+  Type dataType;
+  Type partialsType;
+  Pass pass = Pass::ALL;
+  std::string profileJsonPath;
+
+  po::options_description desc("Options");
+  // clang-format off
+  desc.add_options()
+    ("help", "Produce help message")
+    ("compile-only", "Stop after compilation; don't run the program")
+    ("device-type",
+     po::value<DeviceType>(&deviceType)->default_value(deviceType),
+     deviceTypeHelp)
+    ("input-size", po::value<unsigned>(&inputSize)->required(),
+     "Number of inputs (columns of the weights)")
+    ("output-size", po::value<unsigned>(&outputSize)->required(),
+     "Number of output channels (rows of the weights)")
+    ("n", po::value<unsigned>(&n)->default_value(n),
+     "Number of non-zero values in each group of m columns")
+    ("m", po::value<unsigned>(&m)->default_value(m),
+     "Number of columns in each group")
+    ("data-type",
+     po::value<Type>(&dataType)->default_value(HALF),
+     "Type of the input and output data")
+    ("partials-type",
+     po::value<Type>(&partialsType)->default_value(FLOAT),
+     "Type of partials used during the operation")
+    ("tiles-per-ipu",
+     po::value(&tilesPerIPU),
+     "Number of tiles per IPU")
+    ("batch-size",
+     po::value<unsigned>(&batchSize)->default_value(1),
+     "Batch size")
+    ("single-phase",
+     po::value<Pass>(&pass)->default_value(pass),
+     "Run phase all | fwd | bwd | wu")
+    ("ignore-data", "When set, no upload/download or verification of "
+     "results is performed")
+    ("skip-dynamic", "Do not build the dynamic sparse implementation")
+    ("skip-dense", "Do not build the dense implementation")
+    ("profile", "Enable profiling and print profiling report")
+    ("profile-json",
+     po::value<std::string>(&profileJsonPath)->default_value(profileJsonPath),
+     "Path to a file into which the profiling report will be output in json "
+     "format")
+    ("report-total-cycle-counts", "Report total cycle count ignoring "
+     "upload/download for each pass of each implementation. Note not "
+     "compatible with 'profile' option")
+  ;
+  // clang-format on
+  po::variables_map vm;
+  try {
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    if (vm.count("help")) {
+      std::cout << desc << "\n";
+      return 1;
+    }
+    po::notify(vm);
+  } catch (std::exception &e) {
+    std::cerr << "error: " << e.what() << "\n";
+    return 1;
+  }
+
+  bool profile = vm.count("profile");
+  bool profilingEnabled = profile || !profileJsonPath.empty();
+  bool reportTotalCycleCounts =
+      vm.count("report-total-cycle-counts") && deviceType == DeviceType::Hw;
+  bool ignoreData = vm.count("ignore-data");
+  bool doDynamic = !vm.count("skip-dynamic");
+  bool doDense = !vm.count("skip-dense");
+  bool doFwdPass = pass == Pass::FWD || pass == Pass::ALL;
+  bool doBwdPass = pass == Pass::BWD || pass == Pass::ALL;
+  bool doWuPass = pass == Pass::WU || pass == Pass::ALL;
+
+  if (reportTotalCycleCounts && profilingEnabled) {
+    throw poputil::poplibs_error(
+        "--report-total-cycle-counts and --profile or --profile-json specified "
+        "at the same time. This is not allowed as one affects the other");
+  }
+
+  auto device = tilesPerIPU
+                    ? createTestDevice(deviceType, numIPUs, *tilesPerIPU, true)
+                    : createTestDeviceFullSize(deviceType, numIPUs, true);
+  const auto &target = device.getTarget();
+  const auto typeBytes = target.getTypeSize(dataType);
+  const auto metaInfoTypeBytes = target.getTypeSize(UNSIGNED_SHORT);
+
+  const NMMatMulParams nmParams{n, m, outputSize, inputSize, batchSize};
+  OptionFlags nmOptions{{"partialsType", partialsType.toString()}};
+
+  std::mt19937 randomEngine;
+  std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+  std::vector<float> hostDense(std::size_t(outputSize) * inputSize);
+  std::generate(hostDense.begin(), hostDense.end(),
+                [&] { return dist(randomEngine); });
+  // Throws if the shape is not valid for N:M sparsity
+  const auto nm = denseToNM(hostDense, outputSize, inputSize, n, m);
+  hostDense = nmToDense(nm);
+  const auto csr = nmToCSR(nm);
+
+  boost::multi_array<double, 2> hostInput(boost::extents[batchSize][inputSize]);
+  boost::multi_array<double, 2> hostOutputGrad(
+      boost::extents[batchSize][outputSize]);
+  writeRandomValues(target, dataType, hostInput, -1.0, 1.0, randomEngine);
+  writeRandomValues(target, dataType, hostOutputGrad, -1.0, 1.0, randomEngine);
+
+  Graph graph(target);
+  popops::addCodelets(graph);
+  poplin::addCodelets(graph);
+  popsparse::addCodelets(graph);
+  Sequence uploadProg, downloadProg;
+  std::vector<std::pair<std::string, char *>> tmap;
+  std::vector<Implementation> impls;
+  impls.reserve(3);
+
+  // Only the results of the N:M implementation are checked, the others are
+  // built for comparison and have tests of their own.
+  std::cerr << "Constructing graph...\n";
+  // N:M sparse
+  impls.emplace_back();
+  auto &nmImpl = impls.back();
+  nmImpl.name = std::to_string(n) + ":" + std::to_string(m) + " sparse";
+  const auto nmWeights =
+      createNMSparseWeights(graph, dataType, nmParams, "nm.weights", nmOptions);
+  const auto nmInput =
+      createNMSparseInput(graph, dataType, nmParams, "nm.input", nmOptions);
+  const auto nmOutputGrad =
+      graph.addVariable(dataType, {batchSize, outputSize}, "nm.outputGrad");
+  poputil::mapTensorLinearly(graph, nmOutputGrad);
+  nmImpl.weightBytes = nmWeights.nzValues.numElements() * typeBytes;
+  nmImpl.metaInfoBytes =
+      nmWeights.metaInfo.numElements() * metaInfoTypeBytes;
+  Tensor nmOutputActs, nmInputGrad, nmWeightGrad;
+  if (doFwdPass) {
+    nmOutputActs = nmSparseMatMul(graph, nmWeights, nmInput, nmParams,
+                                  nmImpl.fwdProg, "nm.fwd", nmOptions);
+  }
+  if (doBwdPass) {
+    nmInputGrad =
+        nmSparseMatMulGradA(graph, nmWeights, nmOutputGrad, nmParams,
+                            nmImpl.bwdProg, "nm.grada", nmOptions);
+  }
+  if (doWuPass) {
+    nmWeightGrad = nmSparseMatMulGradW(graph, nmWeights.metaInfo, nmOutputGrad,
+                                       nmInput, nmParams, nmImpl.wuProg,
+                                       "nm.wu", nmOptions);
+  }
+  auto rawNmNzValues = allocateHostMemoryForTensor(
+      nmWeights.nzValues, "nm.weights.nz", graph, uploadProg, downloadProg,
+      tmap);
+  auto rawNmMetaInfo = allocateHostMemoryForTensor(
+      nmWeights.metaInfo, "nm.weights.meta", graph, uploadProg, downloadProg,
+      tmap);
+  auto rawNmInput = allocateHostMemoryForTensor(nmInput, "nm.input", graph,
+                                                uploadProg, downloadProg, tmap);
+  auto rawNmOutputGrad = allocateHostMemoryForTensor(
+      nmOutputGrad, "nm.outputGrad", graph, uploadProg, downloadProg, tmap);
+  std::unique_ptr<char[]> rawNmOutputActs, rawNmInputGrad, rawNmWeightGrad;
+  if (!ignoreData && doFwdPass) {
+    rawNmOutputActs = allocateHostMemoryForTensor(
+        nmOutputActs, "nm.outputActs", graph, uploadProg, downloadProg, tmap);
+  }
+  if (!ignoreData && doBwdPass) {
+    rawNmInputGrad = allocateHostMemoryForTensor(
+        nmInputGrad, "nm.inputGrad", graph, uploadProg, downloadProg, tmap);
+  }
+  if (!ignoreData && doWuPass) {
+    rawNmWeightGrad = allocateHostMemoryForTensor(
+        nmWeightGrad, "nm.weightGrad", graph, uploadProg, downloadProg, tmap);
+  }
+
+  // Dynamic sparse with the same non-zero values
+  dynamic::PlanningCache dynCache;
+  std::unique_ptr<dynamic::Partitioner<float>> partitioner;
+  std::unique_ptr<char[]> rawDynMetaInfo, rawDynNzValues;
+  if (doDynamic) {
+    impls.emplace_back();
+    auto &dynImpl = impls.back();
+    dynImpl.name = "dynamic sparse";
+    OptionFlags options{{"availableMemoryProportion", "1.0"},
+                        {"doGradAPass", doBwdPass ? "true" : "false"},
+                        {"doGradWPass", doWuPass ? "true" : "false"},
+                        {"partialsType", partialsType.toString()}};
+    const auto params =
+        dynamic::FullyConnectedParams::createWithNumNonZeroValues(
+            dynamic::SparsityParams(dynamic::SparsityType::Element,
+                                    dynamic::SparsityStructure::Unstructured),
+            csr.nzValues.size(), batchSize, 1, inputSize, outputSize);
+    const auto weights = dynamic::createFullyConnectedWeights(
+        graph, dataType, params, "dyn.weights", options, &dynCache);
+    const auto input = dynamic::createFullyConnectedInput(
+        graph, dataType, params, "dyn.input", options, &dynCache);
+    dynImpl.weightBytes =
+        weights.getNzValuesTensor().numElements() * typeBytes;
+    dynImpl.metaInfoBytes =
+        weights.getMetaInfoTensor().numElements() * metaInfoTypeBytes;
+    const auto outputActs = dynamic::fullyConnectedFwd(
+        graph, weights, input, params, dynImpl.fwdProg, "dyn.fwd", options,
+        &dynCache);
+    const auto outputGrad = graph.clone(outputActs, "dyn.outputGrad");
+    if (doBwdPass) {
+      dynamic::fullyConnectedGradA(graph, weights, outputGrad, params,
+                                   dynImpl.bwdProg, "dyn.grada", options,
+                                   &dynCache);
+    }
+    if (doWuPass) {
+      dynamic::fullyConnectedSparseGradW(
+          graph, weights.getMetaInfoTensor(), outputGrad, input, params,
+          dynImpl.wuProg, "dyn.wu", options, &dynCache);
+    }
+    partitioner = std::make_unique<dynamic::Partitioner<float>>(
+        params, dataType, target, options, &dynCache);
+    rawDynMetaInfo = allocateHostMemoryForTensor(
+        weights.getMetaInfoTensor(), "dyn.weights.meta", graph, uploadProg,
+        downloadProg, tmap);
+    rawDynNzValues = allocateHostMemoryForTensor(
+        weights.getNzValuesTensor(), "dyn.weights.nz", graph, uploadProg,
+        downloadProg, tmap);
+  }
+
+  // Dense
+  if (doDense) {
+    impls.emplace_back();
+    auto &denseImpl = impls.back();
+    denseImpl.name = "dense";
+    poplin::matmul::PlanningCache cache;
+    OptionFlags options{{"partialsType", partialsType.toString()}};
+    const auto input = poplin::createMatMulInputLHS(
+        graph, dataType, {batchSize, inputSize}, {inputSize, outputSize},
+        "dense.input", options, &cache);
+    const auto weights =
+        poplin::createMatMulInputRHS(graph, dataType, {batchSize, inputSize},
+                                     {inputSize, outputSize}, "dense.weights",
+                                     options, &cache)
+            .transpose();
+    const auto outputGrad = graph.addVariable(
+        dataType, {batchSize, outputSize}, "dense.outputGrad");
+    poputil::mapTensorLinearly(graph, outputGrad);
+    denseImpl.weightBytes = weights.numElements() * typeBytes;
+    if (doFwdPass) {
+      poplin::matMul(graph, input, weights.transpose(), denseImpl.fwdProg,
+                     "dense.fwd", options, &cache);
+    }
+    if (doBwdPass) {
+      poplin::matMul(graph, outputGrad, weights, denseImpl.bwdProg,
+                     "dense.grada", options, &cache);
+    }
+    if (doWuPass) {
+      poplin::matMul(graph, outputGrad.transpose(), input, denseImpl.wuProg,
+                     "dense.wu", options, &cache);
+    }
+  }
+  std::cerr << "Done\n";
+
+  const std::vector<std::pair<std::string, Sequence Implementation::*>>
+      passes = {{"Forward", &Implementation::fwdProg},
+                {"GradA", &Implementation::bwdProg},
+                {"GradW", &Implementation::wuProg}};
+  const std::vector<bool> passEnabled = {doFwdPass, doBwdPass, doWuPass};
+  Sequence controlProg(std::move(uploadProg));
+  for (std::size_t i = 0; i != impls.size(); ++i) {
+    for (std::size_t p = 0; p != passes.size(); ++p) {
+      if (!passEnabled[p]) {
+        continue;
+      }
+      auto &prog = impls[i].*passes[p].second;
+      if (reportTotalCycleCounts) {
+        const auto handle = "cycles" + std::to_string(i) + "_" +
+                            std::to_string(p);
+        const auto cycles = cycleCount(graph, prog, 0, handle);
+        graph.createHostRead(handle, cycles);
+      }
+      controlProg.add(prog);
+    }
+  }
+  if (!ignoreData) {
+    controlProg.add(std::move(downloadProg));
+  }
+
+  std::cerr << "Creating engine...\n";
+  OptionFlags engineOptions;
+  if (profilingEnabled) {
+    engineOptions.set("debug.instrument", "true");
+  }
+  Engine engine(graph, std::move(controlProg), engineOptions);
+
+  if (vm.count("compile-only"))
+    return 0;
+
+  attachStreams(engine, tmap);
+
+  std::cerr << "Running...\n";
+  copy(target, nm.nzValues, dataType, rawNmNzValues.get());
+  copy(target, nm.metaInfo, UNSIGNED_SHORT, rawNmMetaInfo.get());
+  copy(target, hostInput, dataType, rawNmInput.get());
+  copy(target, hostOutputGrad, dataType, rawNmOutputGrad.get());
+  if (doDynamic) {
+    const auto buckets = partitioner->createSparsityDataImpl(csr);
+    copy(target, buckets.metaInfo, UNSIGNED_SHORT, rawDynMetaInfo.get());
+    copy(target, buckets.nzValues, dataType, rawDynNzValues.get());
+  }
+
+  device.bind([&](const Device &d) {
+    engine.loadAndRun(d);
+    if (reportTotalCycleCounts) {
+      for (std::size_t i = 0; i != impls.size(); ++i) {
+        for (std::size_t p = 0; p != passes.size(); ++p) {
+          if (!passEnabled[p]) {
+            continue;
+          }
+          std::uint64_t cyclesBuffer;
+          engine.readTensor("cycles" + std::to_string(i) + "_" +
+                                std::to_string(p),
+                            &cyclesBuffer);
+          std::cerr << "  " << impls[i].name << " " << passes[p].first
+                    << " pass cycles: " << cyclesBuffer << "\n";
+        }
+      }
+    }
+  });
+
+  std::cerr << "Weight memory (bytes):\n";
+  for (const auto &impl : impls) {
+    std::cerr << "  " << std::left << std::setw(16) << impl.name
+              << " non-zero values: " << impl.weightBytes
+              << ", meta-information: " << impl.metaInfoBytes << "\n";
+  }
+
+  bool matchesModel = true;
+  if (!ignoreData) {
+    const double relTolerance = dataType == HALF ? HALF_REL_TOL : FLOAT_REL_TOL;
+    boost::multi_array<double, 2> hostWeights(
+        boost::extents[outputSize][inputSize]);
+    std::copy(hostDense.begin(), hostDense.end(), hostWeights.data());
+    if (doFwdPass) {
+      boost::multi_array<double, 2> hostOutputActs(
+          boost::extents[batchSize][outputSize]);
+      boost::multi_array<double, 2> modelOutputActs(
+          boost::extents[batchSize][outputSize]);
+      copy(target, dataType, rawNmOutputActs.get(), hostOutputActs);
+      poplibs_test::gemm::generalMatrixMultiply(hostInput, hostWeights,
+                                                modelOutputActs, false, true);
+      matchesModel &= checkIsClose("outputActs", hostOutputActs,
+                                   modelOutputActs, relTolerance);
+    }
+    if (doBwdPass) {
+      boost::multi_array<double, 2> hostInputGrad(
+          boost::extents[batchSize][inputSize]);
+      boost::multi_array<double, 2> modelInputGrad(
+          boost::extents[batchSize][inputSize]);
+      copy(target, dataType, rawNmInputGrad.get(), hostInputGrad);
+      poplibs_test::gemm::generalMatrixMultiply(hostOutputGrad, hostWeights,
+                                                modelInputGrad, false, false);
+      matchesModel &= checkIsClose("inputGrad", hostInputGrad, modelInputGrad,
+                                   relTolerance);
+    }
+    if (doWuPass) {
+      boost::multi_array<double, 2> modelWeightGrad(
+          boost::extents[outputSize][inputSize]);
+      poplibs_test::gemm::generalMatrixMultiply(hostOutputGrad, hostInput,
+                                                modelWeightGrad, true, false);
+      // The model gradient at the position of each non-zero value
+      std::vector<double> hostWeightGrad(nm.nzValues.size());
+      std::vector<double> modelNzWeightGrad(nm.nzValues.size());
+      copy(target, dataType, rawNmWeightGrad.get(), hostWeightGrad.data(),
+           hostWeightGrad.size());
+      for (std::size_t row = 0; row != outputSize; ++row) {
+        for (auto i = csr.rowIndices[row]; i != csr.rowIndices[row + 1]; ++i) {
+          modelNzWeightGrad[i] = modelWeightGrad[row][csr.columnIndices[i]];
+        }
+      }
+      matchesModel &= checkIsClose(
+          "weightGrad", hostWeightGrad.data(), {hostWeightGrad.size()},
+          modelNzWeightGrad.data(), modelNzWeightGrad.size(), relTolerance);
+    }
+  }
+
+  if (profile) {
+    engine.printProfileSummary(std::cout, {{"showExecutionSteps", "true"}});
+  }
+  if (!profileJsonPath.empty()) {
+    std::ofstream os(profileJsonPath, std::ios_base::out);
+    const auto &pr = engine.getProfile();
+    poplar::serializeToJSON(os, pr);
+  }
+
+  if (!matchesModel) {
+    std::cerr << "Validation failed\n";
+    return 1;
+  }
+
+  return 0;
+} catch (const poplar::graph_memory_allocation_error &e) {
+  if (e.graphProfile.type() == ProfileValue::Type::MAP) {
+    poplar::printGraphSummary(std::cerr, e.graphProfile,
+                              {{"showVarStorage", "true"}});
+  }
+  throw;
+}
@@ -0,0 +1,215 @@
+// Copyright (c) 2020 Graphcore Ltd. All rights reserved.
+// Benchmark of a row scatter, as used for TensorFlow scatter updates. Run
+// with --use-multi-update=true and =false to compare the multiUpdate
+// implementation with the loop over the indices.
+#include <algorithm>
+#include <boost/multi_array.hpp>
+#include <boost/optional.hpp>
+#include <boost/program_options.hpp>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+#include <poplar/Engine.hpp>
+#include <poplar/Graph.hpp>
+#include <poplibs_support/TestDevice.hpp>
+#include <poplibs_test/Util.hpp>
+#include <popops/Scatter.hpp>
+#include <popops/codelets.hpp>
+#include <poputil/TileMapping.hpp>
+#include <poputil/exceptions.hpp>
+#include <random>
+
+using namespace poplar;
+using namespace poplar::program;
+using namespace poplibs_test::util;
+using namespace poplibs_support;
+
+const OptionFlags defaultEngineOptions;
+
+int main(int argc, char **argv) {
+  namespace po = boost::program_options;
+
+  unsigned numRows, rowSize, numIndices;
+  bool useMultiUpdate;
+  Type dataType;
+  DeviceType deviceType = DeviceType::IpuModel2;
+  boost::optional<unsigned> tilesPerIPU;
+
+  boost::optional<std::string> jsonProfileOut;
+  boost::optional<std::string> profileFormat;
+
+  po::options_description desc("Options");
+  // clang-format off
+  desc.add_options()
+    ("help", "Produce help message")
+    ("compile-only", "Stop after compilation; don't run the program")
+    ("device-type",
+      po::value<DeviceType>(&deviceType)->default_value(deviceType),
+      deviceTypeHelp)
+    ("profile", "Output profiling report to standard output")
+    ("profile-json",
+     po::value<decltype(jsonProfileOut)>(&jsonProfileOut)
+      ->default_value(boost::none),
+     "Write the profile report as JSON to the specified file.")
+    ("profile-format",
+     po::value<decltype(profileFormat)>(&profileFormat)
+      ->default_value(boost::none),
+     "Profile formats: v1 | experimental | unstable")
+    ("ignore-data", "Don't upload and download the results from the device. "
+     "Note that this means the result is not validated against the model.")
+    ("rows", po::value<unsigned>(&numRows)->required(),
+     "Number of rows of the operand")
+    ("row-size", po::value<unsigned>(&rowSize)->required(),
+     "Number of elements in each row of the operand")
+    ("num-indices", po::value<unsigned>(&numIndices)->required(),
+     "Number of rows to scatter, must be no more than the number of rows")
+    ("use-multi-update",
+     po::value<bool>(&useMultiUpdate)->default_value(true),
+     "Scatter with a single multiUpdate rather than a loop over the indices")
+    ("data-type",
+     po::value<Type>(&dataType)->default_value(FLOAT),
+     "Type of the operand and updates")
+    ("tiles-per-ipu",
+     po::value(&tilesPerIPU),
+     "Number of tiles per IPU")
+    ("show-execution-steps", "Show execution steps (requires profiling)")
+    ("show-var-storage", "Show variable liveness (requires profiling)")
+  ;
+  // clang-format on
+  po::variables_map vm;
+  try {
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    if (vm.count("help")) {
+      std::cout << desc << "\n";
+      return 1;
+    }
+    po::notify(vm);
+  } catch (std::exception &e) {
+    std::cerr << "error: " << e.what() << "\n";
+    return 1;
+  }
+
+  if (numIndices > numRows) {
+    std::cerr << "error: num-indices must not be greater than rows\n";
+    return 1;
+  }
+
+  const bool profile = deviceType != DeviceType::Cpu && vm.count("profile");
+  const bool showExecutionSteps = vm.count("show-execution-steps");
+  const bool showVarStorage = vm.count("show-var-storage");
+  const bool ignoreData = vm.count("ignore-data");
+
+  const bool compileIPUCode = true;
+  auto device =
+      tilesPerIPU
+          ? createTestDevice(deviceType, 1, *tilesPerIPU, compileIPUCode)
+          : createTestDeviceFullSize(deviceType, 1, compileIPUCode);
+
+  const auto &target = device.getTarget();
+  Graph graph(target);
+  popops::addCodelets(graph);
+
+  auto operand = graph.addVariable(dataType, {numRows, rowSize}, "operand");
+  poputil::mapTensorLinearly(graph, operand);
+  auto indices = graph.addVariable(INT, {numIndices}, "indices");
+  poputil::mapTensorLinearly(graph, indices);
+  auto updates = graph.addVariable(dataType, {numIndices, rowSize}, "updates");
+  poputil::mapTensorLinearly(graph, updates);
+
+  Sequence prog;
+  popops::scatter(graph, operand, indices, updates, 1, {1}, {0}, {0}, prog,
+                  "scatter",
+                  {{"enableMultiUpdate", useMultiUpdate ? "true" : "false"}});
+
+  Sequence uploadProg, downloadProg;
+  std::vector<std::pair<std::string, char *>> tmap;
+  auto rawOperand = allocateHostMemoryForTensor(
+      operand, "operand", graph, uploadProg, downloadProg, tmap);
+  auto rawIndices = allocateHostMemoryForTensor(
+      indices, "indices", graph, uploadProg, downloadProg, tmap);
+  auto rawUpdates = allocateHostMemoryForTensor(
+      updates, "updates", graph, uploadProg, downloadProg, tmap);
+
+  auto engineOptions = defaultEngineOptions;
+  if (profile || jsonProfileOut) {
+    engineOptions.set("debug.instrumentCompute", "true");
+    if (profileFormat) {
+      engineOptions.set("profiler.format", *profileFormat);
+    }
+  }
+
+  Sequence ctrlProg;
+  if (!ignoreData) {
+    ctrlProg.add(uploadProg);
+  }
+  ctrlProg.add(prog);
+  if (!ignoreData) {
+    ctrlProg.add(downloadProg);
+  }
+
+  Engine engine(graph, ctrlProg, engineOptions);
+
+  if (vm.count("compile-only"))
+    return 0;
+
+  boost::multi_array<double, 2> hostOperand(boost::extents[numRows][rowSize]);
+  boost::multi_array<double, 2> hostUpdates(
+      boost::extents[numIndices][rowSize]);
+  if (!ignoreData) {
+    attachStreams(engine, tmap);
+
+    std::mt19937 randomEngine;
+    writeRandomValues(target, dataType, hostOperand, -1.0, 1.0, randomEngine);
+    writeRandomValues(target, dataType, hostUpdates, -1.0, 1.0, randomEngine);
+    copy(target, hostOperand, dataType, rawOperand.get());
+    copy(target, hostUpdates, dataType, rawUpdates.get());
+    copy(target, dataType, rawOperand.get(), hostOperand);
+    copy(target, dataType, rawUpdates.get(), hostUpdates);
+
+    // distinct rows so the result does not depend on the update order
+    std::vector<int> rows(numRows);
+    std::iota(rows.begin(), rows.end(), 0);
+    std::shuffle(rows.begin(), rows.end(), randomEngine);
+    boost::multi_array<double, 1> hostIndices(boost::extents[numIndices]);
+    for (unsigned i = 0; i != numIndices; ++i) {
+      hostIndices[i] = rows[i];
+      for (unsigned j = 0; j != rowSize; ++j) {
+        hostOperand[rows[i]][j] = hostUpdates[i][j];
+      }
+    }
+    copy(target, hostIndices, INT, rawIndices.get());
+  }
+
+  device.bind([&](const Device &d) {
+    engine.load(d);
+    engine.run(0);
+  });
+
+  bool matchesModel = true;
+  if (!ignoreData) {
+    boost::multi_array<double, 2> hostOut(boost::extents[numRows][rowSize]);
+    copy(target, dataType, rawOperand.get(), hostOut);
+    matchesModel = checkIsClose("scatter", hostOut, hostOperand, 0.0);
+  }
+
+  if (jsonProfileOut) {
+    const auto pr = engine.getProfile();
+
+    std::ofstream os(*jsonProfileOut);
+    poplar::serializeToJSON(os, pr);
+  }
+
+  if (profile) {
+    engine.printProfileSummary(
+        std::cout,
+        {{"showExecutionSteps", showExecutionSteps ? "true" : "false"},
+         {"showVarStorage", showVarStorage ? "true" : "false"}});
+  }
+
+  if (!matchesModel) {
+    std::cerr << "Validation failed\n";
+    return 1;
+  }
+
+  return 0;
+}
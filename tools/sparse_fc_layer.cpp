@@ -109,6 +109,7 @@ int main(int argc, char **argv) try {
   weightedAreaBegin.val = weightedAreaEnd.val = {0, 0};
   double weightedAreaWeighting = 1.0;
   bool denseGradWSerialSplits = false;
+  bool expectDense = false;
 
   po::options_description desc("Options");
   // clang-format off
@@ -178,6 +179,9 @@ int main(int argc, char **argv) try {
       po::value<bool>(&denseGradWSerialSplits)->
         default_value(denseGradWSerialSplits),
      "Report dense GradW splits when GradW pass is enabled")
+    ("expect-dense", po::value<bool>(&expectDense),
+     "Fail unless the planner chooses (true) or does not choose (false) to "
+     "hold the weights densely")
   ;
   // clang-format on
   po::variables_map vm;
@@ -303,6 +307,12 @@ int main(int argc, char **argv) try {
     std::cerr << str << plan << "\n" << planCost << "\n";
   }
 
+  if (vm.count("expect-dense") && expectDense != plan.useDense) {
+    throw poputil::poplibs_error(
+        std::string("Expected the planner to ") +
+        (expectDense ? "choose" : "not choose") + " a dense plan");
+  }
+
   std::size_t fwdMetaInfoBucketSize = plan.fwdMetaInfoElemsPerBucket;
   std::size_t gradAMetaInfoBucketSize = plan.gradAMetaInfoElemsPerBucket;
   std::size_t nzElementBucketSize = plan.nzElemsPerBucket;
@@ -526,9 +536,12 @@ int main(int argc, char **argv) try {
 
   const auto &metaInfoFlat = buckets.metaInfo;
   const auto &nzValuesFlat = buckets.nzValues;
-  // Overflow info is the same for all passes at time of writing.
-  std::cerr << "overflowInfo = {" << metaInfoFlat.at(0) << ","
-            << metaInfoFlat.at(1) << "," << metaInfoFlat.at(2) << "}\n";
+  // Overflow info is the same for all passes at time of writing. There is
+  // none when the weights are held densely.
+  if (!plan.useDense) {
+    std::cerr << "overflowInfo = {" << metaInfoFlat.at(0) << ","
+              << metaInfoFlat.at(1) << "," << metaInfoFlat.at(2) << "}\n";
+  }
 
   copy(target, hostInput, dataType, rawInput.get());
   copy(target, metaInfoFlat, UNSIGNED_SHORT, rawMetaInfo.get());
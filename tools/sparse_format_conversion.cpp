@@ -0,0 +1,317 @@
+// Copyright (c) 2020 Graphcore Ltd. All rights reserved.
+//
+// Measures the host conversions between sparse storage formats on a random
+// block sparse matrix, run on a single thread and on all available threads,
+// and checks that both give the result of a plain serial conversion.
+#include "../lib/popsparse/SparseStorageInternal.hpp"
+#include <algorithm>
+#include <boost/program_options.hpp>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <tbb/task_arena.h>
+#include <vector>
+
+using namespace popsparse;
+
+namespace po = boost::program_options;
+
+template <class V> static bool sameBytes(const V &a, const V &b) {
+  return a.size() == b.size() &&
+         (a.empty() ||
+          std::memcmp(a.data(), b.data(), a.size() * sizeof(a[0])) == 0);
+}
+
+template <class M> static bool sameMatrix(const M &a, const M &b) {
+  return a.getBlockDimensions() == b.getBlockDimensions() &&
+         sameBytes(a.nzValues, b.nzValues) &&
+         sameBytes(a.columnIndices, b.columnIndices) &&
+         sameBytes(a.rowIndices, b.rowIndices);
+}
+
+// Random block sparse CSR matrix with columns in increasing order within
+// each row. The gap to the next non-zero block of a row is geometric so the
+// matrix is built in time proportional to the number of non-zero blocks.
+static CSRMatrix<float> randomCSR(std::size_t numRows, std::size_t numColumns,
+                                  const std::array<std::size_t, 2> &blockDims,
+                                  double density, std::mt19937 &randomEngine) {
+  const auto blockSize = blockDims[0] * blockDims[1];
+  const auto numRowBlocks = numRows / blockDims[0];
+  const auto numColumnBlocks = numColumns / blockDims[1];
+  std::geometric_distribution<std::size_t> gap(density);
+  std::uniform_real_distribution<float> value(-1.0f, 1.0f);
+  CSRMatrix<float> csr(blockDims);
+  csr.rowIndices.push_back(0);
+  for (std::size_t row = 0; row != numRowBlocks; ++row) {
+    for (auto col = gap(randomEngine); col < numColumnBlocks;
+         col += 1 + gap(randomEngine)) {
+      csr.columnIndices.push_back(col * blockDims[1]);
+      for (std::size_t i = 0; i != blockSize; ++i) {
+        csr.nzValues.push_back(value(randomEngine));
+      }
+    }
+    csr.rowIndices.push_back(csr.nzValues.size());
+  }
+  return csr;
+}
+
+// Same blocks as the CSR matrix in a random order.
+static COOMatrix<float> shuffledCOO(const CSRMatrix<float> &csr,
+                                    std::mt19937 &randomEngine) {
+  const auto blockSize = csr.getBlockSize();
+  const auto numBlocks = csr.columnIndices.size();
+  std::vector<std::size_t> order(numBlocks);
+  std::iota(order.begin(), order.end(), 0);
+  std::shuffle(order.begin(), order.end(), randomEngine);
+  std::vector<std::size_t> blockRows(numBlocks);
+  for (std::size_t row = 0; row + 1 < csr.rowIndices.size(); ++row) {
+    for (auto i = csr.rowIndices[row] / blockSize;
+         i != csr.rowIndices[row + 1] / blockSize; ++i) {
+      blockRows[i] = row * csr.getNumRowsInBlock();
+    }
+  }
+  COOMatrix<float> coo(numBlocks * blockSize, csr.getBlockDimensions());
+  coo.rowIndices.resize(numBlocks);
+  coo.columnIndices.resize(numBlocks);
+  for (std::size_t i = 0; i != numBlocks; ++i) {
+    coo.rowIndices[i] = blockRows[order[i]];
+    coo.columnIndices[i] = csr.columnIndices[order[i]];
+    std::copy_n(csr.nzValues.begin() + order[i] * blockSize, blockSize,
+                coo.nzValues.begin() + i * blockSize);
+  }
+  return coo;
+}
+
+// Same matrix with the blocks of each row in a random order.
+static CSRMatrix<float> shuffledRows(const CSRMatrix<float> &csr,
+                                     std::mt19937 &randomEngine) {
+  const auto blockSize = csr.getBlockSize();
+  auto shuffled = csr;
+  for (std::size_t row = 0; row + 1 < csr.rowIndices.size(); ++row) {
+    const auto begin = csr.rowIndices[row] / blockSize;
+    const auto end = csr.rowIndices[row + 1] / blockSize;
+    std::vector<std::size_t> order(end - begin);
+    std::iota(order.begin(), order.end(), begin);
+    std::shuffle(order.begin(), order.end(), randomEngine);
+    for (std::size_t i = begin; i != end; ++i) {
+      const auto src = order[i - begin];
+      shuffled.columnIndices[i] = csr.columnIndices[src];
+      std::copy_n(csr.nzValues.begin() + src * blockSize, blockSize,
+                  shuffled.nzValues.begin() + i * blockSize);
+    }
+  }
+  return shuffled;
+}
+
+// Plain serial CSR to CSC conversion: the blocks of each column are found by
+// scanning the whole matrix in column order.
+static CSCMatrix<float> referenceCSRToCSC(std::size_t numColumns,
+                                          const CSRMatrix<float> &csr) {
+  const auto blockSize = csr.getBlockSize();
+  const auto rowsInBlock = csr.getNumRowsInBlock();
+  const auto columnsInBlock = csr.getNumColumnsInBlock();
+  const auto numRowBlocks = csr.rowIndices.size() - 1;
+  CSCMatrix<float> csc(csr.getBlockDimensions());
+  csc.columnIndices.push_back(0);
+  // The next block of each row not yet placed, in increasing column order
+  std::vector<std::size_t> next(numRowBlocks);
+  for (std::size_t row = 0; row != numRowBlocks; ++row) {
+    next[row] = csr.rowIndices[row] / blockSize;
+  }
+  for (std::size_t column = 0; column < numColumns;
+       column += columnsInBlock) {
+    for (std::size_t row = 0; row != numRowBlocks; ++row) {
+      const auto block = next[row];
+      if (block == csr.rowIndices[row + 1] / blockSize ||
+          csr.columnIndices[block] != column) {
+        continue;
+      }
+      csc.rowIndices.push_back(row * rowsInBlock);
+      for (std::size_t c = 0; c != columnsInBlock; ++c) {
+        for (std::size_t r = 0; r != rowsInBlock; ++r) {
+          csc.nzValues.push_back(
+              csr.nzValues[block * blockSize + r * columnsInBlock + c]);
+        }
+      }
+      ++next[row];
+    }
+    csc.columnIndices.push_back(csc.nzValues.size());
+  }
+  return csc;
+}
+
+// Plain serial split of the blocks of a CSR matrix into smaller blocks.
+static CSRMatrix<float>
+referenceChangeBlockSize(const CSRMatrix<float> &csr,
+                         const std::array<std::size_t, 2> &newBlockDims) {
+  const auto blockSize = csr.getBlockSize();
+  const auto rowsInBlock = csr.getNumRowsInBlock();
+  const auto columnsInBlock = csr.getNumColumnsInBlock();
+  CSRMatrix<float> result(newBlockDims);
+  for (std::size_t row = 0; row + 1 < csr.rowIndices.size(); ++row) {
+    const auto begin = csr.rowIndices[row] / blockSize;
+    const auto end = csr.rowIndices[row + 1] / blockSize;
+    for (std::size_t subR = 0; subR < rowsInBlock; subR += newBlockDims[0]) {
+      result.rowIndices.push_back(result.nzValues.size());
+      for (auto block = begin; block != end; ++block) {
+        for (std::size_t subC = 0; subC < columnsInBlock;
+             subC += newBlockDims[1]) {
+          result.columnIndices.push_back(csr.columnIndices[block] + subC);
+          for (std::size_t r = subR; r != subR + newBlockDims[0]; ++r) {
+            for (std::size_t c = subC; c != subC + newBlockDims[1]; ++c) {
+              result.nzValues.push_back(
+                  csr.nzValues[block * blockSize + r * columnsInBlock + c]);
+            }
+          }
+        }
+      }
+    }
+  }
+  result.rowIndices.push_back(result.nzValues.size());
+  return result;
+}
+
+int main(int argc, char **argv) try {
+  std::size_t numRows;
+  std::size_t numColumns;
+  std::size_t blockRows = 1;
+  std::size_t blockColumns = 1;
+  std::size_t newBlockRows = 1;
+  std::size_t newBlockColumns = 1;
+  double density = 0.1;
+  unsigned iterations = 5;
+  unsigned numThreads = tbb::this_task_arena::max_concurrency();
+  unsigned seed = 42;
+
+  po::options_description desc("Options");
+  // clang-format off
+  desc.add_options()
+    ("help", "Produce help message")
+    ("rows", po::value<std::size_t>(&numRows)->required(),
+     "Number of rows of the matrix")
+    ("columns", po::value<std::size_t>(&numColumns)->required(),
+     "Number of columns of the matrix")
+    ("block-rows", po::value<std::size_t>(&blockRows)->default_value(blockRows),
+     "Number of rows in a block")
+    ("block-columns",
+     po::value<std::size_t>(&blockColumns)->default_value(blockColumns),
+     "Number of columns in a block")
+    ("new-block-rows",
+     po::value<std::size_t>(&newBlockRows)->default_value(newBlockRows),
+     "Number of rows in a block after changing the block size")
+    ("new-block-columns",
+     po::value<std::size_t>(&newBlockColumns)->default_value(newBlockColumns),
+     "Number of columns in a block after changing the block size")
+    ("density", po::value<double>(&density)->default_value(density),
+     "Proportion of blocks that are non-zero")
+    ("iterations", po::value<unsigned>(&iterations)->default_value(iterations),
+     "Number of times each conversion is run. The fastest run is reported")
+    ("threads", po::value<unsigned>(&numThreads)->default_value(numThreads),
+     "Number of threads of the parallel runs")
+    ("seed", po::value<unsigned>(&seed)->default_value(seed),
+     "Seed of the random matrix")
+  ;
+  // clang-format on
+  po::variables_map vm;
+  try {
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    if (vm.count("help")) {
+      std::cout << desc << "\n";
+      return 1;
+    }
+    po::notify(vm);
+  } catch (std::exception &e) {
+    std::cerr << "error: " << e.what() << "\n";
+    return 1;
+  }
+
+  if (density <= 0 || density > 1) {
+    throw poputil::poplibs_error("Density must be in (0, 1]");
+  }
+  if (iterations == 0 || numThreads == 0) {
+    throw poputil::poplibs_error("Iterations and threads must be non-zero");
+  }
+  const std::array<std::size_t, 2> blockDims = {blockRows, blockColumns};
+  const std::array<std::size_t, 2> newBlockDims = {newBlockRows,
+                                                   newBlockColumns};
+  validateBlockSizes(numRows, numColumns, blockRows, blockColumns);
+  validateBlockSizes(numRows, numColumns, newBlockRows, newBlockColumns);
+
+  std::mt19937 randomEngine(seed);
+  const auto csr =
+      randomCSR(numRows, numColumns, blockDims, density, randomEngine);
+  const auto csc = referenceCSRToCSC(numColumns, csr);
+  const CSRMatrix<float> transpose(
+      csc.nzValues, csc.rowIndices, csc.columnIndices,
+      {csc.getNumColumnsInBlock(), csc.getNumRowsInBlock()});
+  const auto coo = shuffledCOO(csr, randomEngine);
+  const auto unsortedCSR = shuffledRows(csr, randomEngine);
+  std::cout << "Matrix " << numRows << "x" << numColumns << " with "
+            << csr.columnIndices.size() << " non-zero blocks of " << blockRows
+            << "x" << blockColumns << "\n";
+
+  tbb::task_arena serialArena(1);
+  tbb::task_arena parallelArena(numThreads);
+
+  // Fastest of the runs of the conversion in the arena, with its result
+  const auto time = [&](tbb::task_arena &arena, const auto &convert) {
+    using Clock = std::chrono::steady_clock;
+    decltype(convert()) result;
+    double best = std::numeric_limits<double>::max();
+    for (unsigned i = 0; i != iterations; ++i) {
+      arena.execute([&] {
+        const auto start = Clock::now();
+        result = convert();
+        const std::chrono::duration<double> elapsed = Clock::now() - start;
+        best = std::min(best, elapsed.count());
+      });
+    }
+    return std::make_pair(best, std::move(result));
+  };
+
+  bool matches = true;
+  const auto run = [&](const std::string &name, const auto &expected,
+                       const auto &convert) {
+    const auto serial = time(serialArena, convert);
+    const auto parallel = time(parallelArena, convert);
+    const bool same = sameMatrix(serial.second, expected) &&
+                      sameMatrix(parallel.second, expected);
+    matches &= same;
+    std::cout << std::left << std::setw(20) << name << std::right
+              << std::fixed << std::setprecision(6) << std::setw(12)
+              << serial.first << "s" << std::setw(12) << parallel.first
+              << "s" << std::setprecision(2) << std::setw(8)
+              << serial.first / parallel.first << "x"
+              << (same ? "" : "  MISMATCH") << "\n";
+  };
+
+  std::cout << "Parallel runs use " << numThreads << " threads\n";
+  std::cout << std::left << std::setw(20) << "Conversion" << std::right
+            << std::setw(13) << "Serial" << std::setw(13) << "Parallel"
+            << std::setw(9) << "Speedup\n";
+  run("csrToCSC", csc, [&] { return csrToCSC(numRows, numColumns, csr); });
+  run("cscToCSR", csr, [&] { return cscToCSR(numRows, numColumns, csc); });
+  run("csrTranspose", transpose,
+      [&] { return csrTranspose(numRows, numColumns, csr); });
+  run("cooToCSR", csr, [&] { return cooToCSR(numRows, numColumns, coo); });
+  run("canonicalizeCSR", csr, [&] {
+    auto result = unsortedCSR;
+    canonicalizeCSR(result);
+    return result;
+  });
+  run("changeCSRBlockSize", referenceChangeBlockSize(csr, newBlockDims),
+      [&] { return changeCSRBlockSize(csr, newBlockDims); });
+
+  if (!matches) {
+    std::cerr << "Validation failed\n";
+    return 1;
+  }
+  return 0;
+} catch (const poputil::poplibs_error &e) {
+  std::cerr << "error: " << e.what() << "\n";
+  return 1;
+}
@@ -0,0 +1,254 @@
+// Copyright (c) 2020 Graphcore Ltd. All rights reserved.
+// Benchmark of popnn::topK. Run with --method=compare to report the cycles of
+// the heap-based and the streaming implementations for the same input.
+#include <algorithm>
+#include <boost/multi_array.hpp>
+#include <boost/optional.hpp>
+#include <boost/program_options.hpp>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <poplar/CycleCount.hpp>
+#include <poplar/Engine.hpp>
+#include <poplar/Graph.hpp>
+#include <poplibs_support/TestDevice.hpp>
+#include <poplibs_test/Util.hpp>
+#include <popnn/Loss.hpp>
+#include <popnn/codelets.hpp>
+#include <popops/codelets.hpp>
+#include <poputil/TileMapping.hpp>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace poplar;
+using namespace poplar::program;
+using namespace poplibs_test::util;
+using namespace poplibs_support;
+
+namespace {
+
+struct Config {
+  std::size_t batchSize;
+  std::size_t numClasses;
+  unsigned k;
+  bool sort;
+  Type dataType;
+  DeviceType deviceType;
+  boost::optional<unsigned> tilesPerIPU;
+  bool profile;
+  bool ignoreData;
+  bool compileOnly;
+};
+
+struct Result {
+  bool matchesModel = true;
+  boost::optional<std::uint64_t> cycles;
+};
+
+Result runTopK(const Config &config, const std::string &method) {
+  const bool compileIPUCode = true;
+  auto device = config.tilesPerIPU
+                    ? createTestDevice(config.deviceType, 1,
+                                       *config.tilesPerIPU, compileIPUCode)
+                    : createTestDeviceFullSize(config.deviceType, 1,
+                                               compileIPUCode);
+  const auto &target = device.getTarget();
+  Graph graph(target);
+  popops::addCodelets(graph);
+  popnn::addCodelets(graph);
+
+  auto input = graph.addVariable(config.dataType,
+                                 {config.batchSize, config.numClasses}, "in");
+  poputil::mapTensorLinearly(graph, input);
+
+  Sequence prog;
+  Tensor indices;
+  auto values = popnn::topK(graph, input, indices, config.k, config.sort, prog,
+                            "topK", {{"method", method}});
+
+  // Count the cycles of the top-k alone on hardware. On a simulated device
+  // the execution profile of the top-k program is used.
+  const bool onHardware = isHw(config.deviceType);
+  Sequence uploadProg, downloadProg;
+  std::vector<std::pair<std::string, char *>> tmap;
+  Tensor cycleCount;
+  std::unique_ptr<char[]> rawCycleCount;
+  if (onHardware) {
+    cycleCount = poplar::cycleCount(graph, prog, 0);
+    rawCycleCount = allocateHostMemoryForTensor(
+        cycleCount, "cycleCount", graph, uploadProg, downloadProg, tmap);
+  }
+  auto rawInput = allocateHostMemoryForTensor(input, "in", graph, uploadProg,
+                                              downloadProg, tmap);
+  auto rawValues = allocateHostMemoryForTensor(values, "values", graph,
+                                               uploadProg, downloadProg, tmap);
+  auto rawIndices = allocateHostMemoryForTensor(
+      indices, "indices", graph, uploadProg, downloadProg, tmap);
+
+  OptionFlags engineOptions;
+  const bool profileCycles =
+      !onHardware && config.deviceType != DeviceType::Cpu;
+  if (config.profile || profileCycles) {
+    engineOptions.set("debug.instrument", "true");
+  }
+  Engine engine(graph, {uploadProg, prog, downloadProg}, engineOptions);
+
+  Result result;
+  if (config.compileOnly) {
+    return result;
+  }
+
+  std::mt19937 randomEngine;
+  boost::multi_array<double, 2> hostInput(
+      boost::extents[config.batchSize][config.numClasses]);
+  writeRandomValues(target, config.dataType, hostInput, -1.0, 1.0,
+                    randomEngine);
+  copy(target, hostInput, config.dataType, rawInput.get());
+  copy(target, config.dataType, rawInput.get(), hostInput);
+
+  device.bind([&](const Device &d) {
+    engine.load(d);
+    attachStreams(engine, tmap);
+    if (!config.ignoreData) {
+      engine.run(0);
+    }
+    if (profileCycles) {
+      engine.resetExecutionProfile();
+    }
+    engine.run(1);
+    if (profileCycles) {
+      result.cycles =
+          engine.getExecutionProfile()["simulation"]["cycles"].asUint();
+    }
+    if (config.profile) {
+      engine.printProfileSummary(std::cout,
+                                 {{"showExecutionSteps", "true"}});
+    }
+    engine.run(2);
+  });
+
+  if (onHardware) {
+    std::uint64_t cycles;
+    std::memcpy(&cycles, rawCycleCount.get(), sizeof(cycles));
+    result.cycles = cycles;
+  }
+
+  if (!config.ignoreData) {
+    boost::multi_array<double, 2> hostValues(
+        boost::extents[config.batchSize][config.k]);
+    boost::multi_array<double, 2> hostIndices(
+        boost::extents[config.batchSize][config.k]);
+    copy(target, config.dataType, rawValues.get(), hostValues);
+    copy(target, UNSIGNED_INT, rawIndices.get(), hostIndices);
+    for (std::size_t b = 0; b < config.batchSize; ++b) {
+      std::vector<double> expected(hostInput[b].begin(), hostInput[b].end());
+      std::sort(expected.begin(), expected.end(), std::greater<double>());
+      std::vector<double> actual(hostValues[b].begin(), hostValues[b].end());
+      if (!config.sort) {
+        std::sort(actual.begin(), actual.end(), std::greater<double>());
+      }
+      for (unsigned i = 0; i < config.k; ++i) {
+        const auto index = static_cast<std::size_t>(hostIndices[b][i]);
+        if (actual[i] != expected[i] || index >= config.numClasses ||
+            hostInput[b][index] != hostValues[b][i]) {
+          std::cerr << "Mismatch in batch " << b << " at position " << i
+                    << "\n";
+          result.matchesModel = false;
+          break;
+        }
+      }
+    }
+  }
+  return result;
+}
+
+} // end anonymous namespace
+
+int main(int argc, char **argv) {
+  namespace po = boost::program_options;
+
+  Config config;
+  config.deviceType = DeviceType::IpuModel2;
+  std::string method;
+
+  po::options_description desc("Options");
+  // clang-format off
+  desc.add_options()
+    ("help", "Produce help message")
+    ("compile-only", "Stop after compilation; don't run the program")
+    ("device-type",
+      po::value<DeviceType>(&config.deviceType)
+        ->default_value(config.deviceType),
+      deviceTypeHelp)
+    ("profile", "Output profiling report to standard output")
+    ("ignore-data", "Don't upload and download the results from the device. "
+     "Note that this means the result is not validated against the model.")
+    ("batch-size",
+     po::value<std::size_t>(&config.batchSize)->default_value(1),
+     "Number of rows of the input")
+    ("num-classes", po::value<std::size_t>(&config.numClasses)->required(),
+     "Number of classes in each row of the input")
+    ("k", po::value<unsigned>(&config.k)->required(),
+     "Number of largest values to find in each row")
+    ("sort", po::value<bool>(&config.sort)->default_value(false),
+     "Sort the results in descending order")
+    ("method", po::value<std::string>(&method)->default_value("compare"),
+     "The topK method: auto | heap | streaming, or compare to run both heap "
+     "and streaming and report their cycles")
+    ("data-type",
+     po::value<Type>(&config.dataType)->default_value(FLOAT),
+     "Type of the input")
+    ("tiles-per-ipu",
+     po::value(&config.tilesPerIPU),
+     "Number of tiles per IPU")
+  ;
+  // clang-format on
+  po::variables_map vm;
+  try {
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    if (vm.count("help")) {
+      std::cout << desc << "\n";
+      return 1;
+    }
+    po::notify(vm);
+  } catch (std::exception &e) {
+    std::cerr << "error: " << e.what() << "\n";
+    return 1;
+  }
+
+  if (config.k == 0 || config.k > config.numClasses) {
+    std::cerr << "error: k must be between 1 and num-classes\n";
+    return 1;
+  }
+  config.profile = vm.count("profile");
+  config.ignoreData = vm.count("ignore-data");
+  config.compileOnly = vm.count("compile-only");
+
+  std::vector<std::string> methods = {method};
+  if (method == "compare") {
+    methods = {"heap", "streaming"};
+  }
+
+  bool matchesModel = true;
+  std::vector<boost::optional<std::uint64_t>> cycles;
+  for (const auto &m : methods) {
+    const auto result = runTopK(config, m);
+    matchesModel &= result.matchesModel;
+    cycles.push_back(result.cycles);
+    if (result.cycles) {
+      std::cout << m << " cycles: " << *result.cycles << "\n";
+    }
+  }
+  if (cycles.size() == 2 && cycles[0] && cycles[1]) {
+    std::cout << "streaming speedup over heap: "
+              << static_cast<double>(*cycles[0]) / *cycles[1] << "\n";
+  }
+
+  if (!matchesModel) {
+    std::cerr << "Validation failed\n";
+    return 1;
+  }
+  return 0;
+}